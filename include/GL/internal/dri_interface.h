@@ -860,7 +860,7 @@ struct __DRIframebufferRec {
  * conjunction with the core extension.
  */
 #define __DRI_SWRAST "DRI_SWRast"
-#define __DRI_SWRAST_VERSION 4
+#define __DRI_SWRAST_VERSION 5
 
 struct __DRIswrastExtensionRec {
     __DRIextension base;
@@ -908,6 +908,16 @@ struct __DRIswrastExtensionRec {
                                     const __DRIconfig ***driver_configs,
                                     void *loaderPrivate);
 
+   /**
+    * swapBuffers() that only presents the damaged parts of the drawable.
+    * The rectangles are x, y, width, height quadruples with a bottom-left
+    * origin, as in EGL_KHR_swap_buffers_with_damage.  Without rectangles
+    * the whole drawable is presented.
+    *
+    * \since version 5
+    */
+   void (*swapBuffersWithDamage)(__DRIdrawable *drawable,
+                                 int nrects, const int *rects);
 };
 
 /** Common DRI function definitions, shared among DRI2 and Image extensions
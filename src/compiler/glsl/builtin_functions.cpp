@@ -84,6 +84,7 @@
 #include <math.h>
 #include "builtin_functions.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 #ifndef M_PIf
 #define M_PIf   ((float) M_PI)
@@ -1001,6 +1002,7 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *lookup(const char *name);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
@@ -1014,10 +1016,31 @@ public:
 private:
    void *mem_ctx;
 
+   /**
+    * Name of the built-in currently being materialized by
+    * create_builtins(), or NULL to only record the names of all built-ins.
+    */
+   const char *lazy_name;
+
+   /** Names of the built-ins that have not been materialized yet. */
+   struct set *pending_names;
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
 
+   /**
+    * Make sure every signature of the built-in \p name exists in
+    * \c shader->symbols.
+    *
+    * Built-in functions are created on first use rather than all at once in
+    * initialize(), since a typical shader only calls a handful of the
+    * several hundred built-ins and generating IR for all of them dominates
+    * the cost of the first shader compile.
+    */
+   void materialize(const char *name);
+   bool want_function(const char *name);
+
    /**
     * IR builder helpers:
     *
@@ -1398,6 +1421,8 @@ builtin_builder::builtin_builder()
    : shader(NULL)
 {
    mem_ctx = NULL;
+   lazy_name = NULL;
+   pending_names = NULL;
 }
 
 builtin_builder::~builtin_builder()
@@ -1426,7 +1451,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = lookup(name);
    if (f == NULL)
       return NULL;
 
@@ -1438,6 +1463,13 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+ir_function *
+builtin_builder::lookup(const char *name)
+{
+   materialize(name);
+   return shader->symbols->get_function(name);
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1448,8 +1480,14 @@ builtin_builder::initialize()
    glsl_type_singleton_init_or_ref();
 
    mem_ctx = ralloc_context(NULL);
+   pending_names = _mesa_set_create(mem_ctx, _mesa_hash_string,
+                                    _mesa_key_string_equal);
    create_shader();
    create_intrinsics();
+
+   /* Only collect the built-in names here; their signatures are created by
+    * materialize() when a shader first refers to them.
+    */
    create_builtins();
 }
 
@@ -1458,6 +1496,7 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   pending_names = NULL;
 
    ralloc_free(shader);
    shader = NULL;
@@ -1465,6 +1504,32 @@ builtin_builder::release()
    glsl_type_singleton_decref();
 }
 
+void
+builtin_builder::materialize(const char *name)
+{
+   struct set_entry *entry = _mesa_set_search(pending_names, name);
+   if (entry == NULL)
+      return;
+
+   lazy_name = (const char *) entry->key;
+   create_builtins();
+   lazy_name = NULL;
+
+   _mesa_set_remove(pending_names, entry);
+}
+
+bool
+builtin_builder::want_function(const char *name)
+{
+   if (lazy_name == NULL) {
+      /* All built-in names are string literals, so no copy is needed. */
+      _mesa_set_add(pending_names, name);
+      return false;
+   }
+
+   return strcmp(name, lazy_name) == 0;
+}
+
 void
 builtin_builder::create_shader()
 {
@@ -1728,6 +1793,18 @@ builtin_builder::create_intrinsics()
                 _is_sparse_texels_resident_intrinsic(), NULL);
 }
 
+/**
+ * Only generate the signatures of the built-in being materialized (or none
+ * at all while collecting names).  The signature constructors are the
+ * add_function() arguments, so the check has to happen before they are
+ * evaluated.
+ */
+#define add_function(NAME, ...)                   \
+   do {                                           \
+      if (want_function(NAME))                    \
+         add_function(NAME, __VA_ARGS__);         \
+   } while (0)
+
 /**
  * Create ir_function and ir_function_signature objects for each built-in.
  *
@@ -5447,6 +5524,8 @@ builtin_builder::create_builtins()
 #undef FIU2_MIXED
 }
 
+#undef add_function
+
 void
 builtin_builder::add_function(const char *name, ...)
 {
@@ -5517,6 +5596,12 @@ builtin_builder::add_image_function(const char *name,
       glsl_type::uimage2DMSArray_type
    };
 
+   /* The intrinsics are called by other built-ins and are always created
+    * up front; only the GLSL-visible stubs are created lazily.
+    */
+   if ((flags & IMAGE_FUNCTION_EMIT_STUB) && !want_function(name))
+      return;
+
    ir_function *f = new(mem_ctx) ir_function(name);
 
    for (unsigned i = 0; i < ARRAY_SIZE(types); ++i) {
@@ -8718,7 +8803,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.lookup(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -8732,10 +8817,15 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    return ret;
 }
 
-gl_shader *
-_mesa_glsl_get_builtin_function_shader()
+ir_function *
+_mesa_glsl_find_builtin_function_by_name(const char *name)
 {
-   return builtins.shader;
+   ir_function *f;
+   mtx_lock(&builtins_lock);
+   f = builtins.lookup(name);
+   mtx_unlock(&builtins_lock);
+
+   return f;
 }
 
 
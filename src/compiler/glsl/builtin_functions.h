@@ -48,8 +48,14 @@ extern bool
 _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state,
                                 const char *name);
 
-extern gl_shader *
-_mesa_glsl_get_builtin_function_shader(void);
+/**
+ * Return every signature of the built-in \p name, creating them if needed.
+ *
+ * Once created, the signatures of a built-in are never modified, so the
+ * result can be walked without holding the built-in lock.
+ */
+extern ir_function *
+_mesa_glsl_find_builtin_function_by_name(const char *name);
 
 extern ir_function_signature *
 _mesa_get_main_function_signature(glsl_symbol_table *symbols);
@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Cold-start cost of the built-in function module: set up the built-ins,
+ * look up the handful of them a typical shader calls and tear everything
+ * down again, which is what the first shader compile of a process pays.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir.h"
+#include "builtin_functions.h"
+#include "util/os_time.h"
+
+static const char *const names[] = {
+   "texture", "dot", "normalize", "max", "clamp", "mix", "pow",
+};
+
+int
+main(int argc, char **argv)
+{
+   const unsigned iterations = argc > 1 ? atoi(argv[1]) : 50;
+
+   int64_t init_time = 0, lookup_time = 0;
+   for (unsigned i = 0; i < iterations; i++) {
+      int64_t start = os_time_get_nano();
+      _mesa_glsl_builtin_functions_init_or_ref();
+      int64_t end = os_time_get_nano();
+      init_time += end - start;
+
+      for (unsigned j = 0; j < ARRAY_SIZE(names); j++) {
+         if (_mesa_glsl_find_builtin_function_by_name(names[j]) == NULL) {
+            fprintf(stderr, "missing built-in %s\n", names[j]);
+            return 1;
+         }
+      }
+      lookup_time += os_time_get_nano() - end;
+
+      _mesa_glsl_builtin_functions_decref();
+   }
+
+   printf("init:   %8.3f ms\n", init_time / 1e6 / iterations);
+   printf("lookup: %8.3f ms (%u built-ins)\n",
+          lookup_time / 1e6 / iterations, (unsigned) ARRAY_SIZE(names));
+   return 0;
+}
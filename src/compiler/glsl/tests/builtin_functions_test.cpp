@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "ir.h"
+#include "builtin_functions.h"
+
+class builtin_functions : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+};
+
+void
+builtin_functions::SetUp()
+{
+   _mesa_glsl_builtin_functions_init_or_ref();
+}
+
+void
+builtin_functions::TearDown()
+{
+   _mesa_glsl_builtin_functions_decref();
+}
+
+static unsigned
+count_signatures(const ir_function *f)
+{
+   unsigned n = 0;
+   foreach_in_list(ir_function_signature, sig, &f->signatures)
+      n++;
+   return n;
+}
+
+TEST_F(builtin_functions, intrinsics_are_created_up_front)
+{
+   ir_function *f =
+      _mesa_glsl_find_builtin_function_by_name("__intrinsic_image_load");
+   ASSERT_NE((ir_function *) NULL, f);
+   EXPECT_NE(0u, count_signatures(f));
+
+   f = _mesa_glsl_find_builtin_function_by_name("__intrinsic_memory_barrier");
+   ASSERT_NE((ir_function *) NULL, f);
+   EXPECT_NE(0u, count_signatures(f));
+}
+
+TEST_F(builtin_functions, materialized_on_first_lookup)
+{
+   ir_function *f = _mesa_glsl_find_builtin_function_by_name("imageLoad");
+   ASSERT_NE((ir_function *) NULL, f);
+
+   const unsigned n = count_signatures(f);
+   EXPECT_NE(0u, n);
+
+   /* A second lookup must not add the signatures again. */
+   EXPECT_EQ(f, _mesa_glsl_find_builtin_function_by_name("imageLoad"));
+   EXPECT_EQ(n, count_signatures(f));
+
+   ASSERT_NE((ir_function *) NULL,
+             _mesa_glsl_find_builtin_function_by_name("texture"));
+   EXPECT_EQ(n, count_signatures(f));
+}
+
+TEST_F(builtin_functions, unknown_name)
+{
+   EXPECT_EQ((ir_function *) NULL,
+             _mesa_glsl_find_builtin_function_by_name("notABuiltin"));
+}
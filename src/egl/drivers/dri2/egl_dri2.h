@@ -35,6 +35,7 @@
 #include <xcb/xcb.h>
 #include <xcb/dri2.h>
 #include <xcb/xfixes.h>
+#include <xcb/shm.h>
 #include <X11/Xlib-xcb.h>
 
 #ifdef HAVE_DRI3
@@ -317,6 +318,12 @@ struct dri2_egl_surface
    int bytes_per_pixel;
    xcb_gcontext_t gc;
    xcb_gcontext_t swapgc;
+   /* MIT-SHM segment of the swrast back buffer, 0 if it can't be attached */
+   int shmid;
+   xcb_shm_seg_t shmseg;
+   /* inside a swap, the round trip after ShmPutImage waits for its end */
+   bool shm_in_swap;
+   bool shm_put_pending;
 #endif
 
 #ifdef HAVE_WAYLAND_PLATFORM
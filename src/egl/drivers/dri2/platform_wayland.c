@@ -2217,6 +2217,7 @@ dri2_initialize_wayland_drm(_EGLDisplay *disp)
    disp->Extensions.EXT_buffer_age = EGL_TRUE;
 
    disp->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+   disp->Extensions.KHR_swap_buffers_with_damage = EGL_TRUE;
 
    disp->Extensions.EXT_present_opaque = EGL_TRUE;
 
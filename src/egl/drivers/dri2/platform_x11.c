@@ -76,6 +76,8 @@ swrastCreateDrawable(struct dri2_egl_display * dri2_dpy,
    valgc[0] = function;
    valgc[1] = False;
    xcb_create_gc(dri2_dpy->conn, dri2_surf->swapgc, dri2_surf->drawable, mask, valgc);
+   dri2_surf->shmid = -1;
+   dri2_surf->shmseg = 0;
    switch (dri2_surf->depth) {
       case 32:
       case 30:
@@ -102,6 +104,8 @@ swrastDestroyDrawable(struct dri2_egl_display * dri2_dpy,
 {
    xcb_free_gc(dri2_dpy->conn, dri2_surf->gc);
    xcb_free_gc(dri2_dpy->conn, dri2_surf->swapgc);
+   if (dri2_surf->shmseg)
+      xcb_shm_detach(dri2_dpy->conn, dri2_surf->shmseg);
 }
 
 static bool
@@ -146,36 +150,182 @@ swrastGetDrawableInfo(__DRIdrawable * draw,
    x11_get_drawable_info(draw, x, y, w, h, loaderPrivate);
 }
 
+static xcb_gcontext_t
+swrast_gc_for_op(struct dri2_egl_surface *dri2_surf, int op)
+{
+   switch (op) {
+   case __DRI_SWRAST_IMAGE_OP_DRAW:
+      return dri2_surf->gc;
+   case __DRI_SWRAST_IMAGE_OP_SWAP:
+      return dri2_surf->swapgc;
+   default:
+      return 0;
+   }
+}
+
+/**
+ * Send an image with xcb_put_image, in as few requests as the maximum
+ * request length allows.
+ */
+static void
+swrast_put_image(struct dri2_egl_display *dri2_dpy,
+                 struct dri2_egl_surface *dri2_surf, xcb_gcontext_t gc,
+                 int x, int y, int w, int h, int stride, const char *data)
+{
+   const int row_bytes = w * dri2_surf->bytes_per_pixel;
+   /* in units of 4 bytes, and leave room for the request header */
+   const uint32_t max_req = xcb_get_maximum_request_length(dri2_dpy->conn);
+   const uint32_t max_bytes = (max_req - 8) * 4;
+   int rows_per_req = 1;
+
+   /* Rows are padded to 32 bits, so only send several at once when the
+    * stride matches that padding.
+    */
+   if (row_bytes > 0 && stride == row_bytes && row_bytes % 4 == 0)
+      rows_per_req = MAX2(max_bytes / row_bytes, 1);
+
+   for (int row = 0; row < h; row += rows_per_req) {
+      const int rows = MIN2(rows_per_req, h - row);
+
+      xcb_put_image(dri2_dpy->conn, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                    dri2_surf->drawable, gc, w, rows, x, y + row, 0,
+                    dri2_surf->depth, rows * row_bytes,
+                    (const uint8_t *)data + row * stride);
+   }
+}
+
+static void
+swrastPutImage2(__DRIdrawable * draw, int op,
+                int x, int y, int w, int h, int stride,
+                char *data, void *loaderPrivate)
+{
+   struct dri2_egl_surface *dri2_surf = loaderPrivate;
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(dri2_surf->base.Resource.Display);
+   xcb_gcontext_t gc = swrast_gc_for_op(dri2_surf, op);
+
+   if (!gc)
+      return;
+
+   swrast_put_image(dri2_dpy, dri2_surf, gc, x, y, w, h, stride, data);
+}
+
 static void
 swrastPutImage(__DRIdrawable * draw, int op,
                int x, int y, int w, int h,
                char *data, void *loaderPrivate)
 {
    struct dri2_egl_surface *dri2_surf = loaderPrivate;
+
+   swrastPutImage2(draw, op, x, y, w, h, w * dri2_surf->bytes_per_pixel,
+                   data, loaderPrivate);
+}
+
+/**
+ * Attach the driver's shared memory back buffer to the X server, once per
+ * segment.  Returns false when the server can't use it, e.g. when it
+ * isn't on the same machine.
+ */
+static bool
+swrast_attach_shm(struct dri2_egl_display *dri2_dpy,
+                  struct dri2_egl_surface *dri2_surf, int shmid)
+{
+   xcb_void_cookie_t cookie;
+   xcb_generic_error_t *error;
+
+   if (shmid == dri2_surf->shmid)
+      return dri2_surf->shmseg != 0;
+
+   if (dri2_surf->shmseg)
+      xcb_shm_detach(dri2_dpy->conn, dri2_surf->shmseg);
+
+   dri2_surf->shmid = shmid;
+   dri2_surf->shmseg = xcb_generate_id(dri2_dpy->conn);
+
+   cookie = xcb_shm_attach_checked(dri2_dpy->conn, dri2_surf->shmseg,
+                                   shmid, true);
+   error = xcb_request_check(dri2_dpy->conn, cookie);
+   if (error) {
+      _eglLog(_EGL_DEBUG, "xcb_shm_attach failed, copying instead");
+      dri2_surf->shmseg = 0;
+      free(error);
+   }
+
+   return dri2_surf->shmseg != 0;
+}
+
+/**
+ * Wait until the server has read the segment of the last ShmPutImage, as
+ * the driver renders into it again once the put or the swap returns.
+ */
+static void
+swrast_sync_shm(struct dri2_egl_display *dri2_dpy,
+                struct dri2_egl_surface *dri2_surf)
+{
+   if (!dri2_surf->shm_put_pending)
+      return;
+
+   free(xcb_get_input_focus_reply(dri2_dpy->conn,
+                                  xcb_get_input_focus(dri2_dpy->conn), NULL));
+   dri2_surf->shm_put_pending = false;
+}
+
+static void
+swrast_put_image_shm(__DRIdrawable * draw, int op, int srcx,
+                     int x, int y, int w, int h, int stride,
+                     int shmid, char *shmaddr, unsigned offset,
+                     void *loaderPrivate)
+{
+   struct dri2_egl_surface *dri2_surf = loaderPrivate;
    struct dri2_egl_display *dri2_dpy = dri2_egl_display(dri2_surf->base.Resource.Display);
+   xcb_gcontext_t gc = swrast_gc_for_op(dri2_surf, op);
 
-   xcb_gcontext_t gc;
+   if (!gc || !dri2_surf->bytes_per_pixel)
+      return;
 
-   switch (op) {
-   case __DRI_SWRAST_IMAGE_OP_DRAW:
-      gc = dri2_surf->gc;
-      break;
-   case __DRI_SWRAST_IMAGE_OP_SWAP:
-      gc = dri2_surf->swapgc;
-      break;
-   default:
+   if (!swrast_attach_shm(dri2_dpy, dri2_surf, shmid)) {
+      swrast_put_image(dri2_dpy, dri2_surf, gc, x, y, w, h, stride,
+                       shmaddr + offset + srcx * dri2_surf->bytes_per_pixel);
       return;
    }
 
-   xcb_put_image(dri2_dpy->conn, XCB_IMAGE_FORMAT_Z_PIXMAP, dri2_surf->drawable,
-                 gc, w, h, x, y, 0, dri2_surf->depth,
-                 w*h*dri2_surf->bytes_per_pixel, (const uint8_t *)data);
+   xcb_shm_put_image(dri2_dpy->conn, dri2_surf->drawable, gc,
+                     stride / dri2_surf->bytes_per_pixel, h,
+                     srcx, 0, w, h, x, y, dri2_surf->depth,
+                     XCB_IMAGE_FORMAT_Z_PIXMAP, 0, dri2_surf->shmseg,
+                     offset);
+
+   /* A swap puts every damage rectangle before the driver renders again,
+    * so it syncs once at its end.
+    */
+   dri2_surf->shm_put_pending = true;
+   if (!dri2_surf->shm_in_swap)
+      swrast_sync_shm(dri2_dpy, dri2_surf);
 }
 
 static void
-swrastGetImage(__DRIdrawable * read,
-               int x, int y, int w, int h,
-               char *data, void *loaderPrivate)
+swrastPutImageShm(__DRIdrawable * draw, int op,
+                  int x, int y, int w, int h, int stride,
+                  int shmid, char *shmaddr, unsigned offset,
+                  void *loaderPrivate)
+{
+   swrast_put_image_shm(draw, op, 0, x, y, w, h, stride,
+                        shmid, shmaddr, offset, loaderPrivate);
+}
+
+static void
+swrastPutImageShm2(__DRIdrawable * draw, int op,
+                   int x, int y, int w, int h, int stride,
+                   int shmid, char *shmaddr, unsigned offset,
+                   void *loaderPrivate)
+{
+   swrast_put_image_shm(draw, op, x, x, y, w, h, stride,
+                        shmid, shmaddr, offset, loaderPrivate);
+}
+
+static void
+swrastGetImage2(__DRIdrawable * read,
+                int x, int y, int w, int h, int stride,
+                char *data, void *loaderPrivate)
 {
    struct dri2_egl_surface *dri2_surf = loaderPrivate;
    struct dri2_egl_display *dri2_dpy = dri2_egl_display(dri2_surf->base.Resource.Display);
@@ -194,13 +344,31 @@ swrastGetImage(__DRIdrawable * read,
       _eglLog(_EGL_WARNING, "error in xcb_get_image");
       free(error);
    } else {
-      uint32_t bytes = xcb_get_image_data_length(reply);
-      uint8_t *idata = xcb_get_image_data(reply);
-      memcpy(data, idata, bytes);
+      const uint32_t bytes = xcb_get_image_data_length(reply);
+      const uint8_t *idata = xcb_get_image_data(reply);
+      const int row_bytes = w * dri2_surf->bytes_per_pixel;
+      const int src_stride = ALIGN_POT(row_bytes, 4);
+      const int rows = src_stride ? MIN2(h, (int)(bytes / src_stride)) : 0;
+
+      /* The reply rows are padded to 32 bits. */
+      for (int row = 0; row < rows; row++)
+         memcpy(data + row * stride, idata + row * src_stride, row_bytes);
    }
    free(reply);
 }
 
+static void
+swrastGetImage(__DRIdrawable * read,
+               int x, int y, int w, int h,
+               char *data, void *loaderPrivate)
+{
+   struct dri2_egl_surface *dri2_surf = loaderPrivate;
+
+   swrastGetImage2(read, x, y, w, h,
+                   ALIGN_POT(w * dri2_surf->bytes_per_pixel, 4),
+                   data, loaderPrivate);
+}
+
 
 static xcb_screen_t *
 get_xcb_screen(xcb_screen_iterator_t iter, int screen)
@@ -930,6 +1098,25 @@ dri2_x11_swap_buffers_msc(_EGLDisplay *disp, _EGLSurface *draw,
    return swap_count;
 }
 
+/**
+ * Swap a swrast drawable, limited to the damage rectangles if any.
+ */
+static void
+dri2_x11_swrast_swap(struct dri2_egl_display *dri2_dpy,
+                     struct dri2_egl_surface *dri2_surf,
+                     const EGLint *rects, EGLint n_rects)
+{
+   dri2_surf->shm_in_swap = true;
+   if (rects)
+      dri2_dpy->swrast->swapBuffersWithDamage(dri2_surf->dri_drawable,
+                                              n_rects, rects);
+   else
+      dri2_dpy->core->swapBuffers(dri2_surf->dri_drawable);
+   dri2_surf->shm_in_swap = false;
+
+   swrast_sync_shm(dri2_dpy, dri2_surf);
+}
+
 static EGLBoolean
 dri2_x11_swap_buffers(_EGLDisplay *disp, _EGLSurface *draw)
 {
@@ -937,7 +1124,7 @@ dri2_x11_swap_buffers(_EGLDisplay *disp, _EGLSurface *draw)
    struct dri2_egl_surface *dri2_surf = dri2_egl_surface(draw);
 
    if (!dri2_dpy->flush) {
-      dri2_dpy->core->swapBuffers(dri2_surf->dri_drawable);
+      dri2_x11_swrast_swap(dri2_dpy, dri2_surf, NULL, 0);
       return EGL_TRUE;
    }
 
@@ -948,6 +1135,19 @@ dri2_x11_swap_buffers(_EGLDisplay *disp, _EGLSurface *draw)
    return EGL_TRUE;
 }
 
+static EGLBoolean
+dri2_x11_swrast_swap_buffers_with_damage(_EGLDisplay *disp,
+                                         _EGLSurface *draw,
+                                         const EGLint *rects,
+                                         EGLint n_rects)
+{
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(disp);
+   struct dri2_egl_surface *dri2_surf = dri2_egl_surface(draw);
+
+   dri2_x11_swrast_swap(dri2_dpy, dri2_surf, rects, n_rects);
+   return EGL_TRUE;
+}
+
 static EGLBoolean
 dri2_x11_swap_buffers_region(_EGLDisplay *disp, _EGLSurface *draw,
                              EGLint numRects, const EGLint *rects)
@@ -1226,6 +1426,24 @@ static const struct dri2_egl_display_vtbl dri2_x11_swrast_display_vtbl = {
    .get_dri_drawable = dri2_surface_get_dri_drawable,
 };
 
+/* Same as above, for drivers that can present only the damage. */
+static const struct dri2_egl_display_vtbl dri2_x11_swrast_damage_display_vtbl = {
+   .authenticate = NULL,
+   .create_window_surface = dri2_x11_create_window_surface,
+   .create_pixmap_surface = dri2_x11_create_pixmap_surface,
+   .create_pbuffer_surface = dri2_x11_create_pbuffer_surface,
+   .destroy_surface = dri2_x11_destroy_surface,
+   .create_image = dri2_create_image_khr,
+   .swap_buffers = dri2_x11_swap_buffers,
+   .swap_buffers_with_damage = dri2_x11_swrast_swap_buffers_with_damage,
+   .swap_buffers_region = dri2_x11_swap_buffers_region,
+   .post_sub_buffer = dri2_x11_post_sub_buffer,
+   .copy_buffers = dri2_x11_copy_buffers,
+   /* XXX: should really implement this since X11 has pixmaps */
+   .query_surface = dri2_query_surface,
+   .get_dri_drawable = dri2_surface_get_dri_drawable,
+};
+
 static const struct dri2_egl_display_vtbl dri2_x11_kopper_display_vtbl = {
    .authenticate = NULL,
    .create_window_surface = dri2_kopper_create_window_surface,
@@ -1261,11 +1479,26 @@ static const struct dri2_egl_display_vtbl dri2_x11_display_vtbl = {
 };
 
 static const __DRIswrastLoaderExtension swrast_loader_extension = {
-   .base = { __DRI_SWRAST_LOADER, 1 },
+   .base = { __DRI_SWRAST_LOADER, 3 },
+
+   .getDrawableInfo = swrastGetDrawableInfo,
+   .putImage        = swrastPutImage,
+   .getImage        = swrastGetImage,
+   .putImage2       = swrastPutImage2,
+   .getImage2       = swrastGetImage2,
+};
+
+/* getImageShm is left out, the driver then reads back with getImage2. */
+static const __DRIswrastLoaderExtension swrast_loader_shm_extension = {
+   .base = { __DRI_SWRAST_LOADER, 5 },
 
    .getDrawableInfo = swrastGetDrawableInfo,
    .putImage        = swrastPutImage,
    .getImage        = swrastGetImage,
+   .putImage2       = swrastPutImage2,
+   .getImage2       = swrastGetImage2,
+   .putImageShm     = swrastPutImageShm,
+   .putImageShm2    = swrastPutImageShm2,
 };
 
 static void
@@ -1297,6 +1530,42 @@ static const __DRIextension *swrast_loader_extensions[] = {
    NULL,
 };
 
+static const __DRIextension *swrast_loader_shm_extensions[] = {
+   &swrast_loader_shm_extension.base,
+   &image_lookup_extension.base,
+   &kopper_loader_extension.base,
+   NULL,
+};
+
+/**
+ * Whether the X server can attach our shared memory segments.
+ */
+static bool
+dri2_x11_check_xshm(struct dri2_egl_display *dri2_dpy)
+{
+   const xcb_query_extension_reply_t *extension;
+   xcb_void_cookie_t cookie;
+   xcb_generic_error_t *error;
+   bool ret = true;
+
+   xcb_prefetch_extension_data(dri2_dpy->conn, &xcb_shm_id);
+   extension = xcb_get_extension_data(dri2_dpy->conn, &xcb_shm_id);
+   if (!(extension && extension->present))
+      return false;
+
+   cookie = xcb_shm_detach_checked(dri2_dpy->conn, 0);
+   if ((error = xcb_request_check(dri2_dpy->conn, cookie))) {
+      /* BadRequest means we're a remote client. If we were local we'd
+       * expect BadValue since 'info' has an invalid segment name.
+       */
+      if (error->error_code == XCB_REQUEST)
+         ret = false;
+      free(error);
+   }
+
+   return ret;
+}
+
 static int
 dri2_find_screen_for_display(const _EGLDisplay *disp, int fallback_screen)
 {
@@ -1412,7 +1681,13 @@ dri2_initialize_x11_swrast(_EGLDisplay *disp)
    if (!dri2_load_driver_swrast(disp))
       goto cleanup;
 
-   dri2_dpy->loader_extensions = swrast_loader_extensions;
+   /* With MIT-SHM the driver allocates its back buffers in segments the
+    * server reads directly, instead of us copying them over the socket.
+    */
+   if (!disp->Options.Zink && dri2_x11_check_xshm(dri2_dpy))
+      dri2_dpy->loader_extensions = swrast_loader_shm_extensions;
+   else
+      dri2_dpy->loader_extensions = swrast_loader_extensions;
 
    if (!dri2_create_screen(disp))
       goto cleanup;
@@ -1434,10 +1709,19 @@ dri2_initialize_x11_swrast(_EGLDisplay *disp)
       disp->Extensions.CHROMIUM_sync_control = EGL_TRUE;
       disp->Extensions.EXT_buffer_age = EGL_TRUE;
       disp->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+      disp->Extensions.KHR_swap_buffers_with_damage = EGL_TRUE;
 
       //dri2_set_WL_bind_wayland_display(disp);
    }
 
+   const bool has_damage = !disp->Options.Zink &&
+                           dri2_dpy->swrast->base.version >= 5 &&
+                           dri2_dpy->swrast->swapBuffersWithDamage;
+   if (has_damage) {
+      disp->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+      disp->Extensions.KHR_swap_buffers_with_damage = EGL_TRUE;
+   }
+
    if (!dri2_x11_add_configs_for_visuals(dri2_dpy, disp, true))
       goto cleanup;
 
@@ -1446,6 +1730,8 @@ dri2_initialize_x11_swrast(_EGLDisplay *disp)
     */
    if (disp->Options.Zink)
       dri2_dpy->vtbl = &dri2_x11_kopper_display_vtbl;
+   else if (has_damage)
+      dri2_dpy->vtbl = &dri2_x11_swrast_damage_display_vtbl;
    else
       dri2_dpy->vtbl = &dri2_x11_swrast_display_vtbl;
 
@@ -1515,6 +1801,7 @@ dri2_initialize_x11_dri3(_EGLDisplay *disp)
    disp->Extensions.CHROMIUM_sync_control = EGL_TRUE;
    disp->Extensions.EXT_buffer_age = EGL_TRUE;
    disp->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+   disp->Extensions.KHR_swap_buffers_with_damage = EGL_TRUE;
 
    dri2_set_WL_bind_wayland_display(disp);
 
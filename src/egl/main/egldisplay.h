@@ -139,6 +139,7 @@ struct _egl_extensions
    EGLBoolean KHR_partial_update;
    EGLBoolean KHR_reusable_sync;
    EGLBoolean KHR_surfaceless_context;
+   EGLBoolean KHR_swap_buffers_with_damage;
    EGLBoolean KHR_wait_sync;
 
    EGLBoolean MESA_drm_image;
@@ -118,6 +118,17 @@ struct cso_context {
    unsigned min_samples, min_samples_saved;
    struct pipe_stencil_ref stencil_ref, stencil_ref_saved;
 
+   /* Templates of the last states bound through cso_set_*(), and the
+    * handles they resulted in.  If the same template is set again while its
+    * handle is still bound, hashing and looking up the template is skipped.
+    */
+   struct pipe_blend_state blend_templ;
+   void *blend_templ_handle;
+   struct pipe_depth_stencil_alpha_state depth_stencil_templ;
+   void *depth_stencil_templ_handle;
+   struct pipe_rasterizer_state rasterizer_templ;
+   void *rasterizer_templ_handle;
+
    /* This should be last to keep all of the above together in memory. */
    struct cso_cache cache;
 };
@@ -440,6 +451,11 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
+
+   if (ctx->blend && ctx->blend == ctx->blend_templ_handle &&
+       memcmp(&ctx->blend_templ, templ, key_size) == 0)
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)templ, key_size);
    iter = cso_find_state_template(&ctx->cache, hash_key, CSO_BLEND,
                                   (void*)templ, key_size);
@@ -469,6 +485,8 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       ctx->blend = handle;
       ctx->pipe->bind_blend_state(ctx->pipe, handle);
    }
+   memcpy(&ctx->blend_templ, templ, key_size);
+   ctx->blend_templ_handle = handle;
    return PIPE_OK;
 }
 
@@ -496,6 +514,12 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
+
+   if (ctx->depth_stencil &&
+       ctx->depth_stencil == ctx->depth_stencil_templ_handle &&
+       memcmp(&ctx->depth_stencil_templ, templ, key_size) == 0)
+      return PIPE_OK;
+
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
    struct cso_hash_iter iter = cso_find_state_template(&ctx->cache,
                                                        hash_key,
@@ -531,6 +555,8 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
       ctx->depth_stencil = handle;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
    }
+   ctx->depth_stencil_templ = *templ;
+   ctx->depth_stencil_templ_handle = handle;
    return PIPE_OK;
 }
 
@@ -558,6 +584,11 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
+
+   if (ctx->rasterizer && ctx->rasterizer == ctx->rasterizer_templ_handle &&
+       memcmp(&ctx->rasterizer_templ, templ, key_size) == 0)
+      return PIPE_OK;
+
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
    struct cso_hash_iter iter = cso_find_state_template(&ctx->cache,
                                                        hash_key,
@@ -597,6 +628,8 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          u_vbuf_set_flatshade_first(ctx->vbuf, ctx->flatshade_first);
       ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
    }
+   ctx->rasterizer_templ = *templ;
+   ctx->rasterizer_templ_handle = handle;
    return PIPE_OK;
 }
 
@@ -1213,8 +1246,19 @@ cso_set_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
                 unsigned idx, const struct pipe_sampler_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_sampler_state);
+   struct cso_sampler *cso = ctx->samplers[shader_stage].cso_samplers[idx];
+
+   /* The same template as the sampler already in this slot, which the
+    * cache keeps alive while it is there: skip hashing and the lookup.
+    * The states are still bound again by cso_single_sampler_done(), since
+    * blitters bind samplers without going through the cso context.
+    */
+   if (cso && memcmp(&cso->state, templ, key_size) == 0) {
+      ctx->samplers[shader_stage].samplers[idx] = cso->data;
+      return true;
+   }
+
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_sampler *cso;
    struct cso_hash_iter iter =
       cso_find_state_template(&ctx->cache,
                               hash_key, CSO_SAMPLER,
@@ -1174,7 +1174,8 @@ draw_set_mapped_texture(struct draw_context *draw,
                         const void *base_ptr,
                         uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                         uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
-                        uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS])
+                        uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS],
+                        boolean tiled)
 {
 #ifdef DRAW_LLVM_AVAILABLE
    if (draw->llvm)
@@ -1183,7 +1184,8 @@ draw_set_mapped_texture(struct draw_context *draw,
                                    sview_idx,
                                    width, height, depth, first_level,
                                    last_level, num_samples, sample_stride, base_ptr,
-                                   row_stride, img_stride, mip_offsets);
+                                   row_stride, img_stride, mip_offsets,
+                                   tiled);
 #endif
 }
 
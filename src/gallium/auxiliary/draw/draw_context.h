@@ -206,7 +206,8 @@ draw_set_mapped_texture(struct draw_context *draw,
                         const void *base,
                         uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                         uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
-                        uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS]);
+                        uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS],
+                        boolean tiled);
 
 void
 draw_set_mapped_image(struct draw_context *draw,
@@ -2457,6 +2457,9 @@ draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_VERTEX][i]);
+      draw_sampler[i].texture_state.tiled =
+         llvm->draw->sampler_views[PIPE_SHADER_VERTEX][i] &&
+         llvm->tiled_textures[PIPE_SHADER_VERTEX][i];
    }
 
    draw_image = draw_llvm_variant_key_images(key);
@@ -2513,7 +2516,8 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
                              const void *base_ptr,
                              uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
-                             uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS])
+                             uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS],
+                             boolean tiled)
 {
    unsigned j;
    struct draw_jit_texture *jit_tex;
@@ -2548,6 +2552,7 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
    jit_tex->base = base_ptr;
    jit_tex->num_samples = num_samples;
    jit_tex->sample_stride = sample_stride;
+   draw->llvm->tiled_textures[shader_stage][sview_idx] = tiled;
 
    for (j = first_level; j <= last_level; j++) {
       jit_tex->mip_offsets[j] = mip_offsets[j];
@@ -3056,6 +3061,9 @@ draw_gs_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_GEOMETRY][i]);
+      draw_sampler[i].texture_state.tiled =
+         llvm->draw->sampler_views[PIPE_SHADER_GEOMETRY][i] &&
+         llvm->tiled_textures[PIPE_SHADER_GEOMETRY][i];
    }
 
    draw_image = draw_gs_llvm_variant_key_images(key);
@@ -3718,6 +3726,9 @@ draw_tcs_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_TESS_CTRL][i]);
+      draw_sampler[i].texture_state.tiled =
+         llvm->draw->sampler_views[PIPE_SHADER_TESS_CTRL][i] &&
+         llvm->tiled_textures[PIPE_SHADER_TESS_CTRL][i];
    }
 
    draw_image = draw_tcs_llvm_variant_key_images(key);
@@ -4254,6 +4265,9 @@ draw_tes_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_TESS_EVAL][i]);
+      draw_sampler[i].texture_state.tiled =
+         llvm->draw->sampler_views[PIPE_SHADER_TESS_EVAL][i] &&
+         llvm->tiled_textures[PIPE_SHADER_TESS_EVAL][i];
    }
 
    draw_image = draw_tes_llvm_variant_key_images(key);
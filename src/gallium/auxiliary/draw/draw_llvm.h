@@ -818,6 +818,9 @@ struct draw_llvm {
    struct draw_tcs_jit_context tcs_jit_context;
    struct draw_tes_jit_context tes_jit_context;
 
+   /** Layout of the mapped textures, see lp_static_texture_state::tiled */
+   boolean tiled_textures[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
    struct draw_llvm_variant_list_item vs_variants_list;
    int nr_variants;
 
@@ -942,7 +945,8 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
                              const void *base_ptr,
                              uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
-                             uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS]);
+                             uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS],
+                             boolean tiled);
 
 void
 draw_llvm_set_mapped_image(struct draw_context *draw,
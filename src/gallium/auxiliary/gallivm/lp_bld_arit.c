@@ -82,6 +82,17 @@
 #define LOG_POLY_DEGREE 4
 
 
+/**
+ * Whether the type fills exactly one AVX-512 zmm register.
+ */
+static inline boolean
+arch_avx512_type(const struct lp_type type)
+{
+   return util_get_cpu_caps()->has_avx512f &&
+          type.width * type.length == 512;
+}
+
+
 /**
  * Generate min(a, b)
  * No checks for special case values of a or b = 1 or 0 are done.
@@ -104,7 +115,13 @@ lp_build_min_simple(struct lp_build_context *bld,
 
    /* TODO: optimize the constant case */
 
-   if (type.floating && util_get_cpu_caps()->has_sse) {
+   /*
+    * The 512bit min intrinsics take an extra rounding argument, so aren't
+    * usable here, but the compare/select below matches vminps/vminpd
+    * on zmm registers anyway (rather than splitting in 256bit halves).
+    */
+   if (type.floating && util_get_cpu_caps()->has_sse &&
+       !arch_avx512_type(type)) {
       if (type.width == 32) {
          if (type.length == 1) {
             intrinsic = "llvm.x86.sse.min.ss";
@@ -258,7 +275,9 @@ lp_build_max_simple(struct lp_build_context *bld,
 
    /* TODO: optimize the constant case */
 
-   if (type.floating && util_get_cpu_caps()->has_sse) {
+   /* See lp_build_min_simple() for 512bit vectors. */
+   if (type.floating && util_get_cpu_caps()->has_sse &&
+       !arch_avx512_type(type)) {
       if (type.width == 32) {
          if (type.length == 1) {
             intrinsic = "llvm.x86.sse.max.ss";
@@ -1368,6 +1387,9 @@ lp_build_lerp_simple(struct lp_build_context *bld,
          } else if (bld->type.width == 16 && bld->type.length == 16 && util_get_cpu_caps()->has_avx2) {
             res = lp_build_intrinsic_binary(builder, "llvm.x86.avx2.pmul.hr.sw", bld->vec_type, x, lp_build_shl_imm(bld, delta, 7));
             res = lp_build_and(bld, res, lp_build_const_int_vec(bld->gallivm, bld->type, 0xff));
+         } else if (bld->type.width == 16 && bld->type.length == 32 && util_get_cpu_caps()->has_avx512bw) {
+            res = lp_build_intrinsic_binary(builder, "llvm.x86.avx512.pmul.hr.sw.512", bld->vec_type, x, lp_build_shl_imm(bld, delta, 7));
+            res = lp_build_and(bld, res, lp_build_const_int_vec(bld->gallivm, bld->type, 0xff));
          } else {
             res = lp_build_mul(bld, x, delta);
             res = lp_build_shr_imm(bld, res, half_width);
@@ -1941,12 +1963,25 @@ lp_build_iround_nearest_sse2(struct lp_build_context *bld,
       if (type.width* type.length == 128) {
          intrinsic = "llvm.x86.sse2.cvtps2dq";
       }
-      else {
-         assert(type.width*type.length == 256);
+      else if (type.width*type.length == 256) {
          assert(util_get_cpu_caps()->has_avx);
 
          intrinsic = "llvm.x86.avx.cvt.ps2dq.256";
       }
+      else {
+         LLVMValueRef args[4];
+
+         assert(type.width*type.length == 512);
+         assert(util_get_cpu_caps()->has_avx512f);
+
+         /* unmasked, with the current (MXCSR) rounding mode */
+         args[0] = a;
+         args[1] = LLVMGetUndef(ret_type);
+         args[2] = LLVMConstAllOnes(LLVMInt16TypeInContext(bld->gallivm->context));
+         args[3] = LLVMConstInt(i32t, 4, 0);
+         return lp_build_intrinsic(builder, "llvm.x86.avx512.mask.cvtps2dq.512",
+                                   ret_type, args, 4, 0);
+      }
       res = lp_build_intrinsic_unary(builder, intrinsic,
                                      ret_type, a);
    }
@@ -2376,7 +2411,8 @@ lp_build_iround(struct lp_build_context *bld,
 
    if ((util_get_cpu_caps()->has_sse2 &&
        ((type.width == 32) && (type.length == 1 || type.length == 4))) ||
-       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8)) {
+       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8) ||
+       (util_get_cpu_caps()->has_avx512f && type.width == 32 && type.length == 16)) {
       return lp_build_iround_nearest_sse2(bld, a);
    }
    if (arch_rounding_available(type)) {
@@ -2782,7 +2818,8 @@ lp_build_fast_rsqrt_available(struct lp_type type)
    assert(type.floating);
 
    if ((util_get_cpu_caps()->has_sse && type.width == 32 && type.length == 4) ||
-       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8)) {
+       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8) ||
+       (util_get_cpu_caps()->has_avx512f && type.width == 32 && type.length == 16)) {
       return true;
    }
    return false;
@@ -2810,9 +2847,18 @@ lp_build_fast_rsqrt(struct lp_build_context *bld,
       if (type.length == 4) {
          intrinsic = "llvm.x86.sse.rsqrt.ps";
       }
-      else {
+      else if (type.length == 8) {
          intrinsic = "llvm.x86.avx.rsqrt.ps.256";
       }
+      else {
+         /* rsqrt14, unmasked: more precise than the above */
+         LLVMValueRef args[3];
+         args[0] = a;
+         args[1] = bld->undef;
+         args[2] = LLVMConstAllOnes(LLVMInt16TypeInContext(bld->gallivm->context));
+         return lp_build_intrinsic(builder, "llvm.x86.avx512.rsqrt14.ps.512",
+                                   bld->vec_type, args, 3, 0);
+      }
       return lp_build_intrinsic_unary(builder, intrinsic, bld->vec_type, a);
    }
    else {
@@ -519,6 +519,17 @@ int lp_build_conv_auto(struct gallivm_state *gallivm,
          lp_build_conv(gallivm, src_type, *dst_type, src, num_srcs, dst, num_dsts);
          return num_dsts;
       }
+
+      /* Special case 1x16x32 --> 1x16x8 */
+      if (src_type.length == 16 &&
+          util_get_cpu_caps()->has_avx512f)
+      {
+         num_dsts = num_srcs;
+         dst_type->length = 16;
+
+         lp_build_conv(gallivm, src_type, *dst_type, src, num_srcs, dst, num_dsts);
+         return num_dsts;
+      }
    }
 
    /* lp_build_resize does not support M:N */
@@ -789,6 +800,71 @@ lp_build_conv(struct gallivm_state *gallivm,
       return;
    }
 
+   /* Special case 1x16x32 --> 1x16x8
+    */
+   else if (src_type.norm     == 0 &&
+       src_type.width    == 32 &&
+       src_type.length   == 16 &&
+       src_type.fixed    == 0 &&
+
+       dst_type.floating == 0 &&
+       dst_type.fixed    == 0 &&
+       dst_type.width    == 8 &&
+       dst_type.length   == 16 &&
+
+       ((src_type.floating == 1 && src_type.sign == 1 && dst_type.norm == 1) ||
+        (src_type.floating == 0 && dst_type.floating == 0 &&
+         src_type.sign == dst_type.sign && dst_type.norm == 0)) &&
+
+       num_srcs == num_dsts &&
+
+       util_get_cpu_caps()->has_avx512f) {
+
+      struct lp_build_context bld, int32_bld;
+      LLVMTypeRef dst_vec_type = lp_build_vec_type(gallivm, dst_type);
+      LLVMValueRef const_scale;
+      LLVMValueRef min_val, max_val;
+
+      lp_build_context_init(&bld, gallivm, src_type);
+      lp_build_context_init(&int32_bld, gallivm,
+                            lp_type_int_vec(32, 32 * src_type.length));
+
+      const_scale = lp_build_const_vec(gallivm, src_type, lp_const_scale(dst_type));
+      min_val = lp_build_const_int_vec(gallivm, int32_bld.type,
+                                       dst_type.sign ? -128 : 0);
+      max_val = lp_build_const_int_vec(gallivm, int32_bld.type,
+                                       dst_type.sign ? 127 : 255);
+
+      /*
+       * Instead of going through the 128bit packs, clamp explicitly and
+       * let the truncation become a single vpmovdb.
+       */
+      for (i = 0; i < num_dsts; ++i) {
+         LLVMValueRef a = src[i];
+
+         if (src_type.floating) {
+            if (dst_type.sign) {
+               a = lp_build_min(&bld, bld.one, a);
+            }
+            else {
+               a = lp_build_min_ext(&bld, bld.one, a,
+                                    GALLIVM_NAN_RETURN_NAN_FIRST_NONNAN);
+            }
+            a = LLVMBuildFMul(builder, a, const_scale, "");
+            a = lp_build_iround(&bld, a);
+            a = lp_build_clamp(&int32_bld, a, min_val, max_val);
+         } else if (!dst_type.sign) {
+            a = lp_build_min(&bld, a,
+                             lp_build_const_int_vec(gallivm, src_type, 255));
+         } else {
+            a = lp_build_clamp(&int32_bld, a, min_val, max_val);
+         }
+         dst[i] = LLVMBuildTrunc(builder, a, dst_vec_type, "");
+      }
+
+      return;
+   }
+
    /* Special case -> 16bit half-float
     */
    else if (dst_type.floating && dst_type.width == 16)
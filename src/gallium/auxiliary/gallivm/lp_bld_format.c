@@ -26,6 +26,7 @@
  **************************************************************************/
 
 
+#include "util/format/u_format.h"
 #include "lp_bld_format.h"
 
 
@@ -54,3 +55,31 @@ lp_build_format_cache_type(struct gallivm_state *gallivm)
 
    return s;
 }
+
+
+/**
+ * Whether a compressed format without a gallivm block decoder can be
+ * fetched through the format cache, the blocks getting decoded into it by
+ * util_format when missed.
+ */
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc)
+{
+   const struct util_format_unpack_description *unpack;
+
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC)
+      return FALSE;
+
+   if (format_desc->block.width != 4 ||
+       format_desc->block.height != 4 ||
+       format_desc->block.depth != 1)
+      return FALSE;
+
+   if (!util_format_fits_8unorm(format_desc))
+      return FALSE;
+
+   unpack = util_format_unpack_description(format_desc->format);
+   return unpack && unpack->unpack_rgba_8unorm_rect != NULL;
+}
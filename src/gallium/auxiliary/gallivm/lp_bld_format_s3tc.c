@@ -38,6 +38,7 @@
 
 #include "util/format/u_format.h"
 #include "util/u_math.h"
+#include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
@@ -57,6 +58,7 @@
 #include "lp_bld_init.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_intr.h"
+#include "lp_bld_misc.h"
 
 
 /**
@@ -1151,6 +1153,68 @@ s3tc_store_cached_block(struct gallivm_state *gallivm,
    }
 }
 
+/**
+ * Decode a block of a format without a gallivm block decoder into the
+ * cache, by calling util_format's unpack function.
+ * Unlike s3tc_store_cached_block(), this stores the texels row by row.
+ */
+static void
+util_store_cached_block(struct gallivm_state *gallivm,
+                        const struct util_format_description *format_desc,
+                        LLVMValueRef ptr_addr,
+                        LLVMValueRef tag_value,
+                        LLVMValueRef hash_index,
+                        LLVMValueRef cache)
+{
+   const struct util_format_unpack_description *unpack =
+      util_format_unpack_description(format_desc->format);
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef pi8t = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef arg_types[6];
+   LLVMValueRef function, ptr, indices[3], args[6];
+
+   /*
+    * Function to call looks like:
+    *   unpack(uint8_t *dst, unsigned dst_stride,
+    *          const uint8_t *src, unsigned src_stride,
+    *          unsigned width, unsigned height)
+    */
+   arg_types[0] = pi8t;
+   arg_types[1] = i32t;
+   arg_types[2] = pi8t;
+   arg_types[3] = i32t;
+   arg_types[4] = i32t;
+   arg_types[5] = i32t;
+
+   if (gallivm->cache)
+      gallivm->cache->dont_cache = true;
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer) unpack->unpack_rgba_8unorm_rect),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          arg_types, ARRAY_SIZE(arg_types),
+                                          format_desc->short_name);
+
+   indices[0] = lp_build_const_int32(gallivm, 0);
+   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_TAGS);
+   indices[2] = hash_index;
+   ptr = LLVMBuildGEP(builder, cache, indices, ARRAY_SIZE(indices), "");
+   LLVMBuildStore(builder, tag_value, ptr);
+
+   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_DATA);
+   indices[2] = LLVMBuildMul(builder, hash_index,
+                             lp_build_const_int32(gallivm, 16), "");
+   ptr = LLVMBuildGEP(builder, cache, indices, ARRAY_SIZE(indices), "");
+
+   args[0] = LLVMBuildBitCast(builder, ptr, pi8t, "");
+   args[1] = lp_build_const_int32(gallivm, 4 * 4);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, 0); /* single row of blocks */
+   args[4] = lp_build_const_int32(gallivm, 4);
+   args[5] = lp_build_const_int32(gallivm, 4);
+   LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
+}
+
 static LLVMValueRef
 s3tc_lookup_cached_pixel(struct gallivm_state *gallivm,
                          LLVMValueRef ptr,
@@ -1938,6 +2002,15 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
    gallivm->builder = LLVMCreateBuilderInContext(gallivm->context);
    LLVMPositionBuilderAtEnd(gallivm->builder, block);
 
+   tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
+                                 LLVMInt64TypeInContext(gallivm->context), "");
+
+   if (format_desc->layout != UTIL_FORMAT_LAYOUT_S3TC) {
+      util_store_cached_block(gallivm, format_desc, ptr_addr, tag_value,
+                              hash_index, cache);
+      goto done;
+   }
+
    lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
                                       ptr_addr);
 
@@ -1962,10 +2035,9 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
       break;
    }
 
-   tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
-                                 LLVMInt64TypeInContext(gallivm->context), "");
    s3tc_store_cached_block(gallivm, col, tag_value, hash_index, cache);
 
+done:
    LLVMBuildRetVoid(gallivm->builder);
 
    LLVMDisposeBuilder(gallivm->builder);
@@ -2092,8 +2164,15 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
 
    hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SIZE - 1);
    hash_index = LLVMBuildAnd(builder, hash_index, hash_mask, "");
-   ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
-   ij_index = LLVMBuildAdd(builder, ij_index, j, "");
+   /* s3tc blocks are cached column by column, util_format ones row by row */
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
+      ij_index = LLVMBuildAdd(builder, ij_index, j, "");
+   }
+   else {
+      ij_index = LLVMBuildShl(builder, j, lp_build_const_int_vec(gallivm, type, 2), "");
+      ij_index = LLVMBuildAdd(builder, ij_index, i, "");
+   }
    block_index = LLVMBuildShl(builder, hash_index,
                               lp_build_const_int_vec(gallivm, type, 4), "");
    block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
@@ -2163,6 +2242,30 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Fetch texels of a compressed format without a gallivm block decoder
+ * through the cache, see lp_build_format_cache_supported().
+ * Parameters and result are the same as for lp_build_fetch_s3tc_rgba_aos.
+ */
+LLVMValueRef
+lp_build_fetch_cached_rgba_aos(struct gallivm_state *gallivm,
+                               const struct util_format_description *format_desc,
+                               unsigned n,
+                               LLVMValueRef base_ptr,
+                               LLVMValueRef offset,
+                               LLVMValueRef i,
+                               LLVMValueRef j,
+                               LLVMValueRef cache)
+{
+   assert(lp_build_format_cache_supported(format_desc));
+   assert(cache);
+   assert((n == 1) || (n % 4 == 0));
+
+   return compressed_fetch_cached(gallivm, format_desc, n,
+                                  base_ptr, offset, i, j, cache);
+}
+
+
 static LLVMValueRef
 s3tc_dxt5_to_rgba_aos(struct gallivm_state *gallivm,
                       unsigned n,
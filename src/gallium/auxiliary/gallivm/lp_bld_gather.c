@@ -336,6 +336,24 @@ lp_build_gather_avx2(struct gallivm_state *gallivm,
       LLVMValueRef args[] = { src_ptr, alignment, mask, passthru };
 
       res = lp_build_intrinsic(builder, intrinsic, src_vec_type, args, 4, 0);
+   } else if (length == 16) {
+      /* AVX-512 gathers take a k register mask, and a 32bit scale */
+      LLVMTypeRef i16_type = LLVMIntTypeInContext(gallivm->context, 16);
+      LLVMTypeRef i32_type = LLVMIntTypeInContext(gallivm->context, 32);
+      const char *intrinsic = dst_type.floating ?
+                              "llvm.x86.avx512.gather.dps.512" :
+                              "llvm.x86.avx512.gather.dpi.512";
+
+      assert(src_width == 32);
+      assert(util_get_cpu_caps()->has_avx512f);
+
+      LLVMValueRef passthru = LLVMGetUndef(src_vec_type);
+      LLVMValueRef mask = LLVMConstAllOnes(i16_type);
+      LLVMValueRef scale = LLVMConstInt(i32_type, 1, 0);
+
+      LLVMValueRef args[] = { passthru, base_ptr, offsets, mask, scale };
+
+      res = lp_build_intrinsic(builder, intrinsic, src_vec_type, args, 5, 0);
    } else {
       LLVMTypeRef i8_type = LLVMIntTypeInContext(gallivm->context, 8);
       const char *intrinsic = NULL;
@@ -492,6 +510,10 @@ lp_build_gather(struct gallivm_state *gallivm,
               src_width == 32 && (length == 4 || length == 8)) {
       return lp_build_gather_avx2(gallivm, length, src_width, dst_type,
                                   base_ptr, offsets);
+   } else if (util_get_cpu_caps()->has_avx512f && !need_expansion &&
+              src_width == 32 && length == 16) {
+      return lp_build_gather_avx2(gallivm, length, src_width, dst_type,
+                                  base_ptr, offsets);
    /*
     * This looks bad on paper wrt throughtput/latency on Haswell.
     * Even on Broadwell it doesn't look stellar.
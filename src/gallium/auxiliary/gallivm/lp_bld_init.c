@@ -409,6 +409,28 @@ fail:
 }
 
 
+/**
+ * Whether to default to 512bit vectors.
+ *
+ * AVX512F alone only covers 32/64bit elements, BW/DQ are needed so that
+ * 8/16bit packing and the int/float conversions stay in zmm registers, and
+ * VL for the 128/256bit ops still mixed in.  LLVM before 7 can't be told
+ * to not split 512bit vectors on cpus it tunes for 256bit.
+ */
+static boolean
+lp_has_avx512_vectors(void)
+{
+#if LLVM_VERSION_MAJOR >= 7
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   return caps->has_avx512f && caps->has_avx512bw &&
+          caps->has_avx512dq && caps->has_avx512vl;
+#else
+   return FALSE;
+#endif
+}
+
+
 boolean
 lp_build_init(void)
 {
@@ -445,10 +467,16 @@ lp_build_init(void)
       util_cpu_caps.has_avx2 = 0;
       util_cpu_caps.has_f16c = 0;
       util_cpu_caps.has_fma = 0;
+      util_cpu_caps.has_avx512f = 0;
+      util_cpu_caps.has_avx512bw = 0;
+      util_cpu_caps.has_avx512dq = 0;
+      util_cpu_caps.has_avx512vl = 0;
    }
 #endif
 
-   if (util_get_cpu_caps()->has_avx2 || util_get_cpu_caps()->has_avx) {
+   if (lp_has_avx512_vectors()) {
+      lp_native_vector_width = 512;
+   } else if (util_get_cpu_caps()->has_avx2 || util_get_cpu_caps()->has_avx) {
       lp_native_vector_width = 256;
    } else {
       /* Leave it at 128, even when no SIMD extensions are available.
@@ -93,6 +93,7 @@
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_type.h"
 
 namespace {
 
@@ -393,6 +394,17 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
         ++f) {
       MAttrs.push_back(((*f).second ? "+" : "-") + (*f).first().str());
    }
+
+#if LLVM_VERSION_MAJOR >= 7 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64))
+   /*
+    * LLVM tunes most AVX-512 cpus for 256bit vectors, which keeps some
+    * combines (and its own vectorization) from using zmm registers even
+    * though all our vectors are 512bit wide.
+    */
+   if (lp_native_vector_width > 256) {
+      MAttrs.push_back("-prefer-256-bit");
+   }
+#endif
 #elif defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
    /*
     * We need to unset attributes because sometimes LLVM mistakenly assumes
@@ -128,6 +128,33 @@ lp_build_const_unpack_shuffle_half(struct gallivm_state *gallivm,
    return LLVMConstVector(elems, n);
 }
 
+/**
+ * Similar to lp_build_const_unpack_shuffle_half, but for 512bit vectors,
+ * matching AVX-512 PUNPCKLxx and PUNPCKHxx which unpack each 128bit lane
+ * independently.
+ */
+static LLVMValueRef
+lp_build_const_unpack_shuffle_lanes(struct gallivm_state *gallivm,
+                                    unsigned n, unsigned lo_hi)
+{
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+   unsigned lane_len = n / 4;
+   unsigned i, j;
+
+   assert(n <= LP_MAX_VECTOR_LENGTH);
+   assert(lo_hi < 2);
+
+   for (i = 0; i < n; i += lane_len) {
+      for (j = 0; j < lane_len / 2; j++) {
+         unsigned src = i + lo_hi * lane_len / 2 + j;
+         elems[i + 2*j + 0] = lp_build_const_int32(gallivm, src);
+         elems[i + 2*j + 1] = lp_build_const_int32(gallivm, n + src);
+      }
+   }
+
+   return LLVMConstVector(elems, n);
+}
+
 /**
  * Similar to lp_build_const_unpack_shuffle_half, but for AVX512
  * See comment above lp_build_interleave2_half for more details.
@@ -487,6 +514,13 @@ lp_build_unpack2_native(struct gallivm_state *gallivm,
    if (src_type.length * src_type.width == 256 && util_get_cpu_caps()->has_avx2) {
       *dst_lo = lp_build_interleave2_half(gallivm, src_type, src, msb, 0);
       *dst_hi = lp_build_interleave2_half(gallivm, src_type, src, msb, 1);
+   } else if (src_type.length * src_type.width == 512 &&
+              util_get_cpu_caps()->has_avx512bw) {
+      LLVMValueRef shuffle;
+      shuffle = lp_build_const_unpack_shuffle_lanes(gallivm, src_type.length, 0);
+      *dst_lo = LLVMBuildShuffleVector(builder, src, msb, shuffle, "");
+      shuffle = lp_build_const_unpack_shuffle_lanes(gallivm, src_type.length, 1);
+      *dst_hi = LLVMBuildShuffleVector(builder, src, msb, shuffle, "");
    } else {
       *dst_lo = lp_build_interleave2(gallivm, src_type, src, msb, 0);
       *dst_hi = lp_build_interleave2(gallivm, src_type, src, msb, 1);
@@ -646,6 +680,37 @@ lp_build_pack2(struct gallivm_state *gallivm,
                res = LLVMBuildBitCast(builder, res, dst_vec_type, "");
             }
          }
+         else if (src_type.width * src_type.length == 512 &&
+                  util_get_cpu_caps()->has_avx512bw &&
+                  !swap_intrinsic_operands) {
+            /*
+             * The zmm packs work on each 128bit lane independently, so
+             * the result has the 64bit halves of lo and hi alternating.
+             * One cross-lane qword permute puts them back in order.
+             */
+            LLVMTypeRef i64t = LLVMInt64TypeInContext(gallivm->context);
+            LLVMTypeRef q_vec_type = LLVMVectorType(i64t, 8);
+            LLVMValueRef shuffles[8];
+            int i;
+
+            intrinsic = src_type.width == 32 ?
+               (dst_type.sign ? "llvm.x86.avx512.packssdw.512" :
+                                "llvm.x86.avx512.packusdw.512") :
+               (dst_type.sign ? "llvm.x86.avx512.packsswb.512" :
+                                "llvm.x86.avx512.packuswb.512");
+
+            for (i = 0; i < 8; i++) {
+               shuffles[i] = lp_build_const_int32(gallivm, (i % 4) * 2 + i / 4);
+            }
+
+            res = lp_build_intrinsic_binary(builder, intrinsic,
+                                            lp_build_vec_type(gallivm, intr_type),
+                                            lo, hi);
+            res = LLVMBuildBitCast(builder, res, q_vec_type, "");
+            res = LLVMBuildShuffleVector(builder, res, res,
+                                         LLVMConstVector(shuffles, 8), "");
+            res = LLVMBuildBitCast(builder, res, dst_vec_type, "");
+         }
          else {
             int num_split = src_type.width * src_type.length / 128;
             int i;
@@ -715,6 +780,7 @@ lp_build_pack2(struct gallivm_state *gallivm,
  *   lo =   l0 __ l1 __ l2 __ l3 __ l4 __ l5 __ l6 __ l7 __
  *   hi =   h0 __ h1 __ h2 __ h3 __ h4 __ h5 __ h6 __ h7 __
  *   res =  l0 l1 l2 l3 h0 h1 h2 h3 l4 l5 l6 l7 h4 h5 h6 h7
+ * and the same goes for each of the four 128bit lanes with avx512.
  *
  * This will only change the number of bits the values are represented, not the
  * values themselves.
@@ -738,9 +804,27 @@ lp_build_pack2_native(struct gallivm_state *gallivm,
    assert(src_type.width == dst_type.width * 2);
    assert(src_type.length * 2 == dst_type.length);
 
-   /* At this point only have special case for avx2 */
-   if (src_type.length * src_type.width == 256 &&
-       util_get_cpu_caps()->has_avx2) {
+   if (src_type.length * src_type.width == 512 &&
+       util_get_cpu_caps()->has_avx512bw) {
+      switch(src_type.width) {
+      case 32:
+         if (dst_type.sign) {
+            intrinsic = "llvm.x86.avx512.packssdw.512";
+         } else {
+            intrinsic = "llvm.x86.avx512.packusdw.512";
+         }
+         break;
+      case 16:
+         if (dst_type.sign) {
+            intrinsic = "llvm.x86.avx512.packsswb.512";
+         } else {
+            intrinsic = "llvm.x86.avx512.packuswb.512";
+         }
+         break;
+      }
+   }
+   else if (src_type.length * src_type.width == 256 &&
+            util_get_cpu_caps()->has_avx2) {
       switch(src_type.width) {
       case 32:
          if (dst_type.sign) {
@@ -2104,16 +2104,47 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Compute the partial offset of a texel along an axis of a tiled texture
+ * (see LP_SAMPLE_TILE_SIZE), that is
+ *
+ *   (coord & ~(LP_SAMPLE_TILE_SIZE - 1)) * stride +
+ *   (coord & (LP_SAMPLE_TILE_SIZE - 1)) * sub_stride
+ *
+ * For x, stride is LP_SAMPLE_TILE_SIZE texels and sub_stride one texel;
+ * for y, stride is the row stride and sub_stride LP_SAMPLE_TILE_SIZE texels.
+ */
+LLVMValueRef
+lp_build_sample_tiled_offset(struct lp_build_context *bld,
+                             LLVMValueRef coord,
+                             LLVMValueRef stride,
+                             LLVMValueRef sub_stride)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef tile_mask = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                   LP_SAMPLE_TILE_SIZE - 1);
+   LLVMValueRef subcoord, offset;
+
+   subcoord = LLVMBuildAnd(builder, coord, tile_mask, "");
+   coord = LLVMBuildXor(builder, coord, subcoord, "");
+
+   offset = lp_build_mul(bld, coord, stride);
+   return lp_build_add(bld, offset, lp_build_mul(bld, subcoord, sub_stride));
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
  * x, y, z, y_stride, z_stride are vectors, and they refer to pixels.
+ * If tiled is set the texture is stored in tiles (and has 1x1 pixel blocks).
  *
  * Returns the relative offset and i,j sub-block coordinates
  */
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2129,21 +2160,41 @@ lp_build_sample_offset(struct lp_build_context *bld,
    x_stride = lp_build_const_vec(bld->gallivm, bld->type,
                                  format_desc->block.bits/8);
 
-   lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
-                                  &offset, out_i);
+   if (tiled) {
+      LLVMValueRef tile_x_stride;
 
-   if (y && y_stride) {
-      LLVMValueRef y_offset;
-      lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
-                                     &y_offset, out_j);
-      offset = lp_build_add(bld, offset, y_offset);
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+      tile_x_stride = lp_build_const_vec(bld->gallivm, bld->type,
+                                         LP_SAMPLE_TILE_SIZE *
+                                         format_desc->block.bits/8);
+
+      offset = lp_build_sample_tiled_offset(bld, x, tile_x_stride, x_stride);
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         y_offset = lp_build_sample_tiled_offset(bld, y, y_stride,
+                                                 tile_x_stride);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      *out_i = bld->zero;
+      *out_j = bld->zero;
    }
    else {
-      *out_j = bld->zero;
+      lp_build_sample_partial_offset(bld,
+                                     format_desc->block.width,
+                                     x, x_stride,
+                                     &offset, out_i);
+
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_partial_offset(bld,
+                                        format_desc->block.height,
+                                        y, y_stride,
+                                        &y_offset, out_j);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      else {
+         *out_j = bld->zero;
+      }
    }
 
    if (z && z_stride) {
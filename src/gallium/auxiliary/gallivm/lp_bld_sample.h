@@ -132,6 +132,15 @@ struct lp_sampler_size_query_params
    LLVMValueRef *sizes_out;
 };
 
+/**
+ * Width and height, in texels, of the square tiles that textures with
+ * lp_static_texture_state::tiled set are stored in.  Texels are stored
+ * row-major within a tile and tiles row-major within the image, with a
+ * row of tiles taking LP_SAMPLE_TILE_SIZE times the row stride.
+ */
+#define LP_SAMPLE_TILE_SIZE 4
+
+
 #define LP_IMG_LOAD 0
 #define LP_IMG_STORE 1
 #define LP_IMG_ATOMIC 2
@@ -175,6 +184,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< stored in LP_SAMPLE_TILE_SIZE^2 tiles */
 };
 
 
@@ -672,9 +682,17 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+LLVMValueRef
+lp_build_sample_tiled_offset(struct lp_build_context *bld,
+                             LLVMValueRef coord,
+                             LLVMValueRef stride,
+                             LLVMValueRef sub_stride);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -141,6 +141,7 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
    /* convert x,y,z coords to linear offset from start of texture, in bytes */
    lp_build_sample_offset(&bld->int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, y_stride, z_stride,
                           &offset, &i, &j);
    if (mipoffsets) {
@@ -2825,6 +2826,12 @@ lp_build_clamp_border_color(struct lp_build_sample_context *bld,
          case PIPE_FORMAT_LATC1_UNORM:
          case PIPE_FORMAT_LATC2_UNORM:
          case PIPE_FORMAT_ETC1_RGB8:
+         case PIPE_FORMAT_ETC2_RGB8:
+         case PIPE_FORMAT_ETC2_SRGB8:
+         case PIPE_FORMAT_ETC2_RGB8A1:
+         case PIPE_FORMAT_ETC2_SRGB8A1:
+         case PIPE_FORMAT_ETC2_RGBA8:
+         case PIPE_FORMAT_ETC2_SRGBA8:
          case PIPE_FORMAT_BPTC_RGBA_UNORM:
          case PIPE_FORMAT_BPTC_SRGBA:
             min_clamp = vec4_bld.zero;
@@ -3164,6 +3171,7 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
 
    lp_build_sample_offset(int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -3980,6 +3988,11 @@ lp_build_sample_gen_func(struct gallivm_state *gallivm,
       if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
          need_cache = TRUE;
       }
+      else if (format_desc &&
+               lp_build_format_cache_supported(util_format_description(
+                  util_format_linear(format_desc->format)))) {
+         need_cache = TRUE;
+      }
    }
 
    /* "unpack" arguments */
@@ -4109,6 +4122,11 @@ lp_build_sample_soa_func(struct gallivm_state *gallivm,
       if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
          need_cache = TRUE;
       }
+      else if (format_desc &&
+               lp_build_format_cache_supported(util_format_description(
+                  util_format_linear(format_desc->format)))) {
+         need_cache = TRUE;
+      }
    }
    /*
     * texture function matches are found by name.
@@ -4673,6 +4691,7 @@ lp_build_img_op_soa(const struct lp_static_texture_state *static_texture_state,
    }
    lp_build_sample_offset(&int_coord_bld,
                           format_desc,
+                          FALSE, /* images are never tiled */
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -1362,6 +1362,21 @@ void sse2_cvtpd2ps( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+/* F16C, VEX.128.66.0F38.W0 13 /r.  The VEX prefix is emitted with the
+ * R, X and B extension bits clear, so only xmm0-7 and the first eight
+ * general purpose registers can be used.
+ */
+void f16c_vcvtph2ps( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   assert(dst.idx < 8 && src.idx < 8);
+   emit_3ub(p, 0xc4, 0xe2, 0x79);
+   emit_1ub(p, 0x13);
+   emit_modrm( p, dst, src );
+}
+
 void sse2_packssdw( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
@@ -2173,6 +2188,8 @@ static void x86_init_func_common( struct x86_function *p )
       p->caps |= X86_SSE3;
    if(util_get_cpu_caps()->has_sse4_1)
       p->caps |= X86_SSE4_1;
+   if(util_get_cpu_caps()->has_f16c)
+      p->caps |= X86_F16C;
    p->csr = p->store;
 #if defined(PIPE_ARCH_X86)
    emit_1i(p, 0xfb1e0ff3);
@@ -47,6 +47,7 @@ struct x86_reg {
 #define X86_SSE2 8
 #define X86_SSE3 0x10
 #define X86_SSE4_1 0x20
+#define X86_F16C 0x40
 
 struct x86_function {
    unsigned caps;
@@ -235,6 +236,8 @@ void sse2_cvtdq2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg s
 void sse2_cvtsd2ss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_cvtpd2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 
+void f16c_vcvtph2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+
 void sse2_movd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_packssdw( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
 void sse2_packsswb( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
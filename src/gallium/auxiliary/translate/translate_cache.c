@@ -35,6 +35,8 @@
 
 struct translate_cache {
    struct cso_hash hash;
+   unsigned hits;
+   unsigned misses;
 };
 
 struct translate_cache * translate_cache_create( void )
@@ -45,6 +47,8 @@ struct translate_cache * translate_cache_create( void )
    }
 
    cso_hash_init(&cache->hash);
+   cache->hits = 0;
+   cache->misses = 0;
    return cache;
 }
 
@@ -100,7 +104,19 @@ struct translate * translate_cache_find(struct translate_cache *cache,
       /* create/insert */
       translate = translate_create(key);
       cso_hash_insert(&cache->hash, hash_key, translate);
+      cache->misses++;
+   }
+   else {
+      cache->hits++;
    }
 
    return translate;
 }
+
+
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               unsigned *hits, unsigned *misses)
+{
+   *hits = cache->hits;
+   *misses = cache->misses;
+}
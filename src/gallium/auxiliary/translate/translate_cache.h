@@ -51,4 +51,11 @@ void translate_cache_destroy(struct translate_cache *cache);
 struct translate *translate_cache_find(struct translate_cache *cache,
                                        struct translate_key *key);
 
+/**
+ * Return how many lookups found an existing translate, and how many
+ * had to create one.
+ */
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               unsigned *hits, unsigned *misses);
+
 #endif
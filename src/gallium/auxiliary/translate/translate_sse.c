@@ -64,8 +64,8 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_FLOAT_CONSTS 9
-#define NUM_UNSIGNED_CONSTS 1
+#define NUM_FLOAT_CONSTS 14
+#define NUM_UNSIGNED_CONSTS 2
 
 enum
 {
@@ -78,8 +78,14 @@ enum
    CONST_INV_4294967295,
    CONST_255,
    CONST_2147483648,
+   CONST_10_10_10_2_SCALE,
+   CONST_10_10_10_2_SIGN,
+   CONST_10_10_10_2_WRAP,
+   CONST_INV_10_10_10_2_UNORM,
+   CONST_INV_10_10_10_2_SNORM,
    /* float consts end */
    CONST_2147483647_INT,
+   CONST_10_10_10_2_MASK,
 };
 
 #define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
@@ -93,12 +99,18 @@ static float consts[NUM_FLOAT_CONSTS][4] = {
    C(1.0 / 4294967295.0),
    C(255.0),
    C(2147483648.0),
+   {1.0f, 1.0f / (1 << 10), 1.0f / (1 << 20), 1.0f / (1 << 30)},
+   {512.0f, 512.0f, 512.0f, 2.0f},
+   {1024.0f, 1024.0f, 1024.0f, 4.0f},
+   {1.0f / 0x3ff, 1.0f / 0x3ff, 1.0f / 0x3ff, 1.0f / 0x3},
+   {1.0f / 0x1ff, 1.0f / 0x1ff, 1.0f / 0x1ff, 1.0f / 0x1},
 };
 
 #undef C
 
 static unsigned uconsts[NUM_UNSIGNED_CONSTS][4] = {
    {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff},
+   {0x3ff, 0x3ff << 10, 0x3ff << 20, 0x3u << 30},
 };
 
 struct translate_sse
@@ -345,6 +357,93 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* Do two channels hold the same kind of data?  Their shifts differ in
+ * any multi-channel format, so the descriptions can't just be memcmp'd.
+ */
+static boolean
+same_channel_type(const struct util_format_channel_description *a,
+                  const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
+/* Is this one of the R10G10B10A2 style formats with normalized or scaled
+ * channels?
+ */
+static boolean
+is_10_10_10_2(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN || desc->nr_channels != 4)
+      return FALSE;
+
+   if (desc->channel[0].type != UTIL_FORMAT_TYPE_UNSIGNED &&
+       desc->channel[0].type != UTIL_FORMAT_TYPE_SIGNED)
+      return FALSE;
+
+   for (i = 0; i < 4; ++i) {
+      if (desc->channel[i].type != desc->channel[0].type ||
+          desc->channel[i].normalized != desc->channel[0].normalized ||
+          desc->channel[i].pure_integer ||
+          desc->channel[i].size != (i < 3 ? 10 : 2) ||
+          desc->channel[i].shift != i * 10)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/* Load a 10_10_10_2 packed value, converting each channel to float in
+ * its own lane.  This is exact: the channels are isolated in place and
+ * then scaled down by powers of two.
+ */
+static void
+emit_load_10_10_10_2(struct translate_sse *p, struct x86_reg data,
+                     struct x86_reg src,
+                     const struct util_format_description *desc)
+{
+   struct x86_reg auxXMM = x86_make_reg(file_XMM, 1);
+
+   sse2_movd(p->func, data, src);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+   sse_andps(p->func, data, get_const(p, CONST_10_10_10_2_MASK));
+
+   /* The W channel lives in the sign bit, so convert as unsigned, like
+    * the 32-bit unsigned case does.
+    */
+   sse_xorps(p->func, auxXMM, auxXMM);
+   sse2_pcmpgtd(p->func, auxXMM, data);
+   sse_andps(p->func, data, get_const(p, CONST_2147483647_INT));
+   sse_andps(p->func, auxXMM, get_const(p, CONST_2147483648));
+   sse2_cvtdq2ps(p->func, data, data);
+   sse_addps(p->func, data, auxXMM);
+
+   sse_mulps(p->func, data, get_const(p, CONST_10_10_10_2_SCALE));
+
+   if (desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED) {
+      /* data -= data >= 2^(bits-1) ? 2^bits : 0 */
+      sse_movaps(p->func, auxXMM, data);
+      sse_cmpps(p->func, auxXMM, get_const(p, CONST_10_10_10_2_SIGN),
+                cc_NotLessThan);
+      sse_andps(p->func, auxXMM, get_const(p, CONST_10_10_10_2_WRAP));
+      sse_subps(p->func, data, auxXMM);
+   }
+
+   if (desc->channel[0].normalized) {
+      sse_mulps(p->func, data,
+                get_const(p, desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED ?
+                             CONST_INV_10_10_10_2_SNORM :
+                             CONST_INV_10_10_10_2_UNORM));
+   }
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -487,28 +586,28 @@ translate_attr_convert(struct translate_sse *p,
         PIPE_SWIZZLE_NONE, PIPE_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed_10_10_10_2;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   packed_10_10_10_2 = is_10_10_10_2(input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !packed_10_10_10_2)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   for (i = 1; i < input_desc->nr_channels && !packed_10_10_10_2; ++i) {
+      if (!same_channel_type(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!same_channel_type(&output_desc->channel[i],
+                             &output_desc->channel[0])) {
          return FALSE;
       }
    }
@@ -539,7 +638,17 @@ translate_attr_convert(struct translate_sse *p,
             id_swizzle = FALSE;
       }
 
-      if (needed_chans > 0) {
+      if (needed_chans > 0 && packed_10_10_10_2) {
+         if (!(x86_target_caps(p->func) & X86_SSE2))
+            return FALSE;
+         emit_load_10_10_10_2(p, dataXMM, src, input_desc);
+
+         if (!id_swizzle) {
+            sse_shufps(p->func, dataXMM, dataXMM,
+                       SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
+         }
+      }
+      else if (needed_chans > 0) {
          switch (input_desc->channel[0].type) {
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
@@ -654,6 +763,16 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
+            if (input_desc->channel[0].size == 16) {
+               if ((x86_target_caps(p->func) & (X86_SSE2 | X86_F16C)) !=
+                   (X86_SSE2 | X86_F16C))
+                  return FALSE;
+               /* missing channels load as zero halves, i.e. 0.0 */
+               emit_load_sse2(p, dataXMM, src,
+                              input_desc->nr_channels * 2);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               break;
+            }
             if (input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
@@ -753,6 +872,10 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
+   else if (packed_10_10_10_2) {
+      /* only converted to float */
+      return FALSE;
+   }
    else if ((x86_target_caps(p->func) & X86_SSE2)
             && input_desc->channel[0].size == 8
             && output_desc->channel[0].size == 16
@@ -43,6 +43,16 @@ util_gen_mipmap(struct pipe_context *pipe, struct pipe_resource *pt,
                 enum pipe_format format, uint base_level, uint last_level,
                 uint first_layer, uint last_layer, uint filter);
 
+bool
+util_gen_mipmap_cpu_supported(enum pipe_format format);
+
+bool
+util_gen_mipmap_cpu_level(enum pipe_format format, unsigned num_layers,
+                          const uint8_t * const *src, unsigned src_stride,
+                          unsigned src_width, unsigned src_height,
+                          uint8_t * const *dst, unsigned dst_stride,
+                          unsigned dst_width, unsigned dst_height);
+
 
 #ifdef __cplusplus
 }
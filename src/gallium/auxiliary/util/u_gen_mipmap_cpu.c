@@ -0,0 +1,567 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Mipmap generation on the CPU
+ *
+ * A 2x2 box filter over linear images, for drivers and fallbacks that can
+ * get at the texels directly.  sRGB channels are averaged in linear space.
+ * Large levels are cut into bands of rows (counted across all layers)
+ * which are filtered on a small thread pool.
+ */
+
+
+#include "util/u_gen_mipmap.h"
+#include "util/format/u_format.h"
+#include "util/format_srgb.h"
+#include "util/half_float.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+#include "util/u_sse.h"
+
+
+/** Levels with fewer destination texels than this aren't split. */
+#define MIP_BAND_TEXELS (64 * 1024)
+
+#define MIP_MAX_THREADS 8
+
+
+struct mip_level;
+
+typedef void (*mip_row_func)(const struct mip_level *level,
+                             const uint8_t *src0, const uint8_t *src1,
+                             uint8_t *dst);
+
+struct mip_level {
+   mip_row_func row;
+   unsigned bpp;
+   unsigned srgb_mask;   /**< bytes of a texel holding sRGB channels */
+
+   const uint8_t * const *src;
+   unsigned src_stride;
+   unsigned src_width;
+   unsigned src_height;
+
+   uint8_t * const *dst;
+   unsigned dst_stride;
+   unsigned dst_width;
+   unsigned dst_height;
+};
+
+struct mip_band {
+   const struct mip_level *level;
+   unsigned first_row;
+   unsigned last_row;
+   struct util_queue_fence fence;
+};
+
+
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Add up horizontally adjacent texels of 1, 2 or 4 bytes, given the column
+ * sums of 16 source bytes as 16-bit values in two registers.
+ */
+static inline __m128i
+mip_pairs_sse2(__m128i s0, __m128i s1, unsigned bpp)
+{
+   switch (bpp) {
+   case 1:
+      return _mm_packs_epi32(_mm_madd_epi16(s0, _mm_set1_epi16(1)),
+                             _mm_madd_epi16(s1, _mm_set1_epi16(1)));
+   case 2:
+      s0 = _mm_add_epi16(s0, _mm_srli_epi64(s0, 32));
+      s1 = _mm_add_epi16(s1, _mm_srli_epi64(s1, 32));
+      return _mm_unpacklo_epi64(_mm_shuffle_epi32(s0, _MM_SHUFFLE(3, 1, 2, 0)),
+                                _mm_shuffle_epi32(s1, _MM_SHUFFLE(3, 1, 2, 0)));
+   default:
+      return _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                           _mm_unpackhi_epi64(s0, s1));
+   }
+}
+
+
+/**
+ * 16 destination bytes at a time, for texels of 1, 2 or 4 bytes.  Returns
+ * how many texels were done.
+ */
+static unsigned
+mip_row_unorm8_sse2(const uint8_t *src0, const uint8_t *src1,
+                    uint8_t *dst, unsigned width, unsigned bpp)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i two = _mm_set1_epi16(2);
+   const unsigned texels = 16 / bpp;
+   unsigned x;
+
+   for (x = 0; x + texels <= width; x += texels) {
+      const uint8_t *a = src0 + 2 * x * bpp;
+      const uint8_t *b = src1 + 2 * x * bpp;
+      const __m128i a0 = _mm_loadu_si128((const __m128i *)a);
+      const __m128i a1 = _mm_loadu_si128((const __m128i *)(a + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *)b);
+      const __m128i b1 = _mm_loadu_si128((const __m128i *)(b + 16));
+
+      /* vertical sums */
+      const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+      const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+      const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+      const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+
+      __m128i h0 = mip_pairs_sse2(s0, s1, bpp);
+      __m128i h1 = mip_pairs_sse2(s2, s3, bpp);
+
+      h0 = _mm_srli_epi16(_mm_add_epi16(h0, two), 2);
+      h1 = _mm_srli_epi16(_mm_add_epi16(h1, two), 2);
+
+      _mm_storeu_si128((__m128i *)(dst + x * bpp), _mm_packus_epi16(h0, h1));
+   }
+
+   return x;
+}
+
+
+/**
+ * Two RGBA16-sized texels at a time.  Returns how many were done.
+ */
+static unsigned
+mip_row_unorm16x4_sse2(const uint8_t *src0, const uint8_t *src1,
+                       uint8_t *dst, unsigned width)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i two = _mm_set1_epi32(2);
+   const __m128i bias = _mm_set1_epi32(0x8000);
+   unsigned x;
+
+   for (x = 0; x + 2 <= width; x += 2) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *)(src0 + x * 16));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *)(src0 + x * 16 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *)(src1 + x * 16));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *)(src1 + x * 16 + 16));
+      __m128i p0, p1, r;
+
+      /* one destination texel per register, in 32 bits */
+      p0 = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi16(a0, zero),
+                                       _mm_unpackhi_epi16(a0, zero)),
+                         _mm_add_epi32(_mm_unpacklo_epi16(b0, zero),
+                                       _mm_unpackhi_epi16(b0, zero)));
+      p1 = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi16(a1, zero),
+                                       _mm_unpackhi_epi16(a1, zero)),
+                         _mm_add_epi32(_mm_unpacklo_epi16(b1, zero),
+                                       _mm_unpackhi_epi16(b1, zero)));
+      p0 = _mm_srli_epi32(_mm_add_epi32(p0, two), 2);
+      p1 = _mm_srli_epi32(_mm_add_epi32(p1, two), 2);
+
+      /* SSE2 only packs signed, so go through the biased range */
+      r = _mm_packs_epi32(_mm_sub_epi32(p0, bias), _mm_sub_epi32(p1, bias));
+      r = _mm_xor_si128(r, _mm_set1_epi16(-0x8000));
+
+      _mm_storeu_si128((__m128i *)(dst + x * 8), r);
+   }
+
+   return x;
+}
+
+
+/**
+ * One RGBA32F texel at a time.
+ */
+static unsigned
+mip_row_float32x4_sse(const uint8_t *src0, const uint8_t *src1,
+                      uint8_t *dst, unsigned width)
+{
+   const __m128 quarter = _mm_set1_ps(0.25f);
+   const float *a = (const float *)src0;
+   const float *b = (const float *)src1;
+   float *d = (float *)dst;
+   unsigned x;
+
+   for (x = 0; x < width; x++) {
+      __m128 s = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a + x * 8),
+                                       _mm_loadu_ps(a + x * 8 + 4)),
+                            _mm_add_ps(_mm_loadu_ps(b + x * 8),
+                                       _mm_loadu_ps(b + x * 8 + 4)));
+      _mm_storeu_ps(d + x * 4, _mm_mul_ps(s, quarter));
+   }
+
+   return x;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+static void
+mip_row_unorm8(const struct mip_level *level,
+               const uint8_t *src0, const uint8_t *src1, uint8_t *dst)
+{
+   const unsigned bpp = level->bpp;
+   const unsigned step = level->src_width > 1 ? bpp : 0;
+   unsigned x = 0, i;
+
+#if defined(PIPE_ARCH_SSE)
+   if ((bpp == 1 || bpp == 2 || bpp == 4) && step)
+      x = mip_row_unorm8_sse2(src0, src1, dst, level->dst_width, bpp);
+#endif
+
+   for (; x < level->dst_width; x++) {
+      const uint8_t *a = src0 + 2 * x * bpp;
+      const uint8_t *b = src1 + 2 * x * bpp;
+
+      for (i = 0; i < bpp; i++)
+         dst[x * bpp + i] = (a[i] + a[i + step] + b[i] + b[i + step] + 2) >> 2;
+   }
+}
+
+
+/**
+ * sRGB goes through 16-bit linear values, which keeps the filter in
+ * integers and the way back down to a single table lookup.
+ */
+static uint16_t mip_srgb_to_linear16[256];
+static uint8_t mip_linear16_to_srgb[65536];
+static once_flag mip_srgb_once = ONCE_FLAG_INIT;
+
+static void
+mip_srgb_init(void)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(mip_srgb_to_linear16); i++)
+      mip_srgb_to_linear16[i] =
+         util_format_srgb_8unorm_to_linear_float(i) * 65535.0f + 0.5f;
+
+   for (i = 0; i < ARRAY_SIZE(mip_linear16_to_srgb); i++)
+      mip_linear16_to_srgb[i] =
+         util_format_linear_float_to_srgb_8unorm(i * (1.0f / 65535.0f));
+}
+
+
+static void
+mip_row_srgb8(const struct mip_level *level,
+              const uint8_t *src0, const uint8_t *src1, uint8_t *dst)
+{
+   const uint16_t *to_linear = mip_srgb_to_linear16;
+   const unsigned bpp = level->bpp;
+   const unsigned step = level->src_width > 1 ? bpp : 0;
+   unsigned x, i;
+
+   for (x = 0; x < level->dst_width; x++) {
+      const uint8_t *a = src0 + 2 * x * bpp;
+      const uint8_t *b = src1 + 2 * x * bpp;
+
+      for (i = 0; i < bpp; i++) {
+         if (level->srgb_mask & (1 << i)) {
+            unsigned sum = to_linear[a[i]] + to_linear[a[i + step]] +
+                           to_linear[b[i]] + to_linear[b[i + step]];
+            dst[x * bpp + i] = mip_linear16_to_srgb[(sum + 2) >> 2];
+         } else {
+            dst[x * bpp + i] =
+               (a[i] + a[i + step] + b[i] + b[i + step] + 2) >> 2;
+         }
+      }
+   }
+}
+
+
+static void
+mip_row_unorm16(const struct mip_level *level,
+                const uint8_t *src0, const uint8_t *src1, uint8_t *dst)
+{
+   const unsigned comps = level->bpp / 2;
+   const unsigned step = level->src_width > 1 ? comps : 0;
+   const uint16_t *a, *b;
+   uint16_t *d = (uint16_t *)dst;
+   unsigned x = 0, i;
+
+#if defined(PIPE_ARCH_SSE)
+   if (comps == 4 && step)
+      x = mip_row_unorm16x4_sse2(src0, src1, dst, level->dst_width);
+#endif
+
+   for (; x < level->dst_width; x++) {
+      a = (const uint16_t *)src0 + 2 * x * comps;
+      b = (const uint16_t *)src1 + 2 * x * comps;
+
+      for (i = 0; i < comps; i++)
+         d[x * comps + i] = (a[i] + a[i + step] + b[i] + b[i + step] + 2) >> 2;
+   }
+}
+
+
+static void
+mip_row_float16(const struct mip_level *level,
+                const uint8_t *src0, const uint8_t *src1, uint8_t *dst)
+{
+   const unsigned comps = level->bpp / 2;
+   const unsigned step = level->src_width > 1 ? comps : 0;
+   const uint16_t *a, *b;
+   uint16_t *d = (uint16_t *)dst;
+   unsigned x, i;
+
+   for (x = 0; x < level->dst_width; x++) {
+      a = (const uint16_t *)src0 + 2 * x * comps;
+      b = (const uint16_t *)src1 + 2 * x * comps;
+
+      for (i = 0; i < comps; i++) {
+         float sum = _mesa_half_to_float(a[i]) + _mesa_half_to_float(a[i + step]) +
+                     _mesa_half_to_float(b[i]) + _mesa_half_to_float(b[i + step]);
+         d[x * comps + i] = _mesa_float_to_half(sum * 0.25f);
+      }
+   }
+}
+
+
+static void
+mip_row_float32(const struct mip_level *level,
+                const uint8_t *src0, const uint8_t *src1, uint8_t *dst)
+{
+   const unsigned comps = level->bpp / 4;
+   const unsigned step = level->src_width > 1 ? comps : 0;
+   const float *a, *b;
+   float *d = (float *)dst;
+   unsigned x = 0, i;
+
+#if defined(PIPE_ARCH_SSE)
+   if (comps == 4 && step)
+      x = mip_row_float32x4_sse(src0, src1, dst, level->dst_width);
+#endif
+
+   for (; x < level->dst_width; x++) {
+      a = (const float *)src0 + 2 * x * comps;
+      b = (const float *)src1 + 2 * x * comps;
+
+      for (i = 0; i < comps; i++)
+         d[x * comps + i] = (a[i] + a[i + step] + b[i] + b[i + step]) * 0.25f;
+   }
+}
+
+
+/**
+ * Pick the row filter for a format, or NULL if it isn't handled.  Every
+ * channel must have the same size and type; padding channels are just
+ * averaged along.
+ */
+static mip_row_func
+mip_row_func_for_format(enum pipe_format format, unsigned *srgb_mask)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const struct util_format_channel_description *chan = NULL;
+   unsigned i;
+
+   *srgb_mask = 0;
+
+   if (!desc ||
+       desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       (desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB &&
+        desc->colorspace != UTIL_FORMAT_COLORSPACE_SRGB))
+      return NULL;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      const struct util_format_channel_description *c = &desc->channel[i];
+
+      if (c->size != desc->channel[0].size)
+         return NULL;
+      if (c->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+      if (!chan)
+         chan = c;
+      else if (c->type != chan->type || c->normalized != chan->normalized)
+         return NULL;
+   }
+
+   if (!chan)
+      return NULL;
+
+   if (chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized) {
+      if (chan->size == 16 && desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB)
+         return mip_row_unorm16;
+      if (chan->size != 8)
+         return NULL;
+      if (desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB)
+         return mip_row_unorm8;
+
+      for (i = 0; i < desc->nr_channels; i++) {
+         if (desc->channel[i].type != UTIL_FORMAT_TYPE_VOID &&
+             desc->swizzle[3] != i)
+            *srgb_mask |= 1 << i;
+      }
+      return mip_row_srgb8;
+   }
+
+   if (chan->type == UTIL_FORMAT_TYPE_FLOAT &&
+       desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB) {
+      if (chan->size == 16)
+         return mip_row_float16;
+      if (chan->size == 32)
+         return mip_row_float32;
+   }
+
+   return NULL;
+}
+
+
+static void
+mip_filter_rows(const struct mip_level *level,
+                unsigned first_row, unsigned last_row)
+{
+   unsigned row;
+
+   for (row = first_row; row < last_row; row++) {
+      const unsigned layer = row / level->dst_height;
+      const unsigned y = row % level->dst_height;
+      const uint8_t *src0 = level->src[layer] + 2 * y * level->src_stride;
+      const uint8_t *src1 = level->src_height > 1 ?
+                            src0 + level->src_stride : src0;
+
+      level->row(level, src0, src1,
+                 level->dst[layer] + y * level->dst_stride);
+   }
+}
+
+
+static void
+mip_band_execute(void *data, void *gdata, int thread_index)
+{
+   struct mip_band *band = data;
+
+   mip_filter_rows(band->level, band->first_row, band->last_row);
+}
+
+
+static struct util_queue mip_queue;
+static unsigned mip_num_threads = 1;
+static once_flag mip_queue_once = ONCE_FLAG_INIT;
+
+static void
+mip_queue_init(void)
+{
+   unsigned threads;
+
+   util_cpu_detect();
+   threads = MIN2(util_get_cpu_caps()->nr_cpus, MIP_MAX_THREADS);
+
+   /* the calling thread filters a band too */
+   if (threads > 1 &&
+       util_queue_init(&mip_queue, "mipmap", MIP_MAX_THREADS, threads - 1,
+                       UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL))
+      mip_num_threads = threads;
+}
+
+
+/**
+ * Whether util_gen_mipmap_cpu_level() can filter the given format.
+ */
+bool
+util_gen_mipmap_cpu_supported(enum pipe_format format)
+{
+   unsigned srgb_mask;
+
+   return mip_row_func_for_format(format, &srgb_mask) != NULL;
+}
+
+
+/**
+ * Generate one mipmap level of a 2D image or array from the level above
+ * it, with a 2x2 box filter.  Odd source dimensions drop their last
+ * column or row, as the GL fallback does.  Both levels must be linear
+ * and are only accessed through the given layer pointers.
+ *
+ * \param src  array[num_layers] of pointers to the source layers
+ * \param dst  array[num_layers] of pointers to the destination layers
+ * \return false if the format or the sizes aren't handled
+ */
+bool
+util_gen_mipmap_cpu_level(enum pipe_format format, unsigned num_layers,
+                          const uint8_t * const *src, unsigned src_stride,
+                          unsigned src_width, unsigned src_height,
+                          uint8_t * const *dst, unsigned dst_stride,
+                          unsigned dst_width, unsigned dst_height)
+{
+   struct mip_level level;
+   struct mip_band bands[MIP_MAX_THREADS];
+   unsigned rows, num_bands, i;
+   uint64_t texels;
+
+   level.row = mip_row_func_for_format(format, &level.srgb_mask);
+   if (!level.row ||
+       dst_width != MAX2(src_width / 2, 1) ||
+       dst_height != MAX2(src_height / 2, 1))
+      return false;
+
+   level.bpp = util_format_get_blocksize(format);
+   level.src = src;
+   level.src_stride = src_stride;
+   level.src_width = src_width;
+   level.src_height = src_height;
+   level.dst = dst;
+   level.dst_stride = dst_stride;
+   level.dst_width = dst_width;
+   level.dst_height = dst_height;
+
+   rows = num_layers * dst_height;
+   texels = (uint64_t)rows * dst_width;
+
+   call_once(&mip_queue_once, mip_queue_init);
+   if (level.row == mip_row_srgb8)
+      call_once(&mip_srgb_once, mip_srgb_init);
+
+   num_bands = MIN2(mip_num_threads, rows);
+   if (texels < (uint64_t)num_bands * MIP_BAND_TEXELS)
+      num_bands = DIV_ROUND_UP(texels, MIP_BAND_TEXELS);
+   if (num_bands <= 1) {
+      mip_filter_rows(&level, 0, rows);
+      return true;
+   }
+
+   for (i = 0; i < num_bands; i++) {
+      bands[i].level = &level;
+      bands[i].first_row = rows * i / num_bands;
+      bands[i].last_row = rows * (i + 1) / num_bands;
+   }
+
+   for (i = 1; i < num_bands; i++) {
+      util_queue_fence_init(&bands[i].fence);
+      util_queue_add_job(&mip_queue, &bands[i], &bands[i].fence,
+                         mip_band_execute, NULL, 0);
+   }
+
+   mip_filter_rows(&level, bands[0].first_row, bands[0].last_row);
+
+   for (i = 1; i < num_bands; i++) {
+      util_queue_fence_wait(&bands[i].fence);
+      util_queue_fence_destroy(&bands[i].fence);
+   }
+
+   return true;
+}
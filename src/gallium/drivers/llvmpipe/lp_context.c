@@ -38,6 +38,7 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/u_upload_mgr.h"
+#include "util/u_threaded_context.h"
 #include "lp_clear.h"
 #include "lp_context.h"
 #include "lp_flush.h"
@@ -307,7 +308,21 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
     */
    llvmpipe->dirty |= LP_NEW_SCISSOR;
 
-   return &llvmpipe->pipe;
+   if (!(flags & PIPE_CONTEXT_PREFER_THREADED) ||
+       (flags & PIPE_CONTEXT_COMPUTE_ONLY) ||
+       !llvmpipe_screen(screen)->allow_threaded)
+      return &llvmpipe->pipe;
+
+   /* No create_fence: flushes through the threaded context stay
+    * synchronous, only state changes, draws and maps are deferred.
+    */
+   return threaded_context_create(&llvmpipe->pipe,
+                                  &llvmpipe_screen(screen)->transfer_pool,
+                                  llvmpipe_replace_buffer_storage,
+                                  &(struct threaded_context_options) {
+                                     .is_resource_busy = llvmpipe_is_resource_busy,
+                                  },
+                                  NULL);
 
  fail:
    llvmpipe_destroy(&llvmpipe->pipe);
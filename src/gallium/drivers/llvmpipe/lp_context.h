@@ -152,6 +152,7 @@ struct llvmpipe_context {
    struct blitter_context *blitter;
 
    unsigned tex_timestamp;
+   unsigned cs_tex_timestamp;
 
    /** List of all fragment shader variants */
    struct lp_fs_variant_list_item fs_variants_list;
@@ -161,6 +162,11 @@ struct llvmpipe_context {
    boolean permit_linear_rasterizer;
    boolean single_vp;
 
+   /** Why the framebuffer/viewports, and the bound fragment shader
+    * variant, rule out the linear rasterizer (enum lp_linear_reason) */
+   unsigned linear_reason;
+   unsigned fs_linear_reason;
+
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
 
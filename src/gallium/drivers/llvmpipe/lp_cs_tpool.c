@@ -80,6 +80,7 @@ lp_cs_tpool_worker(void *data)
    }
    mtx_unlock(&pool->m);
    FREE(lmem.local_mem_ptr);
+   align_free(lmem.cache);
    return 0;
 }
 
@@ -136,6 +137,7 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
          work(data, t, &lmem);
       }
       FREE(lmem.local_mem_ptr);
+      align_free(lmem.cache);
       return NULL;
    }
    task = CALLOC_STRUCT(lp_cs_tpool_task);
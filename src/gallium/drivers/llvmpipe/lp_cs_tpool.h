@@ -51,9 +51,12 @@ struct lp_cs_tpool {
    bool shutdown;
 };
 
+struct lp_build_format_cache;
+
 struct lp_cs_local_mem {
    unsigned local_size;
    void *local_mem_ptr;
+   struct lp_build_format_cache *cache;
 };
 
 typedef void (*lp_cs_tpool_task_func)(void *data, int iter_idx, struct lp_cs_local_mem *lmem);
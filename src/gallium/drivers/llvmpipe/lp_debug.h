@@ -65,6 +65,9 @@
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
 #define PERF_NO_RAST_LINEAR 0x100  	/* disable linear rast */
 #define PERF_NO_SHADE       0x200  	/* disable fragment shaders */
+#define PERF_NO_RAST_AVX    0x400  	/* disable AVX2/AVX-512 triangle rast */
+#define PERF_NO_TEX_TILED   0x800  	/* store all textures linearly */
+#define PERF_NO_HIZ         0x1000 	/* no hierarchical depth rejection */
 
 
 extern int LP_PERF;
@@ -38,7 +38,9 @@
 
 #include "lp_context.h"
 #include "lp_state.h"
+#include "lp_perf.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 
 #include "draw/draw_context.h"
 
@@ -73,9 +75,13 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
       return;
    }
 
-   if (lp->dirty)
+   if (lp->dirty ||
+       lp->tex_timestamp != llvmpipe_screen(pipe->screen)->timestamp)
       llvmpipe_update_derived( lp );
 
+   LP_COUNT(nr_linear_draws[lp->linear_reason ? lp->linear_reason :
+                            lp->fs_linear_reason]);
+
    /*
     * Map vertex buffers
     */
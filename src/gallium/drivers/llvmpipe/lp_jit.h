@@ -301,7 +301,8 @@ enum {
  * @param dady          shader input dady
  * @param color         color buffer
  * @param depth         depth buffer
- * @param mask          mask of visible pixels in block (16-bits per sample)
+ * @param mask          mask of visible pixels in block (16-bits per sample,
+ *                      LP_MASK_WORDS words of four samples each)
  * @param thread_data   task thread data
  * @param stride        color buffer row stride in bytes
  * @param depth_stride  depth buffer row stride in bytes
@@ -316,7 +317,7 @@ typedef void
                     const void *dady,
                     uint8_t **color,
                     uint8_t *depth,
-                    uint64_t mask,
+                    const uint64_t *mask,
                     struct lp_jit_thread_data *thread_data,
                     unsigned *stride,
                     unsigned depth_stride,
@@ -39,6 +39,11 @@
 #define TILE_ORDER 6
 #define TILE_SIZE (1 << TILE_ORDER)
 
+/**
+ * Number of 64-bit words in a bitmask with one bit per 4x4 block of a tile.
+ */
+#define LP_TILE_BLOCK_WORDS ((TILE_SIZE / 4) * (TILE_SIZE / 4) / 64)
+
 
 /**
  * Max texture sizes
@@ -64,7 +69,13 @@
 #define LP_MAX_HEIGHT (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
-#define LP_MAX_SAMPLES 4
+#define LP_MAX_SAMPLES 16
+
+/**
+ * Number of 64-bit words in a 4x4 block coverage mask, which holds 16 bits
+ * per sample.
+ */
+#define LP_MASK_WORDS (LP_MAX_SAMPLES / 4)
 
 #define LP_MAX_THREADS 16
 
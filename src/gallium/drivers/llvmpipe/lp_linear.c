@@ -33,10 +33,12 @@
 #include "util/u_pack_color.h"
 #include "util/u_rect.h"
 #include "util/u_sse.h"
+#include "util/u_surface.h"
 
 #include "lp_jit.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 #include "lp_state_fs.h"
 #include "lp_linear_priv.h"
 
@@ -55,19 +57,109 @@ linear_fallback(const struct lp_rast_state *state,
                 uint8_t *color,
                 unsigned stride)
 {
-   unsigned col = 0x808000ff;
-   int i;
+   enum pipe_format format = state->variant->key.cbuf_format[0];
+   union util_color uc;
 
-   for (y = 0; y < height; y++) {
-      for (i = 0; i < 64; i++) {
-         *((uint32_t *)(color + y*stride) + x + i) = col;
-      }
-   }
+   util_pack_color_ub(0xff, 0, 0xff, 0x80, format, &uc);
+
+   util_fill_rect(color,
+                  format,
+                  stride,
+                  x,
+                  y,
+                  width,
+                  height,
+                  &uc);
 
    return TRUE;
 }
 
 
+/* Expand a row of 565 pixels to the 8-bit BGRX the linear shaders work
+ * on, and back.  The destination of the unpack is 16-byte aligned.
+ */
+static void
+unpack_565_row(const uint16_t *src, uint32_t *dst, unsigned width)
+{
+   const __m128i mask5 = _mm_set1_epi32(0x1f);
+   const __m128i mask6 = _mm_set1_epi32(0x3f);
+   const __m128i alpha = _mm_set1_epi32(0xff000000);
+   const __m128i zero = _mm_setzero_si128();
+   unsigned i;
+
+   for (i = 0; i + 4 <= width; i += 4) {
+      __m128i p = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)&src[i]),
+                                     zero);
+      __m128i b = _mm_and_si128(p, mask5);
+      __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), mask6);
+      __m128i r = _mm_srli_epi32(p, 11);
+
+      b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+      g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+      r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+
+      p = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(r, 16)),
+                       _mm_or_si128(_mm_slli_epi32(g, 8), b));
+      _mm_store_si128((__m128i *)&dst[i], p);
+   }
+
+   for (; i < width; i++) {
+      uint32_t p = src[i];
+      uint32_t b = p & 0x1f;
+      uint32_t g = (p >> 5) & 0x3f;
+      uint32_t r = p >> 11;
+
+      b = (b << 3) | (b >> 2);
+      g = (g << 2) | (g >> 4);
+      r = (r << 3) | (r >> 2);
+
+      dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+   }
+}
+
+
+/* Rounded v * (2^bits - 1) / 255, as (t + (t >> 8)) >> 8 with
+ * t = v * (2^bits - 1) + 128, which is exact for all 8-bit v.
+ */
+static inline __m128i
+scale_unorm8(__m128i v, unsigned bits)
+{
+   __m128i t = _mm_sub_epi32(_mm_slli_epi32(v, bits), v);
+   t = _mm_add_epi32(t, _mm_set1_epi32(128));
+   return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+}
+
+
+static void
+pack_565_row(const uint32_t *src, uint16_t *dst, unsigned width)
+{
+   const __m128i mask8 = _mm_set1_epi32(0xff);
+   unsigned i;
+
+   for (i = 0; i + 4 <= width; i += 4) {
+      __m128i p = _mm_load_si128((const __m128i *)&src[i]);
+      __m128i b = scale_unorm8(_mm_and_si128(p, mask8), 5);
+      __m128i g = scale_unorm8(_mm_and_si128(_mm_srli_epi32(p, 8), mask8), 6);
+      __m128i r = scale_unorm8(_mm_and_si128(_mm_srli_epi32(p, 16), mask8), 5);
+
+      p = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11),
+                                    _mm_slli_epi32(g, 5)), b);
+      /* sign extend so the saturating pack keeps the low 16 bits */
+      p = _mm_srai_epi32(_mm_slli_epi32(p, 16), 16);
+      _mm_storel_epi64((__m128i *)&dst[i], _mm_packs_epi32(p, p));
+   }
+
+   for (; i < width; i++) {
+      uint32_t p = src[i];
+      uint32_t b = ((p & 0xff) * 31 + 127) / 255;
+      uint32_t g = (((p >> 8) & 0xff) * 63 + 127) / 255;
+      uint32_t r = (((p >> 16) & 0xff) * 31 + 127) / 255;
+
+      dst[i] = (uint16_t)((r << 11) | (g << 5) | b);
+   }
+}
+
+
 /* Run our configurable linear shader pipeline:
  */
 static boolean
@@ -91,9 +183,12 @@ lp_fs_linear_run(const struct lp_rast_state *state,
    const float w0 = a0[0][3];
    float oow = 1.0f/w0;
 
+   const enum pipe_format cbuf_format = variant->key.cbuf_format[0];
+   const boolean rgba_order = lp_linear_rgba_order(cbuf_format);
    unsigned input_mask = variant->linear_input_mask;
    int nr_consts = info->base.file_max[TGSI_FILE_CONSTANT]+1;
    int nr_tex = info->num_texs;
+   UNUSED enum lp_linear_reason reason;  /* only counted in debug builds */
    int i, j;
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
@@ -104,6 +199,7 @@ lp_fs_linear_run(const struct lp_rast_state *state,
        dady[0][3] != 0.0f) {
       if (LP_DEBUG & DEBUG_LINEAR2)
          debug_printf("  -- w not constant\n");
+      reason = LP_LINEAR_FAIL_W;
       goto fail;
    }
 
@@ -118,6 +214,7 @@ lp_fs_linear_run(const struct lp_rast_state *state,
             if (val < 0.0f || val > 1.0f) {
                if (LP_DEBUG & DEBUG_LINEAR2)
                   debug_printf("  -- const[%d] out of range %f\n", i, val);
+               reason = LP_LINEAR_FAIL_CONSTANTS;
                goto fail;
             }
             constants[i][j] = (uint8_t)(val * 255.0f);
@@ -132,6 +229,7 @@ lp_fs_linear_run(const struct lp_rast_state *state,
          if (val < 0.0f || val > 1.0f) {
             if (LP_DEBUG & DEBUG_LINEAR2)
                debug_printf("  -- const[%d] out of range %f\n", i, val);
+            reason = LP_LINEAR_FAIL_CONSTANTS;
             goto fail;
          }
          nir_constants[i] = (uint8_t)(val * 255.0f);
@@ -139,15 +237,22 @@ lp_fs_linear_run(const struct lp_rast_state *state,
       jit.constants = (const uint8_t (*)[4])nir_constants;
    }
 
-   /* We assume BGRA ordering */
-   assert(variant->key.cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM ||
-          variant->key.cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM);
+   /* Pixels are BGRA or RGBA ordered, with 565 expanded to BGRX */
+   assert(lp_linear_cbuf_format(cbuf_format));
 
-   jit.blend_color =
-         state->jit_context.u8_blend_color[32] +
-         (state->jit_context.u8_blend_color[16] << 8) +
-         (state->jit_context.u8_blend_color[0] << 16) +
-         (state->jit_context.u8_blend_color[48] << 24);
+   if (rgba_order) {
+      jit.blend_color =
+            state->jit_context.u8_blend_color[0] +
+            (state->jit_context.u8_blend_color[16] << 8) +
+            (state->jit_context.u8_blend_color[32] << 16) +
+            (state->jit_context.u8_blend_color[48] << 24);
+   } else {
+      jit.blend_color =
+            state->jit_context.u8_blend_color[32] +
+            (state->jit_context.u8_blend_color[16] << 8) +
+            (state->jit_context.u8_blend_color[0] << 16) +
+            (state->jit_context.u8_blend_color[48] << 24);
+   }
 
    jit.alpha_ref_value = float_to_ubyte(state->jit_context.alpha_ref_value);
 
@@ -165,12 +270,14 @@ lp_fs_linear_run(const struct lp_rast_state *state,
                                  x, y, width, height,
                                  usage_mask,
                                  perspective,
+                                 rgba_order,
                                  oow,
                                  a0[i+1],
                                  dadx[i+1],
                                  dady[i+1])) {
          if (LP_DEBUG & DEBUG_LINEAR2)
             debug_printf("  -- init_interp(%d) failed\n", i);
+         reason = LP_LINEAR_FAIL_INTERP;
          goto fail;
       }
 
@@ -193,10 +300,12 @@ lp_fs_linear_run(const struct lp_rast_state *state,
                                   tex_info,
                                   lp_fs_variant_key_sampler_idx(&variant->key, unit),
                                   &state->jit_context.textures[unit],
+                                  rgba_order,
                                   x, y, width, height,
                                   a0, dadx, dady)) {
          if (LP_DEBUG & DEBUG_LINEAR2)
             debug_printf("  -- init_sampler(%d) failed\n", i);
+         reason = LP_LINEAR_FAIL_SAMPLER;
          goto fail;
       }
 
@@ -204,15 +313,39 @@ lp_fs_linear_run(const struct lp_rast_state *state,
    }
 
    /* JIT function already does blending */
-   jit.color0 = color + x * 4 + y * stride;
-   for (y = 0; y < height; y++) {
-      jit_func(&jit, 0, 0, width);
-      jit.color0 += stride;
+   if (cbuf_format == PIPE_FORMAT_B5G6R5_UNORM) {
+      PIPE_ALIGN_VAR(16) uint32_t row[TILE_SIZE];
+      uint16_t *dst = (uint16_t *)(color + x * 2 + y * stride);
+
+      /* Opaque shaders with all of RGB written never read the destination,
+       * but the alpha test keeps it for the pixels that fail.
+       */
+      const boolean read_dst = variant->key.blend.rt[0].blend_enable ||
+                               variant->key.alpha.enabled ||
+                               (variant->key.blend.rt[0].colormask & 7) != 7;
+
+      assert(width <= TILE_SIZE);
+      jit.color0 = (uint8_t *)row;
+      for (y = 0; y < height; y++) {
+         if (read_dst)
+            unpack_565_row(dst, row, width);
+         jit_func(&jit, 0, 0, width);
+         pack_565_row(row, dst, width);
+         dst = (uint16_t *)((uint8_t *)dst + stride);
+      }
+   } else {
+      jit.color0 = color + x * 4 + y * stride;
+      for (y = 0; y < height; y++) {
+         jit_func(&jit, 0, 0, width);
+         jit.color0 += stride;
+      }
    }
 
    return TRUE;
 
 fail:
+   LP_COUNT(nr_linear_rects[reason]);
+
    /* Visually distinguish this from other fallbacks:
     */
    if (LP_DEBUG & DEBUG_LINEAR) {
@@ -325,7 +458,8 @@ lp_linear_check_variant(struct lp_fragment_shader_variant *variant)
 
       /* XXX: Relax this once setup premultiplies by oow:
        */
-      if (info->base.input_interpolate[unit] != TGSI_INTERPOLATE_PERSPECTIVE) {
+      if (info->base.input_interpolate[tex_info->coord[0].u.index] !=
+          TGSI_INTERPOLATE_PERSPECTIVE) {
          if (LP_DEBUG & DEBUG_LINEAR)
             debug_printf(" -- samp[%d]: texcoord not perspective\n", i);
          goto fail;
@@ -335,6 +469,7 @@ lp_linear_check_variant(struct lp_fragment_shader_variant *variant)
       if (!lp_linear_check_sampler(samp, tex_info)) {
          if (LP_DEBUG & DEBUG_LINEAR)
             debug_printf(" -- samp[%d]: check_sampler failed\n", i);
+         variant->linear_reason = LP_LINEAR_FAIL_TEXTURE;
          goto fail;
       }
    }
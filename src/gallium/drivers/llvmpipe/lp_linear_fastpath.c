@@ -204,6 +204,11 @@ lp_linear_check_fastpath(struct lp_fragment_shader_variant *variant)
    if (!samp0)
       return false;
 
+   /* The blits copy BGRA texels straight to the color buffer */
+   if (variant->key.cbuf_format[0] != PIPE_FORMAT_B8G8R8A8_UNORM &&
+       variant->key.cbuf_format[0] != PIPE_FORMAT_B8G8R8X8_UNORM)
+      return false;
+
    enum pipe_format tex_format = samp0->texture_state.format;
    if (variant->shader->kind == LP_FS_KIND_BLIT_RGBA &&
        tex_format == PIPE_FORMAT_B8G8R8A8_UNORM &&
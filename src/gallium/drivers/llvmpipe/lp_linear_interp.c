@@ -122,6 +122,7 @@ lp_linear_init_interp(struct lp_linear_interp *interp,
                       int x, int y, int width, int height,
                       unsigned usage_mask,
                       boolean perspective,
+                      boolean rgba_order,
                       float oow,
                       const float *a0,
                       const float *dadx,
@@ -133,6 +134,7 @@ lp_linear_init_interp(struct lp_linear_interp *interp,
    int16_t s0_fp[8];
    int16_t dsdx_fp[4];
    int16_t dsdy_fp[4];
+   int r, b;
    int j;
 
    /* Zero coefficients to avoid using uninitialised values */
@@ -200,14 +202,18 @@ lp_linear_init_interp(struct lp_linear_interp *interp,
 
    interp->width = align(width, 4);
 
-   interp->a0    = _mm_setr_epi16(s0_fp[2], s0_fp[1], s0_fp[0], s0_fp[3],
-                                  s0_fp[6], s0_fp[5], s0_fp[4], s0_fp[7]);
+   /* Pack in the byte order of the color buffer */
+   r = rgba_order ? 0 : 2;
+   b = rgba_order ? 2 : 0;
 
-   interp->dadx  = _mm_setr_epi16(dsdx_fp[2], dsdx_fp[1], dsdx_fp[0], dsdx_fp[3],
-                                  dsdx_fp[2], dsdx_fp[1], dsdx_fp[0], dsdx_fp[3]);
+   interp->a0    = _mm_setr_epi16(s0_fp[r], s0_fp[1], s0_fp[b], s0_fp[3],
+                                  s0_fp[r + 4], s0_fp[5], s0_fp[b + 4], s0_fp[7]);
 
-   interp->dady  = _mm_setr_epi16(dsdy_fp[2], dsdy_fp[1], dsdy_fp[0], dsdy_fp[3],
-                                  dsdy_fp[2], dsdy_fp[1], dsdy_fp[0], dsdy_fp[3]);
+   interp->dadx  = _mm_setr_epi16(dsdx_fp[r], dsdx_fp[1], dsdx_fp[b], dsdx_fp[3],
+                                  dsdx_fp[r], dsdx_fp[1], dsdx_fp[b], dsdx_fp[3]);
+
+   interp->dady  = _mm_setr_epi16(dsdy_fp[r], dsdy_fp[1], dsdy_fp[b], dsdy_fp[3],
+                                  dsdy_fp[r], dsdy_fp[1], dsdy_fp[b], dsdy_fp[3]);
 
    /* If the value is y-invariant, eagerly calculate it here and then
     * always return the precalculated value.
@@ -233,6 +239,7 @@ lp_linear_init_interp(struct lp_linear_interp *interp,
                       int x, int y, int width, int height,
                       unsigned usage_mask,
                       boolean perspective,
+                      boolean rgba_order,
                       float oow,
                       const float *a0,
                       const float *dadx,
@@ -29,6 +29,12 @@ struct lp_linear_sampler {
    int width;
    boolean axis_aligned;
 
+   /**
+    * The texel fetch, when fetch swaps red and blue around it for a
+    * texture in the other byte order from the color buffer.
+    */
+   lp_linear_func fetch_unswapped;
+
    PIPE_ALIGN_VAR(16) uint32_t row[64];
    PIPE_ALIGN_VAR(16) uint32_t stretched_row[2][64];
 
@@ -131,6 +137,7 @@ lp_linear_init_interp(struct lp_linear_interp *interp,
                       int x, int y, int width, int height,
                       unsigned usage_mask,
                       boolean perspective,
+                      boolean rgba_order,
                       float oow,
                       const float *a0,
                       const float *dadx,
@@ -141,6 +148,7 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
                        const struct lp_tgsi_texture_info *info,
                        const struct lp_sampler_static_state *sampler_state,
                        const struct lp_jit_texture *texture,
+                       boolean rgba_order,
                        int x0, int y0, int width, int height,
                        const float (*a0)[4],
                        const float (*dadx)[4],
@@ -730,6 +730,39 @@ sampler_is_nearest(const struct lp_linear_sampler *samp,
    return TRUE;
 }
 
+/* Fetch a row of texels in the other byte order from the color buffer,
+ * and swap red and blue.  The row may point straight into the texture or
+ * at a cached stretched row, so the result always goes to samp->row.
+ */
+static const uint32_t *
+fetch_swap_rb(struct lp_linear_elem *elem)
+{
+   struct lp_linear_sampler *samp = (struct lp_linear_sampler *)elem;
+   const uint32_t *src = samp->fetch_unswapped(elem);
+   uint32_t *row = samp->row;
+   const __m128i mask_ag = _mm_set1_epi32(0xff00ff00);
+   const __m128i mask_rb = _mm_set1_epi32(0x00ff00ff);
+   int i;
+
+   for (i = 0; i + 4 <= samp->width; i += 4) {
+      __m128i texels = _mm_loadu_si128((const __m128i *)&src[i]);
+      __m128i ag = _mm_and_si128(texels, mask_ag);
+      __m128i rb = _mm_and_si128(texels, mask_rb);
+      rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+      _mm_store_si128((__m128i *)&row[i], _mm_or_si128(ag, rb));
+   }
+
+   for (; i < samp->width; i++) {
+      uint32_t texel = src[i];
+      row[i] = (texel & 0xff00ff00) |
+               ((texel & 0xff) << 16) |
+               ((texel >> 16) & 0xff);
+   }
+
+   return row;
+}
+
+
 /* XXX: Lots of static-state parameters being passed in here but very
  * little info is extracted from each one.  Consolidate it all down to
  * something succinct in the prepare phase?
@@ -739,6 +772,7 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
                        const struct lp_tgsi_texture_info *info,
                        const struct lp_sampler_static_state *sampler_state,
                        const struct lp_jit_texture *texture,
+                       boolean rgba_order,
                        int x0, int y0, int width, int height,
                        const float (*a0)[4],
                        const float (*dadx)[4],
@@ -770,6 +804,8 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
    boolean minify;
    boolean need_wrap;
    boolean is_nearest;
+   boolean swap_rb;
+   enum pipe_format format;
 
    samp->texture = texture;
    samp->width = width;
@@ -884,8 +920,26 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
        return FALSE;
    }
 
+   /* RGBA textures use the BGRA fetches, with red and blue swapped
+    * afterwards when the color buffer is in the other order.
+    */
+   format = sampler_state->texture_state.format;
+   switch (format) {
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      format = PIPE_FORMAT_B8G8R8A8_UNORM;
+      swap_rb = !rgba_order;
+      break;
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      format = PIPE_FORMAT_B8G8R8X8_UNORM;
+      swap_rb = !rgba_order;
+      break;
+   default:
+      swap_rb = rgba_order;
+      break;
+   }
+
    if (is_nearest) {
-      switch (sampler_state->texture_state.format) {
+      switch (format) {
       case PIPE_FORMAT_B8G8R8A8_UNORM:
          if (need_wrap)
             samp->base.fetch = fetch_bgra_clamp;
@@ -895,8 +949,7 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
             samp->base.fetch = fetch_bgra_axis_aligned;
          else
             samp->base.fetch = fetch_bgra_memcpy;
-
-         return TRUE;
+         break;
 
       case PIPE_FORMAT_B8G8R8X8_UNORM:
          if (need_wrap)
@@ -907,21 +960,18 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
             samp->base.fetch = fetch_bgrx_axis_aligned;
          else
             samp->base.fetch = fetch_bgrx_memcpy;
-
-         return TRUE;
+         break;
 
       default:
-         break;
+         FAIL("unknown format for nearest");
       }
-
-      FAIL("unknown format for nearest");
    }
    else {
       samp->stretched_row_y[0] = -1;
       samp->stretched_row_y[1] = -1;
       samp->stretched_row_index = 0;
 
-      switch (sampler_state->texture_state.format) {
+      switch (format) {
       case PIPE_FORMAT_B8G8R8A8_UNORM:
          if (need_wrap)
             samp->base.fetch = fetch_bgra_clamp_linear;
@@ -929,8 +979,7 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
             samp->base.fetch = fetch_bgra_linear;
          else
             samp->base.fetch = fetch_bgra_axis_aligned_linear;
-
-         return TRUE;
+         break;
 
       case PIPE_FORMAT_B8G8R8X8_UNORM:
          if (need_wrap)
@@ -939,14 +988,19 @@ lp_linear_init_sampler(struct lp_linear_sampler *samp,
             samp->base.fetch = fetch_bgrx_linear;
          else
             samp->base.fetch = fetch_bgrx_axis_aligned_linear;
-         return TRUE;
+         break;
 
       default:
-         break;
+         FAIL("unknown format");
       }
+   }
 
-      FAIL("unknown format");
+   if (swap_rb) {
+      samp->fetch_unswapped = samp->base.fetch;
+      samp->base.fetch = fetch_swap_rb;
    }
+
+   return TRUE;
 }
 
 
@@ -993,7 +1047,9 @@ lp_linear_check_sampler(const struct lp_sampler_static_state *sampler,
    /* These are the only texture formats we support at the moment
     */
    if (sampler->texture_state.format != PIPE_FORMAT_B8G8R8A8_UNORM &&
-       sampler->texture_state.format != PIPE_FORMAT_B8G8R8X8_UNORM)
+       sampler->texture_state.format != PIPE_FORMAT_B8G8R8X8_UNORM &&
+       sampler->texture_state.format != PIPE_FORMAT_R8G8B8A8_UNORM &&
+       sampler->texture_state.format != PIPE_FORMAT_R8G8B8X8_UNORM)
       return FALSE;
 
    return TRUE;
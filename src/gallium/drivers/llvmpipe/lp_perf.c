@@ -34,6 +34,24 @@
 struct lp_counters lp_count;
 
 
+static const char *lp_linear_reason_names[LP_LINEAR_REASONS] = {
+   "ok",
+   "framebuffer",
+   "viewports",
+   "stencil",
+   "depth",
+   "kill",
+   "logicop",
+   "texture",
+   "shader",
+   "varying w",
+   "constants",
+   "interpolants",
+   "sampler",
+   "depth slope",
+};
+
+
 void
 lp_reset_counters(void)
 {
@@ -88,6 +106,9 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_partially_covered_16x16: %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_16, p3, total_16);
       debug_printf("llvmpipe:   nr_empty_16x16:             %9u (%3.0f%% of %u)\n", lp_count.nr_empty_16, p1, total_16);
 
+      debug_printf("llvmpipe: nr_hiz_rejected_64x64:        %9u\n", lp_count.nr_hiz_rejected_64);
+      debug_printf("llvmpipe: nr_hiz_rejected_16x16:        %9u\n", lp_count.nr_hiz_rejected_16);
+
       total_4 = (lp_count.nr_empty_4 +
                  lp_count.nr_fully_covered_4 +
                  lp_count.nr_partially_covered_4);
@@ -114,6 +135,19 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_rect_part_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_rect_partially_covered_4, p2, total_4);
 
 
+      debug_printf("llvmpipe: nr_linear_draws:              %9u\n", lp_count.nr_linear_draws[LP_LINEAR_OK]);
+      for (unsigned i = 1; i < LP_LINEAR_REASONS; i++) {
+         if (lp_count.nr_linear_draws[i])
+            debug_printf("llvmpipe:   not linear, %-16s  %9u\n",
+                         lp_linear_reason_names[i], lp_count.nr_linear_draws[i]);
+      }
+      debug_printf("llvmpipe: nr_linear_rects:              %9u\n", lp_count.nr_linear_rects[LP_LINEAR_OK]);
+      for (unsigned i = 1; i < LP_LINEAR_REASONS; i++) {
+         if (lp_count.nr_linear_rects[i])
+            debug_printf("llvmpipe:   fallback, %-16s    %9u\n",
+                         lp_linear_reason_names[i], lp_count.nr_linear_rects[i]);
+      }
+
       debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
@@ -35,6 +35,34 @@
 
 #include "pipe/p_compiler.h"
 
+
+/**
+ * Why the linear rasterizer could not handle a draw, or a rectangle
+ * within a draw.  The first group are static: the framebuffer, pipeline
+ * state or shader rules the path out for the whole draw.  The second group
+ * are found at rasterization time, and the rectangle is shaded by the
+ * generic fragment shader instead.
+ */
+enum lp_linear_reason
+{
+   LP_LINEAR_OK = 0,
+   LP_LINEAR_FAIL_FRAMEBUFFER,  /**< color format, samples, layers */
+   LP_LINEAR_FAIL_VIEWPORTS,
+   LP_LINEAR_FAIL_STENCIL,
+   LP_LINEAR_FAIL_DEPTH,        /**< depth state or format */
+   LP_LINEAR_FAIL_KILL,         /**< discard, alpha test with depth */
+   LP_LINEAR_FAIL_LOGICOP,
+   LP_LINEAR_FAIL_TEXTURE,      /**< texture format, layout or filtering */
+   LP_LINEAR_FAIL_SHADER,       /**< instructions, inputs or constants */
+   LP_LINEAR_FAIL_W,            /**< non-constant w */
+   LP_LINEAR_FAIL_CONSTANTS,    /**< constants outside 0..1 */
+   LP_LINEAR_FAIL_INTERP,       /**< interpolants outside 0..1 */
+   LP_LINEAR_FAIL_SAMPLER,      /**< texture coordinates need wrapping */
+   LP_LINEAR_FAIL_DEPTH_SLOPE,  /**< depth varies across the rectangle */
+   LP_LINEAR_REASONS
+};
+
+
 /**
  * Various counters
  */
@@ -62,9 +90,15 @@ struct lp_counters
    unsigned nr_rect_fully_covered_4;
    unsigned nr_rect_partially_covered_4;
    unsigned nr_non_empty_4;
+   unsigned nr_hiz_rejected_64;
+   unsigned nr_hiz_rejected_16;
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
 
+   /** Draws, and rectangles shaded, per enum lp_linear_reason */
+   unsigned nr_linear_draws[LP_LINEAR_REASONS];
+   unsigned nr_linear_rects[LP_LINEAR_REASONS];
+
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
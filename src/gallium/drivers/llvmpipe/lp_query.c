@@ -341,6 +341,12 @@ llvmpipe_get_query_result_resource(struct pipe_context *pipe,
 
    void *dst = (uint8_t *)lpr->data + offset;
 
+   /* let u_threaded_context know the range holds data now */
+   util_range_add(resource, &lpr->base.valid_buffer_range, offset,
+                  offset + num_values *
+                  ((result_type == PIPE_QUERY_TYPE_I64 ||
+                    result_type == PIPE_QUERY_TYPE_U64) ? 8 : 4));
+
    for (unsigned i = 0; i < num_values; i++) {
 
       if (i == 1) {
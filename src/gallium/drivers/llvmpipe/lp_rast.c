@@ -35,6 +35,8 @@
 #include "util/u_thread.h"
 #include "util/u_memset.h"
 #include "util/os_time.h"
+#define XXH_INLINE_ALL
+#include "util/xxhash.h"
 
 #include "lp_scene_queue.h"
 #include "lp_context.h"
@@ -61,6 +63,32 @@ const float lp_sample_pos_4x[4][2] = { { 0.375, 0.125 },
                                        { 0.125, 0.625 },
                                        { 0.625, 0.875 } };
 
+const float lp_sample_pos_8x[8][2] = { { 0.5625, 0.3125 },
+                                       { 0.4375, 0.6875 },
+                                       { 0.8125, 0.5625 },
+                                       { 0.3125, 0.1875 },
+                                       { 0.1875, 0.8125 },
+                                       { 0.0625, 0.4375 },
+                                       { 0.6875, 0.9375 },
+                                       { 0.9375, 0.0625 } };
+
+const float lp_sample_pos_16x[16][2] = { { 0.5625, 0.5625 },
+                                         { 0.4375, 0.3125 },
+                                         { 0.3125, 0.625 },
+                                         { 0.75, 0.4375 },
+                                         { 0.1875, 0.375 },
+                                         { 0.625, 0.8125 },
+                                         { 0.8125, 0.6875 },
+                                         { 0.6875, 0.1875 },
+                                         { 0.375, 0.875 },
+                                         { 0.5, 0.0625 },
+                                         { 0.25, 0.125 },
+                                         { 0.125, 0.75 },
+                                         { 0.0, 0.5 },
+                                         { 0.9375, 0.25 },
+                                         { 0.875, 0.9375 },
+                                         { 0.0625, 0.0 } };
+
 /**
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
@@ -85,6 +113,479 @@ lp_rast_end( struct lp_rasterizer *rast )
 }
 
 
+/** Coverage mask passed to the shader for blocks only shaded at sample 0 */
+const uint64_t lp_rast_sample0_mask[LP_MASK_WORDS] = { 0xffff };
+
+
+/**
+ * Get the persistent uniform block bits of a multisample color buffer for
+ * the current tile, or NULL if the buffer isn't tracked.
+ */
+static uint64_t *
+lp_rast_ms_resource_bits(struct lp_rasterizer_task *task,
+                         unsigned cbuf, unsigned layer)
+{
+   const struct pipe_surface *surf = task->scene->fb.cbufs[cbuf];
+
+   if (!surf || task->scene->cbufs[cbuf].nr_samples <= 1)
+      return NULL;
+
+   return llvmpipe_ms_uniform_bits(llvmpipe_resource(surf->texture),
+                                   surf->u.tex.first_layer + layer,
+                                   task->x / TILE_SIZE, task->y / TILE_SIZE);
+}
+
+
+/**
+ * Like lp_rast_ms_resource_bits(), for the compressed block bits.
+ */
+static uint64_t *
+lp_rast_ms_resource_compressed(struct lp_rasterizer_task *task,
+                               unsigned cbuf, unsigned layer)
+{
+   const struct pipe_surface *surf = task->scene->fb.cbufs[cbuf];
+
+   if (!surf || task->scene->cbufs[cbuf].nr_samples <= 1)
+      return NULL;
+
+   return llvmpipe_ms_compressed_bits(llvmpipe_resource(surf->texture),
+                                      surf->u.tex.first_layer + layer,
+                                      task->x / TILE_SIZE, task->y / TILE_SIZE);
+}
+
+
+/**
+ * Copy sample 0 of a 4x4 block to all the other samples.
+ */
+static void
+lp_rast_ms_expand_block(struct lp_rasterizer_task *task,
+                        unsigned cbuf, unsigned x, unsigned y, unsigned layer)
+{
+   const struct lp_scene_surface *surf = &task->scene->cbufs[cbuf];
+   const uint8_t *src = lp_rast_get_color_block_pointer(task, cbuf, x, y,
+                                                        layer);
+   const unsigned row_bytes = LP_RASTER_BLOCK_SIZE * surf->format_bytes;
+
+   for (unsigned s = 1; s < surf->nr_samples; s++) {
+      uint8_t *dst = (uint8_t *)src + s * surf->sample_stride;
+      for (unsigned row = 0; row < LP_RASTER_BLOCK_SIZE; row++)
+         memcpy(dst + row * surf->stride, src + row * surf->stride, row_bytes);
+   }
+}
+
+
+/**
+ * Called before shading a 4x4 block of multisample color buffers.
+ *
+ * Blocks which end up with the same value in all samples are only written
+ * at sample 0 and marked compressed; they get expanded again before
+ * anything else touches them, at the latest at the end of the tile.
+ *
+ * \param covered  whether the block is covered at every sample
+ * \return TRUE if only sample 0 needs to be shaded
+ */
+boolean
+lp_rast_ms_block_begin(struct lp_rasterizer_task *task,
+                       unsigned x, unsigned y, boolean covered)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_state *state = task->state;
+   const struct lp_fragment_shader_variant *variant = state->variant;
+   const unsigned block = ((y % TILE_SIZE) / 4) * (TILE_SIZE / 4) +
+                          (x % TILE_SIZE) / 4;
+   const unsigned word = block / 64;
+   const uint64_t bit = (uint64_t)1 << (block % 64);
+   const uint32_t all_samples = (1u << scene->fb_max_samples) - 1;
+   boolean uniform;
+   unsigned i;
+
+   assert(task->ms_tracking);
+
+   uniform = covered &&
+             variant->ms_uniform &&
+             (state->jit_context.sample_mask & all_samples) == all_samples;
+
+   /* Blending with differing samples gives differing samples */
+   if (uniform && variant->ms_reads_dst) {
+      for (i = 0; i < scene->fb.nr_cbufs; i++) {
+         if (scene->cbufs[i].nr_samples > 1 &&
+             !(task->ms_uniform[i][word] & bit))
+            uniform = FALSE;
+      }
+   }
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->cbufs[i].nr_samples <= 1)
+         continue;
+
+      if (uniform) {
+         task->ms_uniform[i][word] |= bit;
+         task->ms_compressed[i][word] |= bit;
+      }
+      else {
+         if (task->ms_compressed[i][word] & bit) {
+            lp_rast_ms_expand_block(task, i, x, y, 0);
+            task->ms_compressed[i][word] &= ~bit;
+         }
+         task->ms_uniform[i][word] &= ~bit;
+      }
+   }
+
+   return uniform;
+}
+
+
+/**
+ * Expand the blocks marked in \p compressed of one layer of the tile.
+ */
+static void
+lp_rast_ms_expand_blocks(struct lp_rasterizer_task *task, unsigned cbuf,
+                         const uint64_t *compressed, unsigned layer)
+{
+   for (unsigned word = 0; word < LP_TILE_BLOCK_WORDS; word++) {
+      uint64_t bits = compressed[word];
+      while (bits) {
+         unsigned block = word * 64 + u_bit_scan64(&bits);
+         lp_rast_ms_expand_block(task, cbuf,
+                                 task->x + (block % (TILE_SIZE / 4)) * 4,
+                                 task->y + (block / (TILE_SIZE / 4)) * 4,
+                                 layer);
+      }
+   }
+}
+
+
+/**
+ * Load what is known about the multisample color buffers of a tile.
+ */
+void
+lp_rast_ms_tile_begin(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+
+   if (scene->fb_max_samples <= 1) {
+      task->ms_tracking = FALSE;
+      return;
+   }
+
+   /* Layered rendering isn't tracked, so blocks earlier scenes left
+    * compressed have to be expanded before rendering writes single samples.
+    */
+   task->ms_tracking = scene->fb_max_layer == 0;
+   if (!task->ms_tracking) {
+      for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+         for (unsigned layer = 0; layer <= scene->fb_max_layer; layer++) {
+            uint64_t *compressed = lp_rast_ms_resource_compressed(task, i, layer);
+            if (compressed) {
+               lp_rast_ms_expand_blocks(task, i, compressed, layer);
+               memset(compressed, 0, LP_TILE_BLOCK_WORDS * sizeof(uint64_t));
+            }
+         }
+      }
+      return;
+   }
+
+   for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+      const uint64_t *bits = lp_rast_ms_resource_bits(task, i, 0);
+      const uint64_t *compressed = lp_rast_ms_resource_compressed(task, i, 0);
+
+      if (bits) {
+         memcpy(task->ms_uniform[i], bits, sizeof task->ms_uniform[i]);
+         memcpy(task->ms_compressed[i], compressed,
+                sizeof task->ms_compressed[i]);
+      }
+      else {
+         memset(task->ms_uniform[i], 0, sizeof task->ms_uniform[i]);
+         memset(task->ms_compressed[i], 0, sizeof task->ms_compressed[i]);
+      }
+   }
+}
+
+
+/**
+ * Store which blocks of the tile are uniform and compressed with the
+ * resources.  Compressed blocks stay that way until a later scene touches
+ * them or llvmpipe_resource_ms_expand() is called; only buffers that can't
+ * keep the bits are expanded here.
+ */
+void
+lp_rast_ms_tile_end(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+
+   if (scene->fb_max_samples <= 1)
+      return;
+
+   for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->cbufs[i].nr_samples <= 1)
+         continue;
+
+      if (!task->ms_tracking) {
+         for (unsigned layer = 0; layer <= scene->fb_max_layer; layer++) {
+            uint64_t *bits = lp_rast_ms_resource_bits(task, i, layer);
+            if (bits)
+               memset(bits, 0, LP_TILE_BLOCK_WORDS * sizeof(uint64_t));
+         }
+         continue;
+      }
+
+      uint64_t *bits = lp_rast_ms_resource_bits(task, i, 0);
+      uint64_t *compressed = lp_rast_ms_resource_compressed(task, i, 0);
+      if (!bits) {
+         lp_rast_ms_expand_blocks(task, i, task->ms_compressed[i], 0);
+         continue;
+      }
+
+      memcpy(bits, task->ms_uniform[i], sizeof task->ms_uniform[i]);
+      memcpy(compressed, task->ms_compressed[i], sizeof task->ms_compressed[i]);
+      for (unsigned word = 0; word < LP_TILE_BLOCK_WORDS; word++) {
+         if (task->ms_compressed[i][word]) {
+            /* read once the scene is done, see llvmpipe_resource_ms_expand() */
+            llvmpipe_resource(scene->fb.cbufs[i]->texture)->ms_has_compressed = true;
+            break;
+         }
+      }
+   }
+}
+
+
+/**
+ * Start tracking depth bounds for the tile.  This needs a single layer
+ * unorm depth buffer; float depth isn't clamped the same way everywhere.
+ */
+void
+lp_rast_hiz_tile_begin(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct util_format_description *desc;
+   const struct util_format_channel_description *chan;
+   unsigned i;
+
+   task->hiz_tracking = FALSE;
+   task->hiz_min_valid = 0;
+   task->hiz_max_valid = 0;
+
+   if (!scene->fb.zsbuf || scene->fb_max_layer > 0 ||
+       (LP_PERF & PERF_NO_HIZ))
+      return;
+
+   desc = util_format_description(scene->fb.zsbuf->format);
+   if (!util_format_has_depth(desc) || desc->block.bits > 32)
+      return;
+
+   chan = &desc->channel[desc->swizzle[0]];
+   if (chan->type != UTIL_FORMAT_TYPE_UNSIGNED || !chan->normalized)
+      return;
+
+   task->hiz_tracking = TRUE;
+   task->hiz_shift = chan->shift;
+   task->hiz_mask = (uint32_t)((1ull << chan->size) - 1);
+   /* a fragment's depth may round either way, the bounds too */
+   task->hiz_eps = 3.0f / task->hiz_mask;
+
+   task->hiz_inside = 0;
+   for (i = 0; i < LP_HIZ_BLOCKS; i++) {
+      if ((i % (TILE_SIZE / 16)) * 16 + 16 <= task->width &&
+          (i / (TILE_SIZE / 16)) * 16 + 16 <= task->height)
+         task->hiz_inside |= 1 << i;
+   }
+}
+
+
+/**
+ * Read the depth bounds of a 16x16 block from the depth buffer.
+ */
+static void
+lp_rast_hiz_load(struct lp_rasterizer_task *task, unsigned block)
+{
+   const struct lp_scene *scene = task->scene;
+   const unsigned x = task->x + (block % (TILE_SIZE / 16)) * 16;
+   const unsigned y = task->y + (block / (TILE_SIZE / 16)) * 16;
+   const uint8_t *depth = lp_rast_get_depth_block_pointer(task, x, y, 0);
+   const unsigned shift = task->hiz_shift;
+   const uint32_t mask = task->hiz_mask;
+   uint32_t zmin = mask, zmax = 0;
+   unsigned s, i, j;
+
+   for (s = 0; s < scene->zsbuf.nr_samples; s++) {
+      const uint8_t *row = depth + s * scene->zsbuf.sample_stride;
+
+      for (j = 0; j < 16; j++, row += scene->zsbuf.stride) {
+         if (scene->zsbuf.format_bytes == 2) {
+            const uint16_t *values = (const uint16_t *)row;
+            for (i = 0; i < 16; i++) {
+               uint32_t z = values[i];
+               zmin = MIN2(zmin, z);
+               zmax = MAX2(zmax, z);
+            }
+         }
+         else {
+            const uint32_t *values = (const uint32_t *)row;
+            for (i = 0; i < 16; i++) {
+               uint32_t z = (values[i] >> shift) & mask;
+               zmin = MIN2(zmin, z);
+               zmax = MAX2(zmax, z);
+            }
+         }
+      }
+   }
+
+   task->hiz_min[block] = (float)((double)zmin / mask);
+   task->hiz_max[block] = (float)((double)zmax / mask);
+   task->hiz_min_valid |= 1 << block;
+   task->hiz_max_valid |= 1 << block;
+}
+
+
+/**
+ * Range of the primitive's depth over a 16x16 block, clamped to [0,1] like
+ * the fragment shader does.  The block is grown by a pixel so that any
+ * sample position is included, and the range by the rounding error of the
+ * shader's interpolation.
+ */
+static void
+lp_rast_hiz_range(const struct lp_rast_shader_inputs *inputs,
+                  unsigned x, unsigned y, float *zmin, float *zmax)
+{
+   /* depth is the z channel of the position, polygon offset its x channel */
+   const float a0 = GET_A0(inputs)[0][2] + GET_A0(inputs)[0][0];
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const float x0 = (float)x - 1.0f, x1 = (float)x + 17.0f;
+   const float y0 = (float)y - 1.0f, y1 = (float)y + 17.0f;
+   const float err = (fabsf(a0) + fabsf(dzdx) * x1 + fabsf(dzdy) * y1) *
+                     (1.0f / (1 << 20));
+   const float lo = a0 + MIN2(dzdx * x0, dzdx * x1) +
+                    MIN2(dzdy * y0, dzdy * y1) - err;
+   const float hi = a0 + MAX2(dzdx * x0, dzdx * x1) +
+                    MAX2(dzdy * y0, dzdy * y1) + err;
+
+   *zmin = CLAMP(lo, 0.0f, 1.0f);
+   *zmax = CLAMP(hi, 0.0f, 1.0f);
+}
+
+
+/**
+ * Return which of the given 16x16 blocks of the current tile the primitive
+ * is known to fail the depth test everywhere in.
+ */
+unsigned
+lp_rast_hiz_reject_blocks(struct lp_rasterizer_task *task,
+                          const struct lp_rast_shader_inputs *inputs,
+                          unsigned blocks)
+{
+   const unsigned func = task->state->variant->key.depth.func;
+   const boolean less = func == PIPE_FUNC_LESS || func == PIPE_FUNC_LEQUAL;
+   unsigned tested = blocks & task->hiz_inside;
+   unsigned rejected = 0;
+
+   while (tested) {
+      const unsigned block = u_bit_scan(&tested);
+      float bound, zmin, zmax;
+
+      if (less) {
+         if (!(task->hiz_max_valid & (1 << block)))
+            lp_rast_hiz_load(task, block);
+         bound = task->hiz_max[block] + task->hiz_eps;
+         /* nothing is beyond the far plane */
+         if (bound >= 1.0f)
+            continue;
+      }
+      else {
+         if (!(task->hiz_min_valid & (1 << block)))
+            lp_rast_hiz_load(task, block);
+         bound = task->hiz_min[block] - task->hiz_eps;
+         if (bound <= 0.0f)
+            continue;
+      }
+
+      lp_rast_hiz_range(inputs,
+                        task->x + (block % (TILE_SIZE / 16)) * 16,
+                        task->y + (block / (TILE_SIZE / 16)) * 16,
+                        &zmin, &zmax);
+
+      if (less ? zmin > bound : zmax < bound)
+         rejected |= 1 << block;
+   }
+
+   LP_COUNT_ADD(nr_hiz_rejected_16, util_bitcount(rejected));
+   if (rejected && rejected == blocks)
+      LP_COUNT(nr_hiz_rejected_64);
+
+   return rejected;
+}
+
+
+/**
+ * Whether the primitive fails the depth test everywhere in a rectangle of
+ * the current tile.
+ */
+boolean
+lp_rast_hiz_reject_rect(struct lp_rasterizer_task *task,
+                        const struct lp_rast_shader_inputs *inputs,
+                        int x, int y, unsigned width, unsigned height)
+{
+   const int x0 = MAX2(x - (int)task->x, 0) / 16;
+   const int y0 = MAX2(y - (int)task->y, 0) / 16;
+   const int x1 = MIN2(x - (int)task->x + (int)width - 1, TILE_SIZE - 1) / 16;
+   const int y1 = MIN2(y - (int)task->y + (int)height - 1, TILE_SIZE - 1) / 16;
+   unsigned blocks = 0;
+   int bx, by;
+
+   if (!task->hiz_tracking || !task->state->variant->hiz_test)
+      return FALSE;
+
+   for (by = y0; by <= y1; by++)
+      for (bx = x0; bx <= x1; bx++)
+         blocks |= 1 << (by * (TILE_SIZE / 16) + bx);
+
+   return lp_rast_hiz_reject_blocks(task, inputs, blocks) == blocks;
+}
+
+
+/**
+ * The primitive has been shaded everywhere in the given 16x16 blocks.  If
+ * every fragment ended up either written, or failing the depth test, the
+ * stored depth is now no further than the primitive's.
+ */
+void
+lp_rast_hiz_covered(struct lp_rasterizer_task *task,
+                    const struct lp_rast_shader_inputs *inputs,
+                    unsigned blocks)
+{
+   const struct lp_rast_state *state = task->state;
+   const unsigned func = state->variant->key.depth.func;
+   unsigned covered = blocks & task->hiz_inside;
+
+   if (!task->hiz_tracking || !state->variant->hiz_full_write ||
+       !(state->jit_context.sample_mask & 1))
+      return;
+
+   while (covered) {
+      const unsigned block = u_bit_scan(&covered);
+      float zmin, zmax;
+
+      lp_rast_hiz_range(inputs,
+                        task->x + (block % (TILE_SIZE / 16)) * 16,
+                        task->y + (block / (TILE_SIZE / 16)) * 16,
+                        &zmin, &zmax);
+
+      if (func == PIPE_FUNC_LESS || func == PIPE_FUNC_LEQUAL) {
+         if (!(task->hiz_max_valid & (1 << block)) ||
+             zmax < task->hiz_max[block])
+            task->hiz_max[block] = zmax;
+         task->hiz_max_valid |= 1 << block;
+      }
+      else {
+         if (!(task->hiz_min_valid & (1 << block)) ||
+             zmin > task->hiz_min[block])
+            task->hiz_min[block] = zmin;
+         task->hiz_min_valid |= 1 << block;
+      }
+   }
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -123,6 +624,9 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
                          scene->zsbuf.stride * task->y +
                          scene->zsbuf.format_bytes * task->x;
    }
+
+   lp_rast_ms_tile_begin(task);
+   lp_rast_hiz_tile_begin(task);
 }
 
 
@@ -169,6 +673,18 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
                     &uc);
    }
 
+   /* All blocks entirely inside the tile now have uniform samples */
+   if (task->ms_tracking && scene->cbufs[cbuf].nr_samples > 1) {
+      memset(task->ms_uniform[cbuf], 0, sizeof task->ms_uniform[cbuf]);
+      memset(task->ms_compressed[cbuf], 0, sizeof task->ms_compressed[cbuf]);
+      for (unsigned by = 0; by < task->height / 4; by++) {
+         for (unsigned bx = 0; bx < task->width / 4; bx++) {
+            unsigned block = by * (TILE_SIZE / 4) + bx;
+            task->ms_uniform[cbuf][block / 64] |= (uint64_t)1 << (block % 64);
+         }
+      }
+   }
+
    /* this will increase for each rb which probably doesn't mean much */
    LP_COUNT(nr_color_tile_clear);
 }
@@ -179,7 +695,7 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
  * This is a bin command called during bin processing.
  * Clear commands always clear all bound layers.
  */
-static void
+void
 lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
                        const union lp_rast_cmd_arg arg)
 {
@@ -288,6 +804,27 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
             dst_layer += scene->zsbuf.layer_stride;
          }
       }
+
+      /* The whole tile now has the cleared depth, or unknown depth */
+      if (task->hiz_tracking) {
+         const uint32_t depth_mask = task->hiz_mask << task->hiz_shift;
+
+         if ((clear_mask & depth_mask) == depth_mask) {
+            const float depth = (float)((double)((clear_value & depth_mask) >>
+                                                 task->hiz_shift) /
+                                        task->hiz_mask);
+            for (i = 0; i < LP_HIZ_BLOCKS; i++) {
+               task->hiz_min[i] = depth;
+               task->hiz_max[i] = depth;
+            }
+            task->hiz_min_valid = task->hiz_inside;
+            task->hiz_max_valid = task->hiz_inside;
+         }
+         else if (clear_mask & depth_mask) {
+            task->hiz_min_valid = 0;
+            task->hiz_max_valid = 0;
+         }
+      }
    }
 }
 
@@ -307,6 +844,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
+   unsigned rejected;
    unsigned x, y;
 
    if (inputs->disable) {
@@ -323,6 +861,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   rejected = lp_rast_hiz_reject(task, inputs, (1 << LP_HIZ_BLOCKS) - 1);
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -334,6 +874,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          unsigned depth_sample_stride = 0;
          unsigned i;
 
+         if (rejected & lp_rast_hiz_block(x, y))
+            continue;
+
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             if (scene->fb.cbufs[i]) {
@@ -357,9 +900,17 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
             depth_sample_stride = scene->zsbuf.sample_stride;
          }
 
-         uint64_t mask = 0;
+         uint64_t mask[LP_MASK_WORDS] = { 0 };
+         const uint64_t *shade_mask = mask;
          for (unsigned i = 0; i < scene->fb_max_samples; i++)
-            mask |= (uint64_t)(0xffff) << (16 * i);
+            mask[i / 4] |= (uint64_t)0xffff << (16 * (i % 4));
+
+         /* Samples all get the same value, only shade the first one */
+         if (task->ms_tracking &&
+             lp_rast_ms_block_begin(task, tile_x + x, tile_y + y, TRUE))
+            shade_mask = lp_rast_sample0_mask;
+
+         lp_rast_hiz_write(task, x, y);
 
          /* Propagate non-interpolated raster state. */
          task->thread_data.raster_state.viewport_index = inputs->viewport_index;
@@ -375,7 +926,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
                                             GET_DADY(inputs),
                                             color,
                                             depth,
-                                            mask,
+                                            shade_mask,
                                             &task->thread_data,
                                             stride,
                                             depth_stride,
@@ -384,6 +935,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          END_JIT_CALL();
       }
    }
+
+   lp_rast_hiz_covered(task, inputs, ~rejected & ((1 << LP_HIZ_BLOCKS) - 1));
 }
 
 
@@ -417,7 +970,7 @@ void
 lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
                                 const struct lp_rast_shader_inputs *inputs,
                                 unsigned x, unsigned y,
-                                uint64_t mask)
+                                const uint64_t *mask)
 {
    const struct lp_rast_state *state = task->state;
    struct lp_fragment_shader_variant *variant = state->variant;
@@ -470,6 +1023,19 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
     * allocated 4x4 blocks hence need to filter them out here.
     */
    if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+      if (task->ms_tracking) {
+         boolean covered = TRUE;
+         for (i = 0; i < scene->fb_max_samples; i++) {
+            if (((mask[i / 4] >> (16 * (i % 4))) & 0xffff) != 0xffff)
+               covered = FALSE;
+         }
+         /* Samples all get the same value, only shade the first one */
+         if (lp_rast_ms_block_begin(task, x, y, covered))
+            mask = lp_rast_sample0_mask;
+      }
+
+      lp_rast_hiz_write(task, x, y);
+
       /* Propagate non-interpolated raster state. */
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
       task->thread_data.raster_state.view_index = inputs->view_index;
@@ -500,9 +1066,9 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask)
 {
-   uint64_t new_mask = 0;
+   uint64_t new_mask[LP_MASK_WORDS] = { 0 };
    for (unsigned i = 0; i < task->scene->fb_max_samples; i++)
-      new_mask |= ((uint64_t)mask) << (16 * i);
+      new_mask[i / 4] |= ((uint64_t)mask) << (16 * (i % 4));
    lp_rast_shade_quads_mask_sample(task, inputs, x, y, new_mask);
 }
 
@@ -700,6 +1266,48 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
 
 
 
+/**
+ * Work out whether the tile's color buffers changed, hashing those whose
+ * damage is tracked and comparing with their previous hashes.
+ */
+static void
+lp_rast_damage_tile_end(struct lp_rasterizer_task *task)
+{
+   struct lp_scene *scene = task->scene;
+   const unsigned tile_x = task->x / TILE_SIZE, tile_y = task->y / TILE_SIZE;
+   boolean changed = FALSE;
+
+   for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+      const struct lp_scene_surface *surf = &scene->cbufs[i];
+      const uint8_t *row = task->color_tiles[i];
+      uint64_t *hash, h = 0;
+
+      if (!scene->fb.cbufs[i])
+         continue;
+
+      if (!surf->hashed) {
+         changed = TRUE;
+         continue;
+      }
+
+      for (unsigned y = 0; y < task->height; y++) {
+         h = XXH64(row, task->width * surf->format_bytes, h);
+         row += surf->stride;
+      }
+
+      hash = llvmpipe_tile_hash(llvmpipe_resource(scene->fb.cbufs[i]->texture),
+                                tile_x, tile_y);
+      if (!hash || h != *hash) {
+         if (hash)
+            *hash = h;
+         changed = TRUE;
+      }
+   }
+
+   scene->tile_changed[tile_y][tile_x] = changed;
+}
+
+
 /**
  * Called when we're done writing to a color tile.
  */
@@ -712,6 +1320,9 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
 
+   lp_rast_ms_tile_end(task);
+   lp_rast_damage_tile_end(task);
+
    /* debug */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
@@ -734,7 +1345,7 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
 static const unsigned
 rast_flags[] = {
    BLIT,                        /* clear color */
-   TRI,                         /* clear zstencil */
+   RECT,                        /* clear zstencil */
    TRI,                         /* triangle_1 */
    TRI,                         /* triangle_2 */
    TRI,                         /* triangle_3 */
@@ -976,14 +1587,13 @@ tri_rasterize_bin(struct lp_rasterizer_task *task,
                   const struct cmd_bin *bin,
                   int x, int y)
 {
+   const lp_rast_cmd_func *dispatch = task->rast->dispatch_tri;
    const struct cmd_block *block;
    unsigned k;
 
-   STATIC_ASSERT(ARRAY_SIZE(dispatch_tri) == LP_RAST_OP_MAX);
-
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
-         dispatch_tri[block->cmd[k]]( task, block->arg[k] );
+         dispatch[block->cmd[k]]( task, block->arg[k] );
       }
    }
 }
@@ -1073,13 +1683,11 @@ rasterize_scene(struct lp_rasterizer_task *task,
 
    /* Clear the cache tags. This should not always be necessary but
       simpler for now. */
-#if LP_USE_TEXTURE_CACHE
    memset(task->thread_data.cache->cache_tags, 0,
           sizeof(task->thread_data.cache->cache_tags));
 #if LP_BUILD_FORMAT_CACHE_DEBUG
    task->thread_data.cache->cache_access_total = 0;
    task->thread_data.cache->cache_access_miss = 0;
-#endif
 #endif
 
    if (!task->rast->no_rast) {
@@ -1111,6 +1719,16 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
+   /* The last thread done reports display target damage and makes the
+    * scene's resources idle before the fence signals, so that nobody
+    * waiting on it sees stale contents or busy resources.
+    */
+   if (p_atomic_inc_return(&scene->num_rast_done) ==
+       MAX2(1, (int)task->rast->num_threads)) {
+      lp_scene_report_damage(scene);
+      lp_scene_end_resource_use(scene);
+   }
+
    if (scene->fence) {
       lp_fence_signal(scene->fence);
    }
@@ -1318,6 +1936,10 @@ lp_rast_create( unsigned num_threads )
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
+   STATIC_ASSERT(ARRAY_SIZE(dispatch_tri) == LP_RAST_OP_MAX);
+   memcpy(rast->dispatch_tri, dispatch_tri, sizeof dispatch_tri);
+   lp_rast_triangle_init_dispatch(rast->dispatch_tri);
+
    create_rast_threads(rast);
 
    /* for synchronizing rasterization threads */
@@ -74,6 +74,27 @@ struct cmd_bin;
 struct lp_rasterizer_task;
 
 extern const float lp_sample_pos_4x[4][2];
+extern const float lp_sample_pos_8x[8][2];
+extern const float lp_sample_pos_16x[16][2];
+
+/**
+ * Standard sample positions for the given sample count, or NULL if the
+ * count is not supported for multisampling.
+ */
+static inline const float (*
+lp_sample_positions(unsigned nr_samples))[2]
+{
+   switch (nr_samples) {
+   case 4:
+      return lp_sample_pos_4x;
+   case 8:
+      return lp_sample_pos_8x;
+   case 16:
+      return lp_sample_pos_16x;
+   default:
+      return NULL;
+   }
+}
 
 /**
  * Rasterization state.
@@ -54,7 +54,7 @@ lp_rast_linear_clear(struct lp_rasterizer_task *task,
    uc = arg.clear_rb->color_val;
 
    util_fill_rect(scene->cbufs[0].map,
-                  PIPE_FORMAT_B8G8R8A8_UNORM,
+                  scene->fb.cbufs[0]->format,
                   scene->cbufs[0].stride,
                   task->x,
                   task->y,
@@ -63,6 +63,242 @@ lp_rast_linear_clear(struct lp_rasterizer_task *task,
                   &uc);
 }
 
+/* Compare a fragment's depth against the depth buffer's.
+ */
+static inline boolean
+linear_depth_test(unsigned func, uint32_t z, uint32_t zbuf)
+{
+   switch (func) {
+   case PIPE_FUNC_NEVER:    return FALSE;
+   case PIPE_FUNC_LESS:     return z <  zbuf;
+   case PIPE_FUNC_EQUAL:    return z == zbuf;
+   case PIPE_FUNC_LEQUAL:   return z <= zbuf;
+   case PIPE_FUNC_GREATER:  return z >  zbuf;
+   case PIPE_FUNC_NOTEQUAL: return z != zbuf;
+   case PIPE_FUNC_GEQUAL:   return z >= zbuf;
+   default:                 return TRUE;
+   }
+}
+
+static inline boolean
+linear_depth_test_float(unsigned func, float z, float zbuf)
+{
+   switch (func) {
+   case PIPE_FUNC_NEVER:    return FALSE;
+   case PIPE_FUNC_LESS:     return z <  zbuf;
+   case PIPE_FUNC_EQUAL:    return z == zbuf;
+   case PIPE_FUNC_LEQUAL:   return z <= zbuf;
+   case PIPE_FUNC_GREATER:  return z >  zbuf;
+   case PIPE_FUNC_NOTEQUAL: return z != zbuf;
+   case PIPE_FUNC_GEQUAL:   return z >= zbuf;
+   default:                 return TRUE;
+   }
+}
+
+
+/* Tighten the depth bounds of the 16x16 blocks lying wholly inside the
+ * box, once it has been shaded.
+ */
+static void
+lp_rast_linear_hiz_covered(struct lp_rasterizer_task *task,
+                           const struct lp_rast_shader_inputs *inputs,
+                           const struct u_rect *box)
+{
+   const int x0 = (box->x0 - task->x + 15) / 16;
+   const int y0 = (box->y0 - task->y + 15) / 16;
+   const int x1 = (box->x1 - task->x + 1) / 16;
+   const int y1 = (box->y1 - task->y + 1) / 16;
+   unsigned blocks = 0;
+   int bx, by;
+
+   if (!task->hiz_tracking)
+      return;
+
+   for (by = y0; by < y1; by++)
+      for (bx = x0; bx < x1; bx++)
+         blocks |= 1 << (by * (TILE_SIZE / 16) + bx);
+
+   if (blocks)
+      lp_rast_hiz_covered(task, inputs, blocks);
+}
+
+
+/* Run the scanline shader on a rectangle with depth testing enabled.
+ *
+ * Rectangles facing the viewer have constant depth, so the depth test is
+ * resolved per pixel ahead of shading, with the same conversion the
+ * fragment shader does, and the scanline shader runs on the spans which
+ * pass.  Anything else goes to the generic shader.
+ */
+static void
+lp_rast_linear_rect_depth(struct lp_rasterizer_task *task,
+                          const struct lp_rast_shader_inputs *inputs,
+                          const struct u_rect *box)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_state *state = task->state;
+   struct lp_fragment_shader_variant *variant = state->variant;
+   const struct lp_depth_state *depth = &variant->key.depth;
+   const float (*a0)[4] = (const float (*)[4])GET_A0(inputs);
+   const float (*dadx)[4] = (const float (*)[4])GET_DADX(inputs);
+   const float (*dady)[4] = (const float (*)[4])GET_DADY(inputs);
+   const enum pipe_format format = scene->fb.zsbuf->format;
+   const unsigned width = box->x1 - box->x0 + 1;
+   const unsigned height = box->y1 - box->y0 + 1;
+   const unsigned zstride = scene->zsbuf.stride;
+   uint8_t *zmap = scene->zsbuf.map +
+                   box->y0 * zstride +
+                   box->x0 * scene->zsbuf.format_bytes;
+   uint64_t pass[TILE_SIZE];
+   uint32_t zval = 0, zmask = ~0u;
+   unsigned zshift = 0;
+   float z;
+   unsigned x, y;
+
+   if (lp_rast_hiz_reject_rect(task, inputs, box->x0, box->y0, width, height))
+      return;
+
+   if (!variant->jit_linear || !variant->linear_depth) {
+      LP_COUNT(nr_linear_rects[variant->linear_reason]);
+      lp_rast_linear_rect_fallback(task, inputs, box);
+      lp_rast_linear_hiz_covered(task, inputs, box);
+      return;
+   }
+
+   if (dadx[0][2] != 0.0f || dady[0][2] != 0.0f) {
+      LP_COUNT(nr_linear_rects[LP_LINEAR_FAIL_DEPTH_SLOPE]);
+      lp_rast_linear_rect_fallback(task, inputs, box);
+      lp_rast_linear_hiz_covered(task, inputs, box);
+      return;
+   }
+
+   /* depth is the z channel of the position, polygon offset its x channel */
+   z = CLAMP(a0[0][2] + a0[0][0], 0.0f, 1.0f);
+
+   switch (format) {
+   case PIPE_FORMAT_Z16_UNORM: {
+      union fi fi;
+      fi.f = z * (float)(65535.0 / 65536.0) + 128.0f;
+      zval = fi.ui & 0xffff;
+      zmask = 0xffff;
+      break;
+   }
+   case PIPE_FORMAT_Z24X8_UNORM:
+   case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+      zval = lrintf(z * 16777215.0f);
+      zmask = 0xffffff;
+      break;
+   case PIPE_FORMAT_X8Z24_UNORM:
+   case PIPE_FORMAT_S8_UINT_Z24_UNORM:
+      zval = lrintf(z * 16777215.0f);
+      zmask = 0xffffff;
+      zshift = 8;
+      break;
+   default:
+      assert(format == PIPE_FORMAT_Z32_FLOAT);
+      break;
+   }
+
+   /* Which pixels pass, against the depth before this rectangle */
+   for (y = 0; y < height; y++) {
+      const uint8_t *row = zmap + y * zstride;
+      uint64_t mask = 0;
+
+      if (format == PIPE_FORMAT_Z32_FLOAT) {
+         for (x = 0; x < width; x++)
+            if (linear_depth_test_float(depth->func, z, ((const float *)row)[x]))
+               mask |= 1ull << x;
+      }
+      else if (format == PIPE_FORMAT_Z16_UNORM) {
+         for (x = 0; x < width; x++)
+            if (linear_depth_test(depth->func, zval, ((const uint16_t *)row)[x]))
+               mask |= 1ull << x;
+      }
+      else {
+         for (x = 0; x < width; x++) {
+            uint32_t zbuf = (((const uint32_t *)row)[x] >> zshift) & zmask;
+            if (linear_depth_test(depth->func, zval, zbuf))
+               mask |= 1ull << x;
+         }
+      }
+
+      pass[y] = mask;
+   }
+
+   /* Shade each run of passing pixels, over all the rows sharing the same
+    * mask at once.
+    */
+   for (y = 0; y < height; ) {
+      const uint64_t mask = pass[y];
+      unsigned rows = 1;
+      uint64_t m = mask;
+
+      while (y + rows < height && pass[y + rows] == mask)
+         rows++;
+
+      while (m) {
+         const unsigned x0 = ffsll(m) - 1;
+         const uint64_t run = ~(m >> x0);
+         const unsigned n = run ? ffsll(run) - 1 : 64;
+
+         m &= ~((n == 64 ? ~0ull : (1ull << n) - 1) << x0);
+
+         if (variant->jit_linear(state,
+                                 box->x0 + x0, box->y0 + y,
+                                 n, rows,
+                                 a0, dadx, dady,
+                                 scene->cbufs[0].map,
+                                 scene->cbufs[0].stride)) {
+            LP_COUNT(nr_linear_rects[LP_LINEAR_OK]);
+         }
+         else {
+            /* The generic shader tests depth itself, and writes the same
+             * values as below.
+             */
+            struct u_rect span;
+            span.x0 = box->x0 + x0;
+            span.x1 = box->x0 + x0 + n - 1;
+            span.y0 = box->y0 + y;
+            span.y1 = box->y0 + y + rows - 1;
+            lp_rast_linear_rect_fallback(task, inputs, &span);
+         }
+      }
+
+      y += rows;
+   }
+
+   if (!depth->writemask) {
+      lp_rast_linear_hiz_covered(task, inputs, box);
+      return;
+   }
+
+   for (y = 0; y < height; y++) {
+      uint8_t *row = zmap + y * zstride;
+      uint64_t m = pass[y];
+
+      while (m) {
+         x = u_bit_scan64(&m);
+
+         if (format == PIPE_FORMAT_Z32_FLOAT)
+            ((float *)row)[x] = z;
+         else if (format == PIPE_FORMAT_Z16_UNORM)
+            ((uint16_t *)row)[x] = (uint16_t)zval;
+         else {
+            uint32_t *p = &((uint32_t *)row)[x];
+            *p = (*p & ~(zmask << zshift)) | (zval << zshift);
+         }
+      }
+   }
+
+   /* Forget the depth bounds of the blocks written */
+   for (y = box->y0 & ~15; y <= (unsigned)box->y1; y += 16)
+      for (x = box->x0 & ~15; x <= (unsigned)box->x1; x += 16)
+         lp_rast_hiz_write(task, x, y);
+
+   lp_rast_linear_hiz_covered(task, inputs, box);
+}
+
+
 /* Run the scanline version of the shader across the whole tile.
  */
 static void
@@ -84,6 +320,16 @@ lp_rast_linear_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   if (variant->key.depth.enabled || variant->key.stencil[0].enabled) {
+      struct u_rect box;
+      box.x0 = task->x;
+      box.x1 = task->x + task->width - 1;
+      box.y0 = task->y;
+      box.y1 = task->y + task->height - 1;
+      lp_rast_linear_rect_depth(task, inputs, &box);
+      return;
+   }
+
    if (variant->jit_linear_blit &&
        inputs->is_blit)
    {
@@ -111,8 +357,13 @@ lp_rast_linear_tile(struct lp_rasterizer_task *task,
                               (const float (*)[4])GET_DADX(inputs),
                               (const float (*)[4])GET_DADY(inputs),
                               scene->cbufs[0].map,
-                              scene->cbufs[0].stride))
+                              scene->cbufs[0].stride)) {
+         LP_COUNT(nr_linear_rects[LP_LINEAR_OK]);
          return;
+      }
+   }
+   else {
+      LP_COUNT(nr_linear_rects[variant->linear_reason]);
    }
 
    {
@@ -154,6 +405,11 @@ lp_rast_linear_rect(struct lp_rasterizer_task *task,
    width  = box.x1 - box.x0 + 1;
    height = box.y1 - box.y0 + 1;
 
+   if (variant->key.depth.enabled || variant->key.stencil[0].enabled) {
+      lp_rast_linear_rect_depth(task, inputs, &box);
+      return;
+   }
+
    /* Note that blit primitives can end up in the non-full-tile path,
     * the binner currently doesn't try to classify sub-tile
     * primitives.  Can detect them here though.
@@ -181,8 +437,13 @@ lp_rast_linear_rect(struct lp_rasterizer_task *task,
                               (const float (*)[4])GET_DADX(inputs),
                               (const float (*)[4])GET_DADY(inputs),
                               scene->cbufs[0].map,
-                              scene->cbufs[0].stride))
+                              scene->cbufs[0].stride)) {
+         LP_COUNT(nr_linear_rects[LP_LINEAR_OK]);
          return;
+      }
+   }
+   else {
+      LP_COUNT(nr_linear_rects[variant->linear_reason]);
    }
 
    lp_rast_linear_rect_fallback(task, inputs, &box);
@@ -192,7 +453,7 @@ lp_rast_linear_rect(struct lp_rasterizer_task *task,
 static const lp_rast_cmd_func
 dispatch_linear[] = {
    lp_rast_linear_clear,        /* clear_color */
-   NULL,                        /* clear_zstencil */
+   lp_rast_clear_zstencil,      /* clear_zstencil */
    NULL,                        /* triangle_1 */
    NULL,                        /* triangle_2 */
    NULL,                        /* triangle_3 */
@@ -238,10 +499,11 @@ dispatch_linear[] = {
 };
 
 /* Assumptions for this path:
- *   - Single color buffer, PIPE_FORMAT_B8G8R8A8_UNORM
- *   - No depth buffer
+ *   - Single color buffer, 8-bit BGRA/RGBA or 565
+ *   - Single-sample depth buffer, if any
  *   - All primitives in bins are rect, tile, blit or clear.
- *   - All shaders have a linear variant.
+ *   - Shaders without a linear variant, or rectangles the linear
+ *     variant can't handle, fall back to the generic shader.
  */
 void
 lp_linear_rasterize_bin(struct lp_rasterizer_task *task,
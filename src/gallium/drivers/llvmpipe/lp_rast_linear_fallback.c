@@ -86,87 +86,6 @@ static unsigned bottom_mask_tab[STAMP_SIZE] = {
 };
 
 
-/**
- * Shade all pixels in a 4x4 block.  The fragment code omits the
- * triangle in/out tests.
- * \param x, y location of 4x4 block in window coords
- */
-static void
-shade_quads_all( struct lp_rasterizer_task *task,
-                 const struct lp_rast_shader_inputs *inputs,
-                 unsigned x, unsigned y )
-{
-   const struct lp_scene *scene = task->scene;
-   const struct lp_rast_state *state = task->state;
-   struct lp_fragment_shader_variant *variant = state->variant;
-   uint8_t *color = scene->cbufs[0].map;
-   unsigned stride = scene->cbufs[0].stride;
-   uint8_t *cbufs[1];
-   unsigned strides[1];
-
-   color += x * 4;
-   color += y * stride;
-   cbufs[0] = color;
-   strides[0] = stride;
-
-   assert(!variant->key.depth.enabled);
-
-   /* run shader on 4x4 block */
-   BEGIN_JIT_CALL(state, task);
-   variant->jit_function[RAST_WHOLE]( &state->jit_context,
-                                      x, y,
-                                      1,
-                                      (const float (*)[4])GET_A0(inputs),
-                                      (const float (*)[4])GET_DADX(inputs),
-                                      (const float (*)[4])GET_DADY(inputs),
-                                      cbufs,
-                                      NULL,
-                                      0xffff,
-                                      &task->thread_data,
-                                      strides, 0, 0, 0 );
-   END_JIT_CALL();
-}
-
-static void
-shade_quads_mask(struct lp_rasterizer_task *task,
-                 const struct lp_rast_shader_inputs *inputs,
-                 unsigned x, unsigned y,
-                 unsigned mask)
-{
-   const struct lp_rast_state *state = task->state;
-   struct lp_fragment_shader_variant *variant = state->variant;
-   const struct lp_scene *scene = task->scene;
-   uint8_t *color = scene->cbufs[0].map;
-   unsigned stride = scene->cbufs[0].stride;
-   uint8_t *cbufs[1];
-   unsigned strides[1];
-
-   color += x * 4;
-   color += y * stride;
-   cbufs[0] = color;
-   strides[0] = stride;
-
-   assert(!variant->key.depth.enabled);
-
-   /* Propagate non-interpolated raster state */
-   task->thread_data.raster_state.viewport_index = inputs->viewport_index;
-
-   /* run shader on 4x4 block */
-   BEGIN_JIT_CALL(state, task);
-   variant->jit_function[RAST_EDGE_TEST](&state->jit_context,
-                                         x, y,
-                                         1,
-                                         (const float (*)[4])GET_A0(inputs),
-                                         (const float (*)[4])GET_DADX(inputs),
-                                         (const float (*)[4])GET_DADY(inputs),
-                                         cbufs,
-                                         NULL,
-                                         mask,
-                                         &task->thread_data,
-                                         strides, 0, 0, 0);
-   END_JIT_CALL();
-}
-
 /* Shade a 4x4 stamp completely within the rectangle.
  */
 static inline void
@@ -174,10 +93,10 @@ full(struct lp_rasterizer_task *task,
      const struct lp_rast_shader_inputs *inputs,
      unsigned ix, unsigned iy)
 {
-   shade_quads_all(task,
-                   inputs,
-                   ix * STAMP_SIZE,
-                   iy * STAMP_SIZE);
+   lp_rast_shade_quads_all(task,
+                           inputs,
+                           ix * STAMP_SIZE,
+                           iy * STAMP_SIZE);
 }
 
 /* Shade a 4x4 stamp which may be partially outside the rectangle,
@@ -196,17 +115,19 @@ partial(struct lp_rasterizer_task *task,
       full(task, inputs, ix, iy);
    else {
       assert(mask);
-      shade_quads_mask(task,
-                       inputs,
-                       ix * STAMP_SIZE,
-                       iy * STAMP_SIZE,
-                       mask);
+      lp_rast_shade_quads_mask(task,
+                               inputs,
+                               ix * STAMP_SIZE,
+                               iy * STAMP_SIZE,
+                               mask);
    }
 }
 
 
 /**
- * Run the full SoA shader.
+ * Run the full SoA shader.  This goes through the same block functions
+ * as the triangle rasterizer, so handles any depth/stencil state and
+ * color buffer format the linear path lets through.
  */
 void
 lp_rast_linear_rect_fallback(struct lp_rasterizer_task *task,
@@ -42,6 +42,9 @@
 #define TILE_VECTOR_HEIGHT 4
 #define TILE_VECTOR_WIDTH 4
 
+/* Hierarchical depth is kept for the 16x16 blocks of a tile */
+#define LP_HIZ_BLOCKS ((TILE_SIZE / 16) * (TILE_SIZE / 16))
+
 /* If we crash in a jitted function, we can examine jit_line and jit_state
  * to get some info.  This is not thread-safe, however.
  */
@@ -100,6 +103,33 @@ struct lp_rasterizer_task
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /**
+    * Multisample color buffers, one bit per 4x4 block of the current tile:
+    * ms_uniform marks blocks whose samples all hold the same value,
+    * ms_compressed those of them where only sample 0 has been written yet.
+    * Only used when ms_tracking is set.
+    */
+   boolean ms_tracking;
+   uint64_t ms_uniform[PIPE_MAX_COLOR_BUFS][LP_TILE_BLOCK_WORDS];
+   uint64_t ms_compressed[PIPE_MAX_COLOR_BUFS][LP_TILE_BLOCK_WORDS];
+
+   /**
+    * Conservative bounds of the depth values in each 16x16 block of the
+    * current tile, in [0,1].  They're read from the depth buffer when first
+    * needed, and hiz_min_valid/hiz_max_valid say which ones are known.
+    * Only blocks in hiz_inside, which lie within the framebuffer, are
+    * tracked, and only when hiz_tracking is set.
+    */
+   boolean hiz_tracking;
+   unsigned hiz_inside;
+   unsigned hiz_min_valid;
+   unsigned hiz_max_valid;
+   float hiz_min[LP_HIZ_BLOCKS];
+   float hiz_max[LP_HIZ_BLOCKS];
+   unsigned hiz_shift;       /**< position of depth in the buffer values */
+   uint32_t hiz_mask;        /**< depth bits, after shifting */
+   float hiz_eps;            /**< tolerance for depth buffer rounding */
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -129,19 +159,99 @@ struct lp_rasterizer
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
+
+   /** Bin command functions, with the best triangle functions for this CPU */
+   lp_rast_cmd_func dispatch_tri[LP_RAST_OP_MAX];
 };
 
 void
 lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
                                 const struct lp_rast_shader_inputs *inputs,
                                 unsigned x, unsigned y,
-                                uint64_t mask);
+                                const uint64_t *mask);
 void
 lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          const struct lp_rast_shader_inputs *inputs,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+extern const uint64_t lp_rast_sample0_mask[LP_MASK_WORDS];
+
+boolean
+lp_rast_ms_block_begin(struct lp_rasterizer_task *task,
+                       unsigned x, unsigned y, boolean covered);
+
+void
+lp_rast_ms_tile_begin(struct lp_rasterizer_task *task);
+
+void
+lp_rast_ms_tile_end(struct lp_rasterizer_task *task);
+
+void
+lp_rast_hiz_tile_begin(struct lp_rasterizer_task *task);
+
+unsigned
+lp_rast_hiz_reject_blocks(struct lp_rasterizer_task *task,
+                          const struct lp_rast_shader_inputs *inputs,
+                          unsigned blocks);
+
+boolean
+lp_rast_hiz_reject_rect(struct lp_rasterizer_task *task,
+                        const struct lp_rast_shader_inputs *inputs,
+                        int x, int y, unsigned width, unsigned height);
+
+void
+lp_rast_hiz_covered(struct lp_rasterizer_task *task,
+                    const struct lp_rast_shader_inputs *inputs,
+                    unsigned blocks);
+
+
+/**
+ * Bit for the 16x16 block containing (x, y), in the same order as the
+ * 16x16 block masks of the triangle rasterizer.
+ */
+static inline unsigned
+lp_rast_hiz_block(unsigned x, unsigned y)
+{
+   return 1u << (((y % TILE_SIZE) / 16) * (TILE_SIZE / 16) +
+                 (x % TILE_SIZE) / 16);
+}
+
+
+/**
+ * Return the blocks, of those given, the primitive can't pass the depth
+ * test in.
+ */
+static inline unsigned
+lp_rast_hiz_reject(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   unsigned blocks)
+{
+   if (!task->hiz_tracking || !task->state->variant->hiz_test)
+      return 0;
+
+   return lp_rast_hiz_reject_blocks(task, inputs, blocks);
+}
+
+
+/**
+ * Note that the shader is about to run on the 4x4 block at (x, y), and
+ * forget the bounds its depth writes may move.
+ */
+static inline void
+lp_rast_hiz_write(struct lp_rasterizer_task *task, unsigned x, unsigned y)
+{
+   const unsigned invalidate = task->state->variant->hiz_invalidate;
+
+   if (invalidate) {
+      const unsigned block = lp_rast_hiz_block(x, y);
+      if (invalidate & LP_HIZ_MIN)
+         task->hiz_min_valid &= ~block;
+      if (invalidate & LP_HIZ_MAX)
+         task->hiz_max_valid &= ~block;
+   }
+}
+
 
 /**
  * Get the pointer to a 4x4 color block (within a 64x64 tile).
@@ -262,15 +372,23 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
       depth_stride = scene->zsbuf.stride;
    }
 
-   uint64_t mask = 0;
+   uint64_t mask[LP_MASK_WORDS] = { 0 };
    for (unsigned i = 0; i < scene->fb_max_samples; i++)
-      mask |= (uint64_t)0xffff << (16 * i);
+      mask[i / 4] |= (uint64_t)0xffff << (16 * (i % 4));
 
    /*
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
    if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+      const uint64_t *shade_mask = mask;
+
+      /* Samples all get the same value, only shade the first one */
+      if (task->ms_tracking && lp_rast_ms_block_begin(task, x, y, TRUE))
+         shade_mask = lp_rast_sample0_mask;
+
+      lp_rast_hiz_write(task, x, y);
+
       /* Propagate non-interpolated raster state. */
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
       task->thread_data.raster_state.view_index = inputs->view_index;
@@ -285,7 +403,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                                          GET_DADY(inputs),
                                          color,
                                          depth,
-                                         mask,
+                                         shade_mask,
                                          &task->thread_data,
                                          stride,
                                          depth_stride,
@@ -348,10 +466,20 @@ void lp_rast_triangle_32_3_16( struct lp_rasterizer_task *,
 void lp_rast_triangle_32_4_16( struct lp_rasterizer_task *, 
                             const union lp_rast_cmd_arg );
 
+void lp_rast_triangle_init_dispatch(lp_rast_cmd_func *dispatch);
+
+#ifdef LP_RAST_AVX
+void lp_rast_triangle_init_avx2(lp_rast_cmd_func *dispatch);
+void lp_rast_triangle_init_avx512(lp_rast_cmd_func *dispatch);
+#endif
+
 
 void lp_rast_rectangle( struct lp_rasterizer_task *, 
                         const union lp_rast_cmd_arg );
 
+void lp_rast_clear_zstencil( struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg );
+
 void lp_rast_triangle_ms_1( struct lp_rasterizer_task *,
                          const union lp_rast_cmd_arg );
 void lp_rast_triangle_ms_2( struct lp_rasterizer_task *,
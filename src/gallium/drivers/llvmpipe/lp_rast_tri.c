@@ -30,6 +30,7 @@
  */
 
 #include <limits.h>
+#include "util/u_cpu_detect.h"
 #include "util/u_math.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
@@ -302,6 +303,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    struct { unsigned mask:16; unsigned i:8; unsigned j:8; } out[16];
    unsigned nr = 0;
 
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
    __m128i p1 = _mm_loadu_si128((__m128i *)&plane[1]);
@@ -411,6 +415,9 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    unsigned x = (arg.triangle.plane_mask & 0xff) + task->x;
    unsigned y = (arg.triangle.plane_mask >> 8) + task->y;
 
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 4, 4))
+      return;
+
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
    __m128i p1 = _mm_loadu_si128((__m128i *)&plane[1]);
@@ -586,6 +593,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    struct { unsigned mask:16; unsigned i:8; unsigned j:8; } out[16];
    unsigned nr = 0;
 
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    __m128i p0 = lp_plane_to_m128i(&plane[0]); /* c, dcdx, dcdy, eo */
    __m128i p1 = lp_plane_to_m128i(&plane[1]); /* c, dcdx, dcdy, eo */
    __m128i p2 = lp_plane_to_m128i(&plane[2]); /* c, dcdx, dcdy, eo */
@@ -861,3 +871,25 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
 #include "lp_rast_tri_tmp.h"
 
 #undef RASTER_64
+
+
+/**
+ * Replace the triangle functions of a bin command dispatch table with the
+ * AVX-512 or AVX2 ones when the CPU supports them.  Multisample triangles
+ * and the 4-plane 16x16 path keep using the SSE functions above.
+ */
+void
+lp_rast_triangle_init_dispatch(lp_rast_cmd_func *dispatch)
+{
+#ifdef LP_RAST_AVX
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   if (LP_PERF & PERF_NO_RAST_AVX)
+      return;
+
+   if (caps->has_avx512f)
+      lp_rast_triangle_init_avx512(dispatch);
+   else if (caps->has_avx2)
+      lp_rast_triangle_init_avx2(dispatch);
+#endif
+}
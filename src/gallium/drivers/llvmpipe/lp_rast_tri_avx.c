@@ -0,0 +1,415 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX2 and AVX-512 variants of the binned triangle rasterization.
+ *
+ * This file is built twice, once with -mavx2 and once with -mavx512f, and
+ * the resulting functions are only plugged into the rasterizer's dispatch
+ * table (see lp_rast_triangle_init_dispatch()) when the CPU supports them.
+ *
+ * All the edge tests work on a 4x4 stamp of 32bit edge values at once: a
+ * single zmm register with AVX-512, or a pair of ymm registers with AVX2.
+ * Lane i of a stamp is the pixel (i & 3, i >> 2), which matches the bit
+ * layout of the coverage masks.
+ */
+
+#include <immintrin.h>
+
+#include "util/u_math.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_rast_priv.h"
+
+
+#if defined(__AVX512F__)
+
+#define SIMD(x) x##_avx512
+
+typedef __m512i stamp_t;
+
+/**
+ * Edge values over a 4x4 stamp, starting at c and stepping by dcdx and dcdy.
+ */
+static inline stamp_t
+stamp_steps(int c, int dcdx, int dcdy)
+{
+   const __m512i row_idx = _mm512_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1,
+                                             2, 2, 2, 2, 3, 3, 3, 3);
+   __m512i row = _mm512_broadcast_i32x4(
+      _mm_setr_epi32(c, c + dcdx, c + dcdx * 2, c + dcdx * 3));
+   __m512i col = _mm512_permutexvar_epi32(row_idx,
+      _mm512_castsi128_si512(_mm_setr_epi32(0, dcdy, dcdy * 2, dcdy * 3)));
+
+   return _mm512_add_epi32(row, col);
+}
+
+static inline stamp_t
+stamp_add(stamp_t a, int b)
+{
+   return _mm512_add_epi32(a, _mm512_set1_epi32(b));
+}
+
+static inline stamp_t
+stamp_or(stamp_t a, stamp_t b)
+{
+   return _mm512_or_si512(a, b);
+}
+
+/** Mask with bit i set if lane i of the stamp is negative. */
+static inline unsigned
+stamp_sign_bits(stamp_t a)
+{
+   return _mm512_cmplt_epi32_mask(a, _mm512_setzero_si512());
+}
+
+static inline void
+stamp_store(int32_t *dst, stamp_t a)
+{
+   _mm512_storeu_si512(dst, a);
+}
+
+#elif defined(__AVX2__)
+
+#define SIMD(x) x##_avx2
+
+typedef struct {
+   __m256i r01;   /* rows 0 and 1 */
+   __m256i r23;   /* rows 2 and 3 */
+} stamp_t;
+
+static inline stamp_t
+stamp_steps(int c, int dcdx, int dcdy)
+{
+   __m128i row = _mm_setr_epi32(c, c + dcdx, c + dcdx * 2, c + dcdx * 3);
+   stamp_t s;
+
+   s.r01 = _mm256_inserti128_si256(_mm256_castsi128_si256(row),
+                                   _mm_add_epi32(row, _mm_set1_epi32(dcdy)),
+                                   1);
+   s.r23 = _mm256_add_epi32(s.r01, _mm256_set1_epi32(dcdy * 2));
+   return s;
+}
+
+static inline stamp_t
+stamp_add(stamp_t a, int b)
+{
+   __m256i vb = _mm256_set1_epi32(b);
+   stamp_t s;
+
+   s.r01 = _mm256_add_epi32(a.r01, vb);
+   s.r23 = _mm256_add_epi32(a.r23, vb);
+   return s;
+}
+
+static inline stamp_t
+stamp_or(stamp_t a, stamp_t b)
+{
+   stamp_t s;
+
+   s.r01 = _mm256_or_si256(a.r01, b.r01);
+   s.r23 = _mm256_or_si256(a.r23, b.r23);
+   return s;
+}
+
+static inline unsigned
+stamp_sign_bits(stamp_t a)
+{
+   return _mm256_movemask_ps(_mm256_castsi256_ps(a.r01)) |
+          (_mm256_movemask_ps(_mm256_castsi256_ps(a.r23)) << 8);
+}
+
+static inline void
+stamp_store(int32_t *dst, stamp_t a)
+{
+   _mm256_storeu_si256((__m256i *)dst, a.r01);
+   _mm256_storeu_si256((__m256i *)(dst + 8), a.r23);
+}
+
+#else
+#error "lp_rast_tri_avx.c must be built with -mavx2 or -mavx512f"
+#endif
+
+
+static void
+block_full_4(struct lp_rasterizer_task *task,
+             const struct lp_rast_triangle *tri,
+             int x, int y)
+{
+   lp_rast_shade_quads_all(task, &tri->inputs, x, y);
+}
+
+
+static void
+block_full_16(struct lp_rasterizer_task *task,
+              const struct lp_rast_triangle *tri,
+              int x, int y)
+{
+   unsigned ix, iy;
+   assert(x % 16 == 0);
+   assert(y % 16 == 0);
+   for (iy = 0; iy < 16; iy += 4)
+      for (ix = 0; ix < 16; ix += 4)
+         block_full_4(task, tri, x + ix, y + iy);
+}
+
+
+static inline void
+build_masks_avx(int c,
+                int cdiff,
+                int dcdx,
+                int dcdy,
+                unsigned *outmask,
+                unsigned *partmask)
+{
+   stamp_t cstep = stamp_steps(c, dcdx, dcdy);
+
+   *outmask |= stamp_sign_bits(cstep);
+   *partmask |= stamp_sign_bits(stamp_add(cstep, cdiff));
+}
+
+
+static inline unsigned
+build_mask_linear_avx(int c, int dcdx, int dcdy)
+{
+   return stamp_sign_bits(stamp_steps(c, dcdx, dcdy));
+}
+
+
+#define BUILD_MASKS(c, cdiff, dcdx, dcdy, omask, pmask) build_masks_avx((int)c, (int)cdiff, dcdx, dcdy, omask, pmask)
+#define BUILD_MASK_LINEAR(c, dcdx, dcdy) build_mask_linear_avx((int)c, dcdx, dcdy)
+
+
+/**
+ * Triangle contained in a 16x16 block.  The edge values at the origins of
+ * the 16 4x4 stamps are computed, and trivially rejected, all at once.
+ */
+static void
+SIMD(lp_rast_triangle_32_3_16)(struct lp_rasterizer_task *task,
+                               const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   const int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   const int y = (arg.triangle.plane_mask >> 8) + task->y;
+   int32_t block_c[3][16];
+   stamp_t span[3];
+   stamp_t crej[3];
+   unsigned mask;
+   unsigned j;
+
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 16, 16))
+      return;
+
+   for (j = 0; j < 3; j++) {
+      const int dcdx = -plane[j].dcdx;
+      const int dcdy = plane[j].dcdy;
+
+      /* Adjust so we can just check the sign bit (< 0 comparison), instead
+       * of having to do a less efficient <= 0 comparison.
+       */
+      const int c = (int)(plane[j].c - 1 +
+                          IMUL64(dcdx, x) + IMUL64(dcdy, y));
+
+      stamp_t cblock = stamp_steps(c, dcdx * 4, dcdy * 4);
+
+      crej[j] = stamp_add(cblock, (int)(plane[j].eo * 4 + 1));
+      stamp_store(block_c[j], cblock);
+      span[j] = stamp_steps(0, dcdx, dcdy);
+   }
+
+   mask = ~stamp_sign_bits(stamp_or(stamp_or(crej[0], crej[1]), crej[2])) &
+          0xffff;
+
+   while (mask) {
+      int i = ffs(mask) - 1;
+      unsigned cover;
+
+      mask &= ~(1 << i);
+
+      cover = stamp_sign_bits(
+         stamp_or(stamp_or(stamp_add(span[0], block_c[0][i]),
+                           stamp_add(span[1], block_c[1][i])),
+                  stamp_add(span[2], block_c[2][i])));
+
+      if (cover != 0xffff)
+         lp_rast_shade_quads_mask(task,
+                                  &tri->inputs,
+                                  x + 4 * (i & 3),
+                                  y + 4 * (i >> 2),
+                                  0xffff & ~cover);
+   }
+}
+
+
+/**
+ * Triangle contained in a single 4x4 stamp.
+ */
+static void
+SIMD(lp_rast_triangle_32_3_4)(struct lp_rasterizer_task *task,
+                              const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   const int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   const int y = (arg.triangle.plane_mask >> 8) + task->y;
+   stamp_t c[3];
+   unsigned mask;
+   unsigned j;
+
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 4, 4))
+      return;
+
+   for (j = 0; j < 3; j++) {
+      const int dcdx = -plane[j].dcdx;
+      const int dcdy = plane[j].dcdy;
+      const int cx = (int)(plane[j].c - 1 +
+                           IMUL64(dcdx, x) + IMUL64(dcdy, y));
+
+      c[j] = stamp_steps(cx, dcdx, dcdy);
+   }
+
+   mask = stamp_sign_bits(stamp_or(stamp_or(c[0], c[1]), c[2]));
+
+   if (mask != 0xffff)
+      lp_rast_shade_quads_mask(task,
+                               &tri->inputs,
+                               x,
+                               y,
+                               0xffff & ~mask);
+}
+
+
+#define TRI_PROTOTYPES(n)                                         \
+   void SIMD(lp_rast_triangle_##n)(struct lp_rasterizer_task *,   \
+                                   const union lp_rast_cmd_arg);  \
+   void SIMD(lp_rast_triangle_32_##n)(struct lp_rasterizer_task *,\
+                                      const union lp_rast_cmd_arg);
+
+TRI_PROTOTYPES(1)
+TRI_PROTOTYPES(2)
+TRI_PROTOTYPES(3)
+TRI_PROTOTYPES(4)
+TRI_PROTOTYPES(5)
+TRI_PROTOTYPES(6)
+TRI_PROTOTYPES(7)
+TRI_PROTOTYPES(8)
+
+#undef TRI_PROTOTYPES
+
+
+#define RASTER_64 1
+
+#define TAG(x) SIMD(x##_1)
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_2)
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_3)
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_4)
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_5)
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_6)
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_7)
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_8)
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
+
+#undef RASTER_64
+
+#define TAG(x) SIMD(x##_32_1)
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_2)
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_3)
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_4)
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_5)
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_6)
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_7)
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) SIMD(x##_32_8)
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
+
+
+void
+SIMD(lp_rast_triangle_init)(lp_rast_cmd_func *dispatch)
+{
+   dispatch[LP_RAST_OP_TRIANGLE_1] = SIMD(lp_rast_triangle_1);
+   dispatch[LP_RAST_OP_TRIANGLE_2] = SIMD(lp_rast_triangle_2);
+   dispatch[LP_RAST_OP_TRIANGLE_3] = SIMD(lp_rast_triangle_3);
+   dispatch[LP_RAST_OP_TRIANGLE_4] = SIMD(lp_rast_triangle_4);
+   dispatch[LP_RAST_OP_TRIANGLE_5] = SIMD(lp_rast_triangle_5);
+   dispatch[LP_RAST_OP_TRIANGLE_6] = SIMD(lp_rast_triangle_6);
+   dispatch[LP_RAST_OP_TRIANGLE_7] = SIMD(lp_rast_triangle_7);
+   dispatch[LP_RAST_OP_TRIANGLE_8] = SIMD(lp_rast_triangle_8);
+   dispatch[LP_RAST_OP_TRIANGLE_32_1] = SIMD(lp_rast_triangle_32_1);
+   dispatch[LP_RAST_OP_TRIANGLE_32_2] = SIMD(lp_rast_triangle_32_2);
+   dispatch[LP_RAST_OP_TRIANGLE_32_3] = SIMD(lp_rast_triangle_32_3);
+   dispatch[LP_RAST_OP_TRIANGLE_32_4] = SIMD(lp_rast_triangle_32_4);
+   dispatch[LP_RAST_OP_TRIANGLE_32_5] = SIMD(lp_rast_triangle_32_5);
+   dispatch[LP_RAST_OP_TRIANGLE_32_6] = SIMD(lp_rast_triangle_32_6);
+   dispatch[LP_RAST_OP_TRIANGLE_32_7] = SIMD(lp_rast_triangle_32_7);
+   dispatch[LP_RAST_OP_TRIANGLE_32_8] = SIMD(lp_rast_triangle_32_8);
+   dispatch[LP_RAST_OP_TRIANGLE_32_3_4] = SIMD(lp_rast_triangle_32_3_4);
+   dispatch[LP_RAST_OP_TRIANGLE_32_3_16] = SIMD(lp_rast_triangle_32_3_16);
+}
@@ -50,7 +50,12 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
 #ifndef MULTISAMPLE
    unsigned mask = 0xffff;
 #else
-   uint64_t mask = UINT64_MAX;
+   const unsigned nr_samples = task->scene->fb_max_samples;
+   uint64_t mask[LP_MASK_WORDS];
+   uint64_t any = 0;
+
+   for (unsigned s = 0; s < LP_MASK_WORDS; s++)
+      mask[s] = UINT64_MAX;
 #endif
 
    for (j = 0; j < NR_PLANES; j++) {
@@ -65,7 +70,7 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
                                  plane[j].dcdy);
 #endif
 #else
-      for (unsigned s = 0; s < 4; s++) {
+      for (unsigned s = 0; s < nr_samples; s++) {
          int64_t new_c = (c[j]) + ((IMUL64(task->scene->fixed_sample_pos[s][1], plane[j].dcdy) + IMUL64(task->scene->fixed_sample_pos[s][0], -plane[j].dcdx)) >> FIXED_ORDER);
          uint32_t build_mask;
 #ifdef RASTER_64
@@ -77,15 +82,25 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
                                         -plane[j].dcdx,
                                         plane[j].dcdy);
 #endif
-         mask &= ~((uint64_t)build_mask << (s * 16));
+         mask[s / 4] &= ~((uint64_t)build_mask << ((s % 4) * 16));
       }
 #endif
    }
 
    /* Now pass to the shader:
     */
+#ifndef MULTISAMPLE
    if (mask)
+      lp_rast_shade_quads_mask(task, &tri->inputs, x, y, mask);
+#else
+   for (unsigned s = 0; s < nr_samples; s += 4) {
+      if (nr_samples - s < 4)
+         mask[s / 4] &= ((uint64_t)1 << ((nr_samples - s) * 16)) - 1;
+      any |= mask[s / 4];
+   }
+   if (any)
       lp_rast_shade_quads_mask_sample(task, &tri->inputs, x, y, mask);
+#endif
 }
 
 /**
@@ -205,7 +220,8 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
    struct lp_rast_plane plane[NR_PLANES];
    int64_t c[NR_PLANES];
    unsigned outmask, inmask, partmask, partial_mask;
-   unsigned j = 0;
+   unsigned rejected, covered;
+   unsigned j;
 
    if (tri->inputs.disable) {
       /* This triangle was partially binned and has been disabled */
@@ -215,7 +231,13 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
-   while (plane_mask) {
+   /* The triangle was binned with the command matching the number of bits
+    * in plane_mask, so exactly NR_PLANES planes are set.  Counting up to
+    * NR_PLANES also lets the compiler see that every plane[] and c[] entry
+    * gets initialized.
+    */
+   assert(util_bitcount(plane_mask) == NR_PLANES);
+   for (j = 0; j < NR_PLANES; j++) {
       int i = ffs(plane_mask) - 1;
       plane[j] = tri_plane[i];
       plane_mask &= ~(1 << i);
@@ -287,8 +309,6 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
                      &outmask,   /* sign bits from c[i][0..15] + cox */
                      &partmask); /* sign bits from c[i][0..15] + cio */
       }
-
-      j++;
    }
 
    if (outmask == 0xffff)
@@ -307,6 +327,13 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
    LP_COUNT_ADD(nr_empty_16, util_bitcount(0xffff & ~(partial_mask | inmask)));
 
+   /* Drop the blocks that can't pass the depth test:
+    */
+   rejected = lp_rast_hiz_reject(task, &tri->inputs, partial_mask | inmask);
+   partial_mask &= ~rejected;
+   inmask &= ~rejected;
+   covered = inmask;
+
    /* Iterate over partials:
     */
    while (partial_mask) {
@@ -342,6 +369,8 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       LP_COUNT(nr_fully_covered_16);
       block_full_16(task, tri, px, py);
    }
+
+   lp_rast_hiz_covered(task, &tri->inputs, covered);
 }
 
 #if defined(PIPE_ARCH_SSE) && defined(TRI_16)
@@ -378,6 +407,9 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -443,6 +475,9 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (lp_rast_hiz_reject_rect(task, &tri->inputs, x, y, 4, 4))
+      return;
+
    /* Iterate over partials:
     */
    {
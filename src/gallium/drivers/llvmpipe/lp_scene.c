@@ -31,10 +31,13 @@
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
 #include "util/format/u_format.h"
+#include "util/u_box.h"
+#include "frontend/sw_winsys.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
 #include "lp_context.h"
+#include "lp_screen.h"
 #include "lp_state_fs.h"
 
 #include "lp_setup_context.h"
@@ -56,6 +59,12 @@ struct shader_ref {
    struct shader_ref *next;
 };
 
+/** List of replaced buffer storage */
+struct storage_ref {
+   void *data;
+   struct storage_ref *next;
+};
+
 
 /**
  * Create a new scene object.
@@ -177,7 +186,7 @@ init_scene_texture(struct lp_scene_surface *ssurf, struct pipe_surface *psurf)
       ssurf->map = llvmpipe_resource_map(psurf->texture,
                                          psurf->u.tex.level,
                                          psurf->u.tex.first_layer,
-                                         LP_TEX_USAGE_READ_WRITE);
+                                         LP_TEX_USAGE_RASTER);
       ssurf->format_bytes = util_format_get_blocksize(psurf->format);
       ssurf->nr_samples = util_res_sample_count(psurf->texture);
    }
@@ -205,8 +214,24 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       struct pipe_surface *cbuf = scene->fb.cbufs[i];
       init_scene_texture(&scene->cbufs[i], cbuf);
+      scene->cbufs[i].hashed = FALSE;
+
+      if (cbuf && llvmpipe_resource_is_texture(cbuf->texture)) {
+         struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
+
+         if (llvmpipe_tile_hash(lpr, 0, 0)) {
+            if (cbuf->u.tex.level == 0 && cbuf->u.tex.first_layer == 0 &&
+                scene->fb_max_layer == 0)
+               scene->cbufs[i].hashed = TRUE;
+            else
+               llvmpipe_resource_damage_all(lpr);
+         }
+      }
    }
 
+   for (i = 0; i < scene->tiles_y; i++)
+      memset(scene->tile_changed[i], 0, scene->tiles_x);
+
    if (fb->zsbuf) {
       struct pipe_surface *zsbuf = scene->fb.zsbuf;
       init_scene_texture(&scene->zsbuf, zsbuf);
@@ -216,12 +241,119 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 
+/**
+ * Stop counting the scene's resources as busy, called once the scene
+ * has been rasterized or was dropped.  The references themselves are
+ * only released with the rest of the scene.
+ */
+void
+lp_scene_end_resource_use(struct lp_scene *scene)
+{
+   struct resource_ref *ref;
+   int i;
+
+   if (!scene->resources_busy)
+      return;
+
+   for (ref = scene->resources; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++)
+         p_atomic_dec(&llvmpipe_resource(ref->resource[i])->scene_refs);
+   }
+
+   for (ref = scene->writeable_resources; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++)
+         p_atomic_dec(&llvmpipe_resource(ref->resource[i])->scene_refs);
+   }
+
+   scene->resources_busy = FALSE;
+}
+
+
+/**
+ * Report the tiles the scene changed: to the winsys for display target
+ * color buffers, per tile row the span from the first to the last changed
+ * tile with equal spans on consecutive rows merged, and as a bounding box
+ * to the damage of hashed color buffers.
+ */
+void
+lp_scene_report_damage(struct lp_scene *scene)
+{
+   struct sw_winsys *winsys = llvmpipe_screen(scene->pipe->screen)->winsys;
+   const int width = scene->fb.width, height = scene->fb.height;
+   struct pipe_box boxes[TILES_Y], bounds;
+   unsigned num_boxes = 0;
+   unsigned x, y;
+   int i;
+
+   /* nobody to tell */
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+
+      if (scene->cbufs[i].hashed ||
+          (scene->cbufs[i].map && winsys->displaytarget_damage &&
+           llvmpipe_resource_is_texture(cbuf->texture) &&
+           llvmpipe_resource(cbuf->texture)->dt))
+         break;
+   }
+   if (i == scene->fb.nr_cbufs)
+      return;
+
+   memset(&bounds, 0, sizeof bounds);
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      const int y0 = y * TILE_SIZE, y1 = MIN2(y0 + TILE_SIZE, height);
+      struct pipe_box *prev = num_boxes ? &boxes[num_boxes - 1] : NULL;
+      int x0 = -1, x1 = -1;
+
+      for (x = 0; x < scene->tiles_x; x++) {
+         if (scene->tile_changed[y][x]) {
+            if (x0 < 0)
+               x0 = x * TILE_SIZE;
+            x1 = MIN2((x + 1) * TILE_SIZE, width);
+         }
+      }
+      if (x0 < 0)
+         continue;
+
+      if (prev && prev->x == x0 && prev->x + prev->width == x1 &&
+          prev->y + prev->height == y0)
+         prev->height = y1 - prev->y;
+      else
+         u_box_2d(x0, y0, x1 - x0, y1 - y0, &boxes[num_boxes++]);
+
+      if (!bounds.width) {
+         u_box_2d(x0, y0, x1 - x0, y1 - y0, &bounds);
+      } else {
+         bounds.x = MIN2(bounds.x, x0);
+         bounds.width = MAX2(bounds.x + bounds.width, x1) - bounds.x;
+         bounds.height = y1 - bounds.y;
+      }
+   }
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      struct llvmpipe_resource *lpr;
+
+      if (!scene->cbufs[i].map || !llvmpipe_resource_is_texture(cbuf->texture))
+         continue;
+
+      lpr = llvmpipe_resource(cbuf->texture);
+      if (scene->cbufs[i].hashed)
+         llvmpipe_resource_add_damage(lpr, &bounds);
+      if (lpr->dt && winsys->displaytarget_damage)
+         winsys->displaytarget_damage(winsys, lpr->dt, boxes, num_boxes);
+   }
+}
+
+
 /**
  * Free all the temporary data in a scene.
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
+   lp_scene_end_resource_use(scene);
+
    int i;
 
    /* Unmap color buffers */
@@ -291,6 +423,15 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
+   /* Free the storage of buffers replaced meanwhile
+    */
+   {
+      struct storage_ref *ref;
+
+      for (ref = scene->retired_storage; ref; ref = ref->next)
+         align_free(ref->data);
+   }
+
    /* Decrement shader variant ref counts
     */
    {
@@ -327,6 +468,8 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
    scene->resources = NULL;
    scene->writeable_resources = NULL;
+   scene->num_rast_done = 0;
+   scene->retired_storage = NULL;
    scene->frag_shaders = NULL;
    scene->scene_size = 0;
    scene->resource_reference_size = 0;
@@ -458,6 +601,8 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
     */
    pipe_resource_reference(&ref->resource[ref->count++], resource);
    scene->resource_reference_size += llvmpipe_resource_size(resource);
+   p_atomic_inc(&llvmpipe_resource(resource)->scene_refs);
+   scene->resources_busy = TRUE;
 
    /* Heuristic to advise scene flushes.  This isn't helpful in the
     * initial setup of the scene, but after that point flush on the
@@ -472,6 +617,26 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 }
 
 
+/**
+ * Take over buffer storage which may still be read or written by the scene,
+ * to be freed after rasterization.
+ */
+boolean
+lp_scene_add_retired_storage(struct lp_scene *scene, void *data)
+{
+   struct storage_ref *ref = lp_scene_alloc(scene, sizeof *ref);
+
+   if (!ref)
+      return FALSE;
+
+   ref->data = data;
+   ref->next = scene->retired_storage;
+   scene->retired_storage = ref;
+
+   return TRUE;
+}
+
+
 /**
  * Add a reference to a fragment shader variant
  */
@@ -644,10 +809,12 @@ void lp_scene_begin_binning(struct lp_scene *scene,
    }
    scene->fb_max_layer = max_layer;
    scene->fb_max_samples = util_framebuffer_get_num_samples(fb);
-   if (scene->fb_max_samples == 4) {
-      for (unsigned i = 0; i < 4; i++) {
-         scene->fixed_sample_pos[i][0] = util_iround(lp_sample_pos_4x[i][0] * FIXED_ONE);
-         scene->fixed_sample_pos[i][1] = util_iround(lp_sample_pos_4x[i][1] * FIXED_ONE);
+   if (scene->fb_max_samples > 1) {
+      const float (*sample_pos)[2] = lp_sample_positions(scene->fb_max_samples);
+      assert(sample_pos);
+      for (unsigned i = 0; i < scene->fb_max_samples; i++) {
+         scene->fixed_sample_pos[i][0] = util_iround(sample_pos[i][0] * FIXED_ONE);
+         scene->fixed_sample_pos[i][1] = util_iround(sample_pos[i][1] * FIXED_ONE);
       }
    }
 }
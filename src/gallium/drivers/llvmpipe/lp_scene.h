@@ -120,6 +120,8 @@ struct resource_ref;
 
 struct shader_ref;
 
+struct storage_ref;
+
 struct lp_scene_surface {
    uint8_t *map;
    unsigned stride;
@@ -127,6 +129,7 @@ struct lp_scene_surface {
    unsigned format_bytes;
    unsigned sample_stride;
    unsigned nr_samples;
+   boolean hashed;  /**< tile hashes kept, see llvmpipe_resource */
 };
 
 /**
@@ -171,6 +174,15 @@ struct lp_scene {
    /** list of writable resources referenced by the scene commands */
    struct resource_ref *writeable_resources;
 
+   /** Whether the resources above still count as busy (scene_refs) */
+   boolean resources_busy;
+
+   /** Rasterizer threads done with the scene */
+   int num_rast_done;
+
+   /** buffer storage replaced while the scene used it, to free when done */
+   struct storage_ref *retired_storage;
+
    /** list of frag shaders referenced by the scene commands */
    struct shader_ref *frag_shaders;
 
@@ -198,6 +210,14 @@ struct lp_scene {
    mtx_t mutex;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
+
+   /**
+    * Tiles whose color buffers the scene changed: every rasterized tile,
+    * except that for hashed color buffers only tiles whose contents
+    * changed count.  Written by the rasterizer threads.
+    */
+   uint8_t tile_changed[TILES_Y][TILES_X];
+
    struct data_block_list data;
 };
 
@@ -224,6 +244,9 @@ boolean lp_scene_add_resource_reference(struct lp_scene *scene,
 unsigned lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                         const struct pipe_resource *resource );
 
+boolean lp_scene_add_retired_storage(struct lp_scene *scene,
+                                     void *data);
+
 boolean lp_scene_add_frag_shader_reference(struct lp_scene *scene,
                                            struct lp_fragment_shader_variant *variant);
 
@@ -416,6 +439,12 @@ lp_scene_end_binning(struct lp_scene *scene);
 void
 lp_scene_begin_rasterization(struct lp_scene *scene);
 
+void
+lp_scene_end_resource_use(struct lp_scene *scene);
+
+void
+lp_scene_report_damage(struct lp_scene *scene);
+
 void
 lp_scene_end_rasterization(struct lp_scene *scene);
 
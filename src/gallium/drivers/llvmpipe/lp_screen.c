@@ -95,6 +95,9 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
    { "no_rast_linear", PERF_NO_RAST_LINEAR, NULL },
    { "no_shade",       PERF_NO_SHADE, NULL },
+   { "no_rast_avx",    PERF_NO_RAST_AVX, NULL },
+   { "no_tex_tiled",   PERF_NO_TEX_TILED, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -217,7 +220,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_COMPUTE:
       return GALLIVM_HAVE_CORO;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
-      return 1;
+      /* u_threaded_context can't pass user vertex buffers through */
+      return !llvmpipe_screen(screen)->allow_threaded;
    case PIPE_CAP_TGSI_TEXCOORD:
    case PIPE_CAP_DRAW_INDIRECT:
       return 1;
@@ -235,8 +239,10 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 134217728;
    case PIPE_CAP_TEXTURE_BUFFER_OFFSET_ALIGNMENT:
       return 16;
+   case PIPE_CAP_GENERATE_MIPMAP:
+      return 1;
    case PIPE_CAP_TEXTURE_TRANSFER_MODES:
-      return 0;
+      return PIPE_TEXTURE_TRANSFER_PBO_DOWNLOAD;
    case PIPE_CAP_MAX_VIEWPORTS:
       return PIPE_MAX_VIEWPORTS;
    case PIPE_CAP_ENDIANNESS:
@@ -680,7 +686,7 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
           target == PIPE_TEXTURE_CUBE ||
           target == PIPE_TEXTURE_CUBE_ARRAY);
 
-   if (sample_count != 0 && sample_count != 1 && sample_count != 4)
+   if (sample_count > 1 && !lp_sample_positions(sample_count))
       return false;
 
    if (MAX2(1, sample_count) != MAX2(1, storage_sample_count))
@@ -807,8 +813,12 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
       return false;
    }
 
+   /*
+    * Of the ETC formats only those decoding to 8 bits per channel are
+    * implemented, EAC R11/RG11 get decompressed by the state tracker.
+    */
    if (format_desc->layout == UTIL_FORMAT_LAYOUT_ETC &&
-       format != PIPE_FORMAT_ETC1_RGB8)
+       !util_format_fits_8unorm(util_format_description(util_format_linear(format))))
       return false;
 
    /*
@@ -864,6 +874,8 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    mtx_destroy(&screen->rast_mutex);
    mtx_destroy(&screen->cs_mutex);
+   util_idalloc_mt_fini(&screen->buffer_ids);
+   slab_destroy_parent(&screen->transfer_pool);
    FREE(screen);
 }
 
@@ -1081,6 +1093,16 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
+   /* Opt-in, as it costs PIPE_CAP_USER_VERTEX_BUFFERS.  GALLIUM_THREAD
+    * is checked too, with the same default as threaded_context_create().
+    */
+   screen->allow_threaded =
+      debug_get_bool_option("LP_THREADED", false) &&
+      debug_get_bool_option("GALLIUM_THREAD", util_get_cpu_caps()->nr_cpus > 1);
+   slab_create_parent(&screen->transfer_pool,
+                      sizeof(struct llvmpipe_transfer), 16);
+   util_idalloc_mt_init_tc(&screen->buffer_ids);
+
    lp_build_init(); /* get lp_native_vector_width initialised */
 
    snprintf(screen->renderer_string, sizeof(screen->renderer_string), "llvmpipe (LLVM " MESA_LLVM_VERSION_STRING ", %u bits)", lp_native_vector_width );
@@ -37,6 +37,8 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/slab.h"
+#include "util/u_idalloc.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
 
@@ -64,6 +66,11 @@ struct llvmpipe_screen
    bool use_tgsi;
    bool allow_cl;
 
+   /* Contexts may be wrapped in a u_threaded_context (LP_THREADED) */
+   bool allow_threaded;
+   struct slab_parent_pool transfer_pool;
+   struct util_idalloc_mt buffer_ids;
+
    mtx_t late_mutex;
    bool late_init_done;
 
@@ -1195,6 +1195,19 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
 }
 
 
+/**
+ * Free buffer storage once everything binned so far has been rasterized.
+ */
+boolean
+lp_setup_retire_storage(struct lp_setup_context *setup, void *data)
+{
+   if (!set_scene_state(setup, SETUP_ACTIVE, __FUNCTION__))
+      return FALSE;
+
+   return lp_scene_add_retired_storage(setup->scene, data);
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
@@ -158,6 +158,12 @@ llvmpipe_init_rasterizer_funcs(struct llvmpipe_context *llvmpipe);
 void
 llvmpipe_init_so_funcs(struct llvmpipe_context *llvmpipe);
 
+struct lp_static_texture_state;
+
+void
+llvmpipe_static_texture_state(struct lp_static_texture_state *state,
+                              const struct pipe_sampler_view *view);
+
 void
 llvmpipe_prepare_vertex_sampling(struct llvmpipe_context *ctx,
                                  unsigned num,
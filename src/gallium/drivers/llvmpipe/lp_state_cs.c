@@ -33,6 +33,7 @@
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_intr.h"
 #include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
 #include "gallivm/lp_bld_gather.h"
 #include "gallivm/lp_bld_coro.h"
 #include "gallivm/lp_bld_nir.h"
@@ -445,6 +446,7 @@ generate_compute(struct llvmpipe_context *lp,
       params.ssbo_sizes_ptr = num_ssbo_ptr;
       params.image = image;
       params.shared_ptr = shared_ptr;
+      params.thread_data_ptr = thread_data_ptr;
       params.coro = &coro_info;
       params.kernel_args = kernel_args_ptr;
       params.aniso_filter_table = lp_jit_cs_context_aniso_filter_table(gallivm, context_ptr);
@@ -637,8 +639,8 @@ make_variant_key(struct llvmpipe_context *lp,
           * used views may be included in the shader key.
           */
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
-            lp_sampler_static_texture_state(&cs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            llvmpipe_static_texture_state(&cs_sampler[i].texture_state,
+                                          lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
          }
       }
    }
@@ -646,8 +648,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&cs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            llvmpipe_static_texture_state(&cs_sampler[i].texture_state,
+                                          lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
          }
       }
    }
@@ -703,6 +705,8 @@ dump_cs_variant_key(const struct lp_compute_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -1281,6 +1285,14 @@ update_csctx_ssbo(struct llvmpipe_context *llvmpipe)
 static void
 llvmpipe_cs_update_derived(struct llvmpipe_context *llvmpipe, void *input)
 {
+   struct llvmpipe_screen *lp_screen = llvmpipe_screen(llvmpipe->pipe.screen);
+
+   /* Check for updated textures, see llvmpipe_update_derived() */
+   if (llvmpipe->cs_tex_timestamp != lp_screen->timestamp) {
+      llvmpipe->cs_tex_timestamp = lp_screen->timestamp;
+      llvmpipe->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+   }
+
    if (llvmpipe->cs_dirty & LP_CSNEW_CONSTANTS) {
       lp_csctx_set_cs_constants(llvmpipe->csctx,
                                 ARRAY_SIZE(llvmpipe->constants[PIPE_SHADER_COMPUTE]),
@@ -1344,6 +1356,15 @@ cs_exec_fn(void *init_data, int iter_idx, struct lp_cs_local_mem *lmem)
       memset(lmem->local_mem_ptr, 0, job_info->req_local_mem);
    thread_data.shared = lmem->local_mem_ptr;
 
+   if (!lmem->cache) {
+      lmem->cache = align_malloc(sizeof(struct lp_build_format_cache), 16);
+      if (!lmem->cache)
+         return;
+   }
+   /* Textures may have been written since the last dispatch. */
+   memset(lmem->cache->cache_tags, 0, sizeof(lmem->cache->cache_tags));
+   thread_data.cache = lmem->cache;
+
    unsigned grid_z = iter_idx / (job_info->grid_size[0] * job_info->grid_size[1]);
    unsigned grid_y = (iter_idx - (grid_z * (job_info->grid_size[0] * job_info->grid_size[1]))) / job_info->grid_size[0];
    unsigned grid_x = (iter_idx - (grid_z * (job_info->grid_size[0] * job_info->grid_size[1])) - (grid_y * job_info->grid_size[0]));
@@ -32,6 +32,7 @@
 #include "draw/draw_vertex.h"
 #include "draw/draw_private.h"
 #include "lp_context.h"
+#include "lp_perf.h"
 #include "lp_screen.h"
 #include "lp_setup.h"
 #include "lp_state.h"
@@ -176,24 +177,38 @@ compute_vertex_info(struct llvmpipe_context *llvmpipe)
 static void
 check_linear_rasterizer( struct llvmpipe_context *lp )
 {
-   boolean bgr8;
+   boolean linear_fb;
+   boolean linear_zs;
    boolean permit_linear;
    boolean single_vp;
    boolean clipping_changed = FALSE;
 
-   bgr8 = (lp->framebuffer.nr_cbufs == 1 && lp->framebuffer.cbufs[0] &&
-           util_res_sample_count(lp->framebuffer.cbufs[0]->texture) == 1 &&
-           lp->framebuffer.cbufs[0]->texture->target == PIPE_TEXTURE_2D &&
-           (lp->framebuffer.cbufs[0]->format == PIPE_FORMAT_B8G8R8A8_UNORM ||
-            lp->framebuffer.cbufs[0]->format == PIPE_FORMAT_B8G8R8X8_UNORM));
+   linear_fb = (lp->framebuffer.nr_cbufs == 1 && lp->framebuffer.cbufs[0] &&
+                util_res_sample_count(lp->framebuffer.cbufs[0]->texture) == 1 &&
+                lp->framebuffer.cbufs[0]->texture->target == PIPE_TEXTURE_2D &&
+                lp_linear_cbuf_format(lp->framebuffer.cbufs[0]->format));
+
+   /* Depth/stencil testing is either resolved by the linear rasterizer
+    * or left to the generic shader, per rectangle.
+    */
+   linear_zs = (!lp->framebuffer.zsbuf ||
+                (util_res_sample_count(lp->framebuffer.zsbuf->texture) == 1 &&
+                 lp->framebuffer.zsbuf->texture->target == PIPE_TEXTURE_2D));
 
    /* permit_linear means guardband, hence fake scissor, which we can only
     * handle if there's just one vp. */
    single_vp = lp->viewport_index_slot < 0;
-   permit_linear = (!lp->framebuffer.zsbuf &&
-                    bgr8 &&
+   permit_linear = (linear_fb &&
+                    linear_zs &&
                     single_vp);
 
+   if (!linear_fb || !linear_zs)
+      lp->linear_reason = LP_LINEAR_FAIL_FRAMEBUFFER;
+   else if (!single_vp)
+      lp->linear_reason = LP_LINEAR_FAIL_VIEWPORTS;
+   else
+      lp->linear_reason = LP_LINEAR_OK;
+
    /* Tell draw that we're happy doing our own x/y clipping.
     */
    if (lp->permit_linear_rasterizer != permit_linear) {
@@ -209,8 +224,8 @@ check_linear_rasterizer( struct llvmpipe_context *lp )
 
    /* Disable xy clipping in linear mode.
     *
-    * Use a guard band if we don't have zsbuf.  Could enable
-    * guardband always - this just to be conservative.
+    * Use a guard band whenever the linear rasterizer is permitted.  Z
+    * clipping is still done by draw, so this is fine with a zsbuf too.
     *
     * Because we have a layering violation where the draw module emits
     * state changes to the driver while we're already inside a draw
@@ -257,6 +272,11 @@ void llvmpipe_update_derived( struct llvmpipe_context *llvmpipe )
    if (llvmpipe->tex_timestamp != lp_screen->timestamp) {
       llvmpipe->tex_timestamp = lp_screen->timestamp;
       llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+
+      /* a texture layout may have changed, which is part of the keys of
+       * the draw module's shader variants too
+       */
+      draw_flush(llvmpipe->draw);
    }
 
    /* This needs LP_NEW_RASTERIZER because of draw_prepare_shader_outputs(). */
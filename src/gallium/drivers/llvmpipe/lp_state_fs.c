@@ -105,6 +105,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_texture.h"
 #include "nir/nir_to_tgsi_info.h"
 
 #include "lp_screen.h"
@@ -213,14 +214,15 @@ lp_mem_type_from_format_desc(const struct util_format_description *format_desc,
  * quad arguments with fs length 8.
  *
  * \param first_quad  which quad(s) of the quad group to test, in [0,3]
- * \param mask_input  bitwise mask for the whole 4x4 stamp
+ * \param mask_input  bitwise mask for the whole 4x4 stamp, 16 bits per
+ *                    sample, four samples per 64-bit word
  */
 static LLVMValueRef
 generate_quad_mask(struct gallivm_state *gallivm,
                    struct lp_type fs_type,
                    unsigned first_quad,
                    unsigned sample,
-                   LLVMValueRef mask_input) /* int64 */
+                   LLVMValueRef mask_input) /* int64 * */
 {
    LLVMBuilderRef builder = gallivm->builder;
    struct lp_type mask_type;
@@ -259,7 +261,10 @@ generate_quad_mask(struct gallivm_state *gallivm,
       shift = 0;
    }
 
-   mask_input = LLVMBuildLShr(builder, mask_input, lp_build_const_int64(gallivm, 16 * sample), "");
+   LLVMValueRef word = lp_build_const_int32(gallivm, sample / 4);
+   mask_input = LLVMBuildGEP(builder, mask_input, &word, 1, "");
+   mask_input = LLVMBuildLoad(builder, mask_input, "");
+   mask_input = LLVMBuildLShr(builder, mask_input, lp_build_const_int64(gallivm, 16 * (sample % 4)), "");
    mask_input = LLVMBuildTrunc(builder, mask_input,
                                i32t, "");
    mask_input = LLVMBuildAnd(builder, mask_input, lp_build_const_int32(gallivm, 0xffff), "");
@@ -2407,7 +2412,8 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
    undef_src_val = lp_build_undef(gallivm, fs_type);
 
    row_type.length = fs_type.length;
-   vector_width    = dst_type.floating ? lp_native_vector_width : lp_integer_vector_width;
+   /* the row combining below only deals with 128 or 256bit rows */
+   vector_width    = dst_type.floating ? MIN2(lp_native_vector_width, 256) : lp_integer_vector_width;
 
    /* Compute correct swizzle and count channels */
    memset(swizzle, LP_BLD_SWIZZLE_DONTCARE, TGSI_NUM_CHANNELS);
@@ -3059,7 +3065,12 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.sign = TRUE;          /* values are signed */
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
-   fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   /*
+    * Depth/stencil testing and the color buffer code only know about one
+    * quad or a 4x2 pair of quads per vector, so even with 512bit vectors
+    * this stays at 8 elements.
+    */
+   fs_type.length = MIN2(lp_native_vector_width / 32, 8); /* n*4 elements per vector */
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -3089,7 +3100,7 @@ generate_fragment(struct llvmpipe_context *lp,
    arg_types[6] = LLVMPointerType(fs_elem_type, 0);    /* dady */
    arg_types[7] = LLVMPointerType(LLVMPointerType(int8_type, 0), 0);  /* color */
    arg_types[8] = LLVMPointerType(int8_type, 0);       /* depth */
-   arg_types[9] = LLVMInt64TypeInContext(gallivm->context);  /* mask_input */
+   arg_types[9] = LLVMPointerType(LLVMInt64TypeInContext(gallivm->context), 0);  /* mask_input */
    arg_types[10] = variant->jit_thread_data_ptr_type;  /* per thread data */
    arg_types[11] = LLVMPointerType(int32_type, 0);     /* stride */
    arg_types[12] = int32_type;                         /* depth_stride */
@@ -3193,13 +3204,15 @@ generate_fragment(struct llvmpipe_context *lp,
       LLVMValueRef glob_sample_pos = LLVMAddGlobal(gallivm->module, LLVMArrayType(flt_type, key->coverage_samples * 2), "");
       LLVMValueRef sample_pos_array;
 
-      if (key->multisample && key->coverage_samples == 4) {
-         LLVMValueRef sample_pos_arr[8];
-         for (unsigned i = 0; i < 4; i++) {
-            sample_pos_arr[i * 2] = LLVMConstReal(flt_type, lp_sample_pos_4x[i][0]);
-            sample_pos_arr[i * 2 + 1] = LLVMConstReal(flt_type, lp_sample_pos_4x[i][1]);
+      if (key->multisample && key->coverage_samples > 1) {
+         const float (*sample_pos)[2] = lp_sample_positions(key->coverage_samples);
+         LLVMValueRef sample_pos_arr[LP_MAX_SAMPLES * 2];
+         for (unsigned i = 0; i < key->coverage_samples; i++) {
+            sample_pos_arr[i * 2] = LLVMConstReal(flt_type, sample_pos[i][0]);
+            sample_pos_arr[i * 2 + 1] = LLVMConstReal(flt_type, sample_pos[i][1]);
          }
-         sample_pos_array = LLVMConstArray(LLVMFloatTypeInContext(gallivm->context), sample_pos_arr, 8);
+         sample_pos_array = LLVMConstArray(LLVMFloatTypeInContext(gallivm->context), sample_pos_arr,
+                                           key->coverage_samples * 2);
       } else {
          LLVMValueRef sample_pos_arr[2];
          sample_pos_arr[0] = LLVMConstReal(flt_type, 0.5);
@@ -3359,6 +3372,12 @@ generate_fragment(struct llvmpipe_context *lp,
 
          for (unsigned s = 0; s < key->cbuf_nr_samples[cbuf]; s++) {
             unsigned mask_idx = num_fs * (key->multisample ? s : 0);
+            /*
+             * Skip the other samples when they are not covered, which is
+             * common at edges and for blocks the rasterizer shades at
+             * sample 0 only.
+             */
+            boolean sample_branch = do_branch || (key->multisample && s > 0);
             unsigned out_idx = key->min_samples == 1 ? 0 : s;
             LLVMValueRef out_ptr = color_ptr;;
 
@@ -3374,7 +3393,7 @@ generate_fragment(struct llvmpipe_context *lp,
                                       key->cbuf_format[cbuf],
                                       num_fs, fs_type, &fs_mask[mask_idx], fs_out_color[out_idx],
                                       context_ptr, out_ptr, stride,
-                                      partial_mask, do_branch);
+                                      partial_mask, sample_branch);
          }
       }
    }
@@ -3484,6 +3503,8 @@ dump_fs_variant_key(struct lp_fragment_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -3578,7 +3599,9 @@ generate_variant(struct llvmpipe_context *lp,
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
    boolean no_kill;
+   boolean depth_less, depth_greater;
    boolean linear;
+   unsigned i;
    char module_name[64];
    unsigned char ir_sha1_cache_key[20];
    struct lp_cached_code cached = { 0 };
@@ -3661,6 +3684,91 @@ generate_variant(struct llvmpipe_context *lp,
          shader->info.cbuf[0][3].file != TGSI_FILE_NULL
          ? TRUE : FALSE;
 
+   /*
+    * With per-pixel shading a fully covered block writes the same colour to
+    * all of its samples, unless depth/stencil testing, alpha-to-coverage or
+    * the shader itself (sample masks, centroid interpolation) makes the
+    * result differ between samples.
+    */
+   variant->ms_uniform =
+         key->multisample &&
+         key->min_samples == 1 &&
+         !key->depth.enabled &&
+         !key->stencil[0].enabled &&
+         !key->blend.alpha_to_coverage &&
+         !key->occlusion_count &&
+         !shader->info.base.reads_samplemask &&
+         !shader->info.base.writes_samplemask &&
+         !shader->info.base.uses_fbfetch;
+
+   for (i = 0; i < shader->info.base.num_inputs; i++) {
+      if (shader->info.base.input_interpolate_loc[i] != TGSI_INTERPOLATE_LOC_CENTER)
+         variant->ms_uniform = FALSE;
+   }
+
+   for (i = 0; i < shader->info.base.num_system_values; i++) {
+      switch (shader->info.base.system_value_semantic_name[i]) {
+      case TGSI_SEMANTIC_SAMPLEID:
+      case TGSI_SEMANTIC_SAMPLEPOS:
+      case TGSI_SEMANTIC_SAMPLEMASK:
+         variant->ms_uniform = FALSE;
+         break;
+      default:
+         break;
+      }
+   }
+
+   variant->ms_reads_dst = key->blend.logicop_enable;
+   for (i = 0; i < key->nr_cbufs; i++) {
+      if (key->cbuf_format[i] != PIPE_FORMAT_NONE &&
+          (key->blend.rt[i].blend_enable ||
+           !util_format_colormask_full(util_format_description(key->cbuf_format[i]),
+                                       key->blend.rt[i].colormask)))
+         variant->ms_reads_dst = TRUE;
+   }
+
+   /*
+    * Depth writes with a LESS test can only lower the stored values, and
+    * with a GREATER test only raise them.  Rejecting whole blocks is safe
+    * as long as nothing but the depth test decides a fragment's fate, and
+    * nothing else happens to a fragment failing it.
+    */
+   depth_less = key->depth.func == PIPE_FUNC_LESS ||
+                key->depth.func == PIPE_FUNC_LEQUAL;
+   depth_greater = key->depth.func == PIPE_FUNC_GREATER ||
+                   key->depth.func == PIPE_FUNC_GEQUAL;
+
+   variant->hiz_test =
+         key->depth.enabled &&
+         (depth_less || depth_greater) &&
+         !key->depth_clamp &&
+         !key->stencil[0].enabled &&
+         !shader->info.base.writes_z &&
+         !shader->info.base.writes_memory;
+
+   if (!key->depth.enabled || !key->depth.writemask)
+      variant->hiz_invalidate = 0;
+   else if (shader->info.base.writes_z)
+      variant->hiz_invalidate = LP_HIZ_MIN | LP_HIZ_MAX;
+   else if (depth_less)
+      variant->hiz_invalidate = LP_HIZ_MIN;
+   else if (depth_greater)
+      variant->hiz_invalidate = LP_HIZ_MAX;
+   else if (key->depth.func == PIPE_FUNC_NEVER ||
+            key->depth.func == PIPE_FUNC_EQUAL)
+      variant->hiz_invalidate = 0;
+   else
+      variant->hiz_invalidate = LP_HIZ_MIN | LP_HIZ_MAX;
+
+   variant->hiz_full_write =
+         variant->hiz_test &&
+         key->depth.writemask &&
+         !key->multisample &&
+         !key->alpha.enabled &&
+         !key->blend.alpha_to_coverage &&
+         !shader->info.base.uses_kill &&
+         !shader->info.base.writes_samplemask;
+
    /* We only care about opaque blits for now */
    if (variant->opaque &&
        (shader->kind == LP_FS_KIND_BLIT_RGBA ||
@@ -3680,6 +3788,7 @@ generate_variant(struct llvmpipe_context *lp,
       }
 
       if (target == PIPE_TEXTURE_2D &&
+          !samp0->texture_state.tiled &&
           min_img_filter == PIPE_TEX_FILTER_NEAREST &&
           mag_img_filter == PIPE_TEX_FILTER_NEAREST &&
           min_mip_filter == PIPE_TEX_MIPFILTER_NONE &&
@@ -3695,14 +3804,43 @@ generate_variant(struct llvmpipe_context *lp,
    }
 
 
-   /* Whether this is a candidate for the linear path */
-   linear =
+   /*
+    * The linear rasterizer can resolve the depth test ahead of shading
+    * when nothing the shader does affects depth or coverage.
+    */
+   variant->linear_depth =
+         key->depth.enabled &&
+         lp_linear_depth_format(key->zsbuf_format) &&
          !key->stencil[0].enabled &&
-         !key->depth.enabled &&
-         !shader->info.base.uses_kill &&
-         !key->blend.logicop_enable &&
-         (key->cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM ||
-          key->cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM);
+         !key->depth_clamp &&
+         !key->multisample &&
+         !key->alpha.enabled &&
+         !key->blend.alpha_to_coverage &&
+         !key->occlusion_count &&
+         !shader->info.base.writes_z &&
+         !shader->info.base.writes_samplemask;
+
+   /* Whether this is a candidate for the linear path */
+   if (key->nr_cbufs != 1 || !lp_linear_cbuf_format(key->cbuf_format[0]))
+      variant->linear_reason = LP_LINEAR_FAIL_FRAMEBUFFER;
+   else if (key->stencil[0].enabled)
+      variant->linear_reason = LP_LINEAR_FAIL_STENCIL;
+   else if (key->depth.enabled && !variant->linear_depth)
+      variant->linear_reason = LP_LINEAR_FAIL_DEPTH;
+   else if (shader->info.base.uses_kill)
+      variant->linear_reason = LP_LINEAR_FAIL_KILL;
+   else if (key->blend.logicop_enable)
+      variant->linear_reason = LP_LINEAR_FAIL_LOGICOP;
+   else
+      variant->linear_reason = LP_LINEAR_OK;
+
+   /* The linear path samples textures directly, which must be linear too */
+   for (unsigned i = 0; !variant->linear_reason && i < key->nr_sampler_views; i++) {
+      if (lp_fs_variant_key_samplers(key)[i].texture_state.tiled)
+         variant->linear_reason = LP_LINEAR_FAIL_TEXTURE;
+   }
+
+   linear = variant->linear_reason == LP_LINEAR_OK;
 
    memcpy(&variant->key, key, sizeof *key);
 
@@ -3733,7 +3871,9 @@ generate_variant(struct llvmpipe_context *lp,
        */
       if (fullcolormask &&
           !key->alpha.enabled &&
-          !key->blend.alpha_to_coverage) {
+          !key->blend.alpha_to_coverage &&
+          (key->cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM ||
+           key->cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM)) {
          llvmpipe_fs_variant_linear_fastpath(variant);
       }
 
@@ -3787,6 +3927,9 @@ generate_variant(struct llvmpipe_context *lp,
        * code to determine active inputs.
        */
       lp_linear_check_variant(variant);
+
+      if (!variant->jit_linear && !variant->linear_reason)
+         variant->linear_reason = LP_LINEAR_FAIL_SHADER;
    }
 
    if (needs_caching) {
@@ -4113,6 +4256,22 @@ llvmpipe_set_shader_images(struct pipe_context *pipe,
          bool read_only = !(image->access & PIPE_IMAGE_ACCESS_WRITE);
          llvmpipe_flush_resource(pipe, image->resource, 0, read_only, false,
                                  false, "image");
+
+         /* image access only knows the linear layout */
+         llvmpipe_resource_untile(pipe, image->resource);
+
+         /* shaders may access any sample, and write single samples at any
+          * time from now on
+          */
+         if (image->resource->nr_samples > 1) {
+            llvmpipe_resource_ms_expand(llvmpipe_resource(image->resource));
+            if (!read_only)
+               llvmpipe_resource(image->resource)->ms_untracked = true;
+         }
+
+         /* and anywhere, not just in the tiles being rasterized */
+         if (!read_only)
+            llvmpipe_resource(image->resource)->damage_untracked = true;
       }
    }
 
@@ -4347,8 +4506,8 @@ make_variant_key(struct llvmpipe_context *lp,
           * used views may be included in the shader key.
           */
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
-            lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_static_texture_state(&fs_sampler[i].texture_state,
+                                          lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -4356,8 +4515,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_static_texture_state(&fs_sampler[i].texture_state,
+                                          lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -4482,6 +4641,8 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       }
    }
 
+   lp->fs_linear_reason = variant ? variant->linear_reason : LP_LINEAR_FAIL_SHADER;
+
    /* Bind this variant */
    lp_setup_set_fs_variant(lp->setup, variant);
 }
@@ -75,6 +75,9 @@ struct lp_image_static_state
    struct lp_static_texture_state image_state;
 };
 
+#define LP_HIZ_MIN 0x1
+#define LP_HIZ_MAX 0x2
+
 struct lp_depth_state
 {
    unsigned enabled:1;         /**< depth test enabled? */
@@ -164,6 +167,32 @@ struct lp_fragment_shader_variant
    unsigned potentially_opaque:1;
 
    unsigned blit:1;
+
+   /*
+    * Whether fully covered multisample blocks get the same value in every
+    * sample, and whether that value depends on the colour buffer contents.
+    */
+   unsigned ms_uniform:1;
+   unsigned ms_reads_dst:1;
+
+   /*
+    * Hierarchical depth: whether blocks may be rejected against the depth
+    * bounds of the tile before shading, which of the bounds (LP_HIZ_MIN,
+    * LP_HIZ_MAX) depth writes can move, and whether a fully covered block
+    * always ends up no further than the primitive's depth.
+    */
+   unsigned hiz_test:1;
+   unsigned hiz_invalidate:2;
+   unsigned hiz_full_write:1;
+
+   /*
+    * Linear rasterizer: whether the depth test can be resolved ahead of
+    * the linear shader for constant-depth rectangles, and why the variant
+    * cannot use the linear path at all (enum lp_linear_reason).
+    */
+   unsigned linear_depth:1;
+   unsigned linear_reason:4;
+
    unsigned linear_input_mask:16;
    struct pipe_reference reference;
    boolean opaque;
@@ -233,6 +262,58 @@ struct lp_fragment_shader
 };
 
 
+/**
+ * Color buffer formats the linear rasterizer can render to.  The linear
+ * shaders work on 8-bit BGRA or RGBA pixels; 565 is expanded around them.
+ */
+static inline boolean
+lp_linear_cbuf_format(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+   case PIPE_FORMAT_B5G6R5_UNORM:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Whether the linear shaders for this color buffer produce RGBA rather
+ * than BGRA ordered pixels.
+ */
+static inline boolean
+lp_linear_rgba_order(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_R8G8B8A8_UNORM ||
+          format == PIPE_FORMAT_R8G8B8X8_UNORM;
+}
+
+
+/**
+ * Depth buffer formats the linear rasterizer can test against.
+ */
+static inline boolean
+lp_linear_depth_format(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_Z16_UNORM:
+   case PIPE_FORMAT_Z24X8_UNORM:
+   case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+   case PIPE_FORMAT_X8Z24_UNORM:
+   case PIPE_FORMAT_S8_UINT_Z24_UNORM:
+   case PIPE_FORMAT_Z32_FLOAT:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
 void
 llvmpipe_fs_analyse_nir(struct lp_fragment_shader *shader);
 void
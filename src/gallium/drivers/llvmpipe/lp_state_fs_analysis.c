@@ -208,16 +208,21 @@ llvmpipe_nir_fn_is_linear_compat(struct nir_shader *shader,
             for (unsigned i = 0; i < tex->num_srcs; i++) {
                switch (tex->src[i].src_type) {
                case nir_tex_src_coord: {
-                  nir_ssa_scalar scalar = nir_ssa_scalar_resolved(tex->src[i].src.ssa, 0);
-                  if (scalar.def->parent_instr->type != nir_instr_type_intrinsic)
-                     return false;
-                  nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(scalar.def->parent_instr);
-                  if (intrin->intrinsic != nir_intrinsic_load_deref)
-                     return false;
-                  nir_deref_instr *deref = nir_instr_as_deref(intrin->src[0].ssa->parent_instr);
-                  nir_variable *var = nir_deref_instr_get_variable(deref);
-                  if (var->data.mode != nir_var_shader_in)
-                     return false;
+                  /* s and t must come straight from inputs */
+                  for (unsigned c = 0; c < 2; c++) {
+                     nir_ssa_scalar scalar = nir_ssa_scalar_resolved(tex->src[i].src.ssa, c);
+                     if (scalar.def->parent_instr->type != nir_instr_type_intrinsic)
+                        return false;
+                     nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(scalar.def->parent_instr);
+                     if (intrin->intrinsic != nir_intrinsic_load_deref)
+                        return false;
+                     nir_deref_instr *deref = nir_instr_as_deref(intrin->src[0].ssa->parent_instr);
+                     nir_variable *var = nir_deref_instr_get_variable(deref);
+                     if (var->data.mode != nir_var_shader_in)
+                        return false;
+                     tex_info->coord[c].u.index = var->data.driver_location;
+                     tex_info->coord[c].swizzle = scalar.comp + var->data.location_frac;
+                  }
                   break;
                }
                default:
@@ -249,7 +254,6 @@ llvmpipe_nir_fn_is_linear_compat(struct nir_shader *shader,
             /* this is enforced in the scanner previously. */
             tex_info->coord[0].file = TGSI_FILE_INPUT;
             tex_info->coord[1].file = TGSI_FILE_INPUT;
-            tex_info->coord[1].swizzle = 1;
             info->num_texs++;
             break;
          }
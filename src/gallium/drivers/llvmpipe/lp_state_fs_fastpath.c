@@ -52,7 +52,7 @@ no_op(const struct lp_jit_context *context,
       const void *dady,
       uint8_t **cbufs,
       uint8_t *depth,
-      uint64_t mask,
+      const uint64_t *mask,
       struct lp_jit_thread_data *thread_data,
       unsigned *strides,
       unsigned depth_stride,
@@ -150,14 +150,14 @@ red(const struct lp_jit_context *context,
     const void *dady,
     uint8_t **cbufs,
     uint8_t *depth,
-    uint64_t int_mask,
+    const uint64_t *int_mask,
     struct lp_jit_thread_data *thread_data,
     unsigned *strides,
     unsigned depth_stride,
     unsigned *sample_stride,
     unsigned depth_sample_stride)
 {
-   opaque_color(cbufs, strides, int_mask, 0xffff0000);
+   opaque_color(cbufs, strides, int_mask[0], 0xffff0000);
    (void)facing;
    (void)depth;
    (void)thread_data;
@@ -177,14 +177,14 @@ green(const struct lp_jit_context *context,
       const void *dady,
       uint8_t **cbufs,
       uint8_t *depth,
-      uint64_t int_mask,
+      const uint64_t *int_mask,
       struct lp_jit_thread_data *thread_data,
       unsigned *strides,
       unsigned depth_stride,
       unsigned *sample_stride,
       unsigned depth_sample_stride)
 {
-   opaque_color(cbufs, strides, int_mask, 0xff00ff00);
+   opaque_color(cbufs, strides, int_mask[0], 0xff00ff00);
    (void)facing;
    (void)depth;
    (void)thread_data;
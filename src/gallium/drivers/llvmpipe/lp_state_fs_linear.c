@@ -37,6 +37,7 @@
 #include "lp_jit.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 #include "lp_state_fs.h"
 #include "lp_linear_priv.h"
 
@@ -267,8 +268,10 @@ init_nearest_sampler(struct nearest_sampler *samp,
    int i;
    float oow = 1.0f / w0;
 
-   if (dwdx != 0.0 || dwdy != 0.0)
+   if (dwdx != 0.0 || dwdy != 0.0) {
+      LP_COUNT(nr_linear_rects[LP_LINEAR_FAIL_W]);
       return FALSE;
+   }
 
    samp->texture = texture;
    samp->width = width;
@@ -142,7 +142,17 @@ llvm_fragment_body(struct lp_build_context *bld,
                    struct lp_type fs_type,
                    LLVMValueRef dst)
 {
-   const unsigned char bgra_swizzles[4] = {2, 1, 0, 3};
+   static const unsigned char bgra_swizzles[4] = {2, 1, 0, 3};
+   static const unsigned char rgba_swizzles[4] = {0, 1, 2, 3};
+   enum pipe_format cbuf_format = variant->key.cbuf_format[0];
+
+   /* Pixels are worked on in the color buffer's byte order.  565 buffers
+    * are expanded to 8-bit BGRX around the shader.
+    */
+   const unsigned char *swizzles =
+      lp_linear_rgba_order(cbuf_format) ? rgba_swizzles : bgra_swizzles;
+   if (cbuf_format == PIPE_FORMAT_B5G6R5_UNORM)
+      cbuf_format = PIPE_FORMAT_B8G8R8X8_UNORM;
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS];
@@ -189,14 +199,14 @@ llvm_fragment_body(struct lp_build_context *bld,
 
    if (shader->base.type == PIPE_SHADER_IR_TGSI)
       lp_build_tgsi_aos(gallivm, shader->base.tokens, fs_type,
-                        bgra_swizzles,
+                        swizzles,
                         consts_ptr, inputs, outputs,
                         &sampler->base,
                         &shader->info.base);
    else {
       nir_shader *clone = nir_shader_clone(NULL, shader->base.ir.nir);
       lp_build_nir_aos(gallivm, clone, fs_type,
-                       bgra_swizzles,
+                       swizzles,
                        consts_ptr, inputs, outputs,
                        &sampler->base,
                        &shader->info.base);
@@ -232,14 +242,14 @@ llvm_fragment_body(struct lp_build_context *bld,
 
          mask = lp_build_cmp(bld, variant->key.alpha.func, output, broadcast_alpha);
          /* XXX is 4 correct? */
-         mask = lp_build_swizzle_scalar_aos(bld, mask, bgra_swizzles[3], 4);
+         mask = lp_build_swizzle_scalar_aos(bld, mask, swizzles[3], 4);
 
          lp_build_name(mask, "alpha_test_mask");
       }
 
       result = lp_build_blend_aos(gallivm,
                                   &variant->key.blend,
-                                  variant->key.cbuf_format[i],
+                                  cbuf_format,
                                   fs_type,
                                   cbuf,   /* rt */
                                   output, /* src */
@@ -250,7 +260,7 @@ llvm_fragment_body(struct lp_build_context *bld,
                                   mask,
                                   blend_color,  /* const_ */
                                   NULL,         /* const_alpha */
-                                  bgra_swizzles,
+                                  swizzles,
                                   4);
    }
 
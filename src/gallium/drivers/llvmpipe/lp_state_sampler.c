@@ -33,6 +33,7 @@
 #include "util/u_memory.h"
 
 #include "draw/draw_context.h"
+#include "gallivm/lp_bld_sample.h"
 
 #include "lp_context.h"
 #include "lp_screen.h"
@@ -42,6 +43,20 @@
 #include "lp_flush.h"
 
 
+/**
+ * lp_sampler_static_texture_state() plus the texture layout, which only
+ * llvmpipe knows about.
+ */
+void
+llvmpipe_static_texture_state(struct lp_static_texture_state *state,
+                              const struct pipe_sampler_view *view)
+{
+   lp_sampler_static_texture_state(state, view);
+   if (view)
+      state->tiled = llvmpipe_resource_is_tiled(view->texture);
+}
+
+
 static void *
 llvmpipe_create_sampler_state(struct pipe_context *pipe,
                               const struct pipe_sampler_state *sampler)
@@ -149,9 +164,14 @@ llvmpipe_set_sampler_views(struct pipe_context *pipe,
                       "context\n", i);
       }
 
-      if (view)
+      if (view) {
          llvmpipe_flush_resource(pipe, view->texture, 0, true, false, false, "sampler_view");
 
+         /* shaders may fetch any sample */
+         if (view->texture->nr_samples > 1)
+            llvmpipe_resource_ms_expand(llvmpipe_resource(view->texture));
+      }
+
       if (take_ownership) {
          pipe_sampler_view_reference(&llvmpipe->sampler_views[shader][start + i],
                                      NULL);
@@ -367,7 +387,8 @@ prepare_shader_sampling(
                                  first_level, last_level,
                                  num_samples, sample_stride,
                                  addr,
-                                 row_stride, img_stride, mip_offsets);
+                                 row_stride, img_stride, mip_offsets,
+                                 lp_tex->tiled);
       }
    }
 }
@@ -28,6 +28,8 @@
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_memset.h"
+#include "util/u_gen_mipmap.h"
+#include "util/u_memory.h"
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_limits.h"
@@ -35,6 +37,7 @@
 #include "lp_texture.h"
 #include "lp_query.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 static void
 lp_resource_copy_ms(struct pipe_context *pipe,
@@ -113,6 +116,218 @@ lp_resource_copy(struct pipe_context *pipe,
 }
 
 
+/**
+ * Whether the samples of a format can be averaged byte by byte.
+ */
+static boolean
+lp_resolve_bytewise(const struct util_format_description *desc)
+{
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB)
+      return FALSE;
+
+   for (unsigned i = 0; i < desc->nr_channels; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+      if (chan->size != 8 ||
+          !(chan->type == UTIL_FORMAT_TYPE_VOID ||
+            (chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized)))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+static inline boolean
+lp_resolve_block_uniform(const uint64_t *uniform, unsigned tiles_x,
+                         unsigned x, unsigned y)
+{
+   const uint64_t *tile;
+   unsigned block;
+
+   if (!uniform)
+      return FALSE;
+
+   tile = uniform + ((y / TILE_SIZE) * tiles_x + x / TILE_SIZE) * LP_TILE_BLOCK_WORDS;
+   block = ((y % TILE_SIZE) / 4) * (TILE_SIZE / 4) + (x % TILE_SIZE) / 4;
+   return (tile[block / 64] >> (block % 64)) & 1;
+}
+
+
+/**
+ * Average up to TILE_SIZE pixels over all samples.
+ */
+static void
+lp_resolve_span(enum pipe_format format, boolean bytewise,
+                unsigned nr_samples, unsigned bpp,
+                uint8_t *dst, const uint8_t *src, unsigned sample_stride,
+                unsigned width)
+{
+   assert(width <= TILE_SIZE);
+
+   if (bytewise) {
+      const unsigned shift = util_logbase2(nr_samples);
+      const unsigned n = width * bpp;
+      uint16_t sum[TILE_SIZE * 4];
+
+      assert(util_is_power_of_two_nonzero(nr_samples));
+      assert(n <= ARRAY_SIZE(sum));
+
+      for (unsigned i = 0; i < n; i++)
+         sum[i] = nr_samples / 2 + src[i];
+      for (unsigned s = 1; s < nr_samples; s++) {
+         const uint8_t *sample = src + s * sample_stride;
+         for (unsigned i = 0; i < n; i++)
+            sum[i] += sample[i];
+      }
+      for (unsigned i = 0; i < n; i++)
+         dst[i] = sum[i] >> shift;
+   }
+   else {
+      const float scale = 1.0f / nr_samples;
+      float acc[TILE_SIZE][4], tmp[TILE_SIZE][4];
+
+      util_format_unpack_rgba(format, acc, src, width);
+      for (unsigned s = 1; s < nr_samples; s++) {
+         util_format_unpack_rgba(format, tmp, src + s * sample_stride, width);
+         for (unsigned i = 0; i < width; i++)
+            for (unsigned c = 0; c < 4; c++)
+               acc[i][c] += tmp[i][c];
+      }
+      for (unsigned i = 0; i < width; i++)
+         for (unsigned c = 0; c < 4; c++)
+            acc[i][c] *= scale;
+      util_format_pack_rgba(format, dst, acc, width);
+   }
+}
+
+
+/**
+ * Resolve a rectangle of a multisample image by averaging its samples.
+ * Blocks marked in the uniform bits (see llvmpipe_resource::ms_uniform),
+ * if given, just get sample 0 copied.
+ *
+ * \param src      sample 0 of the pixel at x, y
+ * \param uniform  uniform block bits of the layer, or NULL
+ */
+void
+llvmpipe_resolve_ms_rect(enum pipe_format format, unsigned nr_samples,
+                         uint8_t *dst, unsigned dst_stride,
+                         const uint8_t *src, unsigned src_stride,
+                         unsigned sample_stride,
+                         unsigned x, unsigned y,
+                         unsigned width, unsigned height,
+                         const uint64_t *uniform, unsigned tiles_x)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const boolean bytewise = lp_resolve_bytewise(desc);
+   const unsigned bpp = desc->block.bits / 8;
+
+   for (unsigned row = 0; row < height; row++) {
+      unsigned col = 0;
+
+      while (col < width) {
+         /*
+          * Spans start and end at 4x4 block boundaries, so they are either
+          * entirely uniform or not.
+          */
+         const boolean is_uniform =
+            lp_resolve_block_uniform(uniform, tiles_x, x + col, y + row);
+         unsigned span = MIN2(4 - (x + col) % 4, width - col);
+
+         while (col + span < width && span + 4 <= TILE_SIZE &&
+                lp_resolve_block_uniform(uniform, tiles_x,
+                                         x + col + span, y + row) == is_uniform)
+            span += MIN2(4, width - col - span);
+
+         if (is_uniform)
+            memcpy(dst + col * bpp, src + col * bpp, span * bpp);
+         else
+            lp_resolve_span(format, bytewise, nr_samples, bpp,
+                            dst + col * bpp, src + col * bpp, sample_stride,
+                            span);
+
+         col += span;
+      }
+
+      dst += dst_stride;
+      src += src_stride;
+   }
+}
+
+
+/**
+ * Do multisample color resolves directly, instead of drawing with the
+ * blitter.
+ */
+static boolean
+lp_try_resolve(struct pipe_context *pipe, const struct pipe_blit_info *info)
+{
+   struct pipe_resource *src = info->src.resource;
+   struct pipe_resource *dst = info->dst.resource;
+   struct llvmpipe_resource *src_lpr = llvmpipe_resource(src);
+   const struct pipe_box *box = &info->src.box;
+   const enum pipe_format format = info->src.format;
+   struct pipe_transfer *src_trans, *dst_trans;
+   const uint8_t *src_map;
+   uint8_t *dst_map;
+
+   if (src->nr_samples <= 1 ||
+       dst->nr_samples > 1 ||
+       info->dst.format != format ||
+       util_format_description(format)->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       util_format_is_depth_or_stencil(format) ||
+       util_format_is_pure_integer(format) ||
+       util_format_get_blocksize(format) != util_format_get_blocksize(src->format) ||
+       util_format_get_blocksize(format) != util_format_get_blocksize(dst->format) ||
+       info->mask != PIPE_MASK_RGBA ||
+       info->sample0_only ||
+       info->scissor_enable ||
+       info->num_window_rectangles ||
+       info->alpha_blend)
+      return FALSE;
+
+   if (box->width <= 0 || box->height <= 0 || box->depth <= 0 ||
+       box->x < 0 || box->y < 0 || box->z < 0 ||
+       box->x + box->width > src->width0 ||
+       box->y + box->height > src->height0 ||
+       box->z + box->depth > src->array_size ||
+       box->width != info->dst.box.width ||
+       box->height != info->dst.box.height ||
+       box->depth != info->dst.box.depth)
+      return FALSE;
+
+   src_map = llvmpipe_transfer_map_ms(pipe, src, 0, PIPE_MAP_READ, 0,
+                                      box, &src_trans);
+   if (!src_map)
+      return FALSE;
+
+   dst_map = pipe->texture_map(pipe, dst, info->dst.level,
+                               PIPE_MAP_WRITE | PIPE_MAP_DISCARD_RANGE,
+                               &info->dst.box, &dst_trans);
+   if (!dst_map) {
+      pipe->texture_unmap(pipe, src_trans);
+      return FALSE;
+   }
+
+   for (int z = 0; z < box->depth; z++) {
+      llvmpipe_resolve_ms_rect(format, src->nr_samples,
+                               dst_map + z * dst_trans->layer_stride,
+                               dst_trans->stride,
+                               src_map + z * src_trans->layer_stride,
+                               src_trans->stride,
+                               src_lpr->sample_stride,
+                               box->x, box->y, box->width, box->height,
+                               llvmpipe_ms_uniform_bits(src_lpr, box->z + z, 0, 0),
+                               src_lpr->ms_tiles_x);
+   }
+
+   pipe->texture_unmap(pipe, dst_trans);
+   pipe->texture_unmap(pipe, src_trans);
+   return TRUE;
+}
+
+
 static void lp_blit(struct pipe_context *pipe,
                     const struct pipe_blit_info *blit_info)
 {
@@ -126,6 +341,9 @@ static void lp_blit(struct pipe_context *pipe,
       return; /* done */
    }
 
+   if (lp_try_resolve(pipe, &info))
+      return;
+
    if (!util_blitter_is_blit_supported(lp->blitter, &info)) {
       debug_printf("llvmpipe: blit unsupported %s -> %s\n",
                    util_format_short_name(info.src.resource->format),
@@ -247,13 +465,11 @@ llvmpipe_get_sample_position(struct pipe_context *pipe,
                              unsigned sample_index,
                              float *out_value)
 {
-   switch (sample_count) {
-   case 4:
-      out_value[0] = lp_sample_pos_4x[sample_index][0];
-      out_value[1] = lp_sample_pos_4x[sample_index][1];
-      break;
-   default:
-      break;
+   const float (*sample_pos)[2] = lp_sample_positions(sample_count);
+
+   if (sample_pos) {
+      out_value[0] = sample_pos[sample_index][0];
+      out_value[1] = sample_pos[sample_index][1];
    }
 }
 
@@ -484,6 +700,73 @@ llvmpipe_clear_buffer(struct pipe_context *pipe,
    pipe->buffer_unmap(pipe, dst_t);
 }
 
+/**
+ * Filter the levels straight in texture memory when the CPU filter knows
+ * the format.  Anything else goes back to util_gen_mipmap's blits.
+ */
+static bool
+lp_generate_mipmap(struct pipe_context *pipe,
+                   struct pipe_resource *pt,
+                   enum pipe_format format,
+                   unsigned base_level,
+                   unsigned last_level,
+                   unsigned first_layer,
+                   unsigned last_layer)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(pt);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   const unsigned num_layers = last_layer - first_layer + 1;
+   const uint8_t **src;
+   uint8_t **dst;
+   unsigned level, i;
+
+   if (pt->target == PIPE_TEXTURE_3D ||
+       pt->nr_samples > 1 ||
+       lpr->tiled ||
+       !lpr->tex_data ||
+       !util_gen_mipmap_cpu_supported(format))
+      return false;
+
+   src = MALLOC(num_layers * sizeof(*src));
+   dst = MALLOC(num_layers * sizeof(*dst));
+   if (!src || !dst) {
+      FREE(src);
+      FREE(dst);
+      return false;
+   }
+
+   llvmpipe_flush_resource(pipe, pt, 0,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "generate_mipmap");
+
+   for (level = base_level + 1; level <= last_level; level++) {
+      for (i = 0; i < num_layers; i++) {
+         src[i] = llvmpipe_get_texture_image_address(lpr, first_layer + i,
+                                                     level - 1);
+         dst[i] = llvmpipe_get_texture_image_address(lpr, first_layer + i,
+                                                     level);
+      }
+
+      util_gen_mipmap_cpu_level(format, num_layers,
+                                src, lpr->row_stride[level - 1],
+                                u_minify(pt->width0, level - 1),
+                                u_minify(pt->height0, level - 1),
+                                dst, lpr->row_stride[level],
+                                u_minify(pt->width0, level),
+                                u_minify(pt->height0, level));
+   }
+
+   FREE(src);
+   FREE(dst);
+
+   /* Do something to notify sharing contexts of a texture change. */
+   p_atomic_inc(&screen->timestamp);
+   return true;
+}
+
+
 void
 llvmpipe_init_surface_functions(struct llvmpipe_context *lp)
 {
@@ -496,6 +779,7 @@ llvmpipe_init_surface_functions(struct llvmpipe_context *lp)
    lp->pipe.clear_buffer = llvmpipe_clear_buffer;
    lp->pipe.resource_copy_region = lp_resource_copy;
    lp->pipe.blit = lp_blit;
+   lp->pipe.generate_mipmap = lp_generate_mipmap;
    lp->pipe.flush_resource = lp_flush_resource;
    lp->pipe.get_sample_position = llvmpipe_get_sample_position;
 }
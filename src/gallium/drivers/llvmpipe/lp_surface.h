@@ -32,6 +32,10 @@
 #define LP_SURFACE_H
 
 
+#include "pipe/p_compiler.h"
+#include "pipe/p_format.h"
+
+
 struct llvmpipe_context;
 
 
@@ -39,4 +43,14 @@ extern void
 llvmpipe_init_surface_functions(struct llvmpipe_context *lp);
 
 
+void
+llvmpipe_resolve_ms_rect(enum pipe_format format, unsigned nr_samples,
+                         uint8_t *dst, unsigned dst_stride,
+                         const uint8_t *src, unsigned src_stride,
+                         unsigned sample_stride,
+                         unsigned x, unsigned y,
+                         unsigned width, unsigned height,
+                         const uint64_t *uniform, unsigned tiles_x);
+
+
 #endif /* LP_SURFACE_H */
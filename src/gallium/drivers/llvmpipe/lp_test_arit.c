@@ -255,6 +255,24 @@ const float round_values[] = {
       -FLT_MAX
 };
 
+/*
+ * Only values which fit into an int32, for lp_build_iround.
+ */
+const float iround_values[] = {
+      -10.0, -1, 0.0, 12.0,
+      -1.49, -0.25, 1.25, 2.51,
+      -0.99, -0.01, 0.01, 0.99,
+      -1.5, -0.5, 0.5, 1.5,
+      2.5, -2.5, 8388609.0f, -8388609.0f,
+      2147483520.0f, -2147483648.0f
+};
+
+static LLVMValueRef
+lp_build_iround_float(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_int_to_float(bld, lp_build_iround(bld, a));
+}
+
 static float fractf(float x)
 {
    x -= floorf(x);
@@ -329,6 +347,7 @@ unary_tests[] = {
    {"cos", &lp_build_cos, &cosf, sincos_values, ARRAY_SIZE(sincos_values), 20.0 },
    {"sgn", &lp_build_sgn, &sgnf, sgn_values, ARRAY_SIZE(sgn_values), 20.0 },
    {"round", &lp_build_round, &nearbyintf, round_values, ARRAY_SIZE(round_values), 24.0 },
+   {"iround", &lp_build_iround_float, &nearbyintf, iround_values, ARRAY_SIZE(iround_values), 24.0 },
    {"trunc", &lp_build_trunc, &truncf, round_values, ARRAY_SIZE(round_values), 24.0 },
    {"floor", &lp_build_floor, &floorf, round_values, ARRAY_SIZE(round_values), 24.0 },
    {"ceil", &lp_build_ceil, &ceilf, round_values, ARRAY_SIZE(round_values), 24.0 },
@@ -625,6 +625,10 @@ const struct lp_type blend_types[] = {
    /* float, fixed,  sign,  norm, width, len */
    {   TRUE, FALSE,  TRUE, FALSE,    32,   4 }, /* f32 x 4 */
    {  FALSE, FALSE, FALSE,  TRUE,     8,  16 }, /* u8n x 16 */
+   {   TRUE, FALSE,  TRUE, FALSE,    32,   8 }, /* f32 x 8 */
+   {  FALSE, FALSE, FALSE,  TRUE,     8,  32 }, /* u8n x 32 */
+   {   TRUE, FALSE,  TRUE, FALSE,    32,  16 }, /* f32 x 16 */
+   {  FALSE, FALSE, FALSE,  TRUE,     8,  64 }, /* u8n x 64 */
 };
 
 
@@ -633,6 +637,14 @@ const unsigned num_factors = ARRAY_SIZE(blend_factors);
 const unsigned num_types = ARRAY_SIZE(blend_types);
 
 
+/* Skip 512bit types unless those are native (see lp_test_conv.c). */
+static boolean
+blend_type_enabled(const struct lp_type *type)
+{
+   return type->width * type->length <= MAX2(lp_native_vector_width, 256);
+}
+
+
 boolean
 test_all(unsigned verbose, FILE *fp)
 {
@@ -658,6 +670,9 @@ test_all(unsigned verbose, FILE *fp)
                            *alpha_dst_factor == PIPE_BLENDFACTOR_SRC_ALPHA_SATURATE)
                            continue;
 
+                        if (!blend_type_enabled(type))
+                           continue;
+
                         memset(&blend, 0, sizeof blend);
                         blend.rt[0].blend_enable      = 1;
                         blend.rt[0].rgb_func          = *rgb_func;
@@ -712,7 +727,9 @@ test_some(unsigned verbose, FILE *fp,
          alpha_dst_factor = &blend_factors[rand() % num_factors];
       } while(*alpha_dst_factor == PIPE_BLENDFACTOR_SRC_ALPHA_SATURATE);
 
-      type = &blend_types[rand() % num_types];
+      do {
+         type = &blend_types[rand() % num_types];
+      } while (!blend_type_enabled(type));
 
       memset(&blend, 0, sizeof blend);
       blend.rt[0].blend_enable      = 1;
@@ -352,6 +352,11 @@ const struct lp_type conv_types[] = {
    {   TRUE, FALSE, FALSE,  TRUE,    32,   8 },
    {   TRUE, FALSE, FALSE, FALSE,    32,   8 },
 
+   {   TRUE, FALSE,  TRUE,  TRUE,    32,  16 },
+   {   TRUE, FALSE,  TRUE, FALSE,    32,  16 },
+   {   TRUE, FALSE, FALSE,  TRUE,    32,  16 },
+   {   TRUE, FALSE, FALSE, FALSE,    32,  16 },
+
    /* Fixed */
    {  FALSE,  TRUE,  TRUE,  TRUE,    32,   4 },
    {  FALSE,  TRUE,  TRUE, FALSE,    32,   4 },
@@ -374,11 +379,21 @@ const struct lp_type conv_types[] = {
    {  FALSE, FALSE, FALSE,  TRUE,    32,   8 },
    {  FALSE, FALSE, FALSE, FALSE,    32,   8 },
 
+   {  FALSE, FALSE,  TRUE,  TRUE,    32,  16 },
+   {  FALSE, FALSE,  TRUE, FALSE,    32,  16 },
+   {  FALSE, FALSE, FALSE,  TRUE,    32,  16 },
+   {  FALSE, FALSE, FALSE, FALSE,    32,  16 },
+
    {  FALSE, FALSE,  TRUE,  TRUE,    16,   8 },
    {  FALSE, FALSE,  TRUE, FALSE,    16,   8 },
    {  FALSE, FALSE, FALSE,  TRUE,    16,   8 },
    {  FALSE, FALSE, FALSE, FALSE,    16,   8 },
 
+   {  FALSE, FALSE,  TRUE,  TRUE,    16,  32 },
+   {  FALSE, FALSE,  TRUE, FALSE,    16,  32 },
+   {  FALSE, FALSE, FALSE,  TRUE,    16,  32 },
+   {  FALSE, FALSE, FALSE, FALSE,    16,  32 },
+
    {  FALSE, FALSE,  TRUE,  TRUE,     8,  16 },
    {  FALSE, FALSE,  TRUE, FALSE,     8,  16 },
    {  FALSE, FALSE, FALSE,  TRUE,     8,  16 },
@@ -396,6 +411,17 @@ const struct lp_type conv_types[] = {
 const unsigned num_types = ARRAY_SIZE(conv_types);
 
 
+/*
+ * 512bit types are only tested (and timed) when llvmpipe actually uses
+ * 512bit vectors, e.g. with LP_NATIVE_VECTOR_WIDTH=512.
+ */
+static boolean
+conv_type_enabled(const struct lp_type *type)
+{
+   return type->width * type->length <= MAX2(lp_native_vector_width, 256);
+}
+
+
 boolean
 test_all(unsigned verbose, FILE *fp)
 {
@@ -410,6 +436,9 @@ test_all(unsigned verbose, FILE *fp)
          if(src_type == dst_type)
             continue;
 
+         if (!conv_type_enabled(src_type) || !conv_type_enabled(dst_type))
+            continue;
+
          if(!test_one(verbose, fp, *src_type, *dst_type)){
             success = FALSE;
             ++error_count;
@@ -433,11 +462,14 @@ test_some(unsigned verbose, FILE *fp,
    boolean success = TRUE;
 
    for(i = 0; i < n; ++i) {
-      src_type = &conv_types[rand() % num_types];
-      
+      do {
+         src_type = &conv_types[rand() % num_types];
+      } while (!conv_type_enabled(src_type));
+
       do {
          dst_type = &conv_types[rand() % num_types];
-      } while (src_type == dst_type || src_type->norm != dst_type->norm);
+      } while (src_type == dst_type || src_type->norm != dst_type->norm ||
+               !conv_type_enabled(dst_type));
 
       if(!test_one(verbose, fp, *src_type, *dst_type))
         success = FALSE;
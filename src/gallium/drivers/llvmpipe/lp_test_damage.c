@@ -0,0 +1,383 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Damage tracking of render targets (pipe_screen::resource_get_damage).
+ *
+ * A frame is a clear and one small quad.  Frames which render the same
+ * image as the previous one must report no damage, moving the quad must
+ * report the tiles it left and entered, and writes through a transfer
+ * must damage everything.  Run on a plain and on a threaded context.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_limits.h"
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define FB_SIZE 256
+
+struct damage_context
+{
+   const char *name;
+   struct pipe_context *pipe;
+   struct pipe_resource *tex;
+   struct pipe_surface *surf;
+   struct pipe_resource *vbuf;
+   void *blend, *dsa, *rast, *velems, *vs, *fs;
+};
+
+enum frame_op
+{
+   FRAME_DRAW,
+   FRAME_TRANSFER,
+};
+
+struct frame
+{
+   enum frame_op op;
+   int x0, y0, x1, y1;        /**< quad, in pixels */
+   struct pipe_box expected;  /**< empty for no damage */
+};
+
+static const struct frame frames[] = {
+   { FRAME_DRAW,     10,  10,  30,  30, { 0, 0, 0, FB_SIZE, FB_SIZE, 1 } },
+   { FRAME_DRAW,     10,  10,  30,  30, { 0 } },
+   { FRAME_DRAW,    100, 140, 120, 150, { 0, 0, 0, 2 * TILE_SIZE, 3 * TILE_SIZE, 1 } },
+   { FRAME_DRAW,    100, 140, 120, 150, { 0 } },
+   { FRAME_TRANSFER,  0,   0,   0,   0, { 0, 0, 0, FB_SIZE, FB_SIZE, 1 } },
+   { FRAME_DRAW,    100, 140, 120, 150, { 0, 0, 0, FB_SIZE, FB_SIZE, 1 } },
+   { FRAME_DRAW,    100, 140, 120, 150, { 0 } },
+};
+
+
+static const char fs_text[] =
+   "FRAG\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL CONST[0][0]\n"
+   "  0: MOV OUT[0], CONST[0][0]\n"
+   "  1: END\n";
+
+
+static boolean
+init_context(struct pipe_screen *screen, struct damage_context *dc,
+             const char *name, unsigned flags)
+{
+   struct pipe_context *pipe;
+   struct pipe_resource templ;
+   struct pipe_surface surf_templ;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem;
+   struct pipe_vertex_buffer vb;
+   struct pipe_constant_buffer cb;
+   struct pipe_shader_state fs;
+   struct tgsi_token tokens[64];
+   static const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+   static const enum tgsi_semantic semantic_names[] = {
+      TGSI_SEMANTIC_POSITION
+   };
+   static const uint semantic_indexes[] = { 0 };
+
+   memset(dc, 0, sizeof *dc);
+   dc->name = name;
+   dc->pipe = pipe = screen->context_create(screen, NULL, flags);
+   if (!pipe)
+      return FALSE;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = FB_SIZE;
+   templ.height0 = FB_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   dc->tex = screen->resource_create(screen, &templ);
+
+   dc->vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                                 PIPE_USAGE_STREAM, 6 * 4 * sizeof(float));
+   if (!dc->tex || !dc->vbuf)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   dc->surf = pipe->create_surface(pipe, dc->tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = FB_SIZE;
+   fb.height = FB_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = dc->surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   dc->blend = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, dc->blend);
+
+   memset(&dsa, 0, sizeof dsa);
+   dc->dsa = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dc->dsa);
+
+   memset(&rast, 0, sizeof rast);
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   dc->rast = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, dc->rast);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = FB_SIZE / 2;
+   viewport.scale[1] = FB_SIZE / 2;
+   viewport.scale[2] = 1.0f;
+   viewport.translate[0] = FB_SIZE / 2;
+   viewport.translate[1] = FB_SIZE / 2;
+   pipe->set_viewport_states(pipe, 0, 1, &viewport);
+
+   memset(&velem, 0, sizeof velem);
+   velem.src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   dc->velems = pipe->create_vertex_elements_state(pipe, 1, &velem);
+   pipe->bind_vertex_elements_state(pipe, dc->velems);
+
+   memset(&vb, 0, sizeof vb);
+   vb.stride = 4 * sizeof(float);
+   vb.buffer.resource = dc->vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, 0, false, &vb);
+
+   memset(&cb, 0, sizeof cb);
+   cb.user_buffer = white;
+   cb.buffer_size = sizeof white;
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_FRAGMENT, 0, false, &cb);
+
+   dc->vs = util_make_vertex_passthrough_shader(pipe, 1, semantic_names,
+                                                semantic_indexes, false);
+   pipe->bind_vs_state(pipe, dc->vs);
+
+   if (!tgsi_text_translate(fs_text, tokens, ARRAY_SIZE(tokens)))
+      return FALSE;
+   memset(&fs, 0, sizeof fs);
+   fs.type = PIPE_SHADER_IR_TGSI;
+   fs.tokens = tokens;
+   dc->fs = pipe->create_fs_state(pipe, &fs);
+   pipe->bind_fs_state(pipe, dc->fs);
+
+   return dc->surf && dc->vs && dc->fs;
+}
+
+
+static void
+destroy_context(struct damage_context *dc)
+{
+   struct pipe_context *pipe = dc->pipe;
+
+   if (!pipe)
+      return;
+
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   if (dc->fs)
+      pipe->delete_fs_state(pipe, dc->fs);
+   if (dc->vs)
+      pipe->delete_vs_state(pipe, dc->vs);
+   if (dc->velems)
+      pipe->delete_vertex_elements_state(pipe, dc->velems);
+   if (dc->rast)
+      pipe->delete_rasterizer_state(pipe, dc->rast);
+   if (dc->dsa)
+      pipe->delete_depth_stencil_alpha_state(pipe, dc->dsa);
+   if (dc->blend)
+      pipe->delete_blend_state(pipe, dc->blend);
+   pipe_surface_reference(&dc->surf, NULL);
+   pipe_resource_reference(&dc->vbuf, NULL);
+   pipe_resource_reference(&dc->tex, NULL);
+   pipe->destroy(pipe);
+}
+
+
+static void
+render_frame(struct damage_context *dc, const struct frame *frame)
+{
+   struct pipe_context *pipe = dc->pipe;
+   struct pipe_transfer *transfer;
+   union pipe_color_union clear_color;
+
+   if (frame->op == FRAME_TRANSFER) {
+      uint32_t *texel = pipe_texture_map(pipe, dc->tex, 0, 0, PIPE_MAP_WRITE,
+                                         0, 0, 1, 1, &transfer);
+      *texel ^= 0xffffffff;
+      pipe_texture_unmap(pipe, transfer);
+      return;
+   }
+
+   const float x0 = frame->x0 * 2.0f / FB_SIZE - 1.0f;
+   const float y0 = frame->y0 * 2.0f / FB_SIZE - 1.0f;
+   const float x1 = frame->x1 * 2.0f / FB_SIZE - 1.0f;
+   const float y1 = frame->y1 * 2.0f / FB_SIZE - 1.0f;
+   const float quad[6][4] = {
+      { x0, y0, 0.0f, 1.0f }, { x1, y0, 0.0f, 1.0f }, { x0, y1, 0.0f, 1.0f },
+      { x1, y0, 0.0f, 1.0f }, { x1, y1, 0.0f, 1.0f }, { x0, y1, 0.0f, 1.0f },
+   };
+
+   pipe_buffer_write(pipe, dc->vbuf, 0, sizeof quad, quad);
+
+   memset(&clear_color, 0, sizeof clear_color);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, NULL, &clear_color, 0.0, 0);
+   util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, 6);
+   pipe->flush(pipe, NULL, 0);
+}
+
+
+static boolean
+test_damage(unsigned verbose, FILE *fp)
+{
+   struct pipe_screen *screen;
+   struct damage_context contexts[2];
+   boolean success = TRUE;
+   unsigned i, j;
+
+   /* the threaded context would otherwise only be used with several CPUs */
+   setenv("GALLIUM_THREAD", "1", 1);
+
+   screen = llvmpipe_create_screen(null_sw_create());
+   if (!screen)
+      return FALSE;
+
+   if (!init_context(screen, &contexts[0], "direct", 0) ||
+       !init_context(screen, &contexts[1], "threaded",
+                     PIPE_CONTEXT_PREFER_THREADED)) {
+      success = FALSE;
+      goto out;
+   }
+
+   for (j = 0; j < 2; j++) {
+      struct damage_context *dc = &contexts[j];
+      struct pipe_box box;
+
+      /* the first query only starts tracking */
+      if (screen->resource_get_damage(screen, dc->pipe, dc->tex, &box)) {
+         fprintf(stderr, "%s: damage known before tracking\n", dc->name);
+         success = FALSE;
+      }
+
+      for (i = 0; i < ARRAY_SIZE(frames); i++) {
+         const struct pipe_box *expected = &frames[i].expected;
+         boolean known, pass;
+
+         render_frame(dc, &frames[i]);
+
+         memset(&box, 0, sizeof box);
+         known = screen->resource_get_damage(screen, dc->pipe, dc->tex, &box);
+         pass = known &&
+                box.width == expected->width &&
+                box.height == expected->height &&
+                (!box.width ||
+                 (box.x == expected->x && box.y == expected->y));
+         if (!pass)
+            success = FALSE;
+
+         if (verbose || !pass) {
+            printf("%-8s frame %u: damage %d,%d %dx%d, expected %d,%d %dx%d%s\n",
+                   dc->name, i, box.x, box.y, box.width, box.height,
+                   expected->x, expected->y, expected->width,
+                   expected->height, known ? "" : " (unknown)");
+         }
+
+         if (fp) {
+            fprintf(fp, "%s\t%s\t%u\t%d\t%d\t%d\t%d\n",
+                    pass ? "pass" : "fail", dc->name, i,
+                    box.x, box.y, box.width, box.height);
+         }
+      }
+   }
+
+out:
+   destroy_context(&contexts[1]);
+   destroy_context(&contexts[0]);
+   screen->destroy(screen);
+
+   return success;
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "context\t"
+           "frame\t"
+           "x\t"
+           "y\t"
+           "width\t"
+           "height\n");
+
+   fflush(fp);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_damage(verbose, fp);
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_damage(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_damage(verbose, fp);
+}
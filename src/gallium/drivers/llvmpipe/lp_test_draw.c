@@ -0,0 +1,1066 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Draw call throughput with and without u_threaded_context.
+ *
+ * Frames of many small draws are submitted the way GL applications stream
+ * them: every draw rewrites an orphaned vertex buffer, sets a user constant
+ * buffer and draws.  Every few draws also rewrite a texture buffer the
+ * fragment shader reads, which is then still in use by the binned scene.
+ * The same frames are rendered on a plain llvmpipe context and on a
+ * threaded one, where orphaning a buffer that is still queued replaces its
+ * storage, and the images must match.  The rate of submitting draws and of
+ * finishing frames is reported for both.
+ *
+ * The linear rasterizer is checked against the generic one by rendering
+ * the same textured rectangles with both, into RGBA8 and 565 color
+ * buffers, with the alpha test, with depth testing and with two textures.
+ * The images must match up to the rounding of the 8-bit linear shaders.
+ *
+ * A texture which may be rendered to starts out tiled, and must read back
+ * the same, in the linear layout, once it is bound as a color buffer.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/format/u_format.h"
+#include "util/os_time.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_public.h"
+#include "lp_test.h"
+#include "lp_texture.h"
+
+
+#define FB_SIZE 256
+#define TRIS_PER_DRAW 4
+#define DRAWS_PER_TBO_UPDATE 8
+
+static const unsigned draw_counts[] = { 100, 1000, 10000 };
+
+struct draw_context
+{
+   const char *name;
+   struct pipe_context *pipe;
+   struct pipe_resource *tex;
+   struct pipe_surface *surf;
+   struct pipe_resource *vbuf;
+   struct pipe_resource *tbo;
+   struct pipe_sampler_view *tbo_view;
+   void *blend, *dsa, *rast, *velems, *vs, *fs, *sampler;
+};
+
+
+static const char fs_text[] =
+   "FRAG\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], BUFFER, FLOAT\n"
+   "DCL CONST[0][0]\n"
+   "DCL TEMP[0]\n"
+   "IMM[0] INT32 {0, 0, 0, 0}\n"
+   "  0: TXF TEMP[0], IMM[0], SAMP[0], BUFFER\n"
+   "  1: ADD OUT[0], TEMP[0], CONST[0][0]\n"
+   "  2: END\n";
+
+
+static boolean
+init_context(struct pipe_screen *screen, struct draw_context *dc,
+             const char *name, unsigned flags)
+{
+   struct pipe_context *pipe;
+   struct pipe_resource templ;
+   struct pipe_surface surf_templ;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem;
+   struct pipe_vertex_buffer vb;
+   struct pipe_sampler_view view_templ;
+   struct pipe_sampler_state sampler;
+   struct pipe_shader_state fs;
+   struct tgsi_token tokens[64];
+   static const enum tgsi_semantic semantic_names[] = {
+      TGSI_SEMANTIC_POSITION
+   };
+   static const uint semantic_indexes[] = { 0 };
+
+   memset(dc, 0, sizeof *dc);
+   dc->name = name;
+   dc->pipe = pipe = screen->context_create(screen, NULL, flags);
+   if (!pipe)
+      return FALSE;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = FB_SIZE;
+   templ.height0 = FB_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   dc->tex = screen->resource_create(screen, &templ);
+
+   dc->vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                                 PIPE_USAGE_STREAM,
+                                 TRIS_PER_DRAW * 3 * 4 * sizeof(float));
+   dc->tbo = pipe_buffer_create(screen, PIPE_BIND_SAMPLER_VIEW,
+                                PIPE_USAGE_STREAM, 4 * sizeof(float));
+   if (!dc->tex || !dc->vbuf || !dc->tbo)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   dc->surf = pipe->create_surface(pipe, dc->tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = FB_SIZE;
+   fb.height = FB_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = dc->surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   dc->blend = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, dc->blend);
+
+   memset(&dsa, 0, sizeof dsa);
+   dc->dsa = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dc->dsa);
+
+   memset(&rast, 0, sizeof rast);
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   dc->rast = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, dc->rast);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = FB_SIZE / 2;
+   viewport.scale[1] = FB_SIZE / 2;
+   viewport.scale[2] = 1.0f;
+   viewport.translate[0] = FB_SIZE / 2;
+   viewport.translate[1] = FB_SIZE / 2;
+   pipe->set_viewport_states(pipe, 0, 1, &viewport);
+
+   memset(&velem, 0, sizeof velem);
+   velem.src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   dc->velems = pipe->create_vertex_elements_state(pipe, 1, &velem);
+   pipe->bind_vertex_elements_state(pipe, dc->velems);
+
+   memset(&vb, 0, sizeof vb);
+   vb.stride = 4 * sizeof(float);
+   vb.buffer.resource = dc->vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, 0, false, &vb);
+
+   memset(&view_templ, 0, sizeof view_templ);
+   view_templ.target = PIPE_BUFFER;
+   view_templ.format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   view_templ.u.buf.size = dc->tbo->width0;
+   view_templ.swizzle_r = PIPE_SWIZZLE_X;
+   view_templ.swizzle_g = PIPE_SWIZZLE_Y;
+   view_templ.swizzle_b = PIPE_SWIZZLE_Z;
+   view_templ.swizzle_a = PIPE_SWIZZLE_W;
+   dc->tbo_view = pipe->create_sampler_view(pipe, dc->tbo, &view_templ);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0, false,
+                           &dc->tbo_view);
+
+   memset(&sampler, 0, sizeof sampler);
+   dc->sampler = pipe->create_sampler_state(pipe, &sampler);
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &dc->sampler);
+
+   dc->vs = util_make_vertex_passthrough_shader(pipe, 1, semantic_names,
+                                                semantic_indexes, false);
+   pipe->bind_vs_state(pipe, dc->vs);
+
+   if (!tgsi_text_translate(fs_text, tokens, ARRAY_SIZE(tokens)))
+      return FALSE;
+   memset(&fs, 0, sizeof fs);
+   fs.type = PIPE_SHADER_IR_TGSI;
+   fs.tokens = tokens;
+   dc->fs = pipe->create_fs_state(pipe, &fs);
+   pipe->bind_fs_state(pipe, dc->fs);
+
+   return dc->surf && dc->tbo_view && dc->vs && dc->fs;
+}
+
+
+static void
+destroy_context(struct draw_context *dc)
+{
+   struct pipe_context *pipe = dc->pipe;
+
+   if (!pipe)
+      return;
+
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 0, 1, false, NULL);
+   if (dc->sampler)
+      pipe->delete_sampler_state(pipe, dc->sampler);
+   if (dc->fs)
+      pipe->delete_fs_state(pipe, dc->fs);
+   if (dc->vs)
+      pipe->delete_vs_state(pipe, dc->vs);
+   if (dc->velems)
+      pipe->delete_vertex_elements_state(pipe, dc->velems);
+   if (dc->rast)
+      pipe->delete_rasterizer_state(pipe, dc->rast);
+   if (dc->dsa)
+      pipe->delete_depth_stencil_alpha_state(pipe, dc->dsa);
+   if (dc->blend)
+      pipe->delete_blend_state(pipe, dc->blend);
+   pipe_surface_reference(&dc->surf, NULL);
+   pipe_sampler_view_reference(&dc->tbo_view, NULL);
+   pipe_resource_reference(&dc->tbo, NULL);
+   pipe_resource_reference(&dc->vbuf, NULL);
+   pipe_resource_reference(&dc->tex, NULL);
+   pipe->destroy(pipe);
+}
+
+
+/**
+ * Render a frame of num_draws draws, returning the seconds spent
+ * submitting them and, in *frame_time, finishing the frame.
+ */
+static double
+render_frame(struct draw_context *dc, unsigned num_draws, unsigned seed,
+             double *frame_time)
+{
+   struct pipe_context *pipe = dc->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_fence_handle *fence = NULL;
+   union pipe_color_union clear_color;
+   int64_t start, submitted;
+   unsigned i, j;
+
+   srand(seed);
+   memset(&clear_color, 0, sizeof clear_color);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, NULL, &clear_color, 0.0, 0);
+
+   start = os_time_get_nano();
+
+   for (i = 0; i < num_draws; i++) {
+      struct pipe_transfer *transfer;
+      struct pipe_constant_buffer cb;
+      float color[4];
+      float *v;
+
+      v = pipe_buffer_map(pipe, dc->vbuf,
+                          PIPE_MAP_WRITE | PIPE_MAP_DISCARD_WHOLE_RESOURCE,
+                          &transfer);
+      for (j = 0; j < TRIS_PER_DRAW; j++) {
+         float x = rand() * 2.0f / RAND_MAX - 1.0f;
+         float y = rand() * 2.0f / RAND_MAX - 1.0f;
+         float size = 0.05f;
+
+         v[0] = x;        v[1] = y;        v[2] = 0.0f; v[3] = 1.0f;
+         v[4] = x + size; v[5] = y;        v[6] = 0.0f; v[7] = 1.0f;
+         v[8] = x;        v[9] = y + size; v[10] = 0.0f; v[11] = 1.0f;
+         v += 12;
+      }
+      pipe_buffer_unmap(pipe, transfer);
+
+      if (i % DRAWS_PER_TBO_UPDATE == 0) {
+         v = pipe_buffer_map(pipe, dc->tbo,
+                             PIPE_MAP_WRITE |
+                             PIPE_MAP_DISCARD_WHOLE_RESOURCE,
+                             &transfer);
+         for (j = 0; j < 4; j++)
+            v[j] = (rand() & 0x7f) / 255.0f;
+         pipe_buffer_unmap(pipe, transfer);
+      }
+
+      for (j = 0; j < 4; j++)
+         color[j] = (rand() & 0x7f) / 255.0f;
+      memset(&cb, 0, sizeof cb);
+      cb.user_buffer = color;
+      cb.buffer_size = sizeof color;
+      pipe->set_constant_buffer(pipe, PIPE_SHADER_FRAGMENT, 0, false, &cb);
+
+      util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, TRIS_PER_DRAW * 3);
+   }
+
+   submitted = os_time_get_nano();
+
+   pipe->flush(pipe, &fence, 0);
+   screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   screen->fence_reference(screen, &fence, NULL);
+
+   *frame_time = (os_time_get_nano() - start) / 1e9;
+   return (submitted - start) / 1e9;
+}
+
+
+static uint8_t *
+read_frame(struct draw_context *dc)
+{
+   struct pipe_transfer *transfer;
+   uint8_t *image = MALLOC(FB_SIZE * FB_SIZE * 4);
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_texture_map(dc->pipe, dc->tex, 0, 0, PIPE_MAP_READ,
+                          0, 0, FB_SIZE, FB_SIZE, &transfer);
+   for (y = 0; y < FB_SIZE; y++)
+      memcpy(image + y * FB_SIZE * 4, map + y * transfer->stride,
+             FB_SIZE * 4);
+   pipe_texture_unmap(dc->pipe, transfer);
+
+   return image;
+}
+
+
+static boolean
+test_draws(unsigned verbose, FILE *fp, const unsigned *counts,
+           unsigned num_counts, unsigned long n)
+{
+   struct pipe_screen *screen;
+   struct draw_context contexts[2];
+   unsigned num_frames = MAX2(1, MIN2(n / 100, 10));
+   boolean success = TRUE;
+   unsigned i, j, k;
+
+   /* the threaded context is opt-in, and only used with several CPUs */
+   setenv("LP_THREADED", "1", 1);
+   setenv("GALLIUM_THREAD", "1", 1);
+
+   screen = llvmpipe_create_screen(null_sw_create());
+   if (!screen)
+      return FALSE;
+
+   if (!init_context(screen, &contexts[0], "direct", 0) ||
+       !init_context(screen, &contexts[1], "threaded",
+                     PIPE_CONTEXT_PREFER_THREADED)) {
+      success = FALSE;
+      goto out;
+   }
+
+   for (i = 0; i < num_counts; i++) {
+      uint8_t *images[2];
+      double submit_rate[2], frame_rate[2];
+
+      for (j = 0; j < 2; j++) {
+         double submit_time = 0.0, frame_time = 0.0;
+
+         for (k = 0; k < num_frames; k++) {
+            double t;
+            submit_time += render_frame(&contexts[j], counts[i], k, &t);
+            frame_time += t;
+         }
+
+         submit_rate[j] = counts[i] * num_frames / submit_time;
+         frame_rate[j] = counts[i] * num_frames / frame_time;
+         images[j] = read_frame(&contexts[j]);
+      }
+
+      if (memcmp(images[0], images[1], FB_SIZE * FB_SIZE * 4) != 0) {
+         fprintf(stderr, "threaded context image differs with %u draws\n",
+                 counts[i]);
+         success = FALSE;
+      }
+
+      for (j = 0; j < 2; j++) {
+         if (verbose || !success) {
+            printf("%-8s %6u draws/frame: submit %9.0f draws/s, "
+                   "complete %9.0f draws/s\n",
+                   contexts[j].name, counts[i], submit_rate[j],
+                   frame_rate[j]);
+         }
+
+         if (fp) {
+            fprintf(fp, "%s\t%s\t%u\t%.0f\t%.0f\n",
+                    success ? "pass" : "fail", contexts[j].name, counts[i],
+                    submit_rate[j], frame_rate[j]);
+         }
+      }
+
+      FREE(images[0]);
+      FREE(images[1]);
+   }
+
+out:
+   destroy_context(&contexts[1]);
+   destroy_context(&contexts[0]);
+   screen->destroy(screen);
+
+   return success;
+}
+
+
+/*
+ * Linear rasterizer
+ */
+
+#define LINEAR_TEX_SIZE 64
+#define LINEAR_RECTS 200
+#define LINEAR_TOLERANCE 2
+
+struct linear_case
+{
+   const char *name;
+   enum pipe_format cbuf_format;
+   enum pipe_format zsbuf_format;
+   boolean alpha_test;
+   unsigned num_textures;
+};
+
+static const struct linear_case linear_cases[] = {
+   { "rgba8", PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_NONE, FALSE, 1 },
+   { "565", PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_NONE, FALSE, 1 },
+   { "565_alpha", PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_NONE, TRUE, 1 },
+   { "depth", PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_Z24X8_UNORM, FALSE, 1 },
+   { "two_tex", PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_NONE, FALSE, 2 },
+};
+
+static const char linear_fs_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[1], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL TEMP[0]\n"
+   "  0: TEX TEMP[0], IN[1], SAMP[0], 2D\n"
+   "  1: MUL OUT[0], TEMP[0], IN[0]\n"
+   "  2: END\n";
+
+static const char linear_fs2_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[1], PERSPECTIVE\n"
+   "DCL IN[2], GENERIC[2], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SAMP[1]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL SVIEW[1], 2D, FLOAT\n"
+   "DCL TEMP[0..1]\n"
+   "  0: TEX TEMP[0], IN[1], SAMP[0], 2D\n"
+   "  1: TEX TEMP[1], IN[2], SAMP[1], 2D\n"
+   "  2: MUL TEMP[0], TEMP[0], TEMP[1]\n"
+   "  3: MUL OUT[0], TEMP[0], IN[0]\n"
+   "  4: END\n";
+
+
+/**
+ * Write the vertices of a random pixel aligned rectangle, as two
+ * triangles of position, color and two texture coordinates.  Setup only
+ * turns them back into a rectangle when the attributes are affine.  The texture
+ * coordinates hit texel centers, so nearest filtering picks the same texels
+ * whatever the precision of the interpolation.
+ */
+static void
+random_rect(float *v, boolean depth)
+{
+   unsigned w = 1 + rand() % (LINEAR_TEX_SIZE - 1);
+   unsigned h = 1 + rand() % (LINEAR_TEX_SIZE - 1);
+   unsigned x = rand() % (FB_SIZE - w);
+   unsigned y = rand() % (FB_SIZE - h);
+   unsigned s = rand() % (LINEAR_TEX_SIZE - w);
+   unsigned t = rand() % (LINEAR_TEX_SIZE - h);
+   float z = depth ? (rand() & 0xff) / 256.0f : 0.0f;
+   static const unsigned corners[6] = { 0, 1, 2, 2, 1, 3 };
+   unsigned color[3][4];
+   unsigned i, j;
+
+   for (j = 0; j < 3; j++) {
+      color[0][j] = rand() & 0x7f;
+      color[1][j] = rand() & 0x3f;
+      color[2][j] = rand() & 0x3f;
+   }
+   /* the textures alone decide the alpha test */
+   color[0][3] = 0xff;
+   color[1][3] = 0;
+   color[2][3] = 0;
+
+   for (i = 0; i < 6; i++) {
+      unsigned cx = corners[i] & 1, cy = corners[i] >> 1;
+
+      v[0] = (x + cx * w) * 2.0f / FB_SIZE - 1.0f;
+      v[1] = (y + cy * h) * 2.0f / FB_SIZE - 1.0f;
+      v[2] = z;
+      v[3] = 1.0f;
+      for (j = 0; j < 4; j++)
+         v[4 + j] = (color[0][j] + cx * color[1][j] + cy * color[2][j]) /
+                    256.0f;
+      v[8] = (float)(s + cx * w) / LINEAR_TEX_SIZE;
+      v[9] = (float)(t + cy * h) / LINEAR_TEX_SIZE;
+      v[10] = 0.0f;
+      v[11] = 1.0f;
+      /* the second texture is addressed upside down */
+      v[12] = v[8];
+      v[13] = 1.0f - v[9];
+      v[14] = 0.0f;
+      v[15] = 1.0f;
+      v += 16;
+   }
+}
+
+
+/**
+ * Maximum difference between two pixels, in units of the smallest
+ * channel step of the format.
+ */
+static unsigned
+pixel_diff(enum pipe_format format, const uint8_t *a, const uint8_t *b)
+{
+   unsigned diff = 0;
+
+   if (format == PIPE_FORMAT_B5G6R5_UNORM) {
+      uint16_t pa = *(const uint16_t *)a, pb = *(const uint16_t *)b;
+      static const unsigned shifts[3] = { 0, 5, 11 };
+      static const unsigned masks[3] = { 0x1f, 0x3f, 0x1f };
+      unsigned c;
+
+      for (c = 0; c < 3; c++) {
+         int ca = (pa >> shifts[c]) & masks[c];
+         int cb = (pb >> shifts[c]) & masks[c];
+         diff = MAX2(diff, (unsigned)abs(ca - cb));
+      }
+   }
+   else {
+      unsigned c;
+
+      for (c = 0; c < 4; c++)
+         diff = MAX2(diff, (unsigned)abs(a[c] - b[c]));
+   }
+
+   return diff;
+}
+
+
+/**
+ * Render random rectangles with the linear rasterizer and with the
+ * generic one, and compare the images.
+ */
+static boolean
+test_linear_case(unsigned verbose, struct pipe_screen *screen,
+                 const struct linear_case *lc)
+{
+   struct pipe_context *pipe;
+   struct pipe_resource templ;
+   struct pipe_resource *cbuf, *zsbuf = NULL, *vbuf;
+   struct pipe_resource *textures[2];
+   struct pipe_sampler_view *views[2];
+   struct pipe_surface surf_templ;
+   struct pipe_surface *csurf, *zsurf = NULL;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velems[4];
+   struct pipe_vertex_buffer vb;
+   struct pipe_sampler_view view_templ;
+   struct pipe_sampler_state sampler;
+   struct pipe_shader_state fs;
+   struct tgsi_token tokens[128];
+   void *blend_cso, *dsa_cso, *rast_cso, *velems_cso, *vs, *fs_cso;
+   void *samplers[2];
+   static const enum tgsi_semantic semantic_names[] = {
+      TGSI_SEMANTIC_POSITION,
+      TGSI_SEMANTIC_GENERIC,
+      TGSI_SEMANTIC_GENERIC,
+      TGSI_SEMANTIC_GENERIC
+   };
+   static const uint semantic_indexes[] = { 0, 0, 1, 2 };
+   const unsigned cpp = util_format_get_blocksize(lc->cbuf_format);
+   uint8_t *images[2];
+   unsigned max_diff = 0, num_diffs = 0;
+   int saved_perf = LP_PERF;
+   boolean success = TRUE;
+   unsigned i, j, x, y;
+
+   if (!tgsi_text_translate(lc->num_textures == 2 ? linear_fs2_text :
+                            linear_fs_text, tokens, ARRAY_SIZE(tokens)))
+      return FALSE;
+
+   pipe = screen->context_create(screen, NULL, 0);
+   if (!pipe)
+      return FALSE;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = lc->cbuf_format;
+   templ.width0 = FB_SIZE;
+   templ.height0 = FB_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   cbuf = screen->resource_create(screen, &templ);
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   csurf = pipe->create_surface(pipe, cbuf, &surf_templ);
+
+   if (lc->zsbuf_format != PIPE_FORMAT_NONE) {
+      templ.format = lc->zsbuf_format;
+      templ.bind = PIPE_BIND_DEPTH_STENCIL;
+      zsbuf = screen->resource_create(screen, &templ);
+      surf_templ.format = templ.format;
+      zsurf = pipe->create_surface(pipe, zsbuf, &surf_templ);
+   }
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = FB_SIZE;
+   fb.height = FB_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = csurf;
+   fb.zsbuf = zsurf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   /* Random textures, with alpha well clear of the alpha test reference */
+   templ.width0 = LINEAR_TEX_SIZE;
+   templ.height0 = LINEAR_TEX_SIZE;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+   srand(0);
+   for (i = 0; i < lc->num_textures; i++) {
+      uint32_t texels[LINEAR_TEX_SIZE * LINEAR_TEX_SIZE];
+      struct pipe_box box;
+
+      for (j = 0; j < ARRAY_SIZE(texels); j++)
+         texels[j] = (((uint32_t)rand() << 16 ^ (uint32_t)rand()) &
+                      0xffffff) | (rand() & 1 ? 0xff000000 : 0);
+
+      textures[i] = screen->resource_create(screen, &templ);
+      u_box_2d(0, 0, LINEAR_TEX_SIZE, LINEAR_TEX_SIZE, &box);
+      pipe->texture_subdata(pipe, textures[i], 0, PIPE_MAP_WRITE, &box,
+                            texels, LINEAR_TEX_SIZE * 4, 0);
+
+      memset(&view_templ, 0, sizeof view_templ);
+      view_templ.target = PIPE_TEXTURE_2D;
+      view_templ.format = templ.format;
+      view_templ.swizzle_r = PIPE_SWIZZLE_X;
+      view_templ.swizzle_g = PIPE_SWIZZLE_Y;
+      view_templ.swizzle_b = PIPE_SWIZZLE_Z;
+      view_templ.swizzle_a = PIPE_SWIZZLE_W;
+      views[i] = pipe->create_sampler_view(pipe, textures[i], &view_templ);
+
+      memset(&sampler, 0, sizeof sampler);
+      sampler.wrap_s = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+      sampler.wrap_t = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+      sampler.wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+      sampler.min_img_filter = PIPE_TEX_FILTER_NEAREST;
+      sampler.mag_img_filter = PIPE_TEX_FILTER_NEAREST;
+      sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+      sampler.normalized_coords = 1;
+      samplers[i] = pipe->create_sampler_state(pipe, &sampler);
+   }
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, lc->num_textures,
+                           0, false, views);
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0,
+                             lc->num_textures, samplers);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   blend_cso = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, blend_cso);
+
+   memset(&dsa, 0, sizeof dsa);
+   if (zsbuf) {
+      dsa.depth_enabled = 1;
+      dsa.depth_writemask = 1;
+      dsa.depth_func = PIPE_FUNC_LESS;
+   }
+   if (lc->alpha_test) {
+      dsa.alpha_enabled = 1;
+      dsa.alpha_func = PIPE_FUNC_GREATER;
+      dsa.alpha_ref_value = 0.5f;
+   }
+   dsa_cso = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dsa_cso);
+
+   memset(&rast, 0, sizeof rast);
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   rast_cso = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, rast_cso);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = FB_SIZE / 2;
+   viewport.scale[1] = FB_SIZE / 2;
+   viewport.scale[2] = 1.0f;
+   viewport.translate[0] = FB_SIZE / 2;
+   viewport.translate[1] = FB_SIZE / 2;
+   pipe->set_viewport_states(pipe, 0, 1, &viewport);
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < 4; i++) {
+      velems[i].src_offset = i * 4 * sizeof(float);
+      velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+   velems_cso = pipe->create_vertex_elements_state(pipe, 2 + lc->num_textures,
+                                                   velems);
+   pipe->bind_vertex_elements_state(pipe, velems_cso);
+
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_STREAM,
+                             LINEAR_RECTS * 6 * 16 * sizeof(float));
+   memset(&vb, 0, sizeof vb);
+   vb.stride = 16 * sizeof(float);
+   vb.buffer.resource = vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, 0, false, &vb);
+
+   vs = util_make_vertex_passthrough_shader(pipe, 2 + lc->num_textures,
+                                            semantic_names, semantic_indexes,
+                                            false);
+   pipe->bind_vs_state(pipe, vs);
+
+   memset(&fs, 0, sizeof fs);
+   fs.type = PIPE_SHADER_IR_TGSI;
+   fs.tokens = tokens;
+   fs_cso = pipe->create_fs_state(pipe, &fs);
+   pipe->bind_fs_state(pipe, fs_cso);
+
+   /* Same rectangles, first on the generic path then on the linear one.
+    * Scenes take the linear mode validated by earlier draws, so the first
+    * frame of a context never uses the linear rasterizer.
+    */
+   for (i = 0; i < 2; i++) {
+      struct pipe_transfer *transfer;
+      union pipe_color_union clear_color;
+      const uint8_t *map;
+      float *v;
+#ifdef DEBUG
+      unsigned linear_rects = LP_COUNT_GET(nr_linear_rects[LP_LINEAR_OK]);
+#endif
+
+      if (i == 0)
+         LP_PERF |= PERF_NO_RAST_LINEAR;
+      else
+         LP_PERF &= ~PERF_NO_RAST_LINEAR;
+
+      srand(1);
+      v = pipe_buffer_map(pipe, vbuf, PIPE_MAP_WRITE, &transfer);
+      for (j = 0; j < LINEAR_RECTS; j++)
+         random_rect(v + j * 6 * 16, zsbuf != NULL);
+      pipe_buffer_unmap(pipe, transfer);
+
+      clear_color.f[0] = 0.2f;
+      clear_color.f[1] = 0.6f;
+      clear_color.f[2] = 0.9f;
+      clear_color.f[3] = 1.0f;
+      pipe->clear(pipe, PIPE_CLEAR_COLOR | (zsbuf ? PIPE_CLEAR_DEPTH : 0),
+                  NULL, &clear_color, 1.0, 0);
+      util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, LINEAR_RECTS * 6);
+
+      images[i] = MALLOC(FB_SIZE * FB_SIZE * cpp);
+      map = pipe_texture_map(pipe, cbuf, 0, 0, PIPE_MAP_READ,
+                             0, 0, FB_SIZE, FB_SIZE, &transfer);
+      for (y = 0; y < FB_SIZE; y++)
+         memcpy(images[i] + y * FB_SIZE * cpp, map + y * transfer->stride,
+                FB_SIZE * cpp);
+      pipe_texture_unmap(pipe, transfer);
+
+#ifdef DEBUG
+      /* A case the linear rasterizer no longer takes checks nothing */
+      if (i == 1 &&
+          LP_COUNT_GET(nr_linear_rects[LP_LINEAR_OK]) == linear_rects) {
+         fprintf(stderr, "linear %s: no rectangles on the linear path\n",
+                 lc->name);
+         success = FALSE;
+      }
+#endif
+   }
+
+   LP_PERF = saved_perf;
+
+   /* The linear shaders work in 8 bits, so allow for rounding */
+   for (y = 0; y < FB_SIZE; y++) {
+      for (x = 0; x < FB_SIZE; x++) {
+         unsigned offset = (y * FB_SIZE + x) * cpp;
+         unsigned diff = pixel_diff(lc->cbuf_format, images[0] + offset,
+                                    images[1] + offset);
+
+         if (diff > LINEAR_TOLERANCE) {
+            if (num_diffs++ < 4)
+               fprintf(stderr, "linear %s: pixel %u,%u differs by %u\n",
+                       lc->name, x, y, diff);
+            success = FALSE;
+         }
+         max_diff = MAX2(max_diff, diff);
+      }
+   }
+
+   if (verbose || !success)
+      printf("linear %-10s max difference %u, %u pixels over %u\n",
+             lc->name, max_diff, num_diffs, LINEAR_TOLERANCE);
+
+   FREE(images[0]);
+   FREE(images[1]);
+
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 0,
+                           lc->num_textures, false, NULL);
+   pipe->delete_fs_state(pipe, fs_cso);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_vertex_elements_state(pipe, velems_cso);
+   pipe->delete_rasterizer_state(pipe, rast_cso);
+   pipe->delete_depth_stencil_alpha_state(pipe, dsa_cso);
+   pipe->delete_blend_state(pipe, blend_cso);
+   for (i = 0; i < lc->num_textures; i++) {
+      pipe->delete_sampler_state(pipe, samplers[i]);
+      pipe_sampler_view_reference(&views[i], NULL);
+      pipe_resource_reference(&textures[i], NULL);
+   }
+   pipe_resource_reference(&vbuf, NULL);
+   pipe_surface_reference(&zsurf, NULL);
+   pipe_surface_reference(&csurf, NULL);
+   pipe_resource_reference(&zsbuf, NULL);
+   pipe_resource_reference(&cbuf, NULL);
+   pipe->destroy(pipe);
+
+   return success;
+}
+
+
+static boolean
+test_linear(unsigned verbose)
+{
+   struct pipe_screen *screen;
+   boolean success = TRUE;
+   unsigned i;
+
+   screen = llvmpipe_create_screen(null_sw_create());
+   if (!screen)
+      return FALSE;
+
+   for (i = 0; i < ARRAY_SIZE(linear_cases); i++)
+      success &= test_linear_case(verbose, screen, &linear_cases[i]);
+
+   screen->destroy(screen);
+
+   return success;
+}
+
+
+/*
+ * Untiling
+ */
+
+#define UNTILE_SIZE 64
+#define UNTILE_LEVELS 3
+
+static uint32_t
+untile_texel(unsigned level, unsigned x, unsigned y)
+{
+   return 0xff000000 | level << 16 | y << 8 | x;
+}
+
+
+/**
+ * Bind a tiled render target capable texture as a color buffer, and check
+ * that all its levels were converted to the linear layout.
+ */
+static boolean
+test_untile(unsigned verbose)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource templ;
+   struct pipe_resource *tex;
+   struct pipe_surface surf_templ;
+   struct pipe_surface *surf;
+   struct pipe_framebuffer_state fb;
+   boolean success = TRUE;
+   unsigned level, x, y;
+
+   screen = llvmpipe_create_screen(null_sw_create());
+   if (!screen)
+      return FALSE;
+   pipe = screen->context_create(screen, NULL, 0);
+   if (!pipe) {
+      screen->destroy(screen);
+      return FALSE;
+   }
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = UNTILE_SIZE;
+   templ.height0 = UNTILE_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.last_level = UNTILE_LEVELS - 1;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET;
+   tex = screen->resource_create(screen, &templ);
+
+   for (level = 0; level < UNTILE_LEVELS; level++) {
+      const unsigned size = u_minify(UNTILE_SIZE, level);
+      uint32_t texels[UNTILE_SIZE * UNTILE_SIZE];
+      struct pipe_box box;
+
+      for (y = 0; y < size; y++)
+         for (x = 0; x < size; x++)
+            texels[y * size + x] = untile_texel(level, x, y);
+
+      u_box_2d(0, 0, size, size, &box);
+      pipe->texture_subdata(pipe, tex, level, PIPE_MAP_WRITE, &box,
+                            texels, size * 4, 0);
+   }
+
+   if (!(LP_PERF & PERF_NO_TEX_TILED) && !llvmpipe_resource_is_tiled(tex)) {
+      fprintf(stderr, "untile: render target capable texture not tiled\n");
+      success = FALSE;
+   }
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   surf = pipe->create_surface(pipe, tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = UNTILE_SIZE;
+   fb.height = UNTILE_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   if (llvmpipe_resource_is_tiled(tex)) {
+      fprintf(stderr, "untile: color buffer still tiled\n");
+      success = FALSE;
+   }
+
+   /* direct maps are only handed out for the linear layout */
+   for (level = 0; success && level < UNTILE_LEVELS; level++) {
+      const unsigned size = u_minify(UNTILE_SIZE, level);
+      struct pipe_transfer *transfer;
+      const uint8_t *map;
+
+      map = pipe_texture_map(pipe, tex, level, 0,
+                             PIPE_MAP_READ | PIPE_MAP_DIRECTLY,
+                             0, 0, size, size, &transfer);
+      if (!map) {
+         fprintf(stderr, "untile: level %u not mapped\n", level);
+         success = FALSE;
+         break;
+      }
+
+      for (y = 0; y < size; y++) {
+         const uint32_t *row = (const uint32_t *)(map + y * transfer->stride);
+
+         for (x = 0; x < size; x++) {
+            if (row[x] != untile_texel(level, x, y)) {
+               fprintf(stderr, "untile: level %u texel %u,%u is %08x\n",
+                       level, x, y, row[x]);
+               success = FALSE;
+               break;
+            }
+         }
+         if (!success)
+            break;
+      }
+      pipe_texture_unmap(pipe, transfer);
+   }
+
+   if (verbose || !success)
+      printf("untile %s\n", success ? "ok" : "FAILED");
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&tex, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   return success;
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "context\t"
+           "draws\t"
+           "submit_rate\t"
+           "frame_rate\n");
+
+   fflush(fp);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = test_linear(verbose);
+
+   success &= test_untile(verbose);
+
+   return test_draws(verbose, fp, draw_counts, ARRAY_SIZE(draw_counts),
+                     1000) && success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   boolean success = test_linear(verbose);
+
+   success &= test_untile(verbose);
+
+   return test_draws(verbose, fp, draw_counts, ARRAY_SIZE(draw_counts), n) &&
+          success;
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   static const unsigned count = 100;
+   boolean success = test_linear(verbose);
+
+   success &= test_untile(verbose);
+
+   return test_draws(verbose, fp, &count, 1, 100) && success;
+}
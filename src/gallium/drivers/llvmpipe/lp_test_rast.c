@@ -0,0 +1,1152 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and benchmark for the binned triangle rasterization.
+ *
+ * Random triangles are rasterized with every set of triangle functions the
+ * CPU supports (SSE, AVX2, AVX-512), using stub fragment shaders which
+ * record the coverage masks.  The coverage is compared against a direct
+ * evaluation of the edge functions, and the rasterization rate is reported
+ * in triangles per second for several triangle sizes.
+ *
+ * Multisampled rasterization is checked the same way at every supported
+ * sample count.  The fill rate into multisample color buffers is measured
+ * with and without uniform sample blocks, checking that both give the same
+ * image, and so is the rate of resolving them.
+ *
+ * Hierarchical depth is checked by depth testing overlapping triangles
+ * with and without it, which must give the same depth buffer, and the
+ * fragments it saves from shading are reported.
+ */
+
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+
+#include "lp_rast_priv.h"
+#include "lp_state_fs.h"
+#include "lp_surface.h"
+#include "lp_texture.h"
+#include "lp_test.h"
+
+
+#define FB_SIZE (4 * TILE_SIZE)
+
+static const unsigned tri_sizes[] = { 2, 4, 8, 16, 32, 64, 128 };
+
+struct rast_variant
+{
+   const char *name;
+   lp_rast_cmd_func dispatch[LP_RAST_OP_MAX];
+};
+
+static const unsigned ms_sample_counts[] = { 4, 8, 16 };
+
+static uint8_t coverage[FB_SIZE][FB_SIZE];
+static uint16_t sample_coverage[FB_SIZE][FB_SIZE];
+static uint64_t num_fragments;
+static unsigned num_samples;
+
+/* What fill_mask() writes, and whether it adds to the color buffer */
+static uint32_t fill_value;
+static boolean fill_add;
+
+
+static void
+record_mask(const struct lp_jit_context *context,
+            uint32_t x, uint32_t y, uint32_t facing,
+            const void *a0, const void *dadx, const void *dady,
+            uint8_t **color, uint8_t *depth, const uint64_t *mask,
+            struct lp_jit_thread_data *thread_data,
+            unsigned *stride, unsigned depth_stride,
+            unsigned *color_sample_stride, unsigned depth_sample_stride)
+{
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      if (mask[0] & (1 << i))
+         coverage[y + i / 4][x + i % 4]++;
+   }
+
+   num_fragments += util_bitcount64(mask[0] & 0xffff);
+}
+
+
+/**
+ * Record the per sample coverage, counting samples covered twice in
+ * coverage[][].
+ */
+static void
+record_sample_mask(const struct lp_jit_context *context,
+                   uint32_t x, uint32_t y, uint32_t facing,
+                   const void *a0, const void *dadx, const void *dady,
+                   uint8_t **color, uint8_t *depth, const uint64_t *mask,
+                   struct lp_jit_thread_data *thread_data,
+                   unsigned *stride, unsigned depth_stride,
+                   unsigned *color_sample_stride, unsigned depth_sample_stride)
+{
+   unsigned s, i;
+
+   for (s = 0; s < num_samples; s++) {
+      unsigned bits = (mask[s / 4] >> (16 * (s % 4))) & 0xffff;
+
+      for (i = 0; i < 16; i++) {
+         if (bits & (1 << i)) {
+            if (sample_coverage[y + i / 4][x + i % 4] & (1 << s))
+               coverage[y + i / 4][x + i % 4]++;
+            sample_coverage[y + i / 4][x + i % 4] |= 1 << s;
+         }
+      }
+
+      num_fragments += util_bitcount(bits);
+   }
+}
+
+
+/**
+ * Depth test and write the covered pixels of a Z24X8 buffer, like a shader
+ * with a LESS depth test and no colour outputs.
+ */
+static void
+depth_mask(const struct lp_jit_context *context,
+           uint32_t x, uint32_t y, uint32_t facing,
+           const void *a0, const void *dadx, const void *dady,
+           uint8_t **color, uint8_t *depth, const uint64_t *mask,
+           struct lp_jit_thread_data *thread_data,
+           unsigned *stride, unsigned depth_stride,
+           unsigned *color_sample_stride, unsigned depth_sample_stride)
+{
+   const float (*pos_a0)[4] = a0;
+   const float z0 = pos_a0[0][2] + pos_a0[0][0];
+   const float dzdx = ((const float (*)[4])dadx)[0][2];
+   const float dzdy = ((const float (*)[4])dady)[0][2];
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      if (mask[0] & (1 << i)) {
+         uint32_t *value = (uint32_t *)(depth + (i / 4) * depth_stride) + i % 4;
+         float z = z0 + dzdx * (x + i % 4 + 0.5f) + dzdy * (y + i / 4 + 0.5f);
+         uint32_t zq = (uint32_t)(CLAMP(z, 0.0f, 1.0f) * 0xffffff + 0.5f);
+
+         if (zq < (*value & 0xffffff))
+            *value = zq;
+      }
+   }
+
+   num_fragments += util_bitcount64(mask[0] & 0xffff);
+}
+
+
+/**
+ * Write fill_value to the covered samples of a 32bpp color buffer, like a
+ * shader writing a constant color would.  Samples without coverage are
+ * skipped, as the generated blend code does.
+ */
+static void
+fill_mask(const struct lp_jit_context *context,
+          uint32_t x, uint32_t y, uint32_t facing,
+          const void *a0, const void *dadx, const void *dady,
+          uint8_t **color, uint8_t *depth, const uint64_t *mask,
+          struct lp_jit_thread_data *thread_data,
+          unsigned *stride, unsigned depth_stride,
+          unsigned *color_sample_stride, unsigned depth_sample_stride)
+{
+   unsigned s, i;
+
+   for (s = 0; s < num_samples; s++) {
+      unsigned bits = (mask[s / 4] >> (16 * (s % 4))) & 0xffff;
+      uint8_t *cbuf = color[0] + s * color_sample_stride[0];
+
+      if (!bits)
+         continue;
+
+      for (i = 0; i < 16; i++) {
+         if (bits & (1 << i)) {
+            uint32_t *pixel = (uint32_t *)(cbuf + (i / 4) * stride[0]) + i % 4;
+            *pixel = fill_add ? *pixel + fill_value : fill_value;
+         }
+      }
+
+      num_fragments += util_bitcount(bits);
+   }
+}
+
+
+static void
+count_mask(const struct lp_jit_context *context,
+           uint32_t x, uint32_t y, uint32_t facing,
+           const void *a0, const void *dadx, const void *dady,
+           uint8_t **color, uint8_t *depth, const uint64_t *mask,
+           struct lp_jit_thread_data *thread_data,
+           unsigned *stride, unsigned depth_stride,
+           unsigned *color_sample_stride, unsigned depth_sample_stride)
+{
+   num_fragments += util_bitcount64(mask[0] & 0xffff);
+}
+
+
+struct test_tri
+{
+   struct lp_rast_triangle *tri;
+   struct u_rect bbox;
+   boolean use_32bits;
+};
+
+
+/**
+ * Set up the edge planes the same way lp_setup_tri.c does, for a counter-
+ * clockwise triangle with the top-left fill convention.
+ */
+static void
+setup_planes(struct lp_rast_plane *plane,
+             const int32_t x[3], const int32_t y[3])
+{
+   unsigned i;
+
+   for (i = 0; i < 3; i++) {
+      unsigned j = (i + 1) % 3;
+
+      plane[i].dcdx = y[i] - y[j];
+      plane[i].dcdy = x[i] - x[j];
+      plane[i].c = IMUL64(plane[i].dcdx, x[i]) - IMUL64(plane[i].dcdy, y[i]);
+
+      if (plane[i].dcdx < 0 ||
+          (plane[i].dcdx == 0 && plane[i].dcdy > 0))
+         plane[i].c++;
+
+      plane[i].dcdx <<= FIXED_ORDER;
+      plane[i].dcdy <<= FIXED_ORDER;
+
+      plane[i].eo = 0;
+      if (plane[i].dcdx < 0) plane[i].eo -= plane[i].dcdx;
+      if (plane[i].dcdy > 0) plane[i].eo += plane[i].dcdy;
+   }
+}
+
+
+/**
+ * Make a random triangle whose bounding box is at most size pixels wide.
+ */
+static void
+random_triangle(struct test_tri *t, unsigned size)
+{
+   const unsigned stride = 4 * sizeof(float);   /* position only */
+   int32_t x[3], y[3];
+   int64_t area;
+   unsigned i;
+
+   do {
+      int32_t x0 = rand() % (FB_SIZE - size) << FIXED_ORDER;
+      int32_t y0 = rand() % (FB_SIZE - size) << FIXED_ORDER;
+
+      for (i = 0; i < 3; i++) {
+         x[i] = x0 + rand() % (size << FIXED_ORDER);
+         y[i] = y0 + rand() % (size << FIXED_ORDER);
+      }
+
+      area = IMUL64(x[0] - x[1], y[2] - y[0]) - IMUL64(x[2] - x[0], y[0] - y[1]);
+      if (area < 0) {
+         int32_t tmp;
+         tmp = x[1]; x[1] = x[2]; x[2] = tmp;
+         tmp = y[1]; y[1] = y[2]; y[2] = tmp;
+      }
+
+      t->bbox.x0 = MIN3(x[0], x[1], x[2]) >> FIXED_ORDER;
+      t->bbox.x1 = (MAX3(x[0], x[1], x[2]) - 1) >> FIXED_ORDER;
+      t->bbox.y0 = MIN3(y[0], y[1], y[2]) >> FIXED_ORDER;
+      t->bbox.y1 = (MAX3(y[0], y[1], y[2]) - 1) >> FIXED_ORDER;
+   } while (area == 0 || t->bbox.x1 < t->bbox.x0 || t->bbox.y1 < t->bbox.y0);
+
+   t->use_32bits = ((t->bbox.x1 - (t->bbox.x0 & ~3)) |
+                    (t->bbox.y1 - (t->bbox.y0 & ~3))) <= MAX_FIXED_LENGTH32;
+
+   t->tri = align_malloc(sizeof *t->tri + 3 * stride +
+                         3 * sizeof(struct lp_rast_plane), 16);
+   memset(t->tri, 0, sizeof *t->tri);
+   t->tri->inputs.stride = stride;
+
+   setup_planes(GET_PLANES(t->tri), x, y);
+}
+
+
+/**
+ * Position the task on tile (tx, ty), like lp_rast_tile_begin() does.
+ */
+static void
+set_tile(struct lp_rasterizer_task *task, unsigned tx, unsigned ty)
+{
+   const struct lp_scene_surface *cbuf = &task->scene->cbufs[0];
+   const struct lp_scene_surface *zsbuf = &task->scene->zsbuf;
+
+   task->x = tx * TILE_SIZE;
+   task->y = ty * TILE_SIZE;
+   task->color_tiles[0] = cbuf->map ? cbuf->map + cbuf->stride * task->y +
+                                      cbuf->format_bytes * task->x : NULL;
+   task->depth_tile = zsbuf->map ? zsbuf->map + zsbuf->stride * task->y +
+                                   zsbuf->format_bytes * task->x : NULL;
+}
+
+
+/**
+ * Pick the command lp_setup_bin_triangle() would bin the triangle with.
+ */
+static unsigned
+triangle_command(const struct test_tri *t, boolean ms,
+                 union lp_rast_cmd_arg *arg)
+{
+   const struct u_rect *bbox = &t->bbox;
+
+   if (bbox->x0 / TILE_SIZE == bbox->x1 / TILE_SIZE &&
+       bbox->y0 / TILE_SIZE == bbox->y1 / TILE_SIZE) {
+      unsigned px = bbox->x0 & (TILE_SIZE - 1) & ~3;
+      unsigned py = bbox->y0 & (TILE_SIZE - 1) & ~3;
+      unsigned max_sz = ((bbox->x1 - (bbox->x0 & ~3)) |
+                         (bbox->y1 - (bbox->y0 & ~3)));
+      unsigned sz = max_sz ? 1 << util_logbase2(max_sz) : 0;
+
+      if (sz < 4) {
+         *arg = lp_rast_arg_triangle_contained(t->tri, px, py);
+         if (ms)
+            return LP_RAST_OP_MS_TRIANGLE_3_4;
+         return t->use_32bits ? LP_RAST_OP_TRIANGLE_32_3_4 : LP_RAST_OP_TRIANGLE_3_4;
+      }
+
+      if (sz < 16) {
+         px = MIN2(px, TILE_SIZE - 16);
+         py = MIN2(py, TILE_SIZE - 16);
+         *arg = lp_rast_arg_triangle_contained(t->tri, px, py);
+         if (ms)
+            return LP_RAST_OP_MS_TRIANGLE_3_16;
+         return t->use_32bits ? LP_RAST_OP_TRIANGLE_32_3_16 : LP_RAST_OP_TRIANGLE_3_16;
+      }
+   }
+
+   *arg = lp_rast_arg_triangle(t->tri, 0x7);
+   if (ms)
+      return LP_RAST_OP_MS_TRIANGLE_3;
+   return t->use_32bits ? LP_RAST_OP_TRIANGLE_32_3 : LP_RAST_OP_TRIANGLE_3;
+}
+
+
+/**
+ * Bin the triangle like lp_setup_bin_triangle() does, and run the commands
+ * of each bin it touches.
+ */
+static void
+rasterize_triangle(struct lp_rasterizer_task *task,
+                   const struct rast_variant *variant,
+                   const struct test_tri *t, boolean ms)
+{
+   const struct u_rect *bbox = &t->bbox;
+   union lp_rast_cmd_arg arg;
+   unsigned cmd = triangle_command(t, ms, &arg);
+   int ix, iy;
+
+   for (iy = bbox->y0 / TILE_SIZE; iy <= bbox->y1 / TILE_SIZE; iy++) {
+      for (ix = bbox->x0 / TILE_SIZE; ix <= bbox->x1 / TILE_SIZE; ix++) {
+         set_tile(task, ix, iy);
+         variant->dispatch[cmd](task, arg);
+      }
+   }
+}
+
+
+/**
+ * Compare the recorded coverage against the edge functions.  Only the
+ * bounding box is checked, fragments outside of it show up in the total.
+ */
+static boolean
+check_triangle(unsigned verbose,
+               const struct rast_variant *variant,
+               const struct test_tri *t)
+{
+   const struct lp_rast_plane *plane = GET_PLANES(t->tri);
+   uint64_t expected_fragments = 0;
+   boolean success = TRUE;
+   int x, y;
+   unsigned i;
+
+   for (y = t->bbox.y0; y <= t->bbox.y1; y++) {
+      for (x = t->bbox.x0; x <= t->bbox.x1; x++) {
+         unsigned expected = 1;
+
+         for (i = 0; i < 3; i++) {
+            if (plane[i].c + IMUL64(plane[i].dcdy, y) -
+                IMUL64(plane[i].dcdx, x) <= 0)
+               expected = 0;
+         }
+
+         if (coverage[y][x] != expected) {
+            if (verbose || success)
+               fprintf(stderr, "%s: pixel (%d, %d) covered %u times, "
+                       "expected %u\n", variant->name, x, y,
+                       coverage[y][x], expected);
+            success = FALSE;
+         }
+
+         expected_fragments += expected;
+         coverage[y][x] = 0;
+      }
+   }
+
+   if (num_fragments != expected_fragments) {
+      fprintf(stderr, "%s: %" PRIu64 " fragments, expected %" PRIu64 "\n",
+              variant->name, num_fragments, expected_fragments);
+      success = FALSE;
+   }
+
+   return success;
+}
+
+
+static boolean
+test_size(unsigned verbose, FILE *fp,
+          struct lp_rasterizer_task *task,
+          struct lp_fragment_shader_variant *fs,
+          const struct rast_variant *variants, unsigned num_variants,
+          unsigned size, unsigned long n)
+{
+   struct test_tri *tris = CALLOC(n, sizeof *tris);
+   boolean success = TRUE;
+   unsigned long i;
+   unsigned v;
+
+   for (i = 0; i < n; i++)
+      random_triangle(&tris[i], size);
+
+   for (v = 0; v < num_variants; v++) {
+      int64_t best = INT64_MAX;
+      double rate;
+
+      fs->jit_function[RAST_WHOLE] = record_mask;
+      fs->jit_function[RAST_EDGE_TEST] = record_mask;
+
+      memset(coverage, 0, sizeof coverage);
+
+      for (i = 0; i < n && success; i++) {
+         num_fragments = 0;
+         rasterize_triangle(task, &variants[v], &tris[i], FALSE);
+         success = check_triangle(verbose, &variants[v], &tris[i]);
+      }
+
+      fs->jit_function[RAST_WHOLE] = count_mask;
+      fs->jit_function[RAST_EDGE_TEST] = count_mask;
+
+      /* Take the best of a few runs, to filter out scheduling noise. */
+      for (unsigned r = 0; r < 8; r++) {
+         int64_t start = os_time_get_nano();
+         for (i = 0; i < n; i++)
+            rasterize_triangle(task, &variants[v], &tris[i], FALSE);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+
+      rate = (double)n * 1e9 / MAX2(best, 1);
+
+      if (verbose)
+         printf("%-7s %3u px: %8.3f Mtris/s%s\n", variants[v].name, size,
+                rate * 1e-6, success ? "" : " (FAIL)");
+
+      if (fp) {
+         fprintf(fp, "%s\ttri\t%s\t1\t%u\t%.0f\n",
+                 success ? "pass" : "fail", variants[v].name, size, rate);
+         fflush(fp);
+      }
+   }
+
+   for (i = 0; i < n; i++)
+      align_free(tris[i].tri);
+   FREE(tris);
+
+   return success;
+}
+
+
+/**
+ * Compare the recorded per sample coverage against the edge functions
+ * evaluated at the sample positions, the same way as check_triangle().
+ */
+static boolean
+check_triangle_ms(unsigned verbose, const struct lp_scene *scene,
+                  const struct test_tri *t)
+{
+   const struct lp_rast_plane *plane = GET_PLANES(t->tri);
+   uint64_t expected_fragments = 0;
+   boolean success = TRUE;
+   int x, y;
+   unsigned s, i;
+
+   for (y = t->bbox.y0; y <= t->bbox.y1; y++) {
+      for (x = t->bbox.x0; x <= t->bbox.x1; x++) {
+         unsigned expected = 0;
+
+         for (s = 0; s < num_samples; s++) {
+            boolean inside = TRUE;
+
+            for (i = 0; i < 3; i++) {
+               int64_t c = plane[i].c + IMUL64(plane[i].dcdy, y) -
+                           IMUL64(plane[i].dcdx, x) +
+                           ((IMUL64(scene->fixed_sample_pos[s][1], plane[i].dcdy) -
+                             IMUL64(scene->fixed_sample_pos[s][0], plane[i].dcdx)) >> FIXED_ORDER);
+               if (c <= 0)
+                  inside = FALSE;
+            }
+
+            if (inside)
+               expected |= 1 << s;
+         }
+
+         if (sample_coverage[y][x] != expected || coverage[y][x]) {
+            if (verbose || success)
+               fprintf(stderr, "%ux: pixel (%d, %d) samples 0x%04x, "
+                       "expected 0x%04x\n", num_samples, x, y,
+                       sample_coverage[y][x], expected);
+            success = FALSE;
+         }
+
+         expected_fragments += util_bitcount(expected);
+         sample_coverage[y][x] = 0;
+         coverage[y][x] = 0;
+      }
+   }
+
+   if (num_fragments != expected_fragments) {
+      fprintf(stderr, "%ux: %" PRIu64 " samples, expected %" PRIu64 "\n",
+              num_samples, num_fragments, expected_fragments);
+      success = FALSE;
+   }
+
+   return success;
+}
+
+
+/**
+ * Rasterize the triangles into the multisample color buffer one tile after
+ * the other, like the rasterizer threads do.
+ */
+static void
+fill_triangles(struct lp_rasterizer_task *task,
+               const struct rast_variant *variant,
+               const struct test_tri *tris, unsigned long n,
+               boolean tracking)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned long i;
+   unsigned tx, ty;
+
+   for (ty = 0; ty < scene->tiles_y; ty++) {
+      for (tx = 0; tx < scene->tiles_x; tx++) {
+         set_tile(task, tx, ty);
+
+         task->ms_tracking = FALSE;
+         if (tracking) {
+            lp_rast_ms_tile_begin(task);
+            /* the buffer starts out cleared */
+            memset(task->ms_uniform[0], 0xff, sizeof task->ms_uniform[0]);
+         }
+
+         for (i = 0; i < n; i++) {
+            const struct u_rect *bbox = &tris[i].bbox;
+
+            if (bbox->x1 < (int)task->x || bbox->x0 >= (int)(task->x + TILE_SIZE) ||
+                bbox->y1 < (int)task->y || bbox->y0 >= (int)(task->y + TILE_SIZE))
+               continue;
+
+            fill_value = i + 1;
+            variant->dispatch[LP_RAST_OP_MS_TRIANGLE_3](task,
+               lp_rast_arg_triangle(tris[i].tri, 0x7));
+         }
+
+         if (tracking)
+            lp_rast_ms_tile_end(task);
+      }
+   }
+}
+
+
+/**
+ * Fill with and without uniform sample blocks, check that the images match,
+ * and measure the fill rate.
+ */
+static boolean
+test_fill(unsigned verbose, FILE *fp,
+          struct lp_rasterizer_task *task,
+          struct lp_fragment_shader_variant *fs,
+          const struct rast_variant *variant,
+          const struct test_tri *tris, unsigned long n, unsigned size)
+{
+   struct lp_scene_surface *cbuf = &task->scene->cbufs[0];
+   const size_t fb_bytes = (size_t)cbuf->sample_stride * num_samples;
+   uint8_t *expected = MALLOC(fb_bytes);
+   boolean success = TRUE;
+   double rate[2];
+   unsigned tracking;
+
+   fs->jit_function[RAST_WHOLE] = fill_mask;
+   fs->jit_function[RAST_EDGE_TEST] = fill_mask;
+   fs->ms_uniform = 1;
+
+   for (fill_add = FALSE; fill_add <= TRUE; fill_add++) {
+      fs->ms_reads_dst = fill_add;
+
+      memset(expected, 0, fb_bytes);
+      cbuf->map = expected;
+      fill_triangles(task, variant, tris, n, FALSE);
+
+      cbuf->map = MALLOC(fb_bytes);
+      memset(cbuf->map, 0, fb_bytes);
+      fill_triangles(task, variant, tris, n, TRUE);
+
+      if (memcmp(cbuf->map, expected, fb_bytes) != 0) {
+         fprintf(stderr, "%ux: %u px triangles %s differently with uniform "
+                 "sample blocks\n", num_samples, size,
+                 fill_add ? "blend" : "fill");
+         success = FALSE;
+      }
+      FREE(cbuf->map);
+   }
+   fill_add = FALSE;
+   fs->ms_reads_dst = 0;
+
+   cbuf->map = expected;
+   for (tracking = 0; tracking < 2; tracking++) {
+      int64_t best = INT64_MAX;
+
+      for (unsigned r = 0; r < 4; r++) {
+         int64_t start = os_time_get_nano();
+         fill_triangles(task, variant, tris, n, tracking);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+
+      rate[tracking] = (double)n * 1e9 / MAX2(best, 1);
+
+      if (fp) {
+         fprintf(fp, "%s\tfill\t%s\t%u\t%u\t%.0f\n",
+                 success ? "pass" : "fail",
+                 tracking ? "uniform" : "expanded",
+                 num_samples, size, rate[tracking]);
+         fflush(fp);
+      }
+   }
+   cbuf->map = NULL;
+
+   if (verbose)
+      printf("fill    %2ux %3u px: %8.3f Mtris/s expanded, %8.3f Mtris/s "
+             "uniform%s\n", num_samples, size, rate[0] * 1e-6,
+             rate[1] * 1e-6, success ? "" : " (FAIL)");
+
+   FREE(expected);
+   return success;
+}
+
+
+/**
+ * Resolve a multisample image, once with all blocks known to be uniform and
+ * once without, checking the results and measuring the rate.
+ */
+static boolean
+test_resolve(unsigned verbose, FILE *fp, enum pipe_format format)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const unsigned bpp = desc->block.bits / 8;
+   const unsigned stride = FB_SIZE * bpp;
+   const unsigned sample_stride = stride * FB_SIZE;
+   const unsigned tiles = FB_SIZE / TILE_SIZE;
+   uint8_t *src = MALLOC(sample_stride * num_samples);
+   uint8_t *dst = MALLOC(sample_stride);
+   uint64_t *uniform = MALLOC(tiles * tiles * LP_TILE_BLOCK_WORDS * sizeof(uint64_t));
+   boolean success = TRUE;
+   unsigned mode, i;
+
+   memset(uniform, 0xff, tiles * tiles * LP_TILE_BLOCK_WORDS * sizeof(uint64_t));
+
+   for (mode = 0; mode < 2; mode++) {
+      const uint64_t *bits = mode ? uniform : NULL;
+      int64_t best = INT64_MAX;
+      double rate;
+
+      if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT) {
+         float *values = (float *)src;
+         for (i = 0; i < sample_stride * num_samples / sizeof(float); i++)
+            values[i] = (float)(rand() % 1024) / 1024.0f;
+      }
+      else {
+         for (i = 0; i < sample_stride * num_samples; i++)
+            src[i] = rand();
+      }
+
+      llvmpipe_resolve_ms_rect(format, num_samples, dst, stride,
+                               src, stride, sample_stride,
+                               0, 0, FB_SIZE, FB_SIZE, bits, tiles);
+
+      if (mode) {
+         if (memcmp(dst, src, sample_stride) != 0) {
+            fprintf(stderr, "%s %ux: uniform resolve differs from sample 0\n",
+                    desc->short_name, num_samples);
+            success = FALSE;
+         }
+      }
+      else if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT) {
+         const float *values = (const float *)src;
+         const float *result = (const float *)dst;
+         for (i = 0; i < sample_stride / sizeof(float) && success; i++) {
+            float sum = 0.0f;
+            for (unsigned s = 0; s < num_samples; s++)
+               sum += values[s * sample_stride / sizeof(float) + i];
+            if (fabsf(result[i] - sum / num_samples) > 1e-6f) {
+               fprintf(stderr, "%s %ux: got %f, expected %f\n",
+                       desc->short_name, num_samples, result[i],
+                       sum / num_samples);
+               success = FALSE;
+            }
+         }
+      }
+      else {
+         for (i = 0; i < sample_stride && success; i++) {
+            unsigned sum = num_samples / 2;
+            for (unsigned s = 0; s < num_samples; s++)
+               sum += src[s * sample_stride + i];
+            if (dst[i] != sum / num_samples) {
+               fprintf(stderr, "%s %ux: got %u, expected %u\n",
+                       desc->short_name, num_samples, dst[i],
+                       sum / num_samples);
+               success = FALSE;
+            }
+         }
+      }
+
+      for (unsigned r = 0; r < 4; r++) {
+         int64_t start = os_time_get_nano();
+         llvmpipe_resolve_ms_rect(format, num_samples, dst, stride,
+                                  src, stride, sample_stride,
+                                  0, 0, FB_SIZE, FB_SIZE, bits, tiles);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+
+      rate = (double)FB_SIZE * FB_SIZE * 1e9 / MAX2(best, 1);
+
+      if (verbose)
+         printf("resolve %2ux %s %s: %8.3f Mpix/s%s\n", num_samples,
+                desc->short_name, mode ? "uniform" : "mixed", rate * 1e-6,
+                success ? "" : " (FAIL)");
+
+      if (fp) {
+         fprintf(fp, "%s\tresolve\t%s_%s\t%u\t%u\t%.0f\n",
+                 success ? "pass" : "fail", desc->short_name,
+                 mode ? "uniform" : "mixed", num_samples, FB_SIZE, rate);
+         fflush(fp);
+      }
+   }
+
+   FREE(uniform);
+   FREE(dst);
+   FREE(src);
+
+   return success;
+}
+
+
+/**
+ * Depth test the triangles tile by tile, with hierarchical depth on or off,
+ * and return the time taken.
+ */
+static int64_t
+depth_triangles(struct lp_rasterizer_task *task,
+                const struct rast_variant *variant,
+                const struct test_tri *tris, unsigned long n,
+                boolean hiz)
+{
+   const struct lp_scene *scene = task->scene;
+   int64_t start = os_time_get_nano();
+   unsigned long i;
+   unsigned tx, ty;
+
+   for (ty = 0; ty < scene->tiles_y; ty++) {
+      for (tx = 0; tx < scene->tiles_x; tx++) {
+         set_tile(task, tx, ty);
+         lp_rast_hiz_tile_begin(task);
+         if (!hiz)
+            task->hiz_tracking = FALSE;
+
+         /* The depth buffer was cleared to 1.0, which is what a depth clear
+          * command leaves in the bounds too.
+          */
+         for (i = 0; i < LP_HIZ_BLOCKS; i++) {
+            task->hiz_min[i] = 1.0f;
+            task->hiz_max[i] = 1.0f;
+         }
+         task->hiz_min_valid = task->hiz_inside;
+         task->hiz_max_valid = task->hiz_inside;
+
+         for (i = 0; i < n; i++) {
+            const struct u_rect *bbox = &tris[i].bbox;
+            union lp_rast_cmd_arg arg;
+            unsigned cmd;
+
+            if (bbox->x1 < (int)task->x || bbox->x0 >= (int)(task->x + TILE_SIZE) ||
+                bbox->y1 < (int)task->y || bbox->y0 >= (int)(task->y + TILE_SIZE))
+               continue;
+
+            cmd = triangle_command(&tris[i], FALSE, &arg);
+            variant->dispatch[cmd](task, arg);
+         }
+      }
+   }
+
+   return os_time_get_nano() - start;
+}
+
+
+/**
+ * Draw overlapping triangles at random depths with a LESS depth test, with
+ * and without hierarchical depth, checking that the depth buffers match and
+ * measuring how much shading it saves.
+ */
+static boolean
+test_hiz(unsigned verbose, FILE *fp,
+         struct lp_rasterizer_task *task,
+         struct lp_fragment_shader_variant *fs,
+         const struct rast_variant *variants,
+         unsigned num_variants,
+         unsigned size, unsigned long n)
+{
+   struct lp_scene *scene = task->scene;
+   struct lp_scene_surface *zsbuf = &scene->zsbuf;
+   const size_t fb_bytes = FB_SIZE * FB_SIZE * 4;
+   struct test_tri *tris = CALLOC(n, sizeof *tris);
+   uint8_t *expected = MALLOC(fb_bytes);
+   struct pipe_surface surf;
+   boolean success = TRUE;
+   unsigned long i;
+   unsigned v, hiz;
+
+   for (i = 0; i < n; i++) {
+      float *a0, *dadx, *dady;
+
+      random_triangle(&tris[i], size);
+      a0 = GET_A0(&tris[i].tri->inputs)[0];
+      dadx = GET_DADX(&tris[i].tri->inputs)[0];
+      dady = GET_DADY(&tris[i].tri->inputs)[0];
+      memset(a0, 0, 3 * tris[i].tri->inputs.stride);
+      a0[2] = 0.05f + 0.9f * (float)rand() / RAND_MAX;
+      dadx[2] = (float)(rand() % 201 - 100) * 1e-5f;
+      dady[2] = (float)(rand() % 201 - 100) * 1e-5f;
+   }
+
+   memset(&surf, 0, sizeof surf);
+   surf.format = PIPE_FORMAT_Z24X8_UNORM;
+   scene->fb.zsbuf = &surf;
+   zsbuf->map = MALLOC(fb_bytes);
+   zsbuf->stride = FB_SIZE * 4;
+   zsbuf->format_bytes = 4;
+   zsbuf->sample_stride = fb_bytes;
+   zsbuf->nr_samples = 1;
+
+   fs->jit_function[RAST_WHOLE] = depth_mask;
+   fs->jit_function[RAST_EDGE_TEST] = depth_mask;
+   fs->key.depth.enabled = 1;
+   fs->key.depth.writemask = 1;
+   fs->key.depth.func = PIPE_FUNC_LESS;
+   fs->hiz_test = 1;
+   fs->hiz_invalidate = LP_HIZ_MIN;
+   fs->hiz_full_write = 1;
+
+   for (v = 0; v < num_variants; v++) {
+      uint64_t fragments[2];
+      double rate[2];
+
+      for (hiz = 0; hiz < 2; hiz++) {
+         int64_t best = INT64_MAX;
+
+         for (unsigned r = 0; r < 4; r++) {
+            int64_t t;
+
+            memset(zsbuf->map, 0xff, fb_bytes);
+            num_fragments = 0;
+            t = depth_triangles(task, &variants[v], tris, n, hiz);
+            best = MIN2(best, t);
+         }
+
+         fragments[hiz] = num_fragments;
+         rate[hiz] = (double)n * 1e9 / MAX2(best, 1);
+
+         if (!hiz)
+            memcpy(expected, zsbuf->map, fb_bytes);
+         else if (memcmp(expected, zsbuf->map, fb_bytes) != 0) {
+            fprintf(stderr, "%s: %u px triangles give a different depth "
+                    "buffer with hierarchical depth\n",
+                    variants[v].name, size);
+            success = FALSE;
+         }
+      }
+
+      if (verbose)
+         printf("hiz %-7s %3u px: %8.3f Mtris/s off, %8.3f Mtris/s on, "
+                "%5.1f%% of fragments shaded%s\n", variants[v].name, size,
+                rate[0] * 1e-6, rate[1] * 1e-6,
+                100.0 * fragments[1] / MAX2(fragments[0], 1),
+                success ? "" : " (FAIL)");
+
+      if (fp) {
+         for (hiz = 0; hiz < 2; hiz++)
+            fprintf(fp, "%s\thiz\t%s_%s\t1\t%u\t%.0f\n",
+                    success ? "pass" : "fail", variants[v].name,
+                    hiz ? "on" : "off", size, rate[hiz]);
+         fflush(fp);
+      }
+   }
+
+   memset(&fs->key.depth, 0, sizeof fs->key.depth);
+   fs->hiz_test = 0;
+   fs->hiz_invalidate = 0;
+   fs->hiz_full_write = 0;
+   task->hiz_tracking = FALSE;
+   scene->fb.zsbuf = NULL;
+   FREE(zsbuf->map);
+   zsbuf->map = NULL;
+   task->depth_tile = NULL;
+
+   for (i = 0; i < n; i++)
+      align_free(tris[i].tri);
+   FREE(tris);
+   FREE(expected);
+
+   return success;
+}
+
+
+static boolean
+test_samples(unsigned verbose, FILE *fp,
+             struct lp_rasterizer_task *task,
+             struct lp_fragment_shader_variant *fs,
+             const struct rast_variant *variant,
+             unsigned nr_samples,
+             const unsigned *sizes, unsigned num_sizes,
+             unsigned long n)
+{
+   struct lp_scene *scene = task->scene;
+   const float (*sample_pos)[2] = lp_sample_positions(nr_samples);
+   boolean success = TRUE;
+   unsigned i, s;
+
+   num_samples = nr_samples;
+   scene->fb_max_samples = nr_samples;
+   for (s = 0; s < nr_samples; s++) {
+      scene->fixed_sample_pos[s][0] = util_iround(sample_pos[s][0] * FIXED_ONE);
+      scene->fixed_sample_pos[s][1] = util_iround(sample_pos[s][1] * FIXED_ONE);
+   }
+   scene->cbufs[0].nr_samples = nr_samples;
+   scene->fb.nr_cbufs = 1;
+
+   for (i = 0; i < num_sizes; i++) {
+      struct test_tri *tris = CALLOC(n, sizeof *tris);
+      unsigned long j;
+
+      for (j = 0; j < n; j++)
+         random_triangle(&tris[j], sizes[i]);
+
+      fs->jit_function[RAST_WHOLE] = record_sample_mask;
+      fs->jit_function[RAST_EDGE_TEST] = record_sample_mask;
+      task->ms_tracking = FALSE;
+      scene->cbufs[0].map = MALLOC(scene->cbufs[0].sample_stride * nr_samples);
+
+      for (j = 0; j < n && success; j++) {
+         num_fragments = 0;
+         rasterize_triangle(task, variant, &tris[j], TRUE);
+         success = check_triangle_ms(verbose, scene, &tris[j]);
+      }
+
+      FREE(scene->cbufs[0].map);
+      scene->cbufs[0].map = NULL;
+
+      if (!test_fill(verbose, fp, task, fs, variant, tris, n, sizes[i]))
+         success = FALSE;
+
+      for (j = 0; j < n; j++)
+         align_free(tris[j].tri);
+      FREE(tris);
+   }
+
+   if (!test_resolve(verbose, fp, PIPE_FORMAT_B8G8R8A8_UNORM))
+      success = FALSE;
+   if (!test_resolve(verbose, fp, PIPE_FORMAT_R32G32B32A32_FLOAT))
+      success = FALSE;
+
+   scene->fb_max_samples = 1;
+   scene->cbufs[0].nr_samples = 1;
+   scene->fb.nr_cbufs = 0;
+   task->ms_tracking = FALSE;
+   num_samples = 1;
+
+   return success;
+}
+
+
+static boolean
+test_sizes(unsigned verbose, FILE *fp,
+           const unsigned *sizes, unsigned num_sizes,
+           unsigned long n)
+{
+   struct rast_variant *variants = CALLOC(3, sizeof *variants);
+   struct lp_fragment_shader_variant *fs = CALLOC_STRUCT(lp_fragment_shader_variant);
+   struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
+   struct llvmpipe_resource *res = CALLOC_STRUCT(llvmpipe_resource);
+   struct pipe_surface surf;
+   struct lp_rast_state state;
+   struct lp_rasterizer_task task;
+   unsigned num_variants = 0;
+   boolean success = TRUE;
+   unsigned i;
+
+   memset(&state, 0, sizeof state);
+   state.variant = fs;
+   state.jit_context.sample_mask = ~0;
+
+   scene->tiles_x = FB_SIZE / TILE_SIZE;
+   scene->tiles_y = FB_SIZE / TILE_SIZE;
+   scene->fb_max_samples = 1;
+
+   /*
+    * A 32bpp color buffer for the multisample tests, which bind it while
+    * they run; the resource doesn't track uniform blocks.
+    */
+   memset(&surf, 0, sizeof surf);
+   surf.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   surf.texture = &res->base.b;
+   scene->fb.cbufs[0] = &surf;
+   scene->cbufs[0].stride = FB_SIZE * 4;
+   scene->cbufs[0].format_bytes = 4;
+   scene->cbufs[0].sample_stride = FB_SIZE * FB_SIZE * 4;
+   scene->cbufs[0].nr_samples = 1;
+   num_samples = 1;
+
+   memset(&task, 0, sizeof task);
+   task.scene = scene;
+   task.state = &state;
+   task.width = TILE_SIZE;
+   task.height = TILE_SIZE;
+
+   variants[0].name = "default";
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_3] = lp_rast_triangle_3;
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_3_4] = lp_rast_triangle_3_4;
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_3_16] = lp_rast_triangle_3_16;
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_32_3] = lp_rast_triangle_32_3;
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_32_3_4] = lp_rast_triangle_32_3_4;
+   variants[0].dispatch[LP_RAST_OP_TRIANGLE_32_3_16] = lp_rast_triangle_32_3_16;
+   num_variants++;
+
+#ifdef LP_RAST_AVX
+   if (util_get_cpu_caps()->has_avx2) {
+      variants[num_variants] = variants[0];
+      variants[num_variants].name = "avx2";
+      lp_rast_triangle_init_avx2(variants[num_variants].dispatch);
+      num_variants++;
+   }
+
+   if (util_get_cpu_caps()->has_avx512f) {
+      variants[num_variants] = variants[0];
+      variants[num_variants].name = "avx512";
+      lp_rast_triangle_init_avx512(variants[num_variants].dispatch);
+      num_variants++;
+   }
+#endif
+
+   variants[0].dispatch[LP_RAST_OP_MS_TRIANGLE_3] = lp_rast_triangle_ms_3;
+   variants[0].dispatch[LP_RAST_OP_MS_TRIANGLE_3_4] = lp_rast_triangle_ms_3_4;
+   variants[0].dispatch[LP_RAST_OP_MS_TRIANGLE_3_16] = lp_rast_triangle_ms_3_16;
+
+   for (i = 0; i < num_sizes; i++) {
+      if (!test_size(verbose, fp, &task, fs, variants, num_variants,
+                     sizes[i], n))
+         success = FALSE;
+   }
+
+   for (i = 0; i < num_sizes; i++) {
+      if (!test_hiz(verbose, fp, &task, fs, variants, num_variants,
+                    sizes[i], n))
+         success = FALSE;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(ms_sample_counts); i++) {
+      if (!test_samples(verbose, fp, &task, fs, &variants[0],
+                        ms_sample_counts[i], sizes, num_sizes, n))
+         success = FALSE;
+   }
+
+   FREE(res);
+   FREE(scene);
+   FREE(fs);
+   FREE(variants);
+
+   return success;
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "test\t"
+           "variant\t"
+           "samples\t"
+           "size\t"
+           "rate\n");
+
+   fflush(fp);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_sizes(verbose, fp, tri_sizes, ARRAY_SIZE(tri_sizes), 1000);
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_sizes(verbose, fp, tri_sizes, ARRAY_SIZE(tri_sizes), n);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   static const unsigned size = 4;
+
+   return test_sizes(verbose, fp, &size, 1, 1000);
+}
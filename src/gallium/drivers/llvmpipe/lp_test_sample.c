@@ -0,0 +1,566 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and benchmark for sampling from linear and tiled textures.
+ *
+ * The same mipmapped texture is stored both linearly and in tiles (see
+ * LP_SAMPLE_TILE_SIZE), and sampled with a few access patterns (1:1,
+ * rotated, minified, magnified).  Both layouts must return exactly the same
+ * texels; the sampling rate is reported in texels per second.
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/format/u_format.h"
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_sample.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_jit.h"
+#include "lp_state_fs.h"
+#include "lp_test.h"
+
+
+#define TEX_SIZE 1024
+#define SCREEN_SIZE 256
+
+
+typedef void (*sample_func_t)(const float *s, const float *t, float *texels,
+                              uint32_t count);
+
+
+struct sample_pattern
+{
+   const char *name;
+   float scale;         /* texels per pixel */
+   float angle;         /* degrees */
+};
+
+static const struct sample_pattern patterns[] = {
+   { "1:1",        1.0f,   0.0f },
+   { "rot30",      1.0f,  30.0f },
+   { "min4",       4.0f,   0.0f },
+   { "min3_rot30", 3.0f,  30.0f },
+   { "mag4",       0.25f,  0.0f },
+};
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_R8G8B8A8_UNORM,     /* AoS sampling */
+   PIPE_FORMAT_R32_FLOAT,          /* SoA sampling */
+};
+
+
+/*
+ * The dynamic state of the test texture lives in plain memory, which the
+ * generated code loads from through constant pointers.
+ */
+static struct lp_jit_texture jit_texture;
+static struct lp_jit_sampler jit_sampler;
+
+
+static LLVMValueRef
+test_member_ptr(struct gallivm_state *gallivm, const void *member,
+                LLVMTypeRef type)
+{
+   return LLVMBuildBitCast(gallivm->builder,
+                           lp_build_const_int_pointer(gallivm, member),
+                           LLVMPointerType(type, 0), "");
+}
+
+
+static LLVMValueRef
+test_load_member(struct gallivm_state *gallivm, const void *member,
+                 LLVMTypeRef type)
+{
+   return LLVMBuildLoad(gallivm->builder,
+                        test_member_ptr(gallivm, member, type), "");
+}
+
+
+#define TEST_TEXTURE_MEMBER(_name, _load)                                  \
+   static LLVMValueRef                                                     \
+   test_texture_##_name(const struct lp_sampler_dynamic_state *state,      \
+                        struct gallivm_state *gallivm,                     \
+                        LLVMValueRef context_ptr,                          \
+                        unsigned texture_unit,                             \
+                        LLVMValueRef texture_unit_offset)                  \
+   {                                                                       \
+      LLVMTypeRef i32 = LLVMInt32TypeInContext(gallivm->context);          \
+      if (_load)                                                           \
+         return test_load_member(gallivm, &jit_texture._name, i32);        \
+      return test_member_ptr(gallivm, &jit_texture._name,                  \
+                             LLVMArrayType(i32, LP_MAX_TEXTURE_LEVELS));   \
+   }
+
+TEST_TEXTURE_MEMBER(width, TRUE)
+TEST_TEXTURE_MEMBER(height, TRUE)
+TEST_TEXTURE_MEMBER(depth, TRUE)
+TEST_TEXTURE_MEMBER(first_level, TRUE)
+TEST_TEXTURE_MEMBER(last_level, TRUE)
+TEST_TEXTURE_MEMBER(num_samples, TRUE)
+TEST_TEXTURE_MEMBER(sample_stride, TRUE)
+TEST_TEXTURE_MEMBER(row_stride, FALSE)
+TEST_TEXTURE_MEMBER(img_stride, FALSE)
+TEST_TEXTURE_MEMBER(mip_offsets, FALSE)
+
+
+static LLVMValueRef
+test_texture_base_ptr(const struct lp_sampler_dynamic_state *state,
+                      struct gallivm_state *gallivm,
+                      LLVMValueRef context_ptr,
+                      unsigned texture_unit,
+                      LLVMValueRef texture_unit_offset)
+{
+   LLVMTypeRef i8p = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   return test_load_member(gallivm, &jit_texture.base, i8p);
+}
+
+
+#define TEST_SAMPLER_MEMBER(_name, _load)                                  \
+   static LLVMValueRef                                                     \
+   test_sampler_##_name(const struct lp_sampler_dynamic_state *state,      \
+                        struct gallivm_state *gallivm,                     \
+                        LLVMValueRef context_ptr,                          \
+                        unsigned sampler_unit)                             \
+   {                                                                       \
+      LLVMTypeRef f32 = LLVMFloatTypeInContext(gallivm->context);          \
+      if (_load)                                                           \
+         return test_load_member(gallivm, &jit_sampler._name, f32);        \
+      return test_member_ptr(gallivm, &jit_sampler._name,                  \
+                             LLVMArrayType(f32, 4));                       \
+   }
+
+TEST_SAMPLER_MEMBER(min_lod, TRUE)
+TEST_SAMPLER_MEMBER(max_lod, TRUE)
+TEST_SAMPLER_MEMBER(lod_bias, TRUE)
+TEST_SAMPLER_MEMBER(max_aniso, TRUE)
+TEST_SAMPLER_MEMBER(border_color, FALSE)
+
+
+static void
+init_dynamic_state(struct lp_sampler_dynamic_state *state)
+{
+   memset(state, 0, sizeof *state);
+   state->width = test_texture_width;
+   state->height = test_texture_height;
+   state->depth = test_texture_depth;
+   state->first_level = test_texture_first_level;
+   state->last_level = test_texture_last_level;
+   state->base_ptr = test_texture_base_ptr;
+   state->row_stride = test_texture_row_stride;
+   state->img_stride = test_texture_img_stride;
+   state->mip_offsets = test_texture_mip_offsets;
+   state->num_samples = test_texture_num_samples;
+   state->sample_stride = test_texture_sample_stride;
+   state->min_lod = test_sampler_min_lod;
+   state->max_lod = test_sampler_max_lod;
+   state->lod_bias = test_sampler_lod_bias;
+   state->border_color = test_sampler_border_color;
+   state->max_aniso = test_sampler_max_aniso;
+}
+
+
+/**
+ * Build a function sampling the texture at count vectors of coordinates,
+ * laid out as 2x2 quads so implicit derivatives work.
+ */
+static LLVMValueRef
+add_sample_test(struct gallivm_state *gallivm,
+                struct lp_type type,
+                const struct lp_sampler_static_state *static_state)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef vec_type = lp_build_vec_type(gallivm, type);
+   LLVMTypeRef i32 = LLVMInt32TypeInContext(context);
+   LLVMTypeRef args[4];
+   LLVMValueRef func, s_ptr, t_ptr, texel_ptr, count;
+   LLVMValueRef coords[5], offsets[3] = { NULL }, texel[4], index;
+   struct lp_sampler_dynamic_state dynamic_state;
+   struct lp_sampler_params params;
+   struct lp_build_loop_state loop;
+   LLVMBasicBlockRef block;
+   unsigned chan;
+
+   args[0] = args[1] = args[2] = LLVMPointerType(vec_type, 0);
+   args[3] = i32;
+
+   func = LLVMAddFunction(gallivm->module, "sample",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   s_ptr = LLVMGetParam(func, 0);
+   t_ptr = LLVMGetParam(func, 1);
+   texel_ptr = LLVMGetParam(func, 2);
+   count = LLVMGetParam(func, 3);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   init_dynamic_state(&dynamic_state);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   coords[0] = LLVMBuildLoad(builder,
+                             LLVMBuildGEP(builder, s_ptr, &loop.counter, 1, ""),
+                             "s");
+   coords[1] = LLVMBuildLoad(builder,
+                             LLVMBuildGEP(builder, t_ptr, &loop.counter, 1, ""),
+                             "t");
+   coords[2] = coords[3] = coords[4] = LLVMGetUndef(vec_type);
+
+   memset(&params, 0, sizeof params);
+   params.type = type;
+   params.sample_key = LP_SAMPLER_OP_TEXTURE << LP_SAMPLER_OP_TYPE_SHIFT;
+   params.context_ptr = LLVMConstNull(LLVMPointerType(LLVMInt8TypeInContext(context), 0));
+   params.coords = coords;
+   params.offsets = offsets;
+   params.texel = texel;
+
+   lp_build_sample_soa(&static_state->texture_state,
+                       &static_state->sampler_state,
+                       &dynamic_state, gallivm, &params);
+
+   index = LLVMBuildMul(builder, loop.counter,
+                        lp_build_const_int32(gallivm, 4), "");
+   for (chan = 0; chan < 4; chan++) {
+      LLVMValueRef i = LLVMBuildAdd(builder, index,
+                                    lp_build_const_int32(gallivm, chan), "");
+      LLVMBuildStore(builder, texel[chan],
+                     LLVMBuildGEP(builder, texel_ptr, &i, 1, ""));
+   }
+
+   lp_build_loop_end_cond(&loop, count, NULL, LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Offset of texel x, y in a tiled image, in bytes.
+ */
+static unsigned
+tiled_offset(unsigned x, unsigned y, unsigned row_stride, unsigned bpp)
+{
+   const unsigned mask = LP_SAMPLE_TILE_SIZE - 1;
+
+   return (y & ~mask) * row_stride +
+          ((y & mask) * LP_SAMPLE_TILE_SIZE +
+           (x & ~mask) * LP_SAMPLE_TILE_SIZE + (x & mask)) * bpp;
+}
+
+
+/**
+ * Lay out a full mipmap chain the way llvmpipe_texture_layout() does,
+ * and fill it with random texels, either linearly or in tiles.
+ */
+static void
+init_textures(enum pipe_format format, uint8_t **linear, uint8_t **tiled)
+{
+   const unsigned bpp = util_format_get_blocksize(format);
+   unsigned size = TEX_SIZE;
+   unsigned offset = 0;
+   unsigned level;
+
+   memset(&jit_texture, 0, sizeof jit_texture);
+   jit_texture.width = TEX_SIZE;
+   jit_texture.height = TEX_SIZE;
+   jit_texture.depth = 1;
+   jit_texture.last_level = util_logbase2(TEX_SIZE);
+
+   for (level = 0; level <= jit_texture.last_level; level++) {
+      unsigned aligned = align(size, LP_SAMPLE_TILE_SIZE);
+      jit_texture.row_stride[level] = align(aligned * bpp, 64);
+      jit_texture.img_stride[level] = jit_texture.row_stride[level] * aligned;
+      jit_texture.mip_offsets[level] = offset;
+      offset += align(jit_texture.img_stride[level], 64);
+      size = u_minify(size, 1);
+   }
+
+   *linear = align_malloc(offset, 64);
+   *tiled = align_malloc(offset, 64);
+
+   size = TEX_SIZE;
+   for (level = 0; level <= jit_texture.last_level; level++) {
+      const unsigned row_stride = jit_texture.row_stride[level];
+      uint8_t *lin = *linear + jit_texture.mip_offsets[level];
+      uint8_t *til = *tiled + jit_texture.mip_offsets[level];
+      unsigned x, y, b;
+
+      for (y = 0; y < size; y++) {
+         for (x = 0; x < size; x++) {
+            uint8_t *texel = lin + y * row_stride + x * bpp;
+            for (b = 0; b < bpp; b++)
+               texel[b] = rand();
+            if (format == PIPE_FORMAT_R32_FLOAT)
+               *(float *)texel = (float)rand() / RAND_MAX;
+            memcpy(til + tiled_offset(x, y, row_stride, bpp), texel, bpp);
+         }
+      }
+      size = u_minify(size, 1);
+   }
+}
+
+
+/**
+ * Compute normalized texcoords of the pixels of the screen, in the
+ * order add_sample_test() expects: vectors of length/4 2x2 quads.
+ */
+static void
+init_coords(const struct sample_pattern *pattern, unsigned length,
+            float *s, float *t)
+{
+   const float c = cosf(pattern->angle * (float)M_PI / 180.0f);
+   const float d = sinf(pattern->angle * (float)M_PI / 180.0f);
+   const unsigned quads_x = length / 4;
+   unsigned x0, y0, q, i, n = 0;
+
+   for (y0 = 0; y0 < SCREEN_SIZE; y0 += 2) {
+      for (x0 = 0; x0 < SCREEN_SIZE; x0 += 2 * quads_x) {
+         for (q = 0; q < quads_x; q++) {
+            for (i = 0; i < 4; i++) {
+               float x = x0 + 2 * q + (i & 1) + 0.5f;
+               float y = y0 + (i >> 1) + 0.5f;
+               float u = pattern->scale * (c * x - d * y) + 13.25f;
+               float v = pattern->scale * (d * x + c * y) + 7.75f;
+               s[n] = u / TEX_SIZE;
+               t[n] = v / TEX_SIZE;
+               n++;
+            }
+         }
+      }
+   }
+}
+
+
+static sample_func_t
+compile_sample_test(LLVMContextRef context,
+                    struct gallivm_state **gallivm,
+                    struct lp_type type,
+                    const struct lp_sampler_static_state *static_state)
+{
+   LLVMValueRef func;
+   sample_func_t sample;
+
+   *gallivm = gallivm_create("test_module_sample", context, NULL);
+
+   func = add_sample_test(*gallivm, type, static_state);
+
+   gallivm_compile_module(*gallivm);
+
+   sample = (sample_func_t) gallivm_jit_function(*gallivm, func);
+
+   gallivm_free_ir(*gallivm);
+
+   return sample;
+}
+
+
+static double
+time_sample(sample_func_t sample, const float *s, const float *t,
+            float *texels, unsigned num_vectors)
+{
+   int64_t best = INT64_MAX;
+   unsigned r;
+
+   /* Take the best of a few runs, to filter out scheduling noise. */
+   for (r = 0; r < 5; r++) {
+      int64_t start = os_time_get_nano();
+      sample(s, t, texels, num_vectors);
+      best = MIN2(best, os_time_get_nano() - start);
+   }
+
+   return (double)SCREEN_SIZE * SCREEN_SIZE * 1e9 / MAX2(best, 1);
+}
+
+
+PIPE_ALIGN_STACK
+static boolean
+test_pattern(unsigned verbose, FILE *fp,
+             enum pipe_format format,
+             boolean mipmap,
+             const struct sample_pattern *pattern)
+{
+   const struct lp_type type = lp_type_float_vec(32, lp_native_vector_width);
+   const unsigned num_texels = SCREEN_SIZE * SCREEN_SIZE;
+   const unsigned num_vectors = num_texels / type.length;
+   const char *filter = mipmap ? "trilinear" : "nearest";
+   struct lp_sampler_static_state static_state;
+   struct gallivm_state *gallivm[2];
+   sample_func_t sample[2];
+   LLVMContextRef context;
+   uint8_t *linear, *tiled;
+   float *s, *t, *texels[2];
+   double rate[2];
+   boolean success;
+   unsigned i;
+
+   memset(&static_state, 0, sizeof static_state);
+   static_state.texture_state.format = format;
+   static_state.texture_state.swizzle_r = PIPE_SWIZZLE_X;
+   static_state.texture_state.swizzle_g = PIPE_SWIZZLE_Y;
+   static_state.texture_state.swizzle_b = PIPE_SWIZZLE_Z;
+   static_state.texture_state.swizzle_a = PIPE_SWIZZLE_W;
+   static_state.texture_state.target = PIPE_TEXTURE_2D;
+   static_state.texture_state.pot_width = 1;
+   static_state.texture_state.pot_height = 1;
+   static_state.texture_state.pot_depth = 1;
+   static_state.sampler_state.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   static_state.sampler_state.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   static_state.sampler_state.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   static_state.sampler_state.normalized_coords = 1;
+   if (mipmap) {
+      static_state.sampler_state.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+      static_state.sampler_state.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+      static_state.sampler_state.min_mip_filter = PIPE_TEX_MIPFILTER_LINEAR;
+   }
+   else {
+      static_state.sampler_state.min_img_filter = PIPE_TEX_FILTER_NEAREST;
+      static_state.sampler_state.mag_img_filter = PIPE_TEX_FILTER_NEAREST;
+      static_state.sampler_state.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   }
+
+   init_textures(format, &linear, &tiled);
+
+   memset(&jit_sampler, 0, sizeof jit_sampler);
+   jit_sampler.max_lod = jit_texture.last_level;
+
+   s = align_malloc(num_texels * sizeof *s, 64);
+   t = align_malloc(num_texels * sizeof *t, 64);
+   init_coords(pattern, type.length, s, t);
+
+   context = LLVMContextCreate();
+
+   for (i = 0; i < 2; i++) {
+      static_state.texture_state.tiled = i;
+      sample[i] = compile_sample_test(context, &gallivm[i], type,
+                                      &static_state);
+      texels[i] = align_malloc(4 * num_texels * sizeof(float), 64);
+
+      jit_texture.base = i ? tiled : linear;
+      rate[i] = time_sample(sample[i], s, t, texels[i], num_vectors);
+   }
+
+   success = memcmp(texels[0], texels[1],
+                    4 * num_texels * sizeof(float)) == 0;
+
+   if (verbose || !success) {
+      printf("%-10s %-9s %-10s: linear %8.3f Mtexels/s, tiled %8.3f Mtexels/s%s\n",
+             util_format_short_name(format), filter, pattern->name,
+             rate[0] * 1e-6, rate[1] * 1e-6, success ? "" : " (FAIL)");
+   }
+
+   if (fp) {
+      for (i = 0; i < 2; i++) {
+         fprintf(fp, "%s\t%s\t%s\t%s\t%s\t%.0f\n",
+                 success ? "pass" : "fail",
+                 util_format_short_name(format), filter, pattern->name,
+                 i ? "tiled" : "linear", rate[i]);
+      }
+      fflush(fp);
+   }
+
+   for (i = 0; i < 2; i++) {
+      gallivm_destroy(gallivm[i]);
+      align_free(texels[i]);
+   }
+   LLVMContextDispose(context);
+
+   align_free(s);
+   align_free(t);
+   align_free(linear);
+   align_free(tiled);
+
+   return success;
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "format\t"
+           "filter\t"
+           "pattern\t"
+           "layout\t"
+           "texels_per_sec\n");
+
+   fflush(fp);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+   unsigned f, m, p;
+
+   for (f = 0; f < ARRAY_SIZE(formats); f++) {
+      for (m = 0; m < 2; m++) {
+         for (p = 0; p < ARRAY_SIZE(patterns); p++) {
+            if (!test_pattern(verbose, fp, formats[f], m, &patterns[p]))
+               success = FALSE;
+         }
+      }
+   }
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_pattern(verbose, fp, PIPE_FORMAT_R8G8B8A8_UNORM, TRUE,
+                       &patterns[1]);
+}
@@ -42,8 +42,10 @@
 
 #include "pipe/p_defines.h"
 #include "pipe/p_shader_tokens.h"
+#include "util/format/u_format.h"
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_format.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_tgsi.h"
@@ -334,19 +336,29 @@ LP_LLVM_IMAGE_MEMBER(img_stride, LP_JIT_IMAGE_IMG_STRIDE, TRUE)
 LP_LLVM_IMAGE_MEMBER(num_samples, LP_JIT_IMAGE_NUM_SAMPLES, TRUE)
 LP_LLVM_IMAGE_MEMBER(sample_stride, LP_JIT_IMAGE_SAMPLE_STRIDE, TRUE)
 
-#if LP_USE_TEXTURE_CACHE
 static LLVMValueRef
 lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
                           struct gallivm_state *gallivm,
                           LLVMValueRef thread_data_ptr,
                           unsigned unit)
 {
-   /* We use the same cache for all units */
-   (void)unit;
+#if !LP_USE_TEXTURE_CACHE
+   const struct llvmpipe_sampler_dynamic_state *state =
+      (const struct llvmpipe_sampler_dynamic_state *)base;
+   enum pipe_format format = state->static_state[unit].texture_state.format;
+
+   /*
+    * s3tc and rgtc are decoded inline, the cache is only needed for the
+    * formats whose blocks util_format decodes.
+    */
+   if (!lp_build_format_cache_supported(
+          util_format_description(util_format_linear(format))))
+      return NULL;
+#endif
 
+   /* We use the same cache for all units */
    return lp_jit_thread_data_cache(gallivm, thread_data_ptr);
 }
-#endif
 
 
 static void
@@ -449,9 +461,7 @@ lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state,
    sampler->dynamic_state.base.border_color = lp_llvm_sampler_border_color;
    sampler->dynamic_state.base.max_aniso = lp_llvm_sampler_max_aniso;
 
-#if LP_USE_TEXTURE_CACHE
    sampler->dynamic_state.base.cache_ptr = lp_llvm_texture_cache_ptr;
-#endif
 
    sampler->dynamic_state.static_state = static_state;
 
@@ -37,6 +37,7 @@ struct lp_image_static_state;
 
 /**
  * Whether texture cache is used for s3tc textures.
+ * Formats without a gallivm block decoder (ETC, BPTC) always use it.
  */
 #define LP_USE_TEXTURE_CACHE 0
 
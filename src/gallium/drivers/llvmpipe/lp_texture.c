@@ -42,8 +42,13 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
+#include "util/u_surface.h"
+#include "draw/draw_context.h"
+
+#include "gallivm/lp_bld_sample.h"
 
 #include "lp_context.h"
+#include "lp_debug.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -75,7 +80,7 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
                         struct llvmpipe_resource *lpr,
                         boolean allocate)
 {
-   struct pipe_resource *pt = &lpr->base;
+   struct pipe_resource *pt = &lpr->base.b;
    unsigned level;
    unsigned width = pt->width0;
    unsigned height = pt->height0;
@@ -114,7 +119,7 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
          align_x = align_y = 1;
       else {
          align_x = LP_RASTER_BLOCK_SIZE;
-         if (llvmpipe_resource_is_1d(&lpr->base))
+         if (llvmpipe_resource_is_1d(&lpr->base.b))
             align_y = 1;
          else
             align_y = LP_RASTER_BLOCK_SIZE;
@@ -134,16 +139,16 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       lpr->img_stride[level] = (uint64_t)lpr->row_stride[level] * nblocksy;
 
       /* Number of 3D image slices, cube faces or texture array layers */
-      if (lpr->base.target == PIPE_TEXTURE_CUBE) {
+      if (lpr->base.b.target == PIPE_TEXTURE_CUBE) {
          assert(layers == 6);
       }
 
-      if (lpr->base.target == PIPE_TEXTURE_3D)
+      if (lpr->base.b.target == PIPE_TEXTURE_3D)
          num_slices = depth;
-      else if (lpr->base.target == PIPE_TEXTURE_1D_ARRAY ||
-               lpr->base.target == PIPE_TEXTURE_2D_ARRAY ||
-               lpr->base.target == PIPE_TEXTURE_CUBE ||
-               lpr->base.target == PIPE_TEXTURE_CUBE_ARRAY)
+      else if (lpr->base.b.target == PIPE_TEXTURE_1D_ARRAY ||
+               lpr->base.b.target == PIPE_TEXTURE_2D_ARRAY ||
+               lpr->base.b.target == PIPE_TEXTURE_CUBE ||
+               lpr->base.b.target == PIPE_TEXTURE_CUBE_ARRAY)
          num_slices = layers;
       else
          num_slices = 1;
@@ -193,7 +198,7 @@ llvmpipe_can_create_resource(struct pipe_screen *screen,
 {
    struct llvmpipe_resource lpr;
    memset(&lpr, 0, sizeof(lpr));
-   lpr.base = *res;
+   lpr.base.b = *res;
    if (!llvmpipe_texture_layout(llvmpipe_screen(screen), &lpr, false))
       return false;
 
@@ -201,6 +206,42 @@ llvmpipe_can_create_resource(struct pipe_screen *screen,
 }
 
 
+/**
+ * Whether to store a texture in tiles (see llvmpipe_resource::tiled), which
+ * keeps the texels of a sampling footprint in fewer cache lines.  Sharing
+ * and persistent mappings need the linear layout for good.  Rendering and
+ * image access need it too, but frontends create most textures as possible
+ * render targets (and GL allows glBindImageTexture() on any texture), so
+ * those start tiled and llvmpipe_resource_untile() converts them on their
+ * first such use.
+ */
+static boolean
+llvmpipe_texture_can_tile(const struct pipe_resource *pt)
+{
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   /* the layout aligns the images to whole tiles */
+   STATIC_ASSERT(LP_RASTER_BLOCK_SIZE % LP_SAMPLE_TILE_SIZE == 0);
+
+   if (LP_PERF & PERF_NO_TEX_TILED)
+      return FALSE;
+
+   if (!(pt->bind & PIPE_BIND_SAMPLER_VIEW) ||
+       (pt->bind & ~(PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET)) ||
+       pt->usage == PIPE_USAGE_STAGING ||
+       (pt->flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+                     PIPE_RESOURCE_FLAG_MAP_COHERENT)) ||
+       pt->nr_samples > 1 ||
+       llvmpipe_resource_is_1d(pt))
+      return FALSE;
+
+   return desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          util_format_get_num_planes(pt->format) == 1;
+}
+
+
 static boolean
 llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
                               struct llvmpipe_resource *lpr,
@@ -211,12 +252,12 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
    /* Round up the surface size to a multiple of the tile size to
     * avoid tile clipping.
     */
-   const unsigned width = MAX2(1, align(lpr->base.width0, TILE_SIZE));
-   const unsigned height = MAX2(1, align(lpr->base.height0, TILE_SIZE));
+   const unsigned width = MAX2(1, align(lpr->base.b.width0, TILE_SIZE));
+   const unsigned height = MAX2(1, align(lpr->base.b.height0, TILE_SIZE));
 
    lpr->dt = winsys->displaytarget_create(winsys,
-                                          lpr->base.bind,
-                                          lpr->base.format,
+                                          lpr->base.b.bind,
+                                          lpr->base.b.format,
                                           width, height,
                                           64,
                                           map_front_private,
@@ -226,6 +267,19 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
 }
 
 
+/**
+ * Set up the u_threaded_context part of a new resource.
+ */
+static void
+llvmpipe_resource_init_threaded(struct llvmpipe_screen *screen,
+                                struct llvmpipe_resource *lpr)
+{
+   threaded_resource_init(&lpr->base.b, false);
+   if (lpr->base.b.target == PIPE_BUFFER)
+      lpr->base.buffer_id_unique = util_idalloc_mt_alloc(&screen->buffer_ids);
+}
+
+
 static struct pipe_resource *
 llvmpipe_resource_create_all(struct pipe_screen *_screen,
                              const struct pipe_resource *templat,
@@ -236,15 +290,15 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
    if (!lpr)
       return NULL;
 
-   lpr->base = *templat;
+   lpr->base.b = *templat;
    lpr->screen = screen;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = &screen->base;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = &screen->base;
 
-   /* assert(lpr->base.bind); */
+   /* assert(lpr->base.b.bind); */
 
-   if (llvmpipe_resource_is_texture(&lpr->base)) {
-      if (lpr->base.bind & (PIPE_BIND_DISPLAY_TARGET |
+   if (llvmpipe_resource_is_texture(&lpr->base.b)) {
+      if (lpr->base.b.bind & (PIPE_BIND_DISPLAY_TARGET |
                             PIPE_BIND_SCANOUT |
                             PIPE_BIND_SHARED)) {
          /* displayable surface */
@@ -255,6 +309,24 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
          /* texture map */
          if (!llvmpipe_texture_layout(screen, lpr, alloc_backing))
             goto fail;
+         lpr->tiled = alloc_backing && llvmpipe_texture_can_tile(&lpr->base.b);
+
+         if (alloc_backing && lpr->base.b.nr_samples > 1 &&
+             (lpr->base.b.bind & PIPE_BIND_RENDER_TARGET)) {
+            lpr->ms_tiles_x = DIV_ROUND_UP(lpr->base.b.width0, TILE_SIZE);
+            lpr->ms_tiles_y = DIV_ROUND_UP(lpr->base.b.height0, TILE_SIZE);
+            /* optional, resolves and blends just don't benefit without it */
+            lpr->ms_uniform = CALLOC(lpr->ms_tiles_x * lpr->ms_tiles_y *
+                                     lpr->base.b.array_size * LP_TILE_BLOCK_WORDS,
+                                     sizeof(uint64_t));
+            lpr->ms_compressed = CALLOC(lpr->ms_tiles_x * lpr->ms_tiles_y *
+                                        lpr->base.b.array_size * LP_TILE_BLOCK_WORDS,
+                                        sizeof(uint64_t));
+            if (!lpr->ms_compressed) {
+               FREE(lpr->ms_uniform);
+               lpr->ms_uniform = NULL;
+            }
+         }
       }
    }
    else {
@@ -290,6 +362,7 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
    }
 
    lpr->id = id_counter++;
+   llvmpipe_resource_init_threaded(screen, lpr);
 
 #ifdef DEBUG
    mtx_lock(&resource_list_mutex);
@@ -297,7 +370,7 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
    mtx_unlock(&resource_list_mutex);
 #endif
 
-   return &lpr->base;
+   return &lpr->base.b;
 
  fail:
    FREE(lpr);
@@ -331,6 +404,8 @@ llvmpipe_resource_create_unbacked(struct pipe_screen *_screen,
       return pt;
    lpr = llvmpipe_resource(pt);
    lpr->backable = true;
+   /* the backing may be swapped out, so never replace the storage */
+   lpr->base.is_shared = true;
    *size_required = lpr->size_required;
    return pt;
 }
@@ -376,13 +451,13 @@ llvmpipe_resource_from_memobj(struct pipe_screen *pscreen,
    struct llvmpipe_screen *screen = llvmpipe_screen(pscreen);
    struct llvmpipe_memory_object *lpmo = llvmpipe_memory_object(memobj);
    struct llvmpipe_resource *lpr = CALLOC_STRUCT(llvmpipe_resource);
-   lpr->base = *templat;
+   lpr->base.b = *templat;
 
    lpr->screen = screen;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = &screen->base;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = &screen->base;
 
-   if (llvmpipe_resource_is_texture(&lpr->base)) {
+   if (llvmpipe_resource_is_texture(&lpr->base.b)) {
       /* texture map */
       if (!llvmpipe_texture_layout(screen, lpr, false))
          goto fail;
@@ -419,6 +494,8 @@ llvmpipe_resource_from_memobj(struct pipe_screen *pscreen,
    }
    lpr->id = id_counter++;
    lpr->imported_memory = true;
+   llvmpipe_resource_init_threaded(screen, lpr);
+   lpr->base.is_shared = true;
 
 #ifdef DEBUG
    mtx_lock(&resource_list_mutex);
@@ -426,7 +503,7 @@ llvmpipe_resource_from_memobj(struct pipe_screen *pscreen,
    mtx_unlock(&resource_list_mutex);
 #endif
 
-   return &lpr->base;
+   return &lpr->base.b;
 
 fail:
    free(lpr);
@@ -455,10 +532,16 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
          }
       }
       else if (lpr->data) {
-            if (!lpr->imported_memory)
+            if (!lpr->imported_memory && !lpr->data_owner)
                align_free(lpr->data);
       }
    }
+   FREE(lpr->ms_uniform);
+   FREE(lpr->ms_compressed);
+   FREE(lpr->tile_hashes);
+   if (pt->target == PIPE_BUFFER)
+      util_idalloc_mt_free(&screen->buffer_ids, lpr->base.buffer_id_unique);
+   threaded_resource_deinit(pt);
 #ifdef DEBUG
    mtx_lock(&resource_list_mutex);
    if (lpr->next)
@@ -470,6 +553,100 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
 }
 
 
+/**
+ * Forget which blocks of a multisample resource have uniform samples.
+ * Needs to be called for any write not done by the rasterizer.
+ */
+void
+llvmpipe_resource_ms_invalidate(struct llvmpipe_resource *lpr)
+{
+   if (lpr->ms_uniform) {
+      llvmpipe_resource_ms_expand(lpr);
+      memset(lpr->ms_uniform, 0,
+             lpr->ms_tiles_x * lpr->ms_tiles_y * lpr->base.b.array_size *
+             LP_TILE_BLOCK_WORDS * sizeof(uint64_t));
+   }
+}
+
+
+/**
+ * Copy sample 0 of all compressed blocks of a multisample resource to the
+ * other samples.  Needs to be called, with the resource flushed, before
+ * anything but the rasterizer or the resolve reads samples other than 0.
+ */
+void
+llvmpipe_resource_ms_expand(struct llvmpipe_resource *lpr)
+{
+   const unsigned words_per_layer =
+      lpr->ms_tiles_x * lpr->ms_tiles_y * LP_TILE_BLOCK_WORDS;
+   const unsigned bpp = util_format_get_blocksize(lpr->base.b.format);
+   const unsigned stride = lpr->row_stride[0];
+
+   if (!lpr->ms_has_compressed)
+      return;
+
+   for (unsigned layer = 0; layer < lpr->base.b.array_size; layer++) {
+      uint8_t *image = llvmpipe_get_texture_image_address(lpr, layer, 0);
+      uint64_t *bits = lpr->ms_compressed + layer * words_per_layer;
+
+      for (unsigned i = 0; i < words_per_layer; i++) {
+         const unsigned tile = i / LP_TILE_BLOCK_WORDS;
+         const unsigned tile_x = (tile % lpr->ms_tiles_x) * TILE_SIZE;
+         const unsigned tile_y = (tile / lpr->ms_tiles_x) * TILE_SIZE;
+
+         while (bits[i]) {
+            const unsigned block = (i % LP_TILE_BLOCK_WORDS) * 64 +
+                                   u_bit_scan64(&bits[i]);
+            const unsigned x = tile_x + (block % (TILE_SIZE / 4)) * 4;
+            const unsigned y = tile_y + (block / (TILE_SIZE / 4)) * 4;
+            const uint8_t *src = image + y * stride + x * bpp;
+
+            for (unsigned s = 1; s < lpr->base.b.nr_samples; s++) {
+               uint8_t *dst = (uint8_t *)src + s * lpr->sample_stride;
+               for (unsigned row = 0; row < LP_RASTER_BLOCK_SIZE; row++)
+                  memcpy(dst + row * stride, src + row * stride,
+                         LP_RASTER_BLOCK_SIZE * bpp);
+            }
+         }
+      }
+   }
+
+   lpr->ms_has_compressed = false;
+}
+
+
+/**
+ * Add a box to the damage of a resource whose tiles are hashed.
+ */
+void
+llvmpipe_resource_add_damage(struct llvmpipe_resource *lpr,
+                             const struct pipe_box *box)
+{
+   if (!box->width || !box->height)
+      return;
+
+   if (!lpr->damage.width || !lpr->damage.height)
+      lpr->damage = *box;
+   else
+      u_box_union_2d(&lpr->damage, &lpr->damage, box);
+}
+
+
+/**
+ * Damage all of a resource whose tiles are hashed, and forget the hashes.
+ * Needs to be called for any write not done by the rasterizer.
+ */
+void
+llvmpipe_resource_damage_all(struct llvmpipe_resource *lpr)
+{
+   if (lpr->tile_hashes) {
+      memset(lpr->tile_hashes, 0,
+             lpr->hash_tiles_x * lpr->hash_tiles_y * sizeof(uint64_t));
+      u_box_2d(0, 0, lpr->base.b.width0, lpr->base.b.height0, &lpr->damage);
+   }
+}
+
+
 /**
  * Map a resource for read/write.
  */
@@ -487,7 +664,8 @@ llvmpipe_resource_map(struct pipe_resource *resource,
 
    assert(tex_usage == LP_TEX_USAGE_READ ||
           tex_usage == LP_TEX_USAGE_READ_WRITE ||
-          tex_usage == LP_TEX_USAGE_WRITE_ALL);
+          tex_usage == LP_TEX_USAGE_WRITE_ALL ||
+          tex_usage == LP_TEX_USAGE_RASTER);
 
    if (lpr->dt) {
       /* display target */
@@ -498,6 +676,10 @@ llvmpipe_resource_map(struct pipe_resource *resource,
       if (tex_usage == LP_TEX_USAGE_READ) {
          dt_usage = PIPE_MAP_READ;
       }
+      else if (tex_usage == LP_TEX_USAGE_RASTER) {
+         /* see lp_scene_report_damage() */
+         dt_usage = PIPE_MAP_READ_WRITE | SW_MAP_DAMAGE;
+      }
       else {
          dt_usage = PIPE_MAP_READ_WRITE;
       }
@@ -575,18 +757,18 @@ llvmpipe_resource_from_handle(struct pipe_screen *_screen,
       goto no_lpr;
    }
 
-   lpr->base = *template;
+   lpr->base.b = *template;
    lpr->screen = screen;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = _screen;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = _screen;
 
    /*
     * Looks like unaligned displaytargets work just fine,
     * at least sampler/render ones.
     */
 #if 0
-   assert(lpr->base.width0 == width);
-   assert(lpr->base.height0 == height);
+   assert(lpr->base.b.width0 == width);
+   assert(lpr->base.b.height0 == height);
 #endif
 
    lpr->dt = winsys->displaytarget_from_handle(winsys,
@@ -598,6 +780,8 @@ llvmpipe_resource_from_handle(struct pipe_screen *_screen,
    }
 
    lpr->id = id_counter++;
+   llvmpipe_resource_init_threaded(screen, lpr);
+   lpr->base.is_shared = true;
 
 #ifdef DEBUG
    mtx_lock(&resource_list_mutex);
@@ -605,7 +789,7 @@ llvmpipe_resource_from_handle(struct pipe_screen *_screen,
    mtx_unlock(&resource_list_mutex);
 #endif
 
-   return &lpr->base;
+   return &lpr->base.b;
 
 no_dt:
    FREE(lpr);
@@ -644,12 +828,12 @@ llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
       return NULL;
    }
 
-   lpr->base = *resource;
+   lpr->base.b = *resource;
    lpr->screen = screen;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = _screen;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = _screen;
 
-   if (llvmpipe_resource_is_texture(&lpr->base)) {
+   if (llvmpipe_resource_is_texture(&lpr->base.b)) {
       if (!llvmpipe_texture_layout(screen, lpr, false))
          goto fail;
 
@@ -657,17 +841,146 @@ llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
    } else
       lpr->data = user_memory;
    lpr->user_ptr = true;
+   llvmpipe_resource_init_threaded(screen, lpr);
+   lpr->base.is_user_ptr = true;
+   /* the application owns the contents */
+   util_range_add(&lpr->base.b, &lpr->base.valid_buffer_range,
+                  0, lpr->base.b.width0);
 #ifdef DEBUG
    mtx_lock(&resource_list_mutex);
    insert_at_tail(&resource_list, lpr);
    mtx_unlock(&resource_list_mutex);
 #endif
-   return &lpr->base;
+   return &lpr->base.b;
 fail:
    FREE(lpr);
    return NULL;
 }
 
+/**
+ * Copy a box of a tiled texture level to or from a linear buffer.
+ */
+static void
+llvmpipe_tiled_copy_box(struct llvmpipe_resource *lpr,
+                        unsigned level,
+                        const struct pipe_box *box,
+                        uint8_t *linear,
+                        unsigned linear_stride,
+                        unsigned linear_layer_stride,
+                        bool to_tiled)
+{
+   const unsigned bpp = util_format_get_blocksize(lpr->base.b.format);
+   const unsigned row_stride = lpr->row_stride[level];
+   const unsigned tile_mask = LP_SAMPLE_TILE_SIZE - 1;
+
+   assert(lpr->tiled);
+
+   for (int z = 0; z < box->depth; z++) {
+      uint8_t *image = llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                          level);
+      for (int y = 0; y < box->height; y++) {
+         const unsigned ty = box->y + y;
+         uint8_t *row = image + (ty & ~tile_mask) * row_stride +
+                        (ty & tile_mask) * LP_SAMPLE_TILE_SIZE * bpp;
+         uint8_t *lin = linear + z * linear_layer_stride + y * linear_stride;
+         unsigned x = box->x;
+         const unsigned x_end = box->x + box->width;
+
+         /* texels within a tile row are contiguous */
+         while (x < x_end) {
+            const unsigned n = MIN2(LP_SAMPLE_TILE_SIZE - (x & tile_mask),
+                                    x_end - x);
+            uint8_t *texel = row + ((x & ~tile_mask) * LP_SAMPLE_TILE_SIZE +
+                                    (x & tile_mask)) * bpp;
+            if (to_tiled)
+               memcpy(texel, lin, n * bpp);
+            else
+               memcpy(lin, texel, n * bpp);
+            lin += n * bpp;
+            x += n;
+         }
+      }
+   }
+}
+
+
+/**
+ * Switch a tiled texture to the linear layout for good.  Needs to be called
+ * before the texture is rendered to or bound as an image, which only know
+ * the linear layout.  The conversion is done in place, as both layouts use
+ * the same strides and offsets.
+ *
+ * Scenes of this context which sample from the texture are flushed first.
+ * Other contexts pick the new layout up for their sampler views through the
+ * screen timestamp, like any other texture change.
+ */
+void
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *pt)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct llvmpipe_resource *lpr = llvmpipe_resource(pt);
+   uint8_t *linear;
+
+   if (!lpr->tiled)
+      return;
+
+   llvmpipe_flush_resource(pipe, pt, 0, FALSE, TRUE, FALSE, __FUNCTION__);
+
+   /* the largest level, in the same layout */
+   linear = CALLOC(1, lpr->img_stride[0] * util_num_layers(pt, 0));
+   if (!linear)
+      return;
+
+   for (unsigned level = 0; level <= pt->last_level; level++) {
+      const unsigned num_layers = util_num_layers(pt, level);
+      struct pipe_box box;
+
+      u_box_3d(0, 0, 0, u_minify(pt->width0, level),
+               u_minify(pt->height0, level), num_layers, &box);
+      llvmpipe_tiled_copy_box(lpr, level, &box, linear,
+                              lpr->row_stride[level], lpr->img_stride[level],
+                              false);
+      memcpy(llvmpipe_get_texture_image_address(lpr, 0, level), linear,
+             lpr->img_stride[level] * num_layers);
+   }
+
+   FREE(linear);
+
+   lpr->tiled = false;
+
+   p_atomic_inc(&screen->timestamp);
+   llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+   llvmpipe->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+}
+
+
+/**
+ * Flag the fragment constants dirty if a bound constant buffer is being
+ * written to.
+ */
+static void
+llvmpipe_check_constant_buffer(struct llvmpipe_context *llvmpipe,
+                               struct pipe_resource *resource,
+                               unsigned usage)
+{
+   unsigned i;
+
+   if (!(usage & PIPE_MAP_WRITE) ||
+       !(resource->bind & PIPE_BIND_CONSTANT_BUFFER))
+      return;
+
+   for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[PIPE_SHADER_FRAGMENT]); ++i) {
+      if (resource == llvmpipe->constants[PIPE_SHADER_FRAGMENT][i].buffer) {
+         /* constants may have changed */
+         llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
+         break;
+      }
+   }
+}
+
+
 void *
 llvmpipe_transfer_map_ms( struct pipe_context *pipe,
                           struct pipe_resource *resource,
@@ -690,6 +1003,10 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /* Tiled textures only hand out linear staging copies */
+   if (lpr->tiled && (usage & PIPE_MAP_DIRECTLY))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
     * context if necessary.
@@ -697,7 +1014,9 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
    if (!(usage & PIPE_MAP_UNSYNCHRONIZED)) {
       boolean read_only = !(usage & PIPE_MAP_WRITE);
       boolean do_not_block = !!(usage & PIPE_MAP_DONTBLOCK);
-      if (!llvmpipe_flush_resource(pipe, resource,
+      /* the scenes reference the buffer using the storage */
+      if (!llvmpipe_flush_resource(pipe, lpr->data_owner ?
+                                   &lpr->data_owner->base.b : resource,
                                    level,
                                    read_only,
                                    TRUE, /* cpu_access */
@@ -711,23 +1030,21 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
       }
    }
 
-   /* Check if we're mapping a current constant buffer */
-   if ((usage & PIPE_MAP_WRITE) &&
-       (resource->bind & PIPE_BIND_CONSTANT_BUFFER)) {
-      unsigned i;
-      for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[PIPE_SHADER_FRAGMENT]); ++i) {
-         if (resource == llvmpipe->constants[PIPE_SHADER_FRAGMENT][i].buffer) {
-            /* constants may have changed */
-            llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
-            break;
-         }
-      }
-   }
+   /* Only sample 0 of compressed blocks has been written */
+   if (sample > 0 && !(usage & PIPE_MAP_UNSYNCHRONIZED))
+      llvmpipe_resource_ms_expand(lpr);
+
+   /*
+    * Unsynchronized maps from u_threaded_context happen on the application
+    * thread, so leave the context alone; unmap catches up.
+    */
+   if (!(usage & TC_TRANSFER_MAP_THREADED_UNSYNC))
+      llvmpipe_check_constant_buffer(llvmpipe, resource, usage);
 
    lpt = CALLOC_STRUCT(llvmpipe_transfer);
    if (!lpt)
       return NULL;
-   pt = &lpt->base;
+   pt = &lpt->base.b;
    pipe_resource_reference(&pt->resource, resource);
    pt->box = *box;
    pt->level = level;
@@ -759,13 +1076,7 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
       printf("transfer map tex %u  mode %s\n", lpr->id, mode);
    }
 
-   format = lpr->base.format;
-
-   map = llvmpipe_resource_map(resource,
-                               level,
-                               box->z,
-                               tex_usage);
-
+   format = lpr->base.b.format;
 
    /* May want to do different things here depending on read/write nature
     * of the map:
@@ -773,9 +1084,38 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
    if (usage & PIPE_MAP_WRITE) {
       /* Do something to notify sharing contexts of a texture change.
        */
-      screen->timestamp++;
+      p_atomic_inc(&screen->timestamp);
+
+      /* Samples may be written independently from here on */
+      llvmpipe_resource_ms_invalidate(lpr);
+      llvmpipe_resource_damage_all(lpr);
    }
 
+   if (lpr->tiled) {
+      /* Hand out a linear copy, written back on unmap */
+      pt->stride = box->width * util_format_get_blocksize(format);
+      pt->layer_stride = pt->stride * box->height;
+      lpt->staging = MALLOC(pt->layer_stride * box->depth);
+      if (!lpt->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_MAP_DISCARD_RANGE |
+                     PIPE_MAP_DISCARD_WHOLE_RESOURCE))) {
+         llvmpipe_tiled_copy_box(lpr, level, box, lpt->staging,
+                                 pt->stride, pt->layer_stride, false);
+      }
+      return lpt->staging;
+   }
+
+   map = llvmpipe_resource_map(resource,
+                               level,
+                               box->z,
+                               tex_usage);
+
    map +=
       box->y / util_format_get_blockheight(format) * pt->stride +
       box->x / util_format_get_blockwidth(format) * util_format_get_blocksize(format);
@@ -799,8 +1139,41 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
+   /* Thread safe unmaps may come from any thread */
+   if ((transfer->usage & TC_TRANSFER_MAP_THREADED_UNSYNC) &&
+       !(transfer->usage & PIPE_MAP_THREAD_SAFE))
+      llvmpipe_check_constant_buffer(llvmpipe_context(pipe),
+                                     transfer->resource, transfer->usage);
+
+   if (lpt->staging) {
+      struct llvmpipe_resource *lpr = llvmpipe_resource(transfer->resource);
+      const struct pipe_box *box = &transfer->box;
+
+      if (!(transfer->usage & PIPE_MAP_WRITE)) {
+         /* nothing to write back */
+      } else if (lpr->tiled) {
+         llvmpipe_tiled_copy_box(lpr, transfer->level, box,
+                                 lpt->staging, transfer->stride,
+                                 transfer->layer_stride, true);
+      } else {
+         /* untiled while mapped */
+         util_copy_box(llvmpipe_get_texture_image_address(lpr, 0,
+                                                          transfer->level),
+                       lpr->base.b.format,
+                       lpr->row_stride[transfer->level],
+                       lpr->img_stride[transfer->level],
+                       box->x, box->y, box->z,
+                       box->width, box->height, box->depth,
+                       lpt->staging, transfer->stride,
+                       transfer->layer_stride, 0, 0, 0);
+      }
+      FREE(lpt->staging);
+   }
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
@@ -820,17 +1193,160 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                                  unsigned level)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
-   if (!(presource->bind & (PIPE_BIND_DEPTH_STENCIL |
-                            PIPE_BIND_RENDER_TARGET |
-                            PIPE_BIND_SAMPLER_VIEW |
-                            PIPE_BIND_SHADER_BUFFER |
-                            PIPE_BIND_SHADER_IMAGE)))
+
+   /* Buffers may be written through images whatever they were created for
+    * (e.g. PBO downloads), so go by the scene count instead of the binds.
+    */
+   if (presource->target == PIPE_BUFFER) {
+      if (!p_atomic_read(&llvmpipe_resource(presource)->scene_refs))
+         return LP_UNREFERENCED;
+   } else if (!(presource->bind & (PIPE_BIND_DEPTH_STENCIL |
+                                   PIPE_BIND_RENDER_TARGET |
+                                   PIPE_BIND_SAMPLER_VIEW |
+                                   PIPE_BIND_SHADER_BUFFER |
+                                   PIPE_BIND_SHADER_IMAGE))) {
       return LP_UNREFERENCED;
+   }
 
    return lp_setup_is_resource_referenced(llvmpipe->setup, presource);
 }
 
 
+/**
+ * Whether the resource is still used by binned or rasterizing scenes.
+ * Called by u_threaded_context from the application thread.
+ */
+bool
+llvmpipe_is_resource_busy(struct pipe_screen *screen,
+                          struct pipe_resource *resource,
+                          unsigned usage)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   struct llvmpipe_resource *owner = p_atomic_read(&lpr->data_owner);
+
+   /* vertex, index and compute work is done by the time we get here */
+   return p_atomic_read(&(owner ? owner : lpr)->scene_refs) != 0;
+}
+
+
+/**
+ * Point state that was set up with a buffer's data at its new storage.
+ */
+static void
+llvmpipe_rebind_buffer(struct llvmpipe_context *llvmpipe,
+                       struct pipe_resource *buffer)
+{
+   enum pipe_shader_type sh;
+   unsigned i;
+
+   for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
+      bool draw_stage = sh != PIPE_SHADER_FRAGMENT &&
+                        sh != PIPE_SHADER_COMPUTE;
+
+      for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[sh]); i++) {
+         struct pipe_constant_buffer *cb = &llvmpipe->constants[sh][i];
+         if (cb->buffer != buffer)
+            continue;
+
+         if (sh == PIPE_SHADER_FRAGMENT)
+            llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
+         else if (sh == PIPE_SHADER_COMPUTE)
+            llvmpipe->cs_dirty |= LP_CSNEW_CONSTANTS;
+         else
+            draw_set_mapped_constant_buffer(llvmpipe->draw, sh, i,
+                                            (ubyte *) llvmpipe_resource_data(buffer) +
+                                            cb->buffer_offset,
+                                            cb->buffer_size);
+      }
+
+      for (i = 0; i < ARRAY_SIZE(llvmpipe->ssbos[sh]); i++) {
+         struct pipe_shader_buffer *sb = &llvmpipe->ssbos[sh][i];
+         if (sb->buffer != buffer)
+            continue;
+
+         if (sh == PIPE_SHADER_FRAGMENT)
+            llvmpipe->dirty |= LP_NEW_FS_SSBOS;
+         else if (sh == PIPE_SHADER_COMPUTE)
+            llvmpipe->cs_dirty |= LP_CSNEW_SSBOS;
+         else
+            draw_set_mapped_shader_buffer(llvmpipe->draw, sh, i,
+                                          (ubyte *) llvmpipe_resource_data(buffer) +
+                                          sb->buffer_offset,
+                                          sb->buffer_size);
+      }
+
+      /* the draw stages look images and views up at draw time */
+      for (i = 0; i < ARRAY_SIZE(llvmpipe->images[sh]); i++) {
+         if (llvmpipe->images[sh][i].resource == buffer) {
+            if (sh == PIPE_SHADER_FRAGMENT)
+               llvmpipe->dirty |= LP_NEW_FS_IMAGES;
+            else if (sh == PIPE_SHADER_COMPUTE)
+               llvmpipe->cs_dirty |= LP_CSNEW_IMAGES;
+         }
+      }
+
+      for (i = 0; i < ARRAY_SIZE(llvmpipe->sampler_views[sh]); i++) {
+         struct pipe_sampler_view *view = llvmpipe->sampler_views[sh][i];
+         if (view && view->texture == buffer && !draw_stage) {
+            if (sh == PIPE_SHADER_FRAGMENT)
+               llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+            else
+               llvmpipe->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+         }
+      }
+   }
+
+   for (i = 0; i < llvmpipe->num_so_targets; i++) {
+      if (llvmpipe->so_targets[i] &&
+          llvmpipe->so_targets[i]->target.buffer == buffer)
+         llvmpipe->so_targets[i]->mapping = llvmpipe_resource_data(buffer);
+   }
+}
+
+
+/**
+ * u_threaded_context buffer invalidation: dst takes over the storage of
+ * src, a fresh buffer of the same size which the threaded context keeps
+ * mapping from now on.  dst's old storage is freed once the scenes using
+ * it are done.
+ */
+void
+llvmpipe_replace_buffer_storage(struct pipe_context *pipe,
+                                struct pipe_resource *dst,
+                                struct pipe_resource *src,
+                                unsigned num_rebinds,
+                                uint32_t rebind_mask,
+                                uint32_t delete_buffer_id)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct llvmpipe_resource *lp_dst = llvmpipe_resource(dst);
+   struct llvmpipe_resource *lp_src = llvmpipe_resource(src);
+
+   assert(dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER);
+   assert(lp_dst->size_required == lp_src->size_required);
+   bool retired = false;
+
+   assert(!lp_dst->data_owner && !lp_src->data_owner);
+
+   if (p_atomic_read(&lp_dst->scene_refs)) {
+      retired = lp_setup_retire_storage(llvmpipe->setup, lp_dst->data);
+      if (!retired)
+         llvmpipe_finish(pipe, __FUNCTION__);
+   }
+   if (!retired)
+      align_free(lp_dst->data);
+
+   lp_dst->data = lp_src->data;
+   p_atomic_set(&lp_src->data_owner, lp_dst);
+
+   /* cheap enough to not bother with rebind_mask */
+   llvmpipe_rebind_buffer(llvmpipe, dst);
+
+   util_idalloc_mt_free(&screen->buffer_ids, delete_buffer_id);
+}
+
+
 /**
  * Returns the largest possible alignment for a format in llvmpipe
  */
@@ -877,20 +1393,22 @@ llvmpipe_user_buffer_create(struct pipe_screen *screen,
       return NULL;
 
    buffer->screen = llvmpipe_screen(screen);
-   pipe_reference_init(&buffer->base.reference, 1);
-   buffer->base.screen = screen;
-   buffer->base.format = PIPE_FORMAT_R8_UNORM; /* ?? */
-   buffer->base.bind = bind_flags;
-   buffer->base.usage = PIPE_USAGE_IMMUTABLE;
-   buffer->base.flags = 0;
-   buffer->base.width0 = bytes;
-   buffer->base.height0 = 1;
-   buffer->base.depth0 = 1;
-   buffer->base.array_size = 1;
+   pipe_reference_init(&buffer->base.b.reference, 1);
+   buffer->base.b.screen = screen;
+   buffer->base.b.format = PIPE_FORMAT_R8_UNORM; /* ?? */
+   buffer->base.b.bind = bind_flags;
+   buffer->base.b.usage = PIPE_USAGE_IMMUTABLE;
+   buffer->base.b.flags = 0;
+   buffer->base.b.width0 = bytes;
+   buffer->base.b.height0 = 1;
+   buffer->base.b.depth0 = 1;
+   buffer->base.b.array_size = 1;
    buffer->user_ptr = true;
    buffer->data = ptr;
+   llvmpipe_resource_init_threaded(buffer->screen, buffer);
+   buffer->base.is_user_ptr = true;
 
-   return &buffer->base;
+   return &buffer->base.b;
 }
 
 
@@ -915,7 +1433,7 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 {
    unsigned offset;
 
-   assert(llvmpipe_resource_is_texture(&lpr->base));
+   assert(llvmpipe_resource_is_texture(&lpr->base.b));
 
    offset = lpr->mip_offsets[level];
 
@@ -1002,7 +1520,7 @@ static bool llvmpipe_resource_bind_backing(struct pipe_screen *screen,
    if (!lpr->backable)
       return FALSE;
 
-   if (llvmpipe_resource_is_texture(&lpr->base)) {
+   if (llvmpipe_resource_is_texture(&lpr->base.b)) {
       if (lpr->size_required > LP_MAX_TEXTURE_SIZE)
          return FALSE;
 
@@ -1035,11 +1553,11 @@ llvmpipe_print_resources(void)
    debug_printf("LLVMPIPE: current resources:\n");
    mtx_lock(&resource_list_mutex);
    foreach(lpr, &resource_list) {
-      unsigned size = llvmpipe_resource_size(&lpr->base);
+      unsigned size = llvmpipe_resource_size(&lpr->base.b);
       debug_printf("resource %u at %p, size %ux%ux%u: %u bytes, refcount %u\n",
                    lpr->id, (void *) lpr,
-                   lpr->base.width0, lpr->base.height0, lpr->base.depth0,
-                   size, lpr->base.reference.count);
+                   lpr->base.b.width0, lpr->base.b.height0, lpr->base.b.depth0,
+                   size, lpr->base.b.reference.count);
       total += size;
       n++;
    }
@@ -1118,6 +1636,43 @@ llvmpipe_resource_get_param(struct pipe_screen *screen,
    return false;
 }
 
+
+/**
+ * Report the tiles of a resource that rendering changed since the last
+ * call.  The first call only starts hashing the resource's tiles.
+ */
+static bool
+llvmpipe_resource_get_damage(struct pipe_screen *screen,
+                             struct pipe_context *ctx,
+                             struct pipe_resource *resource,
+                             struct pipe_box *box)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+
+   if ((resource->target != PIPE_TEXTURE_2D &&
+        resource->target != PIPE_TEXTURE_RECT) ||
+       resource->nr_samples > 1 || resource->array_size > 1 ||
+       resource->last_level > 0 || lpr->damage_untracked)
+      return false;
+
+   ctx = threaded_context_unwrap_sync(ctx);
+   if (ctx)
+      llvmpipe_flush_resource(ctx, resource, 0, TRUE, TRUE, FALSE, "damage");
+
+   if (!lpr->tile_hashes) {
+      lpr->hash_tiles_x = DIV_ROUND_UP(resource->width0, TILE_SIZE);
+      lpr->hash_tiles_y = DIV_ROUND_UP(resource->height0, TILE_SIZE);
+      lpr->tile_hashes = CALLOC(lpr->hash_tiles_x * lpr->hash_tiles_y,
+                                sizeof(uint64_t));
+      memset(&lpr->damage, 0, sizeof lpr->damage);
+      return false;
+   }
+
+   *box = lpr->damage;
+   memset(&lpr->damage, 0, sizeof lpr->damage);
+   return true;
+}
+
 void
 llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
 {
@@ -1148,6 +1703,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
 
    screen->resource_get_info = llvmpipe_get_resource_info;
    screen->resource_get_param = llvmpipe_resource_get_param;
+   screen->resource_get_damage = llvmpipe_resource_get_damage;
    screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->allocate_memory = llvmpipe_allocate_memory;
    screen->free_memory = llvmpipe_free_memory;
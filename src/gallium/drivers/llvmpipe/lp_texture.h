@@ -31,6 +31,7 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_threaded_context.h"
 #include "lp_limits.h"
 
 
@@ -38,7 +39,9 @@ enum lp_texture_usage
 {
    LP_TEX_USAGE_READ = 100,
    LP_TEX_USAGE_READ_WRITE,
-   LP_TEX_USAGE_WRITE_ALL
+   LP_TEX_USAGE_WRITE_ALL,
+   /* read/write by a scene, which reports the tiles it wrote */
+   LP_TEX_USAGE_RASTER
 };
 
 
@@ -59,7 +62,7 @@ struct sw_displaytarget;
  */
 struct llvmpipe_resource
 {
-   struct pipe_resource base;
+   struct threaded_resource base;
 
    /** an extra screen pointer to avoid crashing in driver trace */
    struct llvmpipe_screen *screen;
@@ -89,9 +92,22 @@ struct llvmpipe_resource
     */
    void *data;
 
+   /**
+    * Buffer which owns data, when u_threaded_context handed this buffer's
+    * storage over to it (see llvmpipe_replace_buffer_storage).
+    */
+   struct llvmpipe_resource *data_owner;
+
    bool user_ptr;  /** Is this a user-space buffer? */
    unsigned timestamp;
 
+   /**
+    * Number of scenes (binned or still rasterizing) holding a reference
+    * to this resource.  Lets the threaded context tell whether a map
+    * needs to wait without touching the context.
+    */
+   int scene_refs;
+
    unsigned id;  /**< temporary, for debugging */
 
    unsigned sample_stride;
@@ -100,6 +116,47 @@ struct llvmpipe_resource
    uint64_t backing_offset;
    bool backable;
    bool imported_memory;
+
+   /**
+    * Texels are stored in LP_SAMPLE_TILE_SIZE x LP_SAMPLE_TILE_SIZE tiles
+    * rather than row by row (strides and offsets are the same either way).
+    * Transfers go through a linear copy, and llvmpipe_resource_untile()
+    * gives the layout up once the texture is rendered to or used as an
+    * image.
+    */
+   bool tiled;
+
+   /**
+    * Multisample color buffers: one bit per 4x4 block (LP_TILE_BLOCK_WORDS
+    * words per TILE_SIZE x TILE_SIZE tile, per layer) marking the blocks
+    * whose samples are known to all hold the same value.  Maintained by
+    * the rasterizer, cleared by any other write, and given up for good
+    * (ms_untracked) once the resource is bound as a writable image.
+    *
+    * ms_compressed marks those uniform blocks where only sample 0 has been
+    * written (same layout).  The rasterizer keeps them that way between
+    * scenes; llvmpipe_resource_ms_expand() fills in the other samples
+    * before anything else reads them.  ms_has_compressed is set when any
+    * bit might be.
+    */
+   uint64_t *ms_uniform;
+   uint64_t *ms_compressed;
+   unsigned ms_tiles_x, ms_tiles_y;
+   bool ms_untracked;
+   bool ms_has_compressed;
+
+   /**
+    * Single sample 2D color buffers a frontend asked for the damage of
+    * (see pipe_screen::resource_get_damage): a hash of each TILE_SIZE x
+    * TILE_SIZE tile as the rasterizer last left it, and the bounding box of
+    * the tiles that changed since the last query.  Any other write damages
+    * everything and forgets the hashes, and binding as a writable image
+    * gives up tracking for good (damage_untracked).
+    */
+   uint64_t *tile_hashes;
+   unsigned hash_tiles_x, hash_tiles_y;
+   struct pipe_box damage;
+   bool damage_untracked;
 #ifdef DEBUG
    /** for linked list */
    struct llvmpipe_resource *prev, *next;
@@ -109,7 +166,10 @@ struct llvmpipe_resource
 
 struct llvmpipe_transfer
 {
-   struct pipe_transfer base;
+   struct threaded_transfer base;
+
+   /** Linear copy of the box, for tiled textures */
+   void *staging;
 };
 
 struct llvmpipe_memory_object
@@ -174,6 +234,17 @@ llvmpipe_resource_is_texture(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Whether sampling from the resource needs tiled address generation
+ * (see lp_static_texture_state::tiled).
+ */
+static inline boolean
+llvmpipe_resource_is_tiled(const struct pipe_resource *resource)
+{
+   return resource && llvmpipe_resource_const(resource)->tiled;
+}
+
+
 static inline boolean
 llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 {
@@ -222,6 +293,68 @@ llvmpipe_sample_stride(struct pipe_resource *resource)
    return lpr->sample_stride;
 }
 
+/**
+ * The uniform block bits of a multisample resource for one tile of a layer,
+ * or NULL if they are not tracked.
+ */
+static inline uint64_t *
+llvmpipe_ms_uniform_bits(struct llvmpipe_resource *lpr,
+                         unsigned layer, unsigned tile_x, unsigned tile_y)
+{
+   if (!lpr->ms_uniform || lpr->ms_untracked)
+      return NULL;
+
+   assert(tile_x < lpr->ms_tiles_x);
+   assert(tile_y < lpr->ms_tiles_y);
+   return lpr->ms_uniform +
+          ((layer * lpr->ms_tiles_y + tile_y) * lpr->ms_tiles_x + tile_x) *
+          LP_TILE_BLOCK_WORDS;
+}
+
+/**
+ * Get the compressed block bits matching llvmpipe_ms_uniform_bits().
+ */
+static inline uint64_t *
+llvmpipe_ms_compressed_bits(struct llvmpipe_resource *lpr,
+                            unsigned layer, unsigned tile_x, unsigned tile_y)
+{
+   if (!lpr->ms_compressed || lpr->ms_untracked)
+      return NULL;
+
+   return lpr->ms_compressed +
+          ((layer * lpr->ms_tiles_y + tile_y) * lpr->ms_tiles_x + tile_x) *
+          LP_TILE_BLOCK_WORDS;
+}
+
+void
+llvmpipe_resource_ms_invalidate(struct llvmpipe_resource *lpr);
+
+void
+llvmpipe_resource_ms_expand(struct llvmpipe_resource *lpr);
+
+void
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *pt);
+
+static inline uint64_t *
+llvmpipe_tile_hash(struct llvmpipe_resource *lpr,
+                   unsigned tile_x, unsigned tile_y)
+{
+   if (!lpr->tile_hashes || lpr->damage_untracked)
+      return NULL;
+
+   assert(tile_x < lpr->hash_tiles_x);
+   assert(tile_y < lpr->hash_tiles_y);
+   return &lpr->tile_hashes[tile_y * lpr->hash_tiles_x + tile_x];
+}
+
+void
+llvmpipe_resource_add_damage(struct llvmpipe_resource *lpr,
+                             const struct pipe_box *box);
+
+void
+llvmpipe_resource_damage_all(struct llvmpipe_resource *lpr);
+
 void *
 llvmpipe_resource_map(struct pipe_resource *resource,
                       unsigned level,
@@ -260,6 +393,19 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                                  struct pipe_resource *presource,
                                  unsigned level);
 
+bool
+llvmpipe_is_resource_busy(struct pipe_screen *screen,
+                          struct pipe_resource *resource,
+                          unsigned usage);
+
+void
+llvmpipe_replace_buffer_storage(struct pipe_context *pipe,
+                                struct pipe_resource *dst,
+                                struct pipe_resource *src,
+                                unsigned num_rebinds,
+                                uint32_t rebind_mask,
+                                uint32_t delete_buffer_id);
+
 unsigned
 llvmpipe_get_format_alignment(enum pipe_format format);
 
@@ -40,6 +40,7 @@
 #include "sp_screen.h"
 #include "sp_query.h"
 #include "sp_tile_cache.h"
+#include "sp_tile_rast.h"
 
 
 /**
@@ -68,6 +69,10 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    softpipe_update_derived(softpipe, PIPE_PRIM_TRIANGLES); /* not needed?? */
 #endif
 
+   /* the clears go to the context's tile caches */
+   if (softpipe->tile_rast)
+      sp_tile_rast_flush(softpipe->tile_rast, 0);
+
    if (buffers & PIPE_CLEAR_COLOR) {
       for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
          if (buffers & (PIPE_CLEAR_COLOR0 << i))
@@ -49,6 +49,7 @@ struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_tile_rast;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -104,6 +105,12 @@ struct softpipe_context {
    uint64_t occlusion_count;
    unsigned active_query_count;
 
+   /** Texture cache hits and misses of the tile threads' caches.  Those
+    * of tex_cache[] are kept in the caches themselves.
+    */
+   uint64_t tex_cache_hits;
+   uint64_t tex_cache_misses;
+
    /** Mapped vertex buffers */
    ubyte *mapped_vbuffer[PIPE_MAX_ATTRIBS];
 
@@ -146,12 +153,7 @@ struct softpipe_context {
    bool render_cond_cond;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct sp_quad_pipeline quad;
 
    /** TGSI exec things */
    struct {
@@ -178,6 +180,9 @@ struct softpipe_context {
    struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
    struct softpipe_tile_cache *zsbuf_cache;
 
+   /** Threaded tile rasterization, NULL when rendering single-threaded */
+   struct sp_tile_rast *tile_rast;
+
    unsigned tex_timestamp;
 
    /*
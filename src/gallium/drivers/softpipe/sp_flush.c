@@ -38,6 +38,7 @@
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_tile_rast.h"
 #include "util/u_debug_image.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
@@ -53,6 +54,9 @@ softpipe_flush( struct pipe_context *pipe,
 
    draw_flush(softpipe->draw);
 
+   if (softpipe->tile_rast)
+      sp_tile_rast_flush(softpipe->tile_rast, flags);
+
    if (flags & SP_FLUSH_TEXTURE_CACHE) {
       unsigned sh;
 
@@ -174,6 +178,9 @@ void softpipe_texture_barrier(struct pipe_context *pipe, unsigned flags)
    struct softpipe_context *softpipe = softpipe_context(pipe);
    uint i, sh;
 
+   if (softpipe->tile_rast)
+      sp_tile_rast_flush(softpipe->tile_rast, SP_FLUSH_TEXTURE_CACHE);
+
    for (sh = 0; sh < ARRAY_SIZE(softpipe->tex_cache); sh++) {
       for (i = 0; i < softpipe->num_sampler_views[sh]; i++) {
          sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
@@ -40,6 +40,7 @@
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
+#include "sp_tile_rast.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "util/u_memory.h"
@@ -60,6 +61,9 @@ struct softpipe_vbuf_render
    struct softpipe_context *softpipe;
    struct setup_context *setup;
 
+   /** Binning for sp_tile_rast instead of rendering right away? */
+   boolean binning;
+
    enum pipe_prim_type prim;
    uint vertex_size;
    uint nr_vertices;
@@ -153,6 +157,59 @@ static inline cptrf4 get_vert( const void *vertex_buffer,
 }
 
 
+static inline void
+emit_point(struct softpipe_vbuf_render *cvbr, cptrf4 v0)
+{
+   if (cvbr->binning)
+      sp_tile_rast_bin(cvbr->softpipe->tile_rast, 1, v0, NULL, NULL);
+   else
+      sp_setup_point(cvbr->setup, v0);
+}
+
+
+static inline void
+emit_line(struct softpipe_vbuf_render *cvbr, cptrf4 v0, cptrf4 v1)
+{
+   if (cvbr->binning)
+      sp_tile_rast_bin(cvbr->softpipe->tile_rast, 2, v0, v1, NULL);
+   else
+      sp_setup_line(cvbr->setup, v0, v1);
+}
+
+
+static inline void
+emit_tri(struct softpipe_vbuf_render *cvbr, cptrf4 v0, cptrf4 v1, cptrf4 v2)
+{
+   if (cvbr->binning)
+      sp_tile_rast_bin(cvbr->softpipe->tile_rast, 3, v0, v1, v2);
+   else
+      sp_setup_tri(cvbr->setup, v0, v1, v2);
+}
+
+
+/**
+ * Start a batch of primitives, binning them for threaded rasterization
+ * when possible.
+ */
+static inline void
+begin_prims(struct softpipe_vbuf_render *cvbr)
+{
+   struct sp_tile_rast *tile_rast = cvbr->softpipe->tile_rast;
+
+   cvbr->binning = tile_rast && sp_tile_rast_begin(tile_rast);
+}
+
+
+static inline void
+end_prims(struct softpipe_vbuf_render *cvbr)
+{
+   if (cvbr->binning) {
+      sp_tile_rast_end(cvbr->softpipe->tile_rast);
+      cvbr->binning = FALSE;
+   }
+}
+
+
 /**
  * draw elements / indexed primitives
  */
@@ -163,53 +220,54 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    struct softpipe_context *softpipe = cvbr->softpipe;
    const unsigned stride = softpipe->vertex_info.size * sizeof(float);
    const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
+   begin_prims(cvbr);
+
    switch (cvbr->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
-         sp_setup_point( setup,
-                         get_vert(vertex_buffer, indices[i-0], stride) );
+         emit_point( cvbr,
+                     get_vert(vertex_buffer, indices[i-0], stride) );
       }
       break;
 
    case PIPE_PRIM_LINES:
       for (i = 1; i < nr; i += 2) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, indices[i-1], stride),
-                        get_vert(vertex_buffer, indices[i-0], stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, indices[i-1], stride),
+                    get_vert(vertex_buffer, indices[i-0], stride) );
       }
       break;
 
    case PIPE_PRIM_LINE_STRIP:
       for (i = 1; i < nr; i ++) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, indices[i-1], stride),
-                        get_vert(vertex_buffer, indices[i-0], stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, indices[i-1], stride),
+                    get_vert(vertex_buffer, indices[i-0], stride) );
       }
       break;
 
    case PIPE_PRIM_LINE_LOOP:
       for (i = 1; i < nr; i ++) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, indices[i-1], stride),
-                        get_vert(vertex_buffer, indices[i-0], stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, indices[i-1], stride),
+                    get_vert(vertex_buffer, indices[i-0], stride) );
       }
       if (nr) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, indices[nr-1], stride),
-                        get_vert(vertex_buffer, indices[0], stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, indices[nr-1], stride),
+                    get_vert(vertex_buffer, indices[0], stride) );
       }
       break;
 
    case PIPE_PRIM_TRIANGLES:
       for (i = 2; i < nr; i += 3) {
-         sp_setup_tri( setup,
-                       get_vert(vertex_buffer, indices[i-2], stride),
-                       get_vert(vertex_buffer, indices[i-1], stride),
-                       get_vert(vertex_buffer, indices[i-0], stride) );
+         emit_tri( cvbr,
+                   get_vert(vertex_buffer, indices[i-2], stride),
+                   get_vert(vertex_buffer, indices[i-1], stride),
+                   get_vert(vertex_buffer, indices[i-0], stride) );
       }
       break;
 
@@ -217,20 +275,20 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first triangle vertex as first triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i+(i&1)-1], stride),
-                          get_vert(vertex_buffer, indices[i-(i&1)], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-2], stride),
+                      get_vert(vertex_buffer, indices[i+(i&1)-1], stride),
+                      get_vert(vertex_buffer, indices[i-(i&1)], stride) );
 
          }
       }
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last triangle vertex as last triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i+(i&1)-2], stride),
-                          get_vert(vertex_buffer, indices[i-(i&1)-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i+(i&1)-2], stride),
+                      get_vert(vertex_buffer, indices[i-(i&1)-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       break;
@@ -239,19 +297,19 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[0], stride) );
          }
       }
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last non-spoke vertex as last vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[0], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[0], stride),
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       break;
@@ -261,29 +319,29 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride) );
-
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[i-3], stride),
+                      get_vert(vertex_buffer, indices[i-2], stride) );
+
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[i-2], stride),
+                      get_vert(vertex_buffer, indices[i-1], stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
-
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-3], stride),
+                      get_vert(vertex_buffer, indices[i-2], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
+
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-2], stride),
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       break;
@@ -293,27 +351,27 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-3], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[i-3], stride),
+                      get_vert(vertex_buffer, indices[i-2], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-3], stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-3], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-3], stride),
+                      get_vert(vertex_buffer, indices[i-2], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-3], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       break;
@@ -325,19 +383,19 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) { 
          /* emit first polygon  vertex as first triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[0], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[0], stride),
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride) );
          }
       }
       else {
          /* emit first polygon  vertex as last triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride),
-                          get_vert(vertex_buffer, indices[0], stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, indices[i-1], stride),
+                      get_vert(vertex_buffer, indices[i-0], stride),
+                      get_vert(vertex_buffer, indices[0], stride) );
          }
       }
       break;
@@ -345,6 +403,8 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   end_prims(cvbr);
 }
 
 
@@ -357,81 +417,82 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
    const unsigned stride = softpipe->vertex_info.size * sizeof(float);
    const void *vertex_buffer =
       (void *) get_vert(cvbr->vertex_buffer, start, stride);
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
+   begin_prims(cvbr);
+
    switch (cvbr->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
-         sp_setup_point( setup,
-                         get_vert(vertex_buffer, i-0, stride) );
+         emit_point( cvbr,
+                     get_vert(vertex_buffer, i-0, stride) );
       }
       break;
 
    case PIPE_PRIM_LINES:
       for (i = 1; i < nr; i += 2) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, i-1, stride),
-                        get_vert(vertex_buffer, i-0, stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, i-1, stride),
+                    get_vert(vertex_buffer, i-0, stride) );
       }
       break;
 
    case PIPE_PRIM_LINES_ADJACENCY:
       for (i = 3; i < nr; i += 4) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, i-2, stride),
-                        get_vert(vertex_buffer, i-1, stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, i-2, stride),
+                    get_vert(vertex_buffer, i-1, stride) );
       }
       break;
 
    case PIPE_PRIM_LINE_STRIP:
       for (i = 1; i < nr; i ++) {
-         sp_setup_line( setup,
-                     get_vert(vertex_buffer, i-1, stride),
-                     get_vert(vertex_buffer, i-0, stride) );
+         emit_line( cvbr,
+                 get_vert(vertex_buffer, i-1, stride),
+                 get_vert(vertex_buffer, i-0, stride) );
       }
       break;
 
    case PIPE_PRIM_LINE_STRIP_ADJACENCY:
       for (i = 3; i < nr; i++) {
-         sp_setup_line( setup,
-                     get_vert(vertex_buffer, i-2, stride),
-                     get_vert(vertex_buffer, i-1, stride) );
+         emit_line( cvbr,
+                 get_vert(vertex_buffer, i-2, stride),
+                 get_vert(vertex_buffer, i-1, stride) );
       }
       break;
 
    case PIPE_PRIM_LINE_LOOP:
       for (i = 1; i < nr; i ++) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, i-1, stride),
-                        get_vert(vertex_buffer, i-0, stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, i-1, stride),
+                    get_vert(vertex_buffer, i-0, stride) );
       }
       if (nr) {
-         sp_setup_line( setup,
-                        get_vert(vertex_buffer, nr-1, stride),
-                        get_vert(vertex_buffer, 0, stride) );
+         emit_line( cvbr,
+                    get_vert(vertex_buffer, nr-1, stride),
+                    get_vert(vertex_buffer, 0, stride) );
       }
       break;
 
    case PIPE_PRIM_TRIANGLES:
       for (i = 2; i < nr; i += 3) {
-         sp_setup_tri( setup,
-                       get_vert(vertex_buffer, i-2, stride),
-                       get_vert(vertex_buffer, i-1, stride),
-                       get_vert(vertex_buffer, i-0, stride) );
+         emit_tri( cvbr,
+                   get_vert(vertex_buffer, i-2, stride),
+                   get_vert(vertex_buffer, i-1, stride),
+                   get_vert(vertex_buffer, i-0, stride) );
       }
       break;
 
    case PIPE_PRIM_TRIANGLES_ADJACENCY:
       for (i = 5; i < nr; i += 6) {
-         sp_setup_tri( setup,
-                       get_vert(vertex_buffer, i-5, stride),
-                       get_vert(vertex_buffer, i-3, stride),
-                       get_vert(vertex_buffer, i-1, stride) );
+         emit_tri( cvbr,
+                   get_vert(vertex_buffer, i-5, stride),
+                   get_vert(vertex_buffer, i-3, stride),
+                   get_vert(vertex_buffer, i-1, stride) );
       }
       break;
 
@@ -439,19 +500,19 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i++) {
             /* emit first triangle vertex as first triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i+(i&1)-1, stride),
-                          get_vert(vertex_buffer, i-(i&1), stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-2, stride),
+                      get_vert(vertex_buffer, i+(i&1)-1, stride),
+                      get_vert(vertex_buffer, i-(i&1), stride) );
          }
       }
       else {
          for (i = 2; i < nr; i++) {
             /* emit last triangle vertex as last triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i+(i&1)-2, stride),
-                          get_vert(vertex_buffer, i-(i&1)-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i+(i&1)-2, stride),
+                      get_vert(vertex_buffer, i-(i&1)-1, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
          }
       }
       break;
@@ -460,19 +521,19 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 5; i < nr; i += 2) {
             /* emit first triangle vertex as first triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-5, stride),
-                          get_vert(vertex_buffer, i+(i&1)*2-3, stride),
-                          get_vert(vertex_buffer, i-(i&1)*2-1, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-5, stride),
+                      get_vert(vertex_buffer, i+(i&1)*2-3, stride),
+                      get_vert(vertex_buffer, i-(i&1)*2-1, stride) );
          }
       }
       else {
          for (i = 5; i < nr; i += 2) {
             /* emit last triangle vertex as last triangle vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i+(i&1)*2-5, stride),
-                          get_vert(vertex_buffer, i-(i&1)*2-3, stride),
-                          get_vert(vertex_buffer, i-1, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i+(i&1)*2-5, stride),
+                      get_vert(vertex_buffer, i-(i&1)*2-3, stride),
+                      get_vert(vertex_buffer, i-1, stride) );
          }
       }
       break;
@@ -481,19 +542,19 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, 0, stride)  );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, 0, stride)  );
          }
       }
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last non-spoke vertex as last vertex */
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, 0, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, 0, stride),
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
          }
       }
       break;
@@ -503,27 +564,27 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, i-3, stride),
-                          get_vert(vertex_buffer, i-2, stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-1, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, i-3, stride),
+                      get_vert(vertex_buffer, i-2, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, i-2, stride),
+                      get_vert(vertex_buffer, i-1, stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-3, stride),
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-3, stride),
+                      get_vert(vertex_buffer, i-2, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-2, stride),
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
          }
       }
       break;
@@ -533,27 +594,27 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) { 
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, i-3, stride),
-                          get_vert(vertex_buffer, i-2, stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-3, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, i-3, stride),
+                      get_vert(vertex_buffer, i-2, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-3, stride) );
          }
       }
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-3, stride),
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-3, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-3, stride),
+                      get_vert(vertex_buffer, i-2, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-3, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
          }
       }
       break;
@@ -565,19 +626,19 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) { 
          /* emit first polygon  vertex as first triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, 0, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, 0, stride),
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-0, stride) );
          }
       }
       else {
          /* emit first polygon  vertex as last triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            sp_setup_tri( setup,
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride),
-                          get_vert(vertex_buffer, 0, stride) );
+            emit_tri( cvbr,
+                      get_vert(vertex_buffer, i-1, stride),
+                      get_vert(vertex_buffer, i-0, stride),
+                      get_vert(vertex_buffer, 0, stride) );
          }
       }
       break;
@@ -585,6 +646,8 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   end_prims(cvbr);
 }
 
 /*
@@ -59,6 +59,9 @@ struct blend_quad_stage
    boolean clamp[PIPE_MAX_COLOR_BUFS];  /**< clamp colors to [0,1]? */
    enum format base_format[PIPE_MAX_COLOR_BUFS];
    enum util_format_type format_type[PIPE_MAX_COLOR_BUFS];
+   /** to round dest colors, NULL if not needed */
+   const struct util_format_pack_description *pack[PIPE_MAX_COLOR_BUFS];
+   const struct util_format_unpack_description *unpack[PIPE_MAX_COLOR_BUFS];
 };
 
 
@@ -916,6 +919,38 @@ rebase_colors(enum format base_format, float (*quadColor)[4])
    }
 }
 
+/**
+ * Round dest colors to what the color buffer can store.
+ *
+ * Tiles are cached as floats and only packed when written back, so without
+ * this a blend would see the unrounded result of an earlier blend while the
+ * tile stays cached but the rounded one after it was evicted.  Rounding on
+ * every read makes the result independent of the tile cache, and so of how
+ * screen tiles are shared out between threads.
+ */
+static void
+quantize_colors(const struct blend_quad_stage *bqs, unsigned cbuf,
+                float (*dest)[TGSI_QUAD_SIZE])
+{
+   float rgba[TGSI_QUAD_SIZE][4];
+   uint8_t packed[TGSI_QUAD_SIZE * 16];
+   uint i, j;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      for (i = 0; i < 4; i++)
+         rgba[j][i] = dest[i][j];
+
+   /* the same conversions as pipe_put_tile_rgba/pipe_get_tile_rgba */
+   bqs->pack[cbuf]->pack_rgba_float(packed, 0, &rgba[0][0], 0,
+                                    TGSI_QUAD_SIZE, 1);
+   bqs->unpack[cbuf]->unpack_rgba(rgba, packed, TGSI_QUAD_SIZE);
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      for (i = 0; i < 4; i++)
+         dest[i][j] = rgba[j][i];
+}
+
+
 static void
 blend_fallback(struct quad_stage *qs, 
                struct quad_header *quads[],
@@ -934,7 +969,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+            = sp_get_cached_tile(qs->pipeline->cbuf_cache[cbuf],
                                  quads[0]->input.x0, 
                                  quads[0]->input.y0, quads[0]->input.layer);
          const boolean clamp = bqs->clamp[cbuf];
@@ -985,6 +1020,9 @@ blend_fallback(struct quad_stage *qs,
                }
             }
 
+            if (bqs->pack[cbuf])
+               quantize_colors(bqs, cbuf, dest);
+
 
             if (blend->logicop_enable) {
                if (bqs->format_type[cbuf] != UTIL_FORMAT_TYPE_FLOAT) {
@@ -1037,7 +1075,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1057,6 +1095,9 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
          }
       }
 
+      if (bqs->pack[0])
+         quantize_colors(bqs, 0, dest);
+
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
        */
@@ -1111,7 +1152,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1129,6 +1170,9 @@ blend_single_add_one_one(struct quad_stage *qs,
             dest[i][j] = tile->data.color[y][x][i];
          }
       }
+
+      if (bqs->pack[0])
+         quantize_colors(bqs, 0, dest);
      
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
@@ -1179,7 +1223,7 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->pipeline->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1267,6 +1311,17 @@ choose_blend_quad(struct quad_stage *qs,
          /* assuming all or no color channels are normalized: */
          bqs->clamp[i] = desc->channel[0].normalized;
          bqs->format_type[i] = desc->channel[0].type;
+         /* 32-bit floats come back from the color buffer unchanged */
+         if (!util_format_is_pure_integer(format) &&
+             !(desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT &&
+               desc->channel[0].size == 32)) {
+            bqs->pack[i] = util_format_pack_description(format);
+            bqs->unpack[i] = util_format_unpack_description(format);
+         }
+         else {
+            bqs->pack[i] = NULL;
+            bqs->unpack[i] = NULL;
+         }
 
          if (util_format_is_intensity(format))
             bqs->base_format[i] = INTENSITY;
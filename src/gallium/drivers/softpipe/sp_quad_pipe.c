@@ -32,10 +32,67 @@
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct sp_quad_pipeline *quad, struct quad_stage *stage)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   stage->next = quad->first;
+   quad->first = stage;
+}
+
+
+/**
+ * Create the stages of a quad pipeline.  The caller fills in the
+ * machine, caches and counters they use.
+ */
+boolean
+sp_create_quad_pipeline(struct softpipe_context *sp,
+                        struct sp_quad_pipeline *quad)
+{
+   quad->shade = sp_quad_shade_stage(sp);
+   quad->depth_test = sp_quad_depth_test_stage(sp);
+   quad->blend = sp_quad_blend_stage(sp);
+
+   if (!quad->shade || !quad->depth_test || !quad->blend)
+      return FALSE;
+
+   quad->shade->pipeline = quad;
+   quad->depth_test->pipeline = quad;
+   quad->blend->pipeline = quad;
+
+   return TRUE;
+}
+
+
+void
+sp_destroy_quad_pipeline(struct sp_quad_pipeline *quad)
+{
+   if (quad->shade)
+      quad->shade->destroy( quad->shade );
+
+   if (quad->depth_test)
+      quad->depth_test->destroy( quad->depth_test );
+
+   if (quad->blend)
+      quad->blend->destroy( quad->blend );
+}
+
+
+/**
+ * Chain the stages of a pipeline, depth testing before or after shading.
+ */
+void
+sp_link_quad_pipeline(struct sp_quad_pipeline *quad,
+                      boolean early_depth_test)
+{
+   quad->first = quad->blend;
+
+   if (early_depth_test) {
+      insert_stage_at_head( quad, quad->shade );
+      insert_stage_at_head( quad, quad->depth_test );
+   }
+   else {
+      insert_stage_at_head( quad, quad->depth_test );
+      insert_stage_at_head( quad, quad->shade );
+   }
 }
 
 
@@ -51,16 +108,6 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+   sp_link_quad_pipeline(&sp->quad, early_depth_test);
 }
-
@@ -31,9 +31,14 @@
 #ifndef SP_QUAD_PIPE_H
 #define SP_QUAD_PIPE_H
 
+#include "pipe/p_state.h"
+
 
 struct softpipe_context;
+struct softpipe_tile_cache;
 struct quad_header;
+struct sp_quad_pipeline;
+struct tgsi_exec_machine;
 
 
 /**
@@ -46,6 +51,9 @@ struct quad_stage {
 
    struct quad_stage *next;
 
+   /** the pipeline this stage belongs to */
+   struct sp_quad_pipeline *pipeline;
+
    void (*begin)(struct quad_stage *qs);
 
    /** the stage action */
@@ -55,6 +63,27 @@ struct quad_stage {
 };
 
 
+/**
+ * The quad stages, and what they render with.  The context has a
+ * pipeline of its own, and each tile rasterization thread has another,
+ * with its own shader machine and tile caches.
+ */
+struct sp_quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *first; /**< points to one of the above stages */
+
+   struct tgsi_exec_machine *fs_machine;
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   /** Where passing samples and shader invocations are counted */
+   uint64_t *occlusion_count;
+   uint64_t *ps_invocations;
+};
+
+
 struct quad_stage *sp_quad_earlyz_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_shade_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_alpha_test_stage( struct softpipe_context *softpipe );
@@ -66,6 +95,11 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
+boolean sp_create_quad_pipeline(struct softpipe_context *sp,
+                                struct sp_quad_pipeline *quad);
+void sp_destroy_quad_pipeline(struct sp_quad_pipeline *quad);
+void sp_link_quad_pipeline(struct sp_quad_pipeline *quad,
+                           boolean early_depth_test);
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
 #endif /* SP_QUAD_PIPE_H */
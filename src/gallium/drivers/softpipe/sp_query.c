@@ -36,6 +36,7 @@
 #include "sp_context.h"
 #include "sp_query.h"
 #include "sp_state.h"
+#include "sp_tex_tile_cache.h"
 
 struct softpipe_query {
    unsigned type;
@@ -52,6 +53,48 @@ static struct softpipe_query *softpipe_query( struct pipe_query *p )
    return (struct softpipe_query *)p;
 }
 
+
+static const struct pipe_driver_query_info sp_driver_queries[] = {
+   {"sp-tex-cache-hits", SP_QUERY_TEX_CACHE_HITS, {0}},
+   {"sp-tex-cache-misses", SP_QUERY_TEX_CACHE_MISSES, {0}},
+};
+
+int
+softpipe_get_driver_query_info(struct pipe_screen *screen, unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   if (!info)
+      return ARRAY_SIZE(sp_driver_queries);
+
+   if (index >= ARRAY_SIZE(sp_driver_queries))
+      return 0;
+
+   *info = sp_driver_queries[index];
+   return 1;
+}
+
+
+/**
+ * Return the hit or miss count summed over all texture tile caches.
+ */
+static uint64_t
+get_tex_cache_count(struct softpipe_context *softpipe, unsigned type)
+{
+   uint64_t hits, misses;
+   unsigned sh, i;
+
+   hits = softpipe->tex_cache_hits;
+   misses = softpipe->tex_cache_misses;
+   for (sh = 0; sh < ARRAY_SIZE(softpipe->tex_cache); sh++) {
+      for (i = 0; i < ARRAY_SIZE(softpipe->tex_cache[0]); i++) {
+         hits += softpipe->tex_cache[sh][i]->hits;
+         misses += softpipe->tex_cache[sh][i]->misses;
+      }
+   }
+
+   return type == SP_QUERY_TEX_CACHE_HITS ? hits : misses;
+}
+
 static struct pipe_query *
 softpipe_create_query(struct pipe_context *pipe, 
 		      unsigned type,
@@ -71,7 +114,9 @@ softpipe_create_query(struct pipe_context *pipe,
           type == PIPE_QUERY_PIPELINE_STATISTICS ||
           type == PIPE_QUERY_GPU_FINISHED ||
           type == PIPE_QUERY_TIMESTAMP ||
-          type == PIPE_QUERY_TIMESTAMP_DISJOINT);
+          type == PIPE_QUERY_TIMESTAMP_DISJOINT ||
+          type == SP_QUERY_TEX_CACHE_HITS ||
+          type == SP_QUERY_TEX_CACHE_MISSES);
    sq = CALLOC_STRUCT( softpipe_query );
    sq->type = type;
    sq->index = index;
@@ -135,6 +180,10 @@ softpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
              sizeof(sq->stats));
       softpipe->active_statistics_queries++;
       break;
+   case SP_QUERY_TEX_CACHE_HITS:
+   case SP_QUERY_TEX_CACHE_MISSES:
+      sq->start = get_tex_cache_count(softpipe, sq->type);
+      break;
    default:
       assert(0);
       break;
@@ -220,6 +269,10 @@ softpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
 
       softpipe->active_statistics_queries--;
       break;
+   case SP_QUERY_TEX_CACHE_HITS:
+   case SP_QUERY_TEX_CACHE_MISSES:
+      sq->end = get_tex_cache_count(softpipe, sq->type);
+      break;
    default:
       assert(0);
       break;
@@ -39,5 +39,15 @@ softpipe_check_render_cond(struct softpipe_context *sp);
 struct softpipe_context;
 extern void softpipe_init_query_funcs(struct softpipe_context * );
 
+/* Driver specific queries */
+#define SP_QUERY_TEX_CACHE_HITS   (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define SP_QUERY_TEX_CACHE_MISSES (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+
+struct pipe_screen;
+struct pipe_driver_query_info;
+extern int
+softpipe_get_driver_query_info(struct pipe_screen *screen, unsigned index,
+                               struct pipe_driver_query_info *info);
+
 
 #endif /* SP_QUERY_H */
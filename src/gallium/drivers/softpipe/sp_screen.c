@@ -41,10 +41,13 @@
 #include "frontend/sw_winsys.h"
 #include "tgsi/tgsi_exec.h"
 
+#include "sp_limits.h"
 #include "sp_texture.h"
 #include "sp_screen.h"
 #include "sp_context.h"
 #include "sp_fence.h"
+#include "sp_query.h"
+#include "sp_tex_tile_cache.h"
 #include "sp_public.h"
 
 static const struct debug_named_value sp_debug_options[] = {
@@ -605,8 +608,20 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.flush_frontbuffer = softpipe_flush_frontbuffer;
    screen->base.get_compute_param = softpipe_get_compute_param;
    screen->base.get_compiler_options = softpipe_get_compiler_options;
+   screen->base.get_driver_query_info = softpipe_get_driver_query_info;
    screen->use_llvm = sp_debug & SP_DBG_USE_LLVM;
 
+   screen->num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   screen->num_threads = MIN2(screen->num_threads, SP_MAX_THREADS);
+
+   screen->tex_cache_tiles = debug_get_num_option("SOFTPIPE_TEX_CACHE_TILES",
+                                                  DEFAULT_TEX_TILE_ENTRIES);
+   screen->tex_cache_tiles = CLAMP(screen->tex_cache_tiles,
+                                   TEX_TILE_CACHE_WAYS, MAX_TEX_TILE_ENTRIES);
+   screen->tex_cache_tiles = util_next_power_of_two(screen->tex_cache_tiles);
+   screen->tex_native_tiles = debug_get_bool_option("SOFTPIPE_TEX_NATIVE_TILES",
+                                                    TRUE);
+
    softpipe_init_screen_texture_funcs(&screen->base);
    softpipe_init_screen_fence_funcs(&screen->base);
 
@@ -47,6 +47,14 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+
+   /** Threads to rasterize tiles with, 0 or 1 for none */
+   unsigned num_threads;
+
+   /** Entries per texture tile cache, a power of two */
+   unsigned tex_cache_tiles;
+   /** Keep 8-bit unorm texture tiles as rgba8 instead of float */
+   boolean tex_native_tiles;
 };
 
 static inline struct softpipe_screen *
@@ -75,6 +75,13 @@ struct edge {
 struct setup_context {
    struct softpipe_context *softpipe;
 
+   /* Where quads go and what they are clipped against; the context's own
+    * pipeline and cliprects unless rasterizing a single screen tile.
+    */
+   struct sp_quad_pipeline *quad_pipe;
+   const struct pipe_scissor_state *cliprect;
+   uint64_t *c_primitives;
+
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
     * Codegen will help cope with this.
@@ -129,7 +136,7 @@ static inline void
 quad_clip(struct setup_context *setup, struct quad_header *quad)
 {
    unsigned viewport_index = quad[0].input.viewport_index;
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect[viewport_index];
+   const struct pipe_scissor_state *cliprect = &setup->cliprect[viewport_index];
    const int minx = (int) cliprect->minx;
    const int maxx = (int) cliprect->maxx;
    const int miny = (int) cliprect->miny;
@@ -163,13 +170,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip(setup, quad);
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *pipe = setup->quad_pipe->first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      pipe->run( pipe, &quad, 1 );
    }
 }
 
@@ -204,7 +211,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->quad_pipe->first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -653,7 +660,7 @@ subtriangle(struct setup_context *setup,
             int lines,
             unsigned viewport_index)
 {
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect[viewport_index];
+   const struct pipe_scissor_state *cliprect = &setup->cliprect[viewport_index];
    const int minx = (int) cliprect->minx;
    const int maxx = (int) cliprect->maxx;
    const int miny = (int) cliprect->miny;
@@ -814,8 +821,8 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
-      setup->softpipe->pipeline_statistics.c_primitives++;
+   if (setup->softpipe->active_statistics_queries && setup->c_primitives) {
+      (*setup->c_primitives)++;
    }
 
 #if DEBUG_FRAGS
@@ -1401,7 +1408,7 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
-   sp->quad.first->begin( sp->quad.first );
+   setup->quad_pipe->first->begin( setup->quad_pipe->first );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1416,6 +1423,23 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Redirect the quads of this setup context to another quad pipeline,
+ * clipped against the given per-viewport cliprects.  A NULL c_primitives
+ * means primitives aren't counted here.
+ */
+void
+sp_setup_set_target(struct setup_context *setup,
+                    struct sp_quad_pipeline *quad_pipe,
+                    const struct pipe_scissor_state *cliprect,
+                    uint64_t *c_primitives)
+{
+   setup->quad_pipe = quad_pipe;
+   setup->cliprect = cliprect;
+   setup->c_primitives = c_primitives;
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -1433,6 +1457,8 @@ sp_setup_create_context(struct softpipe_context *softpipe)
    unsigned i;
 
    setup->softpipe = softpipe;
+   sp_setup_set_target(setup, &softpipe->quad, softpipe->cliprect,
+                       &softpipe->pipeline_statistics.c_primitives);
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
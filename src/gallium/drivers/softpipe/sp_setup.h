@@ -29,6 +29,8 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_quad_pipeline;
+struct pipe_scissor_state;
 
 /**
  * Attribute interpolation mode
@@ -73,5 +75,9 @@ sp_clamp_viewport_idx(int idx)
 struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
 void sp_setup_prepare( struct setup_context *setup );
 void sp_setup_destroy_context( struct setup_context *setup );
+void sp_setup_set_target(struct setup_context *setup,
+                         struct sp_quad_pipeline *quad_pipe,
+                         const struct pipe_scissor_state *cliprect,
+                         uint64_t *c_primitives);
 
 #endif
@@ -30,6 +30,7 @@
 #include "sp_state.h"
 #include "sp_fs.h"
 #include "sp_texture.h"
+#include "sp_tile_rast.h"
 
 #include "nir.h"
 #include "nir/nir_to_tgsi.h"
@@ -220,6 +221,9 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      if (softpipe->tile_rast)
+         sp_tile_rast_release_fs_variant(softpipe->tile_rast, var);
+
       var->delete(var, softpipe->fs_machine);
    }
 
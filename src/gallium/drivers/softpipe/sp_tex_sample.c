@@ -724,7 +724,7 @@ get_texel_buffer_no_border(const struct sp_sampler_view *sp_sview,
 
    tile = sp_get_cached_tile_tex(sp_sview->cache, addr);
 
-   return &tile->data.color[0][x][0];
+   return sp_tex_tile_texel(sp_sview->cache, tile, x, 0);
 }
 
 
@@ -740,7 +740,7 @@ get_texel_2d_no_border(const struct sp_sampler_view *sp_sview,
 
    tile = sp_get_cached_tile_tex(sp_sview->cache, addr);
 
-   return &tile->data.color[y][x][0];
+   return sp_tex_tile_texel(sp_sview->cache, tile, x, y);
 }
 
 
@@ -927,10 +927,10 @@ get_texel_quad_2d_no_border_single_tile(const struct sp_sampler_view *sp_sview,
 
    tile = sp_get_cached_tile_tex(sp_sview->cache, addr);
       
-   out[0] = &tile->data.color[y  ][x  ][0];
-   out[1] = &tile->data.color[y  ][x+1][0];
-   out[2] = &tile->data.color[y+1][x  ][0];
-   out[3] = &tile->data.color[y+1][x+1][0];
+   out[0] = sp_tex_tile_texel(sp_sview->cache, tile, x,   y  );
+   out[1] = sp_tex_tile_texel(sp_sview->cache, tile, x+1, y  );
+   out[2] = sp_tex_tile_texel(sp_sview->cache, tile, x,   y+1);
+   out[3] = sp_tex_tile_texel(sp_sview->cache, tile, x+1, y+1);
 }
 
 
@@ -966,7 +966,7 @@ get_texel_3d_no_border(const struct sp_sampler_view *sp_sview,
 
    tile = sp_get_cached_tile_tex(sp_sview->cache, addr);
 
-   return &tile->data.color[y][x][0];
+   return sp_tex_tile_texel(sp_sview->cache, tile, x, y);
 }
 
 
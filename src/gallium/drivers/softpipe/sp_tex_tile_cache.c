@@ -38,16 +38,31 @@
 #include "util/format/u_format.h"
 #include "util/u_math.h"
 #include "sp_context.h"
+#include "sp_screen.h"
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
-   
+
+/** Handed out when a tile can't be allocated, reads as transparent black */
+static union softpipe_tex_tile_data sp_tex_tile_dummy_data;
+
+
+static void
+invalidate_entries(struct softpipe_tex_tile_cache *tc)
+{
+   unsigned pos;
+
+   for (pos = 0; pos < tc->num_entries; pos++) {
+      tc->entries[pos].addr.bits.invalid = 1;
+   }
+}
+
 
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
 {
+   struct softpipe_screen *screen = softpipe_screen(pipe->screen);
    struct softpipe_tex_tile_cache *tc;
-   uint pos;
 
    /* make sure max texture size works */
    assert((TEX_TILE_SIZE << TEX_Y_BITS) >= (1 << (SP_MAX_TEXTURE_2D_LEVELS-1)));
@@ -55,9 +70,14 @@ sp_create_tex_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
+      tc->num_entries = screen->tex_cache_tiles;
+      tc->set_mask = tc->num_entries / TEX_TILE_CACHE_WAYS - 1;
+      tc->entries = CALLOC(tc->num_entries, sizeof(tc->entries[0]));
+      if (!tc->entries) {
+         FREE(tc);
+         return NULL;
       }
+      invalidate_entries(tc);
       tc->last_tile = &tc->entries[0]; /* any tile */
    }
    return tc;
@@ -70,8 +90,8 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
    if (tc) {
       uint pos;
 
-      for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
+      for (pos = 0; pos < tc->num_entries; pos++) {
+         FREE(tc->entries[pos].data);
       }
       if (tc->transfer) {
          tc->pipe->texture_unmap(tc->pipe, tc->transfer);
@@ -80,6 +100,7 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
          tc->pipe->texture_unmap(tc->pipe, tc->tex_trans);
       }
 
+      FREE( tc->entries );
       FREE( tc );
    }
 }
@@ -92,14 +113,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 void
 sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
 {
-   unsigned i;
-
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < ARRAY_SIZE(tc->entries); i++) {
-      tc->entries[i].addr.bits.invalid = 1;
-   }
+   invalidate_entries(tc);
 }
 
 static boolean
@@ -116,6 +133,26 @@ sp_tex_tile_is_compat_view(struct softpipe_tex_tile_cache *tc,
            tc->swizzle_a == view->swizzle_a);
 }
 
+/**
+ * Can tiles of the view be kept as rgba8 without changing the texels
+ * the samplers see?  That's the case for plain linear 8-bit unorm
+ * formats, whose float unpack is ubyte_to_float() of each channel.
+ */
+static boolean
+sp_tex_tile_use_native(const struct pipe_sampler_view *view)
+{
+   const struct util_format_description *desc =
+      util_format_description(view->format);
+
+   return view->texture->target != PIPE_BUFFER &&
+          desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+          desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB &&
+          util_format_is_unorm8(desc) &&
+          util_format_get_blocksize(view->texture->format) ==
+          desc->block.bits / 8 &&
+          util_format_unpack_description(view->format)->unpack_rgba_8unorm;
+}
+
 /**
  * Specify the sampler view to cache.
  */
@@ -124,7 +161,6 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
                                    struct pipe_sampler_view *view)
 {
    struct pipe_resource *texture = view ? view->texture : NULL;
-   uint i;
 
    assert(!tc->transfer);
 
@@ -143,13 +179,13 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
          tc->swizzle_b = view->swizzle_b;
          tc->swizzle_a = view->swizzle_a;
          tc->format = view->format;
+         tc->native = softpipe_screen(tc->pipe->screen)->tex_native_tiles &&
+                      sp_tex_tile_use_native(view);
       }
 
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < ARRAY_SIZE(tc->entries); i++) {
-         tc->entries[i].addr.bits.invalid = 1;
-      }
+      invalidate_entries(tc);
 
       tc->tex_z = -1; /* any invalid value here */
    }
@@ -165,13 +201,9 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
-   int pos;
-
    if (tc->texture) {
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
+      invalidate_entries(tc);
       tc->tex_z = -1;
    }
 
@@ -180,22 +212,48 @@ sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the cache set where the texture tile may be cached.
  */
 static inline uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_set( const struct softpipe_tex_tile_cache *tc,
+               union tex_tile_address addr )
 {
-   uint entry = (addr.bits.x + 
-                 addr.bits.y * 9 + 
-                 addr.bits.z +
-                 addr.bits.level * 7);
+   uint set = (addr.bits.x +
+               addr.bits.y * 9 +
+               addr.bits.z * 5 +
+               addr.bits.level * 7);
 
-   return entry % NUM_TEX_TILE_ENTRIES;
+   return set & tc->set_mask;
 }
 
+
+/**
+ * Copy a tile of a plain 8-bit unorm texture to rgba8.
+ */
+static void
+get_tile_rgba8(struct softpipe_tex_tile_cache *tc,
+               unsigned x, unsigned y,
+               uint8_t dst[TEX_TILE_SIZE][TEX_TILE_SIZE][4])
+{
+   const struct util_format_unpack_description *unpack =
+      util_format_unpack_description(tc->format);
+   const struct pipe_transfer *pt = tc->tex_trans;
+   const unsigned bpp = util_format_get_blocksize(tc->format);
+   const uint8_t *src;
+   unsigned w = TEX_TILE_SIZE, h = TEX_TILE_SIZE;
+   unsigned i;
+
+   if (u_clip_tile(x, y, &w, &h, &pt->box))
+      return;
+
+   src = (const uint8_t *) tc->tex_trans_map + y * pt->stride + x * bpp;
+   for (i = 0; i < h; i++) {
+      unpack->unpack_rgba_8unorm(dst[i][0], src, w);
+      src += pt->stride;
+   }
+}
+
+
 /**
  * Similar to sp_get_cached_tile() but for textures.
  * Tiles are read-only and indexed with more params.
@@ -204,9 +262,27 @@ const struct softpipe_tex_cached_tile *
 sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                         union tex_tile_address addr )
 {
-   struct softpipe_tex_cached_tile *tile;
+   struct softpipe_tex_cached_tile *set, *tile;
+   unsigned way;
 
-   tile = tc->entries + tex_cache_pos( addr );
+   set = tc->entries + tex_cache_set(tc, addr) * TEX_TILE_CACHE_WAYS;
+
+   /* Look for the tile, remembering the least recently used entry */
+   tile = &set[0];
+   for (way = 0; way < TEX_TILE_CACHE_WAYS; way++) {
+      if (set[way].addr.value == addr.value) {
+         tile = &set[way];
+         break;
+      }
+      if (set[way].addr.bits.invalid) {
+         if (!tile->addr.bits.invalid)
+            tile = &set[way];
+      }
+      else if (!tile->addr.bits.invalid &&
+               set[way].last_used < tile->last_used) {
+         tile = &set[way];
+      }
+   }
 
    if (addr.value != tile->addr.value) {
 
@@ -215,12 +291,18 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
        * texture.  Currently we effectively flush the cache on texture
        * bind.
        */
-#if 0
-      _debug_printf("miss at %u:  x=%d y=%d z=%d face=%d level=%d\n"
-                    "   tile %u:  x=%d y=%d z=%d face=%d level=%d\n",
-                    pos, x/TILE_SIZE, y/TILE_SIZE, z, face, level,
-                    pos, tile->addr.bits.x, tile->addr.bits.y, tile->z, tile->face, tile->level);
-#endif
+      tc->misses++;
+
+      if (!tile->data) {
+         tile->data = MALLOC(sizeof(*tile->data));
+         if (!tile->data) {
+            static struct softpipe_tex_cached_tile dummy = {
+               .addr.bits.invalid = 1,
+               .data = &sp_tex_tile_dummy_data,
+            };
+            return &dummy;
+         }
+      }
 
       /* check if we need to get a new transfer */
       if (!tc->tex_trans ||
@@ -259,16 +341,28 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
       /* Get tile from the transfer (view into texture), explicitly passing
        * the image format.
        */
-      pipe_get_tile_rgba(tc->tex_trans, tc->tex_trans_map,
-                         addr.bits.x * TEX_TILE_SIZE,
-                         addr.bits.y * TEX_TILE_SIZE,
-                         TEX_TILE_SIZE,
-                         TEX_TILE_SIZE,
-                         tc->format,
-                         (float *) tile->data.color);
+      if (tc->native) {
+         get_tile_rgba8(tc,
+                        addr.bits.x * TEX_TILE_SIZE,
+                        addr.bits.y * TEX_TILE_SIZE,
+                        tile->data->rgba8);
+      }
+      else {
+         pipe_get_tile_rgba(tc->tex_trans, tc->tex_trans_map,
+                            addr.bits.x * TEX_TILE_SIZE,
+                            addr.bits.y * TEX_TILE_SIZE,
+                            TEX_TILE_SIZE,
+                            TEX_TILE_SIZE,
+                            tc->format,
+                            (float *) tile->data->color);
+      }
       tile->addr = addr;
    }
+   else {
+      tc->hits++;
+   }
 
+   tile->last_used = ++tc->clock;
    tc->last_tile = tile;
    return tile;
 }
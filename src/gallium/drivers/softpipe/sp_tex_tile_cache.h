@@ -30,6 +30,7 @@
 
 
 #include "pipe/p_compiler.h"
+#include "util/u_math.h"
 #include "sp_limits.h"
 
 
@@ -61,23 +62,39 @@ union tex_tile_address {
 };
 
 
+/**
+ * Texel storage of a cached tile.  Views of plain 8-bit unorm formats
+ * may keep their tiles as rgba8 (see softpipe_tex_tile_cache::native),
+ * everything else is decoded to float.
+ */
+union softpipe_tex_tile_data
+{
+   float color[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
+   uint8_t rgba8[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
+};
+
 struct softpipe_tex_cached_tile
 {
    union tex_tile_address addr;
-   union {
-      float color[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
-      unsigned int colorui[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
-      int colori[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
-   } data;
+   unsigned last_used;    /**< cache clock at last use, for LRU */
+   union softpipe_tex_tile_data *data;  /**< allocated on first use */
 };
 
 /*
- * The number of cache entries.
- * Should not be decreased to lower than 16, and even that
- * seems too low to avoid cache thrashing in some cases (because
- * the cache is direct mapped, see tex_cache_pos() function).
+ * The cache is set associative: a tile can go into any of the
+ * TEX_TILE_CACHE_WAYS entries of the set picked by tex_cache_set(), and
+ * the least recently used one is replaced.  The total number of entries
+ * comes from SOFTPIPE_TEX_CACHE_TILES.
+ */
+#define TEX_TILE_CACHE_WAYS 4
+#define DEFAULT_TEX_TILE_ENTRIES 64
+#define MAX_TEX_TILE_ENTRIES 1024
+
+/*
+ * Number of decoded texels handed out for native tiles before a slot
+ * gets reused.  The samplers hold on to at most 8 texels at a time.
  */
-#define NUM_TEX_TILE_ENTRIES 16
+#define TEX_TILE_TEXELS 16
 
 struct softpipe_tex_tile_cache
 {
@@ -88,7 +105,10 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_TEX_TILE_ENTRIES];
+   struct softpipe_tex_cached_tile *entries;
+   unsigned num_entries;
+   unsigned set_mask;   /**< number of sets - 1 */
+   unsigned clock;      /**< bumped on every tile switch, for LRU */
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -100,6 +120,15 @@ struct softpipe_tex_tile_cache
    unsigned swizzle_a;
    enum pipe_format format;
 
+   /** Are the tiles stored as rgba8 rather than float? */
+   boolean native;
+   float texels[TEX_TILE_TEXELS][4];
+   unsigned next_texel;
+
+   /** Lookups since creation, for the driver queries */
+   uint64_t hits;
+   uint64_t misses;
+
    struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
 };
 
@@ -150,12 +179,37 @@ static inline const struct softpipe_tex_cached_tile *
 sp_get_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                        union tex_tile_address addr )
 {
-   if (tc->last_tile->addr.value == addr.value)
+   if (tc->last_tile->addr.value == addr.value) {
+      tc->hits++;
       return tc->last_tile;
+   }
 
    return sp_find_cached_tile_tex( tc, addr );
 }
 
+/* Return the texel at x, y of a tile as float RGBA.  For native tiles
+ * the pointer stays valid for the next TEX_TILE_TEXELS - 1 texels only.
+ */
+static inline const float *
+sp_tex_tile_texel(struct softpipe_tex_tile_cache *tc,
+                  const struct softpipe_tex_cached_tile *tile,
+                  unsigned x, unsigned y)
+{
+   const uint8_t *src;
+   float *texel;
+
+   if (!tc->native)
+      return tile->data->color[y][x];
+
+   src = tile->data->rgba8[y][x];
+   texel = tc->texels[tc->next_texel++ % TEX_TILE_TEXELS];
+   texel[0] = ubyte_to_float(src[0]);
+   texel[1] = ubyte_to_float(src[1]);
+   texel[2] = ubyte_to_float(src[2]);
+   texel[3] = ubyte_to_float(src[3]);
+   return texel;
+}
+
 
 #endif /* SP_TEX_TILE_CACHE_H */
 
@@ -74,6 +74,19 @@ is_clear_flag_set(const uint *bitvec, union tile_address addr, unsigned max)
 }
    
 
+/**
+ * Mark the tile at (x,y) as cleared.
+ */
+static inline void
+set_clear_flag(uint *bitvec, union tile_address addr, unsigned max)
+{
+   int pos;
+   pos = addr_to_clear_pos(addr);
+   assert(pos / 32 < max);
+   bitvec[pos / 32] |= 1 << (pos & 31);
+}
+
+
 /**
  * Mark the tile at (x,y) as not cleared.
  */
@@ -564,6 +577,47 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 
 
 
+/**
+ * Move the pending clears of the tiles (x, y) with
+ * (x + y) % num_shares == share from src to tc, which caches the same
+ * surface and has no clears pending of its own.  This lets another cache
+ * take over rendering to those tiles without writing the clears out.
+ */
+void
+sp_tile_cache_move_clears(struct softpipe_tile_cache *tc,
+                          struct softpipe_tile_cache *src,
+                          unsigned share, unsigned num_shares)
+{
+   int layer;
+   uint x, y;
+
+   if (!src->num_maps || tc->surface != src->surface)
+      return;
+
+   tc->clear_color = src->clear_color;
+   tc->clear_val = src->clear_val;
+
+   for (layer = 0; layer < src->num_maps; layer++) {
+      const uint w = src->surface->width;
+      const uint h = src->surface->height;
+
+      for (y = 0; y < h; y += TILE_SIZE) {
+         for (x = 0; x < w; x += TILE_SIZE) {
+            union tile_address addr = tile_address(x, y, layer);
+
+            if ((x + y) / TILE_SIZE % num_shares == share &&
+                is_clear_flag_set(src->clear_flags, addr,
+                                  src->clear_flags_size)) {
+               set_clear_flag(tc->clear_flags, addr, tc->clear_flags_size);
+               clear_clear_flag(src->clear_flags, addr,
+                                src->clear_flags_size);
+            }
+         }
+      }
+   }
+}
+
+
 /**
  * When a whole surface is being cleared to a value we can avoid
  * fetching tiles above.
@@ -118,6 +118,11 @@ sp_tile_cache_get_surface(struct softpipe_tile_cache *tc);
 extern void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc);
 
+extern void
+sp_tile_cache_move_clears(struct softpipe_tile_cache *tc,
+                          struct softpipe_tile_cache *src,
+                          unsigned share, unsigned num_shares);
+
 extern void
 sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     const union pipe_color_union *color,
@@ -0,0 +1,831 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Threaded tile rasterization.
+ *
+ * Tile (tx, ty) belongs to share (tx + ty) % num_threads of the work.
+ * Share 0 runs on the calling thread, the others on threads of their own,
+ * although a share may run on the calling thread too when it is the only
+ * one with work.  Since setup emits quads in 16 pixel wide runs aligned
+ * to 16 pixels, clipping a primitive against a TILE_SIZE tile produces
+ * exactly the quads, and so the interpolated values, the whole primitive
+ * would have produced there.
+ *
+ * Either the context's tile caches or the shares' caches hold tiles and
+ * pending clears, never both: whichever side is about to render flushes
+ * the other, moving the clears over rather than writing them out so that
+ * cleared tiles start from the exact clear value either way.
+ */
+
+#include <stdio.h>
+
+#include "os/os_thread.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "sp_context.h"
+#include "sp_flush.h"
+#include "sp_quad_pipe.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+#include "sp_tile_rast.h"
+
+
+enum sp_tile_rast_task {
+   SP_TILE_RAST_RENDER,
+   SP_TILE_RAST_FLUSH,
+};
+
+
+/** A point, line or triangle binned in the current batch */
+struct sp_tile_prim {
+   const float (*v[3])[4];
+   unsigned nr;                  /**< number of vertices */
+   unsigned tx0, ty0, tx1, ty1;  /**< inclusive range of tiles touched */
+};
+
+
+/** One share of the tiles, with everything needed to render them */
+struct sp_tile_rast_thread {
+   struct sp_tile_rast *rast;
+   unsigned index;
+   boolean busy;
+
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   struct setup_context *setup;
+   struct sp_quad_pipeline quad;
+   struct tgsi_exec_machine *machine;
+   const struct sp_fragment_shader_variant *fs_variant;
+
+   /** Copy of the context's fragment sampler, using our texture caches */
+   struct sp_tgsi_sampler sampler;
+   unsigned num_sampler_views;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned num_tex_caches;
+
+   /** The context's cliprects clipped to the current tile */
+   struct pipe_scissor_state cliprect[PIPE_MAX_VIEWPORTS];
+
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+   uint64_t c_primitives;
+};
+
+
+struct sp_tile_rast {
+   struct softpipe_context *softpipe;
+   unsigned num_threads;
+
+   struct sp_tile_rast_thread thread[SP_MAX_THREADS];
+   thrd_t threads[SP_MAX_THREADS];
+   unsigned num_threads_started;
+   boolean exit_flag;
+
+   enum sp_tile_rast_task task;
+   unsigned fpstate;
+
+   /** Do the shares' tile caches hold any tiles or clears? */
+   boolean tiles_cached;
+
+   struct sp_tile_prim *prims;
+   unsigned num_prims, max_prims;
+
+   /* Tile t lists prims tile_prims[tile_start[t]..tile_start[t+1]-1].
+    * While binning, tile_start[t+1] counts the prims of tile t.  The
+    * same allocation holds the fill positions used to build the lists.
+    */
+   unsigned tiles_x, tiles_y;
+   unsigned *tile_start;
+   unsigned max_tile_start;
+   unsigned *tile_prims;
+   unsigned num_tile_prims, max_tile_prims;
+};
+
+
+/**
+ * Make room for n elements of the given size in *array.
+ */
+static boolean
+grow_array(void **array, unsigned *max, unsigned n, size_t size)
+{
+   unsigned new_max;
+   void *new_array;
+
+   if (n <= *max)
+      return TRUE;
+
+   new_max = MAX2(n, *max * 2);
+   new_array = REALLOC(*array, *max * size, new_max * size);
+   if (!new_array)
+      return FALSE;
+
+   *array = new_array;
+   *max = new_max;
+   return TRUE;
+}
+
+
+static void
+flush_tile_caches(struct sp_tile_rast_thread *thr)
+{
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_flush_tile_cache(thr->quad.cbuf_cache[i]);
+   sp_flush_tile_cache(thr->quad.zsbuf_cache);
+}
+
+
+/**
+ * Render the binned primitives of every tile of this share, in row order.
+ */
+static void
+render_tiles(struct sp_tile_rast_thread *thr)
+{
+   struct sp_tile_rast *rast = thr->rast;
+   const struct softpipe_context *sp = rast->softpipe;
+   const unsigned n = rast->num_threads;
+   unsigned tx, ty, vp, i;
+
+   for (ty = 0; ty < rast->tiles_y; ty++) {
+      for (tx = (thr->index + n - ty % n) % n; tx < rast->tiles_x; tx += n) {
+         const unsigned t = ty * rast->tiles_x + tx;
+
+         if (rast->tile_start[t] == rast->tile_start[t + 1])
+            continue;
+
+         for (vp = 0; vp < PIPE_MAX_VIEWPORTS; vp++) {
+            const struct pipe_scissor_state *cliprect = &sp->cliprect[vp];
+
+            thr->cliprect[vp].minx = MAX2(cliprect->minx, tx * TILE_SIZE);
+            thr->cliprect[vp].miny = MAX2(cliprect->miny, ty * TILE_SIZE);
+            thr->cliprect[vp].maxx = MIN2(cliprect->maxx, (tx + 1) * TILE_SIZE);
+            thr->cliprect[vp].maxy = MIN2(cliprect->maxy, (ty + 1) * TILE_SIZE);
+         }
+
+         for (i = rast->tile_start[t]; i < rast->tile_start[t + 1]; i++) {
+            const struct sp_tile_prim *prim = &rast->prims[rast->tile_prims[i]];
+
+            /* count each primitive once, in the first tile it touches */
+            sp_setup_set_target(thr->setup, &thr->quad, thr->cliprect,
+                                prim->tx0 == tx && prim->ty0 == ty ?
+                                &thr->c_primitives : NULL);
+
+            switch (prim->nr) {
+            case 3:
+               sp_setup_tri(thr->setup, prim->v[0], prim->v[1], prim->v[2]);
+               break;
+            case 2:
+               sp_setup_line(thr->setup, prim->v[0], prim->v[1]);
+               break;
+            default:
+               sp_setup_point(thr->setup, prim->v[0]);
+               break;
+            }
+         }
+      }
+   }
+}
+
+
+static void
+do_task(struct sp_tile_rast_thread *thr)
+{
+   switch (thr->rast->task) {
+   case SP_TILE_RAST_RENDER:
+      render_tiles(thr);
+      break;
+   case SP_TILE_RAST_FLUSH:
+      flush_tile_caches(thr);
+      break;
+   }
+}
+
+
+/**
+ * Run the current task on every busy share and wait for them.  The first
+ * busy share runs on the calling thread.
+ */
+static void
+run_busy_shares(struct sp_tile_rast *rast, enum sp_tile_rast_task task)
+{
+   struct sp_tile_rast_thread *local = NULL;
+   unsigned i;
+
+   rast->task = task;
+   rast->fpstate = util_fpstate_get();
+
+   for (i = 0; i < rast->num_threads; i++) {
+      if (!rast->thread[i].busy)
+         continue;
+
+      if (!local)
+         local = &rast->thread[i];
+      else
+         pipe_semaphore_signal(&rast->thread[i].work_ready);
+   }
+
+   if (local)
+      do_task(local);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      if (rast->thread[i].busy && &rast->thread[i] != local)
+         pipe_semaphore_wait(&rast->thread[i].work_done);
+      rast->thread[i].busy = FALSE;
+   }
+}
+
+
+static int
+thread_function(void *init_data)
+{
+   struct sp_tile_rast_thread *thr = (struct sp_tile_rast_thread *) init_data;
+   struct sp_tile_rast *rast = thr->rast;
+   char thread_name[16];
+
+   snprintf(thread_name, sizeof thread_name, "softpipe-%u", thr->index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&thr->work_ready);
+
+      if (rast->exit_flag)
+         break;
+
+      /* round and treat denorms the way the calling thread does */
+      util_fpstate_set(rast->fpstate);
+
+      do_task(thr);
+
+      pipe_semaphore_signal(&thr->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Point the shares' samplers at their own texture caches, holding the
+ * context's current fragment sampler views.
+ */
+static boolean
+update_samplers(struct sp_tile_rast *rast)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   const struct sp_tgsi_sampler *sampler = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   const unsigned num = sp->num_sampler_views[PIPE_SHADER_FRAGMENT];
+   unsigned i, j;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      memcpy(&thr->sampler, sampler, offsetof(struct sp_tgsi_sampler, sp_sview));
+      memcpy(thr->sampler.sp_sview, sampler->sp_sview,
+             num * sizeof(sampler->sp_sview[0]));
+      if (thr->num_sampler_views > num) {
+         memset(&thr->sampler.sp_sview[num], 0,
+                (thr->num_sampler_views - num) * sizeof(sampler->sp_sview[0]));
+      }
+      thr->num_sampler_views = num;
+
+      for (j = 0; j < MAX2(num, thr->num_tex_caches); j++) {
+         struct pipe_sampler_view *view =
+            j < num ? sp->sampler_views[PIPE_SHADER_FRAGMENT][j] : NULL;
+         struct softpipe_tex_tile_cache *tc = thr->tex_cache[j];
+
+         if (!tc) {
+            if (!view)
+               continue;
+
+            tc = sp_create_tex_tile_cache(&sp->pipe);
+            if (!tc)
+               return FALSE;
+
+            thr->tex_cache[j] = tc;
+            thr->num_tex_caches = MAX2(thr->num_tex_caches, j + 1);
+         }
+
+         sp_tex_tile_cache_set_sampler_view(tc, view);
+
+         if (tc->texture) {
+            struct softpipe_resource *spt = softpipe_resource(tc->texture);
+            if (spt->timestamp != tc->timestamp) {
+               sp_tex_tile_cache_validate_texture(tc);
+               tc->timestamp = spt->timestamp;
+            }
+         }
+
+         if (view)
+            thr->sampler.sp_sview[j].cache = tc;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+destroy_thread_data(struct softpipe_context *sp,
+                    struct sp_tile_rast_thread *thr)
+{
+   unsigned i;
+
+   if (thr->setup)
+      sp_setup_destroy_context(thr->setup);
+
+   sp_destroy_quad_pipeline(&thr->quad);
+
+   if (thr->machine)
+      tgsi_exec_machine_destroy(thr->machine);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(thr->quad.cbuf_cache[i]);
+   sp_destroy_tile_cache(thr->quad.zsbuf_cache);
+
+   for (i = 0; i < thr->num_tex_caches; i++) {
+      if (thr->tex_cache[i]) {
+         sp_tex_tile_cache_set_sampler_view(thr->tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(thr->tex_cache[i]);
+      }
+   }
+}
+
+
+static boolean
+create_thread_data(struct softpipe_context *sp,
+                   struct sp_tile_rast_thread *thr)
+{
+   unsigned i;
+
+   if (!sp_create_quad_pipeline(sp, &thr->quad))
+      return FALSE;
+
+   thr->machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   if (!thr->machine)
+      return FALSE;
+
+   thr->quad.fs_machine = thr->machine;
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      thr->quad.cbuf_cache[i] = sp_create_tile_cache(&sp->pipe);
+      if (!thr->quad.cbuf_cache[i])
+         return FALSE;
+   }
+   thr->quad.zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+   if (!thr->quad.zsbuf_cache)
+      return FALSE;
+
+   thr->quad.occlusion_count = &thr->occlusion_count;
+   thr->quad.ps_invocations = &thr->ps_invocations;
+
+   thr->setup = sp_setup_create_context(sp);
+   if (!thr->setup)
+      return FALSE;
+
+   sp_setup_set_target(thr->setup, &thr->quad, thr->cliprect, NULL);
+
+   return TRUE;
+}
+
+
+/**
+ * Create the tile rasterizer and start num_threads - 1 threads; the
+ * calling thread does a share of the work too.
+ */
+struct sp_tile_rast *
+sp_tile_rast_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_tile_rast *rast;
+   unsigned i;
+
+   assert(num_threads > 1 && num_threads <= SP_MAX_THREADS);
+
+   rast = CALLOC_STRUCT(sp_tile_rast);
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = softpipe;
+   rast->num_threads = num_threads;
+
+   for (i = 0; i < num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      thr->rast = rast;
+      thr->index = i;
+      pipe_semaphore_init(&thr->work_ready, 0);
+      pipe_semaphore_init(&thr->work_done, 0);
+
+      if (!create_thread_data(softpipe, thr))
+         goto fail;
+   }
+
+   for (i = 1; i < num_threads; i++) {
+      rast->threads[i] = u_thread_create(thread_function, &rast->thread[i]);
+      if (!rast->threads[i])
+         goto fail;
+      rast->num_threads_started = i;
+   }
+
+   return rast;
+
+fail:
+   sp_tile_rast_destroy(rast);
+   return NULL;
+}
+
+
+void
+sp_tile_rast_destroy(struct sp_tile_rast *rast)
+{
+   unsigned i;
+
+   /* Wake the threads up so they notice exit_flag and return. */
+   rast->exit_flag = TRUE;
+   for (i = 1; i <= rast->num_threads_started; i++)
+      pipe_semaphore_signal(&rast->thread[i].work_ready);
+
+   for (i = 1; i <= rast->num_threads_started; i++)
+      thrd_join(rast->threads[i], NULL);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      destroy_thread_data(rast->softpipe, &rast->thread[i]);
+      pipe_semaphore_destroy(&rast->thread[i].work_ready);
+      pipe_semaphore_destroy(&rast->thread[i].work_done);
+   }
+
+   FREE(rast->prims);
+   FREE(rast->tile_start);
+   FREE(rast->tile_prims);
+   FREE(rast);
+}
+
+
+/**
+ * Write the tiles the shares hold back to the surfaces, and/or forget
+ * their cached texture tiles with SP_FLUSH_TEXTURE_CACHE.
+ */
+void
+sp_tile_rast_flush(struct sp_tile_rast *rast, unsigned flags)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   unsigned i, j;
+
+   if (flags & SP_FLUSH_TEXTURE_CACHE) {
+      for (i = 0; i < rast->num_threads; i++) {
+         for (j = 0; j < rast->thread[i].num_tex_caches; j++) {
+            if (rast->thread[i].tex_cache[j])
+               sp_flush_tex_tile_cache(rast->thread[i].tex_cache[j]);
+         }
+      }
+   }
+
+   if (!rast->tiles_cached)
+      return;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_tile_cache_move_clears(sp->cbuf_cache[j],
+                                   thr->quad.cbuf_cache[j], 0, 1);
+      sp_tile_cache_move_clears(sp->zsbuf_cache, thr->quad.zsbuf_cache, 0, 1);
+
+      thr->busy = TRUE;
+   }
+
+   run_busy_shares(rast, SP_TILE_RAST_FLUSH);
+
+   rast->tiles_cached = FALSE;
+}
+
+
+/**
+ * Called when the framebuffer state changes, before the context's own
+ * tile caches are switched over.
+ */
+void
+sp_tile_rast_set_framebuffer(struct sp_tile_rast *rast,
+                             const struct pipe_framebuffer_state *fb)
+{
+   unsigned i, j;
+
+   sp_tile_rast_flush(rast, 0);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         struct pipe_surface *cb = j < fb->nr_cbufs ? fb->cbufs[j] : NULL;
+
+         if (sp_tile_cache_get_surface(thr->quad.cbuf_cache[j]) != cb)
+            sp_tile_cache_set_surface(thr->quad.cbuf_cache[j], cb);
+      }
+
+      if (sp_tile_cache_get_surface(thr->quad.zsbuf_cache) != fb->zsbuf)
+         sp_tile_cache_set_surface(thr->quad.zsbuf_cache, fb->zsbuf);
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant that is about to be deleted.
+ */
+void
+sp_tile_rast_release_fs_variant(struct sp_tile_rast *rast,
+                                const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      if (thr->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(thr->machine, NULL, NULL, NULL, NULL);
+         thr->fs_variant = NULL;
+      }
+   }
+}
+
+
+/**
+ * Start binning a batch of primitives, with the state set up by
+ * sp_setup_prepare().  Returns FALSE if the batch has to be rendered
+ * by the calling thread, through the context's own setup.
+ */
+boolean
+sp_tile_rast_begin(struct sp_tile_rast *rast)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   const struct sp_fragment_shader_variant *var = sp->fs_variant;
+   unsigned num_tiles, i, j;
+
+   rast->tiles_x = DIV_ROUND_UP(sp->framebuffer.width, TILE_SIZE);
+   rast->tiles_y = DIV_ROUND_UP(sp->framebuffer.height, TILE_SIZE);
+   num_tiles = rast->tiles_x * rast->tiles_y;
+
+   /* Fragment shaders with side effects would run once per tile touched
+    * rather than once per fragment, so render those single-threaded.
+    */
+   if (!var || var->info.writes_memory ||
+       sp->rasterizer->rasterizer_discard ||
+       num_tiles == 0 ||
+       !grow_array((void **) &rast->tile_start, &rast->max_tile_start,
+                   2 * num_tiles + 1, sizeof(unsigned)) ||
+       !grow_array((void **) &rast->tile_prims, &rast->max_tile_prims,
+                   num_tiles, sizeof(unsigned)) ||
+       !grow_array((void **) &rast->prims, &rast->max_prims,
+                   1, sizeof(struct sp_tile_prim)) ||
+       !update_samplers(rast)) {
+      sp_tile_rast_flush(rast, 0);
+      return FALSE;
+   }
+
+   if (!rast->tiles_cached) {
+      /* take the context's pending clears, and write its tiles out */
+      for (i = 0; i < rast->num_threads; i++) {
+         struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+         for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+            sp_tile_cache_move_clears(thr->quad.cbuf_cache[j],
+                                      sp->cbuf_cache[j], i, rast->num_threads);
+         sp_tile_cache_move_clears(thr->quad.zsbuf_cache, sp->zsbuf_cache,
+                                   i, rast->num_threads);
+      }
+
+      for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+         sp_flush_tile_cache(sp->cbuf_cache[i]);
+      sp_flush_tile_cache(sp->zsbuf_cache);
+
+      rast->tiles_cached = TRUE;
+   }
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      if (thr->fs_variant != var) {
+         var->prepare(var, thr->machine, &thr->sampler.base,
+                      (struct tgsi_image *) sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                      (struct tgsi_buffer *) sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+         thr->fs_variant = var;
+      }
+
+      sp_link_quad_pipeline(&thr->quad, sp->early_depth);
+      sp_setup_prepare(thr->setup);
+   }
+
+   memset(rast->tile_start, 0, (num_tiles + 1) * sizeof(unsigned));
+   rast->num_prims = 0;
+   rast->num_tile_prims = 0;
+
+   return TRUE;
+}
+
+
+/**
+ * Build the per-tile lists of the binned primitives and render them.
+ */
+static void
+render_batch(struct sp_tile_rast *rast)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   const unsigned num_tiles = rast->tiles_x * rast->tiles_y;
+   unsigned *tile_fill = rast->tile_start + num_tiles + 1;
+   unsigned t, p, tx, ty, i, j;
+
+   if (!rast->num_prims)
+      return;
+
+   for (t = 0; t < num_tiles; t++) {
+      rast->tile_start[t + 1] += rast->tile_start[t];
+      tile_fill[t] = rast->tile_start[t];
+   }
+
+   for (p = 0; p < rast->num_prims; p++) {
+      const struct sp_tile_prim *prim = &rast->prims[p];
+
+      for (ty = prim->ty0; ty <= prim->ty1; ty++) {
+         for (tx = prim->tx0; tx <= prim->tx1; tx++)
+            rast->tile_prims[tile_fill[ty * rast->tiles_x + tx]++] = p;
+      }
+   }
+
+   for (ty = 0; ty < rast->tiles_y; ty++) {
+      for (tx = 0; tx < rast->tiles_x; tx++) {
+         t = ty * rast->tiles_x + tx;
+         if (rast->tile_start[t] != rast->tile_start[t + 1])
+            rast->thread[(tx + ty) % rast->num_threads].busy = TRUE;
+      }
+   }
+
+   run_busy_shares(rast, SP_TILE_RAST_RENDER);
+
+   for (i = 0; i < rast->num_threads; i++) {
+      struct sp_tile_rast_thread *thr = &rast->thread[i];
+
+      sp->occlusion_count += thr->occlusion_count;
+      sp->pipeline_statistics.ps_invocations += thr->ps_invocations;
+      sp->pipeline_statistics.c_primitives += thr->c_primitives;
+      thr->occlusion_count = 0;
+      thr->ps_invocations = 0;
+      thr->c_primitives = 0;
+
+      for (j = 0; j < thr->num_tex_caches; j++) {
+         struct softpipe_tex_tile_cache *tc = thr->tex_cache[j];
+
+         if (tc) {
+            sp->tex_cache_hits += tc->hits;
+            sp->tex_cache_misses += tc->misses;
+            tc->hits = 0;
+            tc->misses = 0;
+         }
+      }
+   }
+
+   memset(rast->tile_start, 0, (num_tiles + 1) * sizeof(unsigned));
+   rast->num_prims = 0;
+   rast->num_tile_prims = 0;
+}
+
+
+/**
+ * Return the tile a window coordinate falls in, clamped to the
+ * framebuffer.
+ */
+static inline unsigned
+tile_index(float coord, unsigned num_tiles)
+{
+   if (coord <= 0.0f)
+      return 0;
+   if (coord >= (float) (num_tiles * TILE_SIZE))
+      return num_tiles - 1;
+   return (unsigned) coord / TILE_SIZE;
+}
+
+
+/**
+ * Bin a point (nr = 1), line (nr = 2) or triangle (nr = 3).  The vertices
+ * must stay valid until sp_tile_rast_end().
+ */
+void
+sp_tile_rast_bin(struct sp_tile_rast *rast, unsigned nr,
+                 const float (*v0)[4],
+                 const float (*v1)[4],
+                 const float (*v2)[4])
+{
+   const struct softpipe_context *sp = rast->softpipe;
+   struct sp_tile_prim *prim;
+   float xmin, xmax, ymin, ymax, margin;
+   unsigned tx, ty, n;
+
+   xmin = xmax = v0[0][0];
+   ymin = ymax = v0[0][1];
+   if (nr > 1) {
+      xmin = MIN2(xmin, v1[0][0]);
+      xmax = MAX2(xmax, v1[0][0]);
+      ymin = MIN2(ymin, v1[0][1]);
+      ymax = MAX2(ymax, v1[0][1]);
+   }
+   if (nr > 2) {
+      xmin = MIN2(xmin, v2[0][0]);
+      xmax = MAX2(xmax, v2[0][0]);
+      ymin = MIN2(ymin, v2[0][1]);
+      ymax = MAX2(ymax, v2[0][1]);
+   }
+
+   /* Setup rounds to pixels and 2x2 quads, and points extend by half
+    * their size.
+    */
+   if (nr == 1) {
+      const float size = sp->psize_slot > 0 ? v0[sp->psize_slot][0]
+                                            : sp->rasterizer->point_size;
+      margin = 0.5f * size + 2.0f;
+   }
+   else {
+      margin = 2.0f;
+   }
+
+   if (rast->num_prims == rast->max_prims &&
+       !grow_array((void **) &rast->prims, &rast->max_prims,
+                   rast->num_prims + 1, sizeof(struct sp_tile_prim)))
+      render_batch(rast);
+
+   prim = &rast->prims[rast->num_prims];
+   prim->v[0] = v0;
+   prim->v[1] = v1;
+   prim->v[2] = v2;
+   prim->nr = nr;
+
+   /* NaN positions or sizes could land anywhere, bin them everywhere */
+   if (xmin - margin <= xmax + margin && ymin - margin <= ymax + margin) {
+      prim->tx0 = tile_index(xmin - margin, rast->tiles_x);
+      prim->tx1 = tile_index(xmax + margin, rast->tiles_x);
+      prim->ty0 = tile_index(ymin - margin, rast->tiles_y);
+      prim->ty1 = tile_index(ymax + margin, rast->tiles_y);
+   }
+   else {
+      prim->tx0 = 0;
+      prim->tx1 = rast->tiles_x - 1;
+      prim->ty0 = 0;
+      prim->ty1 = rast->tiles_y - 1;
+   }
+
+   n = (prim->tx1 - prim->tx0 + 1) * (prim->ty1 - prim->ty0 + 1);
+   if (!grow_array((void **) &rast->tile_prims, &rast->max_tile_prims,
+                   rast->num_tile_prims + n, sizeof(unsigned))) {
+      /* there is always room for one primitive in an empty batch */
+      struct sp_tile_prim tmp = *prim;
+      render_batch(rast);
+      rast->prims[0] = tmp;
+      prim = &rast->prims[0];
+   }
+
+   for (ty = prim->ty0; ty <= prim->ty1; ty++) {
+      for (tx = prim->tx0; tx <= prim->tx1; tx++)
+         rast->tile_start[ty * rast->tiles_x + tx + 1]++;
+   }
+
+   rast->num_tile_prims += n;
+   rast->num_prims++;
+}
+
+
+/**
+ * Render the binned primitives and wait for them to be done.
+ */
+void
+sp_tile_rast_end(struct sp_tile_rast *rast)
+{
+   render_batch(rast);
+}
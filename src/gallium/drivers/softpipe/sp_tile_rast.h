@@ -0,0 +1,81 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Threaded tile rasterization.
+ *
+ * The primitives of each vbuf batch are binned by the TILE_SIZE screen
+ * tiles they touch, and the tiles are shaded in parallel.  Every tile
+ * position is always rendered by the same share of the work, which owns
+ * its own quad pipeline, shader machine and tile caches, so no two
+ * threads ever touch the same cached tile and each tile sees its
+ * primitives in submission order.
+ */
+
+#ifndef SP_TILE_RAST_H
+#define SP_TILE_RAST_H
+
+#include "pipe/p_compiler.h"
+
+
+struct pipe_framebuffer_state;
+struct softpipe_context;
+struct sp_fragment_shader_variant;
+struct sp_tile_rast;
+
+
+struct sp_tile_rast *
+sp_tile_rast_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_tile_rast_destroy(struct sp_tile_rast *rast);
+
+boolean
+sp_tile_rast_begin(struct sp_tile_rast *rast);
+
+void
+sp_tile_rast_bin(struct sp_tile_rast *rast, unsigned nr,
+                 const float (*v0)[4],
+                 const float (*v1)[4],
+                 const float (*v2)[4]);
+
+void
+sp_tile_rast_end(struct sp_tile_rast *rast);
+
+void
+sp_tile_rast_flush(struct sp_tile_rast *rast, unsigned flags);
+
+void
+sp_tile_rast_set_framebuffer(struct sp_tile_rast *rast,
+                             const struct pipe_framebuffer_state *fb);
+
+void
+sp_tile_rast_release_fs_variant(struct sp_tile_rast *rast,
+                                const struct sp_fragment_shader_variant *var);
+
+
+#endif /* SP_TILE_RAST_H */
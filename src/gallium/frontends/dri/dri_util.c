@@ -789,6 +789,21 @@ driSwapBuffers(__DRIdrawable *pdp)
     pdp->driScreenPriv->driver->SwapBuffers(pdp);
 }
 
+/**
+ * SwapBuffers with a damage region, for swrast drivers.  Drivers that
+ * can't limit presentation to the damage do a full swap.
+ */
+static void
+driSwapBuffersWithDamage(__DRIdrawable *pdp, int nrects, const int *rects)
+{
+    assert(pdp->driScreenPriv->swrast_loader);
+
+    if (pdp->driScreenPriv->driver->SwapBuffersWithDamage)
+        pdp->driScreenPriv->driver->SwapBuffersWithDamage(pdp, nrects, rects);
+    else
+        pdp->driScreenPriv->driver->SwapBuffers(pdp);
+}
+
 /** Core interface */
 const __DRIcoreExtension driCoreExtension = {
     .base = { __DRI_CORE, 2 },
@@ -838,13 +853,14 @@ const __DRIdri2Extension swkmsDRI2Extension = {
 };
 
 const __DRIswrastExtension driSWRastExtension = {
-    .base = { __DRI_SWRAST, 4 },
+    .base = { __DRI_SWRAST, 5 },
 
     .createNewScreen            = driSWRastCreateNewScreen,
     .createNewDrawable          = driCreateNewDrawable,
     .createNewContextForAPI     = driCreateNewContextForAPI,
     .createContextAttribs       = driCreateContextAttribs,
     .createNewScreen2           = driSWRastCreateNewScreen2,
+    .swapBuffersWithDamage      = driSwapBuffersWithDamage,
 };
 
 const __DRI2configQueryExtension dri2ConfigQueryExtension = {
@@ -142,6 +142,9 @@ struct __DriverAPIRec {
 
     void (*CopySubBuffer)(__DRIdrawable *driDrawPriv, int x, int y,
                           int w, int h);
+
+    void (*SwapBuffersWithDamage)(__DRIdrawable *driDrawPriv,
+                                  int nrects, const int *rects);
 };
 
 /**
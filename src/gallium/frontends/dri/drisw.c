@@ -42,6 +42,7 @@
 #include "dri_query_renderer.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(swrast_no_present, "SWRAST_NO_PRESENT", FALSE);
+DEBUG_GET_ONCE_BOOL_OPTION(swrast_present_damage, "SWRAST_PRESENT_DAMAGE", FALSE);
 
 static inline void
 get_drawable_info(__DRIdrawable *dPriv, int *x, int *y, int *w, int *h)
@@ -234,13 +235,31 @@ drisw_copy_to_front(struct pipe_context *pipe,
  * Backend functions for st_framebuffer interface and swap_buffers.
  */
 
+/**
+ * Get the parts of the back buffer that rendering changed since the last
+ * swap, if the driver can tell and presenting only those was asked for.
+ * Windows must then not lose their contents, as without a compositor.
+ */
+static bool
+drisw_get_back_damage(struct dri_context *ctx, struct dri_screen *screen,
+                      struct pipe_resource *ptex, struct pipe_box *damage)
+{
+   struct pipe_screen *pscreen = screen->base.screen;
+
+   return screen->swrast_present_damage && pscreen->resource_get_damage &&
+          pscreen->resource_get_damage(pscreen, ctx->st->pipe, ptex, damage);
+}
+
 static void
-drisw_swap_buffers(__DRIdrawable *dPriv)
+drisw_swap_buffers_with_damage(__DRIdrawable *dPriv, int nrects,
+                               const int *rects)
 {
    struct dri_context *ctx = dri_get_current(dPriv->driScreenPriv);
    struct dri_drawable *drawable = dri_drawable(dPriv);
    struct dri_screen *screen = dri_screen(drawable->sPriv);
    struct pipe_resource *ptex;
+   struct pipe_box damage;
+   bool damage_known;
 
    if (!ctx)
       return;
@@ -267,10 +286,52 @@ drisw_swap_buffers(__DRIdrawable *dPriv)
       screen->base.screen->fence_finish(screen->base.screen, ctx->st->pipe,
                                         fence, PIPE_TIMEOUT_INFINITE);
       screen->base.screen->fence_reference(screen->base.screen, &fence, NULL);
-      drisw_copy_to_front(ctx->st->pipe, dPriv, ptex);
+
+      damage_known = drisw_get_back_damage(ctx, screen, ptex, &damage);
+
+      if (nrects > 0) {
+         /* Only send the damaged rectangles, clipped to the drawable and
+          * to what actually changed.
+          */
+         for (int i = 0; i < nrects; i++) {
+            const int *rect = &rects[i * 4];
+            int x0 = MAX2(rect[0], 0);
+            int y0 = MAX2(dPriv->h - rect[1] - rect[3], 0);
+            int x1 = MIN2(rect[0] + rect[2], dPriv->w);
+            int y1 = MIN2(dPriv->h - rect[1], dPriv->h);
+            struct pipe_box box;
+
+            if (damage_known) {
+               x0 = MAX2(x0, damage.x);
+               y0 = MAX2(y0, damage.y);
+               x1 = MIN2(x1, damage.x + damage.width);
+               y1 = MIN2(y1, damage.y + damage.height);
+            }
+
+            if (x0 >= x1 || y0 >= y1)
+               continue;
+
+            u_box_2d(x0, y0, x1 - x0, y1 - y0, &box);
+            drisw_present_texture(ctx->st->pipe, dPriv, ptex, &box);
+         }
+
+         drisw_invalidate_drawable(dPriv);
+      } else if (damage_known) {
+         if (damage.width && damage.height)
+            drisw_present_texture(ctx->st->pipe, dPriv, ptex, &damage);
+         drisw_invalidate_drawable(dPriv);
+      } else {
+         drisw_copy_to_front(ctx->st->pipe, dPriv, ptex);
+      }
    }
 }
 
+static void
+drisw_swap_buffers(__DRIdrawable *dPriv)
+{
+   drisw_swap_buffers_with_damage(dPriv, 0, NULL);
+}
+
 static void
 drisw_copy_sub_buffer(__DRIdrawable *dPriv, int x, int y,
                       int w, int h)
@@ -529,6 +590,7 @@ drisw_init_screen(__DRIscreen * sPriv)
    screen->fd = -1;
 
    screen->swrast_no_present = debug_get_option_swrast_no_present();
+   screen->swrast_present_damage = debug_get_option_swrast_present_damage();
 
    sPriv->driverPrivate = (void *)screen;
 
@@ -607,6 +669,7 @@ const struct __DriverAPIRec galliumsw_driver_api = {
    .DestroyBuffer = dri_destroy_buffer,
    .SwapBuffers = drisw_swap_buffers,
    .CopySubBuffer = drisw_copy_sub_buffer,
+   .SwapBuffersWithDamage = drisw_swap_buffers_with_damage,
 };
 
 static const struct __DRIDriverVtableExtensionRec galliumsw_vtable = {
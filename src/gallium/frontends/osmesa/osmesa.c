@@ -41,6 +41,11 @@
  * Because of these constraints we always render into ordinary resources then
  * copy the results to the user's buffer in the flush_front() function which
  * is called when the app calls glFlush/Finish.
+ * With OSMESA_COPY_DAMAGE set and a driver which can tell
+ * (pipe_screen::resource_get_damage), only the parts of the color buffer
+ * which changed since the previous copy to the same buffer are copied.
+ * That is off by default since it doesn't undo what the application
+ * wrote to the buffer itself between flushes.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -73,6 +78,8 @@
 #include "state_tracker/st_gl_api.h"
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(osmesa_copy_damage, "OSMESA_COPY_DAMAGE", false)
+
 
 extern struct pipe_screen *
 osmesa_create_screen(void);
@@ -89,6 +96,11 @@ struct osmesa_buffer
 
    void *map;
 
+   /* Where the color buffer was last copied to, see flush_front() */
+   void *copied_map;
+   int copied_stride;
+   boolean copied_y_up;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -188,35 +200,43 @@ get_st_api(void)
 }
 
 /* Reads the color or depth buffer from the backing context to either the user storage
- * (color buffer) or our temporary (z/s)
+ * (color buffer) or our temporary (z/s).  Only the given box is read, or all
+ * of the buffer if box is NULL.
  */
 static void
 osmesa_read_buffer(OSMesaContext osmesa, struct pipe_resource *res, void *dst,
-                   int dst_stride, bool y_up)
+                   int dst_stride, bool y_up, const struct pipe_box *box)
 {
    struct pipe_context *pipe = osmesa->stctx->pipe;
 
-   struct pipe_box box;
-   u_box_2d(0, 0, res->width0, res->height0, &box);
+   struct pipe_box full;
+   if (!box) {
+      u_box_2d(0, 0, res->width0, res->height0, &full);
+      box = &full;
+   }
 
    struct pipe_transfer *transfer = NULL;
-   ubyte *src = pipe->texture_map(pipe, res, 0, PIPE_MAP_READ, &box,
+   ubyte *src = pipe->texture_map(pipe, res, 0, PIPE_MAP_READ, box,
                                    &transfer);
 
    /*
     * Copy the color buffer from the resource to the user's buffer.
     */
 
+   unsigned bpp = util_format_get_blocksize(res->format);
+   dst = (ubyte *)dst + box->x * bpp;
+
    if (y_up) {
       /* need to flip image upside down */
-      dst = (ubyte *)dst + (res->height0 - 1) * dst_stride;
+      dst = (ubyte *)dst + (res->height0 - 1 - box->y) * dst_stride;
       dst_stride = -dst_stride;
+   } else {
+      dst = (ubyte *)dst + box->y * dst_stride;
    }
 
-   unsigned bpp = util_format_get_blocksize(res->format);
-   for (unsigned y = 0; y < res->height0; y++)
+   for (int y = 0; y < box->height; y++)
    {
-      memcpy(dst, src, bpp * res->width0);
+      memcpy(dst, src, bpp * box->width);
       dst = (ubyte *)dst + dst_stride;
       src += transfer->stride;
    }
@@ -398,12 +418,30 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    else
       dst_stride = bpp * osbuffer->width;
 
-   osmesa_read_buffer(osmesa, res, osbuffer->map, dst_stride, osmesa->y_up);
+   /* Only copy what changed since the last copy to the same place. */
+   struct pipe_screen *screen = res->screen;
+   struct pipe_box damage;
+   if (debug_get_option_osmesa_copy_damage() &&
+       screen->resource_get_damage &&
+       screen->resource_get_damage(screen, stctx->pipe, res, &damage) &&
+       osbuffer->copied_map == osbuffer->map &&
+       osbuffer->copied_stride == dst_stride &&
+       osbuffer->copied_y_up == osmesa->y_up) {
+      if (damage.width && damage.height)
+         osmesa_read_buffer(osmesa, res, osbuffer->map, dst_stride,
+                            osmesa->y_up, &damage);
+   } else {
+      osmesa_read_buffer(osmesa, res, osbuffer->map, dst_stride,
+                         osmesa->y_up, NULL);
+      osbuffer->copied_map = osbuffer->map;
+      osbuffer->copied_stride = dst_stride;
+      osbuffer->copied_y_up = osmesa->y_up;
+   }
 
    /* If the user has requested the Z/S buffer, then snapshot that one too. */
    if (osmesa->zs) {
       osmesa_read_buffer(osmesa, osbuffer->textures[ST_ATTACHMENT_DEPTH_STENCIL],
-                         osmesa->zs, osmesa->zs_stride, true);
+                         osmesa->zs, osmesa->zs_stride, true, NULL);
    }
 
    return true;
@@ -941,7 +979,7 @@ OSMesaGetDepthBuffer(OSMesaContext c, GLint *width, GLint *height,
       if (!c->zs)
          return GL_FALSE;
 
-      osmesa_read_buffer(c, res, c->zs, c->zs_stride, true);
+      osmesa_read_buffer(c, res, c->zs, c->zs_stride, true, NULL);
    }
 
    *buffer = c->zs;
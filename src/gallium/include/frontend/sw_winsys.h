@@ -35,6 +35,7 @@
 #define SW_WINSYS_H
 
 
+#include "pipe/p_defines.h"
 #include "pipe/p_format.h"
 #include "frontend/winsys_handle.h"
 
@@ -53,6 +54,12 @@ struct pipe_box;
  */
 struct sw_displaytarget;
 
+/**
+ * displaytarget_map flag: everything written through the mapping is
+ * reported with displaytarget_damage before it is unmapped.
+ */
+#define SW_MAP_DAMAGE (PIPE_MAP_DRV_PRV << 0)
+
 
 /**
  * This is the interface that sw expects any window system
@@ -120,6 +127,19 @@ struct sw_winsys
    (*displaytarget_unmap)( struct sw_winsys *ws,
                            struct sw_displaytarget *dt );
 
+   /**
+    * Optional.  Report which parts of a display target mapped for writing
+    * with SW_MAP_DAMAGE have been written, so that a winsys which renders
+    * into a copy of the display target only writes those back.  Other
+    * write mappings are written back whole.  May be called from another
+    * thread than the one that mapped the display target.
+    */
+   void
+   (*displaytarget_damage)( struct sw_winsys *ws,
+                            struct sw_displaytarget *dt,
+                            const struct pipe_box *boxes,
+                            unsigned num_boxes );
+
    /**
     * @sa pipe_screen:flush_frontbuffer.
     *
@@ -1017,6 +1017,7 @@ enum pipe_texture_transfer_mode {
    PIPE_TEXTURE_TRANSFER_DEFAULT = 0,
    PIPE_TEXTURE_TRANSFER_BLIT = (1 << 0),
    PIPE_TEXTURE_TRANSFER_COMPUTE = (1 << 1),
+   PIPE_TEXTURE_TRANSFER_PBO_DOWNLOAD = (1 << 2),
 };
 
 /**
@@ -546,6 +546,20 @@ struct pipe_screen {
                              unsigned int nrects,
                              const struct pipe_box *rects);
 
+   /**
+    * Optional. Return the bounding box of the parts of a 2D resource whose
+    * contents changed since the previous call, after finishing the
+    * rendering of ctx to it. An empty box means nothing changed.
+    *
+    * Returns false when the driver can't tell, which is always the case
+    * for the first call on a resource; everything must then be assumed
+    * changed.
+    */
+   bool (*resource_get_damage)(struct pipe_screen *screen,
+                               struct pipe_context *ctx,
+                               struct pipe_resource *resource,
+                               struct pipe_box *box);
+
    /**
     * Run driver-specific NIR lowering and optimization passes.
     *
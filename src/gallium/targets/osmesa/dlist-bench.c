@@ -0,0 +1,150 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Replay time of display lists made of many small objects that each set
+ * their state again before drawing, the way old visualisation code builds
+ * them.  The triangles are tiny, so this mostly measures the cost of
+ * glCallList itself.  Run with MESA_NO_DLIST_OPTIMIZE=1 to compare with
+ * the lists as compiled.
+ *
+ * Usage: ./osmesa-dlist-bench [objects [replays]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "GL/osmesa.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+
+#define SIZE 64
+
+
+/**
+ * Every object re-enables the same state and draws a triangle strip with
+ * per-vertex colors.
+ */
+static void
+redundant_state(unsigned i)
+{
+   const float x = (i % SIZE) * 2.0f / SIZE - 1.0f;
+   const float y = (i / SIZE % SIZE) * 2.0f / SIZE - 1.0f;
+
+   glEnable(GL_DEPTH_TEST);
+   glDisable(GL_LIGHTING);
+   glLineWidth(1.0f);
+   glDepthMask(GL_TRUE);
+
+   glBegin(GL_TRIANGLE_STRIP);
+   for (unsigned v = 0; v < 4; v++) {
+      glColor3f((i & 0xff) / 255.0f, v / 3.0f, 0.5f);
+      glVertex3f(x + (v & 1) * 0.01f, y + (v >> 1) * 0.01f, 0.5f);
+   }
+   glEnd();
+}
+
+
+/**
+ * Like redundant_state(), but with a per-object normal and lighting, so
+ * only the repeated state can go.
+ */
+static void
+lit_objects(unsigned i)
+{
+   const float x = (i % SIZE) * 2.0f / SIZE - 1.0f;
+   const float y = (i / SIZE % SIZE) * 2.0f / SIZE - 1.0f;
+
+   glEnable(GL_LIGHTING);
+   glEnable(GL_LIGHT0);
+   glNormal3f(0.0f, (i & 1) ? 0.6f : 0.0f, (i & 1) ? 0.8f : 1.0f);
+
+   glBegin(GL_TRIANGLES);
+   glVertex3f(x, y, 0.5f);
+   glVertex3f(x + 0.01f, y, 0.5f);
+   glVertex3f(x, y + 0.01f, 0.5f);
+   glEnd();
+}
+
+
+static const struct {
+   const char *name;
+   void (*emit)(unsigned i);
+} scenes[] = {
+   { "redundant state", redundant_state },
+   { "lit objects", lit_objects },
+};
+
+
+int main(int argc, char **argv)
+{
+   unsigned objects = argc > 1 ? atoi(argv[1]) : 20000;
+   unsigned replays = argc > 2 ? atoi(argv[2]) : 200;
+   static uint32_t pixels[SIZE * SIZE];
+   OSMesaContext ctx;
+   unsigned i, j;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, pixels, GL_UNSIGNED_BYTE, SIZE, SIZE))
+      return 1;
+
+   printf("%-24s %10s %10s %10s\n", "scene", "compile ms", "replay ms",
+          "Mtri/s");
+
+   for (i = 0; i < ARRAY_SIZE(scenes); i++) {
+      const unsigned tris_per_object = 2 - i;
+      int64_t start;
+      double compile, replay;
+
+      start = os_time_get_nano();
+      glNewList(1, GL_COMPILE);
+      for (j = 0; j < objects; j++)
+         scenes[i].emit(j);
+      glEndList();
+      compile = (os_time_get_nano() - start) / 1e9;
+
+      /* warm up */
+      glCallList(1);
+      glFinish();
+
+      start = os_time_get_nano();
+      for (j = 0; j < replays; j++) {
+         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+         glCallList(1);
+      }
+      glFinish();
+      replay = (os_time_get_nano() - start) / 1e9 / replays;
+
+      printf("%-24s %10.2f %10.3f %10.2f\n", scenes[i].name, compile * 1e3,
+             replay * 1e3, objects * tris_per_object / replay / 1e6);
+
+      glDeleteLists(1, 1);
+   }
+
+   if (glGetError() != GL_NO_ERROR) {
+      printf("GL error\n");
+      return 1;
+   }
+
+   OSMesaDestroyContext(ctx);
+   return 0;
+}
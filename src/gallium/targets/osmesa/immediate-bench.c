@@ -0,0 +1,163 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Throughput of immediate mode the way plotting code uses it: lots of
+ * short glBegin/glEnd pairs with a color, and sometimes a normal, per
+ * vertex.  Rasterization is discarded, so this measures the glVertex path
+ * and how many draws the glBegin/glEnd pairs turn into.
+ *
+ * Usage: ./osmesa-immediate-bench [pairs [frames]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "GL/osmesa.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+
+#define SIZE 64
+
+
+/**
+ * An 8-vertex line strip with per-vertex colors, like one curve of a plot.
+ */
+static unsigned
+line_strips(unsigned i)
+{
+   const float y = (i % SIZE) * 2.0f / SIZE - 1.0f;
+
+   glBegin(GL_LINE_STRIP);
+   for (unsigned v = 0; v < 8; v++) {
+      glColor4f((i & 0xff) / 255.0f, v / 7.0f, 0.5f, 1.0f);
+      glVertex2f(v / 4.0f - 1.0f, y + (v & 1) * 0.01f);
+   }
+   glEnd();
+
+   return 8;
+}
+
+
+/**
+ * A row of points with nothing but a position.
+ */
+static unsigned
+points(unsigned i)
+{
+   const float y = (i % SIZE) * 2.0f / SIZE - 1.0f;
+
+   glBegin(GL_POINTS);
+   for (unsigned v = 0; v < SIZE; v++)
+      glVertex2f(v * 2.0f / SIZE - 1.0f, y);
+   glEnd();
+
+   return SIZE;
+}
+
+
+/**
+ * A lit triangle fan with a color and a normal per vertex.
+ */
+static unsigned
+lit_fans(unsigned i)
+{
+   const float x = (i % SIZE) * 2.0f / SIZE - 1.0f;
+   const float y = (i / SIZE % SIZE) * 2.0f / SIZE - 1.0f;
+
+   glBegin(GL_TRIANGLE_FAN);
+   for (unsigned v = 0; v < 6; v++) {
+      glColor3f((i & 0xff) / 255.0f, v / 5.0f, 0.5f);
+      glNormal3f(0.0f, (v & 1) ? 0.6f : 0.0f, (v & 1) ? 0.8f : 1.0f);
+      glVertex3f(x + (v & 1) * 0.01f, y + (v >> 1) * 0.01f, 0.5f);
+   }
+   glEnd();
+
+   return 6;
+}
+
+
+static const struct {
+   const char *name;
+   bool lighting;
+   unsigned (*emit)(unsigned i);
+} scenes[] = {
+   { "line strips", false, line_strips },
+   { "points", false, points },
+   { "lit fans", true, lit_fans },
+};
+
+
+int main(int argc, char **argv)
+{
+   unsigned pairs = argc > 1 ? atoi(argv[1]) : 100000;
+   unsigned frames = argc > 2 ? atoi(argv[2]) : 20;
+   static uint32_t pixels[SIZE * SIZE];
+   OSMesaContext ctx;
+   unsigned i, j, k;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, pixels, GL_UNSIGNED_BYTE, SIZE, SIZE))
+      return 1;
+
+   glEnable(GL_RASTERIZER_DISCARD);
+   glEnable(GL_LIGHT0);
+   glEnable(GL_COLOR_MATERIAL);
+
+   printf("%-24s %10s %10s\n", "scene", "frame ms", "Mvert/s");
+
+   for (i = 0; i < ARRAY_SIZE(scenes); i++) {
+      uint64_t vertices = 0;
+      int64_t start;
+      double t;
+
+      if (scenes[i].lighting)
+         glEnable(GL_LIGHTING);
+      else
+         glDisable(GL_LIGHTING);
+
+      /* warm up */
+      for (j = 0; j < pairs; j++)
+         scenes[i].emit(j);
+      glFinish();
+
+      start = os_time_get_nano();
+      for (k = 0; k < frames; k++) {
+         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+         for (j = 0; j < pairs; j++)
+            vertices += scenes[i].emit(j);
+      }
+      glFinish();
+      t = (os_time_get_nano() - start) / 1e9;
+
+      printf("%-24s %10.2f %10.2f\n", scenes[i].name, t * 1e3 / frames,
+             vertices / t / 1e6);
+   }
+
+   if (glGetError() != GL_NO_ERROR) {
+      printf("GL error\n");
+      return 1;
+   }
+
+   OSMesaDestroyContext(ctx);
+   return 0;
+}
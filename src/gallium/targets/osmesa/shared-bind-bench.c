@@ -0,0 +1,150 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Object binding throughput of several contexts that share their objects,
+ * each bound to its own thread, the way multi-threaded loaders and
+ * compositors use them.  Every bind looks the name up in the shared
+ * tables, so this mostly measures how well those lookups scale with the
+ * number of threads.
+ *
+ * Usage: ./osmesa-shared-bind-bench [binds [objects]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#define GL_GLEXT_PROTOTYPES
+#include "GL/osmesa.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/u_thread.h"
+
+#define SIZE 16
+#define MAX_THREADS 8
+
+struct bench_thread {
+   OSMesaContext ctx;
+   uint32_t pixels[SIZE * SIZE];
+   int64_t time;
+   bool error;
+};
+
+static unsigned binds, objects;
+static GLuint *textures, *buffers;
+static util_barrier start;
+
+
+static int
+bind_objects(void *data)
+{
+   struct bench_thread *t = data;
+   int64_t begin;
+   unsigned i;
+
+   if (!OSMesaMakeCurrent(t->ctx, t->pixels, GL_UNSIGNED_BYTE, SIZE, SIZE)) {
+      t->error = true;
+      util_barrier_wait(&start);
+      return 0;
+   }
+
+   util_barrier_wait(&start);
+
+   begin = os_time_get_nano();
+   for (i = 0; i < binds; i++) {
+      glBindTexture(GL_TEXTURE_2D, textures[i % objects]);
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[i % objects]);
+   }
+   t->time = os_time_get_nano() - begin;
+
+   t->error = glGetError() != GL_NO_ERROR;
+   OSMesaMakeCurrent(NULL, NULL, 0, 0, 0);
+   return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+   static struct bench_thread threads[MAX_THREADS];
+   static uint32_t pixels[SIZE * SIZE];
+   OSMesaContext ctx;
+   unsigned i, n;
+
+   binds = argc > 1 ? atoi(argv[1]) : 1000000;
+   objects = argc > 2 ? atoi(argv[2]) : 256;
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, pixels, GL_UNSIGNED_BYTE, SIZE, SIZE))
+      return 1;
+
+   textures = calloc(objects, sizeof(*textures));
+   buffers = calloc(objects, sizeof(*buffers));
+   if (!textures || !buffers)
+      return 1;
+
+   /* the first bind creates the objects */
+   glGenTextures(objects, textures);
+   glGenBuffers(objects, buffers);
+   for (i = 0; i < objects; i++) {
+      glBindTexture(GL_TEXTURE_2D, textures[i]);
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+   }
+   glFinish();
+
+   printf("%-8s %10s %12s\n", "threads", "ms", "Mbinds/s");
+
+   for (n = 1; n <= MAX_THREADS; n *= 2) {
+      thrd_t handles[MAX_THREADS];
+      int64_t time = 0;
+
+      for (i = 0; i < n; i++) {
+         threads[i].ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, ctx);
+         if (!threads[i].ctx)
+            return 1;
+      }
+
+      util_barrier_init(&start, n);
+      for (i = 0; i < n; i++)
+         handles[i] = u_thread_create(bind_objects, &threads[i]);
+      for (i = 0; i < n; i++) {
+         thrd_join(handles[i], NULL);
+         time = MAX2(time, threads[i].time);
+         if (threads[i].error) {
+            printf("GL error\n");
+            return 1;
+         }
+         OSMesaDestroyContext(threads[i].ctx);
+      }
+      util_barrier_destroy(&start);
+
+      /* two binds per iteration */
+      printf("%-8u %10.2f %12.2f\n", n, time / 1e6,
+             2.0 * binds * n / (time / 1e9) / 1e6);
+   }
+
+   glDeleteTextures(objects, textures);
+   glDeleteBuffers(objects, buffers);
+   free(textures);
+   free(buffers);
+   OSMesaDestroyContext(ctx);
+   return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Render display lists that the glEndList optimizer rewrites, and compare
+ * them with the same lists rendered with MESA_NO_DLIST_OPTIMIZE=1.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "GL/osmesa.h"
+#include "util/macros.h"
+
+#define WIDTH 64
+#define HEIGHT 64
+#define GRID 16
+#define NUM_OBJECTS (GRID * GRID)
+
+struct dlist_case {
+   const char *name;
+   void (*setup)(void);
+   void (*object)(unsigned i);
+};
+
+static float
+object_x(unsigned i)
+{
+   return (i % GRID) * 2.0f / GRID - 1.0f;
+}
+
+static float
+object_y(unsigned i)
+{
+   return (i / GRID) * 2.0f / GRID - 1.0f;
+}
+
+/* A triangle in the cell of object i, with a color per vertex if given. */
+static void
+triangle(unsigned i, unsigned corner, const float (*colors)[3])
+{
+   const float x = object_x(i), y = object_y(i), s = 1.5f / GRID;
+
+   glBegin(GL_TRIANGLES);
+   for (unsigned v = 0; v < 3; v++) {
+      if (colors)
+         glColor3fv(colors[v]);
+      glVertex3f(x + (corner ? s - (v & 1) * s : (v & 1) * s),
+                 y + (v >> 1) * s, (i % 7) / 7.0f - 0.5f);
+   }
+   glEnd();
+}
+
+static void
+no_setup(void)
+{
+}
+
+/* Every object sets the same state again, some of it twice in a row. */
+static void
+redundant_state_object(unsigned i)
+{
+   const float colors[3][3] = {
+      { (i & 0xff) / 255.0f, 0.0f, 0.5f },
+      { 0.5f, (i & 0xf) / 15.0f, 0.0f },
+      { 0.0f, 0.5f, 1.0f },
+   };
+
+   glEnable(GL_DEPTH_TEST);
+   glDisable(GL_LIGHTING);
+   glDepthMask(i % 3 != 0);
+   glShadeModel(GL_SMOOTH);
+   glShadeModel(i % 5 ? GL_SMOOTH : GL_FLAT);
+   glColor3f(1.0f, 0.0f, 0.0f);
+   glColor3f(0.25f, (i & 0xf) / 15.0f, 0.75f);
+
+   triangle(i, 0, i & 1 ? colors : NULL);
+   triangle(i, 1, NULL);
+}
+
+/* Vertex lists that copy their last color to the current color, followed
+ * by ones that draw with it.
+ */
+static void
+copy_current_object(unsigned i)
+{
+   const float colors[3][3] = {
+      { 1.0f, 0.0f, 0.0f },
+      { 0.0f, 1.0f, 0.0f },
+      { (i & 0xf) / 15.0f, 0.0f, (i >> 4) / 15.0f },
+   };
+
+   /* overwritten by the vertex list */
+   glColor3f(0.5f, 0.5f, 0.5f);
+   triangle(i, 0, colors);
+
+   /* redundant after the first object, but splits the vertex lists */
+   glEnable(GL_DEPTH_TEST);
+   triangle(i, 1, NULL);
+}
+
+static void
+color_material_setup(void)
+{
+   const float light[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+
+   glLightfv(GL_LIGHT0, GL_POSITION, light);
+   glEnable(GL_LIGHT0);
+   glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+}
+
+/* With GL_COLOR_MATERIAL, the current color also becomes the material each
+ * time it changes.  The material is set apart from the color first, by
+ * a glMaterial between glBegin and glEnd, so that a missed change of the
+ * current color shows up as the wrong material.
+ */
+static void
+color_material_object(unsigned i)
+{
+   const float base[3] = { 0.25f, 0.5f, (i & 0xf) / 15.0f };
+   const float material[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
+   const float to_base[3][3] = {
+      { 1.0f, 1.0f, 0.0f },
+      { 0.0f, 1.0f, 1.0f },
+      { base[0], base[1], base[2] },
+   };
+   const float to_other[3][3] = {
+      { 0.0f, 0.0f, 1.0f },
+      { 1.0f, 0.0f, 0.0f },
+      { 0.0f, 1.0f, (i >> 4) / 15.0f },
+   };
+
+   glEnable(GL_LIGHTING);
+   glEnable(GL_COLOR_MATERIAL);
+   glNormal3f(0.0f, 0.0f, 1.0f);
+   glColor3fv(base);
+
+   glBegin(GL_POINTS);
+   glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, material);
+   glVertex3f(2.0f, 2.0f, 0.0f);
+   glEnd();
+
+   switch (i % 3) {
+   case 0:
+      /* Reaches the material before the vertex list is drawn, which then
+       * sets the color back to base.
+       */
+      glColor3f(0.0f, 0.0f, 0.0f);
+      triangle(i, 0, to_base);
+      break;
+   case 1:
+      /* Two vertex lists that can be merged.  Only the first one changes
+       * the current color, the second one sets it back to base.
+       */
+      triangle(i, 0, to_other);
+      glEnable(GL_LIGHTING);
+      triangle(i, 0, to_base);
+      break;
+   default:
+      /* Sets the color to what it already is. */
+      glColor3fv(base);
+      break;
+   }
+
+   glEnable(GL_LIGHTING);
+   triangle(i, 1, NULL);
+
+   if (i % 4 == 3) {
+      glDisable(GL_COLOR_MATERIAL);
+      glColor3f(1.0f, 1.0f, 1.0f);
+      glEnable(GL_COLOR_MATERIAL);
+   }
+}
+
+static const struct dlist_case cases[] = {
+   { "redundant_state", no_setup, redundant_state_object },
+   { "copy_current", no_setup, copy_current_object },
+   { "color_material", color_material_setup, color_material_object },
+};
+
+/* Compile the objects of a case into a list, and render it twice. */
+static bool
+render(const struct dlist_case *c, uint32_t *pixels)
+{
+   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+
+   if (!ctx || !OSMesaMakeCurrent(ctx, pixels, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT))
+      return false;
+
+   c->setup();
+
+   GLuint list = glGenLists(1);
+   glNewList(list, GL_COMPILE);
+   for (unsigned i = 0; i < NUM_OBJECTS; i++)
+      c->object(i);
+   glEndList();
+
+   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   glCallList(list);
+
+   /* again, starting from the state the list left */
+   glMatrixMode(GL_MODELVIEW);
+   glTranslatef(0.5f / GRID, 0.5f / GRID, 0.0f);
+   glCallList(list);
+   glFinish();
+
+   glDeleteLists(list, 1);
+   OSMesaDestroyContext(ctx);
+   return true;
+}
+
+TEST(OSMesaDlistTest, matches_unoptimized)
+{
+   const size_t image_size = WIDTH * HEIGHT;
+   const size_t size = ARRAY_SIZE(cases) * image_size * sizeof(uint32_t);
+
+   /* MESA_NO_DLIST_OPTIMIZE is read once per process, so the reference
+    * images come from a child that sets it before compiling any list.
+    */
+   uint32_t *reference = (uint32_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   ASSERT_NE(reference, MAP_FAILED);
+
+   pid_t pid = fork();
+   ASSERT_NE(pid, -1);
+   if (pid == 0) {
+      setenv("MESA_NO_DLIST_OPTIMIZE", "1", 1);
+      for (unsigned i = 0; i < ARRAY_SIZE(cases); i++) {
+         if (!render(&cases[i], reference + i * image_size))
+            _exit(1);
+      }
+      _exit(0);
+   }
+
+   int status;
+   ASSERT_EQ(waitpid(pid, &status, 0), pid);
+   ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(cases); i++) {
+      static uint32_t pixels[WIDTH * HEIGHT];
+      unsigned differ = 0, drawn = 0;
+
+      ASSERT_TRUE(render(&cases[i], pixels));
+
+      for (unsigned p = 0; p < image_size; p++) {
+         differ += pixels[p] != reference[i * image_size + p];
+         drawn += pixels[p] != 0;
+      }
+
+      EXPECT_EQ(differ, 0u) << cases[i].name;
+      EXPECT_GT(drawn, image_size / 8) << cases[i].name;
+   }
+
+   munmap(reference, size);
+}
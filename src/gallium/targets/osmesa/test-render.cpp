@@ -308,3 +308,50 @@ TEST(OSMesaRenderTest, resize)
       EXPECT_EQ(draw2[i], be_bswap32(0x0000ff00));
    EXPECT_EQ(draw1[0], be_bswap32(0x000000ff));
 }
+
+/* glVertex must write the right vertex when the vertex layout changes
+ * within a primitive, and in a glBegin/glEnd pair batched with the
+ * previous one.
+ */
+TEST(OSMesaRenderTest, immediate_vertex_layouts)
+{
+   std::unique_ptr<osmesa_context, decltype(&OSMesaDestroyContext)> ctx{
+      OSMesaCreateContext(GL_RGBA, NULL), &OSMesaDestroyContext};
+   ASSERT_TRUE(ctx);
+
+   const int w = 8;
+   uint8_t pixels[w * 4];
+   ASSERT_EQ(OSMesaMakeCurrent(ctx.get(), pixels, GL_UNSIGNED_BYTE, w, 1), GL_TRUE);
+
+   glClearColor(0.0, 0.0, 0.0, 0.0);
+   glClear(GL_COLOR_BUFFER_BIT);
+
+#define X(i) (((i) + 0.5f) * 2.0f / w - 1.0f)
+#define RED(i) glColor4ub(((i) + 1) * 0x10, 0, 0, 0xff)
+   const GLfloat v1[2] = { X(1), 0 };
+   const GLfloat v3[3] = { X(3), 0, 0 };
+
+   glBegin(GL_POINTS);
+   RED(0); glVertex2f(X(0), 0);
+   RED(1); glVertex2fv(v1);
+   /* the position grows to 3 floats */
+   RED(2); glVertex3f(X(2), 0, 0);
+   RED(3); glVertex3fv(v3);
+   RED(4); glVertex2f(X(4), 0);
+   /* a new attribute before the position */
+   glTexCoord2f(0, 0);
+   RED(5); glVertex3f(X(5), 0, 0);
+   glEnd();
+
+   /* starts with the layout of the previous primitive */
+   glBegin(GL_POINTS);
+   RED(6); glVertex3f(X(6), 0, 0);
+   RED(7); glVertex2f(X(7), 0);
+   glEnd();
+   glFinish();
+#undef RED
+#undef X
+
+   for (unsigned i = 0; i < w; i++)
+      EXPECT_EQ(pixels[i * 4], (i + 1) * 0x10) << "pixel " << i;
+}
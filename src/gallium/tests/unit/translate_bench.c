@@ -0,0 +1,197 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex throughput of the translate implementations over a few common
+ * vertex layouts, converted to float4 outputs the way draw fetches them.
+ * The x86 results are also checked against translate_generic.
+ *
+ * Usage: ./translate_bench [vertices]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "translate/translate.h"
+#include "translate/translate_cache.h"
+#include "util/u_memory.h"
+#include "util/format/u_format.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+
+struct layout {
+   const char *name;
+   unsigned nr_elements;
+   enum pipe_format formats[4];
+};
+
+static const struct layout layouts[] = {
+   { "pos3f normal3f uv2f", 3,
+     { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT,
+       PIPE_FORMAT_R32G32_FLOAT } },
+   { "pos3f color4ub uv2f", 3,
+     { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R8G8B8A8_UNORM,
+       PIPE_FORMAT_R32G32_FLOAT } },
+   { "pos4h normal10_10_10_2 uv2h", 3,
+     { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R10G10B10A2_SNORM,
+       PIPE_FORMAT_R16G16_FLOAT } },
+   { "pos3s normal4b uv2us color10_10_10_2", 4,
+     { PIPE_FORMAT_R16G16B16_SNORM, PIPE_FORMAT_R8G8B8A8_SNORM,
+       PIPE_FORMAT_R16G16_UNORM, PIPE_FORMAT_B10G10R10A2_UNORM } },
+   { "pos3d color4f", 2,
+     { PIPE_FORMAT_R64G64B64_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT } },
+};
+
+
+static void
+make_key(const struct layout *layout, struct translate_key *key,
+         unsigned *input_stride)
+{
+   unsigned i, offset = 0;
+
+   memset(key, 0, sizeof(*key));
+   key->nr_elements = layout->nr_elements;
+   key->output_stride = layout->nr_elements * 4 * sizeof(float);
+
+   for (i = 0; i < layout->nr_elements; i++) {
+      key->element[i].type = TRANSLATE_ELEMENT_NORMAL;
+      key->element[i].input_format = layout->formats[i];
+      key->element[i].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+      key->element[i].input_buffer = 0;
+      key->element[i].input_offset = offset;
+      key->element[i].output_offset = i * 4 * sizeof(float);
+      offset += util_format_get_blocksize(layout->formats[i]);
+   }
+
+   *input_stride = offset;
+}
+
+
+static double
+run(struct translate *translate, const unsigned *elts, unsigned count,
+    void *output)
+{
+   int64_t start = os_time_get_nano();
+
+   if (elts)
+      translate->run_elts(translate, elts, count, 0, 0, output);
+   else
+      translate->run(translate, 0, count, 0, 0, output);
+
+   return (os_time_get_nano() - start) / 1e9;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned count = argc > 1 ? atoi(argv[1]) : 1 << 20;
+   struct translate_cache *cache;
+   unsigned *elts;
+   unsigned char *input;
+   float *output[2];
+   unsigned i, j, hits, misses;
+   int failed = 0;
+
+   util_cpu_detect();
+
+   cache = translate_cache_create();
+   input = align_malloc(count * 64, 64);
+   output[0] = align_malloc(count * 4 * 4 * sizeof(float), 64);
+   output[1] = align_malloc(count * 4 * 4 * sizeof(float), 64);
+   elts = align_malloc(count * sizeof(*elts), 64);
+   if (!cache || !input || !output[0] || !output[1] || !elts)
+      return 1;
+
+   srand(4359025);
+   for (i = 0; i < count * 64; i++)
+      input[i] = rand();
+   /* strip-like reuse, as in an indexed mesh */
+   for (i = 0; i < count; i++)
+      elts[i] = MIN2(i / 3 + i % 3, count - 1);
+
+   printf("%-36s %10s %10s %10s %10s\n", "layout",
+          "generic", "x86", "x86 elts", "Mvert/s");
+
+   for (i = 0; i < ARRAY_SIZE(layouts); i++) {
+      struct translate_key key;
+      struct translate *generic, *x86;
+      unsigned input_stride;
+      double t_generic, t_x86 = 0, t_x86_elts = 0;
+
+      make_key(&layouts[i], &key, &input_stride);
+
+      /* draw looks its translates up once per draw */
+      for (j = 0; j < 1000; j++)
+         translate_cache_find(cache, &key);
+
+      generic = translate_generic_create(&key);
+      x86 = translate_sse2_create(&key);
+      if (!generic)
+         continue;
+
+      generic->set_buffer(generic, 0, input, input_stride, count - 1);
+      t_generic = run(generic, NULL, count, output[0]);
+
+      if (x86) {
+         x86->set_buffer(x86, 0, input, input_stride, count - 1);
+         t_x86 = run(x86, NULL, count, output[1]);
+
+         /* NaN inputs may come out with a different payload */
+         for (j = 0; j < count * key.output_stride / sizeof(float); j++) {
+            if (output[0][j] != output[1][j] &&
+                !(output[0][j] != output[0][j] &&
+                  output[1][j] != output[1][j])) {
+               printf("%s: mismatch at vertex %u: %g vs %g\n",
+                      layouts[i].name, j / (key.output_stride / 4),
+                      output[0][j], output[1][j]);
+               failed = 1;
+               break;
+            }
+         }
+
+         t_x86_elts = run(x86, elts, count, output[1]);
+      }
+
+      printf("%-36s %9.2fms %9.2fms %9.2fms %10.1f\n", layouts[i].name,
+             t_generic * 1e3, t_x86 * 1e3, t_x86_elts * 1e3,
+             count / (x86 ? t_x86 : t_generic) / 1e6);
+
+      if (x86)
+         x86->release(x86);
+      generic->release(generic);
+   }
+
+   translate_cache_get_stats(cache, &hits, &misses);
+   printf("translate_cache: %u hits, %u misses\n", hits, misses);
+
+   translate_cache_destroy(cache);
+   align_free(elts);
+   align_free(output[1]);
+   align_free(output[0]);
+   align_free(input);
+
+   return failed;
+}
@@ -0,0 +1,202 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Time util_gen_mipmap_cpu_level() building whole mipmap chains, and check
+ * the first level against a plain float box filter.  Every format gets the
+ * same amount of memory as a size x size RGBA8 image, so wider formats get
+ * fewer rows.
+ *
+ * Usage: ./u_gen_mipmap_bench [size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "util/u_gen_mipmap.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/format/u_format.h"
+#include "util/format_srgb.h"
+#include "util/os_time.h"
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_R8G8B8A8_UNORM,
+   PIPE_FORMAT_B8G8R8A8_SRGB,
+   PIPE_FORMAT_R8_UNORM,
+   PIPE_FORMAT_R8G8_UNORM,
+   PIPE_FORMAT_R16G16B16A16_UNORM,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+};
+
+/* rows of the first level checked against the reference */
+#define CHECK_ROWS 64
+
+
+/**
+ * Check the first destination rows against a float box filter, allowing
+ * one unit of error for the normalized formats.
+ */
+static bool
+check_level(enum pipe_format format,
+            const uint8_t *src, unsigned src_stride,
+            unsigned src_width, unsigned src_height,
+            const uint8_t *dst, unsigned dst_stride, unsigned dst_width,
+            unsigned rows)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const bool normalized = desc->channel[0].normalized;
+   const bool srgb = desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB;
+   const float tolerance = normalized ?
+      1.0f / ((1 << desc->channel[0].size) - 1) + 1e-6f : 1e-3f;
+   unsigned x, y, i, c;
+   bool ok = true;
+
+   for (y = 0; y < rows && ok; y++) {
+      for (x = 0; x < dst_width && ok; x++) {
+         float expected[4] = {0}, got[4];
+
+         for (i = 0; i < 4; i++) {
+            const unsigned sx = MIN2(2 * x + i % 2, src_width - 1);
+            const unsigned sy = MIN2(2 * y + i / 2, src_height - 1);
+            float texel[4];
+
+            util_format_unpack_rgba(format, texel,
+                                    src + sy * src_stride +
+                                    sx * util_format_get_blocksize(format), 1);
+            for (c = 0; c < 4; c++)
+               expected[c] += texel[c] * 0.25f;
+         }
+
+         util_format_unpack_rgba(format, got,
+                                 dst + y * dst_stride +
+                                 x * util_format_get_blocksize(format), 1);
+
+         /* sRGB results are off by up to one step of the encoding */
+         if (srgb) {
+            for (c = 0; c < 3; c++) {
+               got[c] = util_format_linear_to_srgb_float(got[c]);
+               expected[c] = util_format_linear_to_srgb_float(expected[c]);
+            }
+         }
+
+         for (c = 0; c < 4; c++) {
+            float err = fabsf(got[c] - expected[c]);
+            if (err > tolerance * MAX2(1.0f, fabsf(expected[c]))) {
+               printf("%s: texel %u,%u channel %u: %g, expected %g\n",
+                      util_format_short_name(format), x, y, c,
+                      got[c], expected[c]);
+               ok = false;
+            }
+         }
+      }
+   }
+
+   return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned size = MAX2(argc > 1 ? atoi(argv[1]) : 8192, 2);
+   unsigned i, j;
+   int failed = 0;
+
+   printf("%-24s %12s %10s %10s\n", "format", "base", "ms", "GB/s");
+
+   for (i = 0; i < ARRAY_SIZE(formats); i++) {
+      const enum pipe_format format = formats[i];
+      const unsigned bpp = util_format_get_blocksize(format);
+      const unsigned width = size;
+      const unsigned height = MAX2(size * 4 / bpp, 1);
+      const unsigned num_levels = util_logbase2(MAX2(width, height)) + 1;
+      uint8_t *levels[32];
+      unsigned strides[32];
+      uint64_t bytes = 0;
+      int64_t start;
+      double t;
+
+      if (!util_gen_mipmap_cpu_supported(format)) {
+         printf("%-24s unsupported\n", util_format_short_name(format));
+         failed = 1;
+         continue;
+      }
+
+      for (j = 0; j < num_levels; j++) {
+         strides[j] = u_minify(width, j) * bpp;
+         levels[j] = MALLOC((size_t)strides[j] * u_minify(height, j));
+         if (!levels[j])
+            return 1;
+         bytes += (uint64_t)strides[j] * u_minify(height, j);
+      }
+
+      /* random texels, with floats kept finite */
+      srand(4359025 + i);
+      if (util_format_is_float(format)) {
+         for (j = 0; j < width * height; j++) {
+            float v[4];
+            unsigned c;
+
+            for (c = 0; c < 4; c++)
+               v[c] = (rand() & 0xffff) / 4096.0f;
+            util_format_pack_rgba(format, levels[0] + j * bpp, v, 1);
+         }
+      } else {
+         for (j = 0; j < strides[0] * height; j++)
+            levels[0][j] = rand();
+      }
+
+      start = os_time_get_nano();
+      for (j = 1; j < num_levels; j++) {
+         const uint8_t *src = levels[j - 1];
+         uint8_t *dst = levels[j];
+
+         util_gen_mipmap_cpu_level(format, 1,
+                                   &src, strides[j - 1],
+                                   u_minify(width, j - 1),
+                                   u_minify(height, j - 1),
+                                   &dst, strides[j],
+                                   u_minify(width, j), u_minify(height, j));
+      }
+      t = (os_time_get_nano() - start) / 1e9;
+
+      if (!check_level(format, levels[0], strides[0], width, height,
+                       levels[1], strides[1], u_minify(width, 1),
+                       MIN2(CHECK_ROWS, u_minify(height, 1))))
+         failed = 1;
+
+      printf("%-24s %6ux%-5u %10.2f %10.2f\n",
+             util_format_short_name(format), width, height, t * 1e3,
+             bytes / t / 1e9);
+
+      for (j = 0; j < num_levels; j++)
+         FREE(levels[j]);
+   }
+
+   return failed;
+}
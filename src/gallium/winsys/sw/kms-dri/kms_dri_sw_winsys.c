@@ -48,7 +48,9 @@
 #include "util/format/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_debug.h"
 #include "util/list.h"
+#include "util/simple_mtx.h"
 
 #include "frontend/sw_winsys.h"
 #include "frontend/drm_driver.h"
@@ -62,6 +64,20 @@
 
 struct kms_sw_displaytarget;
 
+/* Render into malloc'ed copies of the dumb buffers we create and write
+ * back the damaged parts, for devices where dumb buffers are uncached.
+ */
+DEBUG_GET_ONCE_BOOL_OPTION(kms_swrast_shadow, "KMS_SWRAST_SHADOW", false)
+
+/** Rows of a display target to write back from its shadow, in bytes */
+struct kms_sw_damage
+{
+   unsigned offset;
+   unsigned stride;
+   unsigned width;
+   unsigned height;
+};
+
 struct kms_sw_plane
 {
    unsigned width;
@@ -81,6 +97,15 @@ struct kms_sw_displaytarget
    void *mapped;
    void *ro_mapped;
 
+   /* Shadow copy, written back as damage is reported.  Once a write
+    * mapping without SW_MAP_DAMAGE is made, the whole buffer is written
+    * back when the last mapping goes away.  Damage comes from the
+    * rasterizer threads, so write-backs and the flag take the lock.
+    */
+   void *shadow;
+   simple_mtx_t shadow_lock;
+   bool write_back_all;
+
    int ref_count;
    int map_count;
    struct list_head link;
@@ -192,6 +217,14 @@ kms_sw_displaytarget_create(struct sw_winsys *ws,
 
    kms_sw_dt->size = create_req.size;
    kms_sw_dt->handle = create_req.handle;
+   if (debug_get_option_kms_swrast_shadow()) {
+      /* new dumb buffers are cleared */
+      kms_sw_dt->shadow = align_calloc(kms_sw_dt->size, 64);
+      if (!kms_sw_dt->shadow)
+         goto free_bo;
+      simple_mtx_init(&kms_sw_dt->shadow_lock, mtx_plain);
+   }
+
    struct kms_sw_plane *plane = get_plane(kms_sw_dt, format, width, height,
                                           create_req.pitch, 0);
    if (!plane)
@@ -208,6 +241,10 @@ kms_sw_displaytarget_create(struct sw_winsys *ws,
    memset(&destroy_req, 0, sizeof destroy_req);
    destroy_req.handle = create_req.handle;
    drmIoctl(kms_sw->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_req);
+   if (kms_sw_dt->shadow) {
+      simple_mtx_destroy(&kms_sw_dt->shadow_lock);
+      align_free(kms_sw_dt->shadow);
+   }
    FREE(kms_sw_dt);
  no_dt:
    return NULL;
@@ -230,6 +267,15 @@ kms_sw_displaytarget_destroy(struct sw_winsys *ws,
       DEBUG_PRINT("KMS-DEBUG: leaked map buffer %u\n", kms_sw_dt->handle);
    }
 
+   if (kms_sw_dt->mapped != MAP_FAILED)
+      munmap(kms_sw_dt->mapped, kms_sw_dt->size);
+   if (kms_sw_dt->ro_mapped != MAP_FAILED)
+      munmap(kms_sw_dt->ro_mapped, kms_sw_dt->size);
+   if (kms_sw_dt->shadow) {
+      simple_mtx_destroy(&kms_sw_dt->shadow_lock);
+      align_free(kms_sw_dt->shadow);
+   }
+
    memset(&destroy_req, 0, sizeof destroy_req);
    destroy_req.handle = kms_sw_dt->handle;
    drmIoctl(kms_sw->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_req);
@@ -246,39 +292,72 @@ kms_sw_displaytarget_destroy(struct sw_winsys *ws,
    FREE(kms_sw_dt);
 }
 
+/**
+ * Map the dumb buffer.  Mappings are kept until the buffer is destroyed,
+ * so that mapping it for every frame doesn't cost an ioctl, an mmap and
+ * page faults on first touch.
+ */
 static void *
-kms_sw_displaytarget_map(struct sw_winsys *ws,
-                         struct sw_displaytarget *dt,
-                         unsigned flags)
+kms_sw_displaytarget_mmap(struct kms_sw_winsys *kms_sw,
+                          struct kms_sw_displaytarget *kms_sw_dt,
+                          unsigned flags)
 {
-   struct kms_sw_winsys *kms_sw = kms_sw_winsys(ws);
-   struct kms_sw_plane *plane = kms_sw_plane(dt);
-   struct kms_sw_displaytarget *kms_sw_dt = plane->dt;
    struct drm_mode_map_dumb map_req;
    int prot, ret;
 
-   memset(&map_req, 0, sizeof map_req);
-   map_req.handle = kms_sw_dt->handle;
-   ret = drmIoctl(kms_sw->fd, DRM_IOCTL_MODE_MAP_DUMB, &map_req);
-   if (ret)
-      return NULL;
+   /* a writable mapping does for reads too */
+   if (kms_sw_dt->mapped != MAP_FAILED)
+      return kms_sw_dt->mapped;
 
    prot = (flags == PIPE_MAP_READ) ? PROT_READ : (PROT_READ | PROT_WRITE);
    void **ptr = (flags == PIPE_MAP_READ) ? &kms_sw_dt->ro_mapped : &kms_sw_dt->mapped;
    if (*ptr == MAP_FAILED) {
-      void *tmp = mmap(NULL, kms_sw_dt->size, prot, MAP_SHARED,
-                       kms_sw->fd, map_req.offset);
-      if (tmp == MAP_FAILED)
+      memset(&map_req, 0, sizeof map_req);
+      map_req.handle = kms_sw_dt->handle;
+      ret = drmIoctl(kms_sw->fd, DRM_IOCTL_MODE_MAP_DUMB, &map_req);
+      if (ret)
+         return MAP_FAILED;
+
+      *ptr = mmap(NULL, kms_sw_dt->size, prot, MAP_SHARED,
+                  kms_sw->fd, map_req.offset);
+   }
+
+   return *ptr;
+}
+
+static void *
+kms_sw_displaytarget_map(struct sw_winsys *ws,
+                         struct sw_displaytarget *dt,
+                         unsigned flags)
+{
+   struct kms_sw_winsys *kms_sw = kms_sw_winsys(ws);
+   struct kms_sw_plane *plane = kms_sw_plane(dt);
+   struct kms_sw_displaytarget *kms_sw_dt = plane->dt;
+   void *ptr;
+
+   if (kms_sw_dt->shadow) {
+      /* the shadow is written back through a writable mapping */
+      if (kms_sw_displaytarget_mmap(kms_sw, kms_sw_dt,
+                                    PIPE_MAP_READ_WRITE) == MAP_FAILED)
+         return NULL;
+      if ((flags & PIPE_MAP_WRITE) && !(flags & SW_MAP_DAMAGE)) {
+         simple_mtx_lock(&kms_sw_dt->shadow_lock);
+         kms_sw_dt->write_back_all = true;
+         simple_mtx_unlock(&kms_sw_dt->shadow_lock);
+      }
+      ptr = kms_sw_dt->shadow;
+   } else {
+      ptr = kms_sw_displaytarget_mmap(kms_sw, kms_sw_dt, flags);
+      if (ptr == MAP_FAILED)
          return NULL;
-      *ptr = tmp;
    }
 
    DEBUG_PRINT("KMS-DEBUG: mapped buffer %u (size %u) at %p\n",
-         kms_sw_dt->handle, kms_sw_dt->size, *ptr);
+         kms_sw_dt->handle, kms_sw_dt->size, ptr);
 
    kms_sw_dt->map_count++;
 
-   return *ptr + plane->offset;
+   return (uint8_t *)ptr + plane->offset;
 }
 
 static struct kms_sw_displaytarget *
@@ -353,6 +432,62 @@ kms_sw_displaytarget_add_from_prime(struct kms_sw_winsys *kms_sw, int fd,
    return plane;
 }
 
+static void
+kms_sw_write_back(struct kms_sw_displaytarget *kms_sw_dt,
+                  const struct kms_sw_damage *damage)
+{
+   const uint8_t *src = (const uint8_t *)kms_sw_dt->shadow + damage->offset;
+   uint8_t *dst = (uint8_t *)kms_sw_dt->mapped + damage->offset;
+   unsigned y;
+
+   if (damage->width == damage->stride) {
+      memcpy(dst, src, (size_t)damage->stride * damage->height);
+      return;
+   }
+
+   for (y = 0; y < damage->height; y++) {
+      memcpy(dst, src, damage->width);
+      src += damage->stride;
+      dst += damage->stride;
+   }
+}
+
+static void
+kms_sw_displaytarget_damage(struct sw_winsys *ws,
+                            struct sw_displaytarget *dt,
+                            const struct pipe_box *boxes,
+                            unsigned num_boxes)
+{
+   struct kms_sw_plane *plane = kms_sw_plane(dt);
+   struct kms_sw_displaytarget *kms_sw_dt = plane->dt;
+   const unsigned bpp = util_format_get_blocksize(kms_sw_dt->format);
+   unsigned i;
+
+   if (!kms_sw_dt->shadow || kms_sw_dt->mapped == MAP_FAILED)
+      return;
+
+   /* Written back now rather than on unmap, since the rasterizer reports
+    * damage before signalling its fence but keeps the mapping longer.
+    */
+   simple_mtx_lock(&kms_sw_dt->shadow_lock);
+   for (i = 0; i < num_boxes; i++) {
+      const struct pipe_box *box = &boxes[i];
+      struct kms_sw_damage damage;
+
+      if (box->width <= 0 || box->height <= 0 ||
+          box->x + box->width > (int)plane->width ||
+          box->y + box->height > (int)plane->height)
+         continue;
+
+      damage.offset = plane->offset + box->y * plane->stride + box->x * bpp;
+      damage.stride = plane->stride;
+      damage.width = box->width * bpp;
+      damage.height = box->height;
+      kms_sw_write_back(kms_sw_dt, &damage);
+   }
+   simple_mtx_unlock(&kms_sw_dt->shadow_lock);
+}
+
 static void
 kms_sw_displaytarget_unmap(struct sw_winsys *ws,
                            struct sw_displaytarget *dt)
@@ -370,16 +505,22 @@ kms_sw_displaytarget_unmap(struct sw_winsys *ws,
       return;
    }
 
-   DEBUG_PRINT("KMS-DEBUG: unmapped buffer %u (was %p)\n", kms_sw_dt->handle, kms_sw_dt->mapped);
-   DEBUG_PRINT("KMS-DEBUG: unmapped buffer %u (was %p)\n", kms_sw_dt->handle, kms_sw_dt->ro_mapped);
-
-   if (kms_sw_dt->mapped != MAP_FAILED) {
-      munmap(kms_sw_dt->mapped, kms_sw_dt->size);
-      kms_sw_dt->mapped = MAP_FAILED;
-   }
-   if (kms_sw_dt->ro_mapped != MAP_FAILED) {
-      munmap(kms_sw_dt->ro_mapped, kms_sw_dt->size);
-      kms_sw_dt->ro_mapped = MAP_FAILED;
+   DEBUG_PRINT("KMS-DEBUG: unmapped buffer %u\n", kms_sw_dt->handle);
+
+   /* The dumb buffer itself stays mapped until it is destroyed. */
+   if (kms_sw_dt->shadow) {
+      simple_mtx_lock(&kms_sw_dt->shadow_lock);
+      if (kms_sw_dt->write_back_all) {
+         struct kms_sw_damage all = {
+            .offset = 0,
+            .stride = kms_sw_dt->size,
+            .width = kms_sw_dt->size,
+            .height = 1,
+         };
+         kms_sw_write_back(kms_sw_dt, &all);
+         kms_sw_dt->write_back_all = false;
+      }
+      simple_mtx_unlock(&kms_sw_dt->shadow_lock);
    }
 }
 
@@ -504,6 +645,7 @@ kms_dri_create_winsys(int fd)
    /* texture functions */
    ws->base.displaytarget_map = kms_sw_displaytarget_map;
    ws->base.displaytarget_unmap = kms_sw_displaytarget_unmap;
+   ws->base.displaytarget_damage = kms_sw_displaytarget_damage;
 
    ws->base.displaytarget_display = kms_sw_displaytarget_display;
 
@@ -0,0 +1,204 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Tests the KMS_SWRAST_SHADOW write-back of the kms_swrast winsys against
+ * a stub DRM device: dumb buffers are ranges of a memfd, which the test
+ * maps to see what reached the "device".
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <xf86drm.h>
+
+#include "frontend/sw_winsys.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+
+extern "C" {
+#include "kms_dri_sw_winsys.h"
+}
+
+#define DEVICE_SIZE (16 << 20)
+#define WIDTH 256
+#define HEIGHT 128
+
+static uint32_t next_offset;
+static unsigned map_dumb_calls;
+
+/* Overrides libdrm's, so that the winsys talks to the memfd. */
+extern "C" int
+drmIoctl(int fd, unsigned long request, void *arg)
+{
+   switch (request) {
+   case DRM_IOCTL_MODE_CREATE_DUMB: {
+      struct drm_mode_create_dumb *create = (struct drm_mode_create_dumb *)arg;
+      create->pitch = create->width * create->bpp / 8 + 64;
+      create->size = (uint64_t)create->pitch * create->height;
+      create->handle = next_offset + 1;
+      next_offset += 1 << 20;
+      return 0;
+   }
+   case DRM_IOCTL_MODE_MAP_DUMB: {
+      struct drm_mode_map_dumb *map = (struct drm_mode_map_dumb *)arg;
+      map->offset = map->handle - 1;
+      map_dumb_calls++;
+      return 0;
+   }
+   default:
+      return 0;
+   }
+}
+
+class kms_sw_shadow : public ::testing::Test {
+protected:
+   void SetUp() override
+   {
+      /* read once, on the first displaytarget_create */
+      setenv("KMS_SWRAST_SHADOW", "true", 1);
+
+      fd = memfd_create("kms_sw_shadow", 0);
+      ASSERT_NE(fd, -1);
+      ASSERT_EQ(ftruncate(fd, DEVICE_SIZE), 0);
+      device = (uint8_t *)mmap(NULL, DEVICE_SIZE, PROT_READ, MAP_SHARED,
+                               fd, 0);
+      ASSERT_NE(device, MAP_FAILED);
+
+      next_offset = 0;
+      map_dumb_calls = 0;
+      ws = kms_dri_create_winsys(fd);
+      ASSERT_TRUE(ws);
+      dt = ws->displaytarget_create(ws, 0, PIPE_FORMAT_B8G8R8A8_UNORM,
+                                    WIDTH, HEIGHT, 64, NULL, &stride);
+      ASSERT_TRUE(dt);
+   }
+
+   void TearDown() override
+   {
+      if (dt)
+         ws->displaytarget_destroy(ws, dt);
+      if (ws)
+         ws->destroy(ws);
+      munmap(device, DEVICE_SIZE);
+      close(fd);
+   }
+
+   uint8_t pixel(unsigned x, unsigned y)
+   {
+      return device[y * stride + x * 4];
+   }
+
+   int fd;
+   uint8_t *device;
+   struct sw_winsys *ws;
+   struct sw_displaytarget *dt;
+   unsigned stride;
+};
+
+TEST_F(kms_sw_shadow, writes_back_only_damage)
+{
+   struct pipe_box box;
+
+   u_box_2d(64, 32, 64, 16, &box);
+
+   for (unsigned frame = 1; frame <= 3; frame++) {
+      uint8_t *map = (uint8_t *)
+         ws->displaytarget_map(ws, dt, PIPE_MAP_READ_WRITE | SW_MAP_DAMAGE);
+      ASSERT_TRUE(map);
+      memset(map, frame, stride * HEIGHT);
+      ws->displaytarget_damage(ws, dt, &box, 1);
+      ws->displaytarget_unmap(ws, dt);
+
+      EXPECT_EQ(pixel(64, 32), frame);
+      EXPECT_EQ(pixel(127, 47), frame);
+      EXPECT_EQ(pixel(0, 0), 0);
+      EXPECT_EQ(pixel(128, 32), 0);
+      EXPECT_EQ(pixel(64, 48), 0);
+   }
+
+   /* the dumb buffer stays mapped */
+   EXPECT_EQ(map_dumb_calls, 1u);
+}
+
+TEST_F(kms_sw_shadow, writes_back_unreported_maps_whole)
+{
+   uint8_t *map = (uint8_t *)
+      ws->displaytarget_map(ws, dt, PIPE_MAP_WRITE);
+   ASSERT_TRUE(map);
+   memset(map, 0x7f, stride * HEIGHT);
+   ws->displaytarget_unmap(ws, dt);
+
+   EXPECT_EQ(pixel(0, 0), 0x7f);
+   EXPECT_EQ(pixel(WIDTH - 1, HEIGHT - 1), 0x7f);
+}
+
+/* A CPU write made while the rasterizer has the display target mapped is
+ * not covered by the rasterizer's damage, however often it reports some.
+ * The reports come from another thread, as they do from llvmpipe.
+ */
+TEST_F(kms_sw_shadow, damage_does_not_hide_unreported_writes)
+{
+   struct pipe_box box;
+
+   u_box_2d(0, 0, 16, 16, &box);
+
+   uint8_t *scene = (uint8_t *)
+      ws->displaytarget_map(ws, dt, PIPE_MAP_READ_WRITE | SW_MAP_DAMAGE);
+   uint8_t *cpu = (uint8_t *)
+      ws->displaytarget_map(ws, dt, PIPE_MAP_WRITE);
+   ASSERT_TRUE(scene && cpu);
+
+   memset(cpu, 0x55, stride * HEIGHT);
+   ws->displaytarget_unmap(ws, dt);
+
+   std::thread rast([&] {
+      /* the same display target bound as two color buffers */
+      ws->displaytarget_damage(ws, dt, &box, 1);
+      ws->displaytarget_damage(ws, dt, &box, 1);
+   });
+   rast.join();
+
+   EXPECT_EQ(pixel(0, 0), 0x55);
+   EXPECT_EQ(pixel(WIDTH - 1, HEIGHT - 1), 0);
+
+   ws->displaytarget_unmap(ws, dt);
+
+   EXPECT_EQ(pixel(WIDTH - 1, HEIGHT - 1), 0x55);
+
+   /* and the next frame only writes back its damage again */
+   scene = (uint8_t *)
+      ws->displaytarget_map(ws, dt, PIPE_MAP_READ_WRITE | SW_MAP_DAMAGE);
+   ASSERT_TRUE(scene);
+   memset(scene, 0x66, stride * HEIGHT);
+   ws->displaytarget_damage(ws, dt, &box, 1);
+   ws->displaytarget_unmap(ws, dt);
+
+   EXPECT_EQ(pixel(0, 0), 0x66);
+   EXPECT_EQ(pixel(WIDTH - 1, HEIGHT - 1), 0x55);
+}
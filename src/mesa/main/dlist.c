@@ -48,6 +48,7 @@
 #include "main/dispatch.h"
 
 #include "vbo/vbo_save.h"
+#include "util/u_debug.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "api_exec_decl.h"
@@ -749,10 +750,9 @@ vbo_destroy_vertex_list(struct gl_context *ctx, struct vbo_save_vertex_list *nod
       pipe_vertex_state_reference(&node->state[mode], NULL);
    }
 
-   if (node->modes) {
-      free(node->modes);
+   if (node->num_draws > 1)
       free(node->start_counts);
-   }
+   free(node->modes);
 
    _mesa_reference_buffer_object(ctx, &node->cold->ib.obj, NULL);
    free(node->cold->current_data);
@@ -1504,16 +1504,21 @@ dlist_alloc(struct gl_context *ctx, OpCode opcode, GLuint bytes, bool align8)
 
    assert(bytes <= BLOCK_SIZE * sizeof(Node));
 
-   /* If this node needs to start on an 8-byte boundary, pad the last node. */
-   if (sizeof(void *) == 8 && align8 &&
-       ctx->ListState.CurrentPos % 2 == 1) {
-      Node *last = ctx->ListState.CurrentBlock + ctx->ListState.CurrentPos -
-                   ctx->ListState.LastInstSize;
-      last->InstSize++;
-      ctx->ListState.CurrentPos++;
-   }
-
-   if (ctx->ListState.CurrentPos + numNodes + contNodes > BLOCK_SIZE) {
+   /* If this node needs to start on an 8-byte boundary, pad the last node.
+    * The padding must fit in the block too, or the last node could end up
+    * without room for the OPCODE_CONTINUE after it.
+    */
+   const GLuint pad = sizeof(void *) == 8 && align8 &&
+                      ctx->ListState.CurrentPos % 2 == 1;
+
+   if (ctx->ListState.CurrentPos + pad + numNodes + contNodes <= BLOCK_SIZE) {
+      if (pad) {
+         Node *last = ctx->ListState.CurrentBlock + ctx->ListState.CurrentPos -
+                      ctx->ListState.LastInstSize;
+         last->InstSize++;
+         ctx->ListState.CurrentPos++;
+      }
+   } else {
       /* This block is full.  Allocate a new block and chain to it */
       Node *newblock;
       Node *n = ctx->ListState.CurrentBlock + ctx->ListState.CurrentPos;
@@ -13624,6 +13629,488 @@ replace_op_vertex_list_recursively(struct gl_context *ctx, struct gl_display_lis
 }
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(no_dlist_optimize, "MESA_NO_DLIST_OPTIMIZE", false)
+
+
+/* The glEndList optimizer tracks this many pieces of state at a time. */
+#define OPT_MAX_STATE 32
+
+/* Key class shared by all the vertex attribute opcodes. */
+#define OPT_KEY_ATTR OPCODE_ATTR_1F_NV
+
+struct dlist_opt_state
+{
+   uint32_t key;
+   unsigned setter;  /**< index of the instruction that set the value */
+   bool known;       /**< the state has the value set by setter */
+   bool pending;     /**< nothing has read the value since setter */
+};
+
+
+/**
+ * Describe a state-setting instruction that the glEndList optimizer can
+ * reason about: it sets one piece of state, identified by \p key, to a
+ * value held entirely in its opcode and its first \p nparams parameters,
+ * and has no other effect.
+ */
+static bool
+get_state_op_key(const Node *n, uint32_t *key, unsigned *nparams)
+{
+   const OpCode opcode = n[0].opcode;
+
+   switch (opcode) {
+   case OPCODE_ENABLE:
+   case OPCODE_DISABLE:
+      if (n[1].e > 0xffff)
+         return false;
+      *key = (OPCODE_ENABLE << 16) | n[1].e;
+      *nparams = 1;
+      return true;
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      /* Position emits a vertex. */
+      if (n[1].ui == VERT_ATTRIB_POS || n[1].ui >= VERT_ATTRIB_GENERIC0)
+         return false;
+      *key = (OPT_KEY_ATTR << 16) | n[1].ui;
+      *nparams = 2 + opcode - OPCODE_ATTR_1F_NV;
+      return true;
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      /* Generic 0 aliases position. */
+      if (n[1].ui == 0 || n[1].ui >= MAX_VERTEX_GENERIC_ATTRIBS)
+         return false;
+      *key = (OPT_KEY_ATTR << 16) | (VERT_ATTRIB_GENERIC0 + n[1].ui);
+      *nparams = 2 + opcode - OPCODE_ATTR_1F_ARB;
+      return true;
+   case OPCODE_ALPHA_FUNC:
+      *key = opcode << 16;
+      *nparams = 2;
+      return true;
+   case OPCODE_CULL_FACE:
+   case OPCODE_DEPTH_FUNC:
+   case OPCODE_DEPTH_MASK:
+   case OPCODE_FRONT_FACE:
+   case OPCODE_LINE_WIDTH:
+   case OPCODE_POINT_SIZE:
+   case OPCODE_SHADE_MODEL:
+      *key = opcode << 16;
+      *nparams = 1;
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+static bool
+same_state_value(const Node *a, const Node *b, unsigned nparams)
+{
+   if (a[0].opcode != b[0].opcode)
+      return false;
+
+   /* Only the low byte of a boolean parameter is written. */
+   if (a[0].opcode == OPCODE_DEPTH_MASK)
+      return a[1].b == b[1].b;
+
+   for (unsigned i = 1; i <= nparams; i++) {
+      if (a[i].ui != b[i].ui)
+         return false;
+   }
+   return true;
+}
+
+
+/**
+ * Whether executing the instruction always replaces the state, i.e. it
+ * can't raise an error and leave the previous value in place.  Only then
+ * can an earlier setter of the same state be dropped.
+ */
+static bool
+state_op_always_succeeds(const Node *n)
+{
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+   case OPCODE_DEPTH_MASK:
+      return true;
+   case OPCODE_ALPHA_FUNC:
+   case OPCODE_DEPTH_FUNC:
+      return n[1].e >= GL_NEVER && n[1].e <= GL_ALWAYS;
+   case OPCODE_CULL_FACE:
+      return n[1].e == GL_FRONT || n[1].e == GL_BACK ||
+             n[1].e == GL_FRONT_AND_BACK;
+   case OPCODE_FRONT_FACE:
+      return n[1].e == GL_CW || n[1].e == GL_CCW;
+   case OPCODE_LINE_WIDTH:
+   case OPCODE_POINT_SIZE:
+      return n[1].f > 0.0f;
+   case OPCODE_SHADE_MODEL:
+      return n[1].e == GL_FLAT || n[1].e == GL_SMOOTH;
+   default:
+      /* glEnable of an unsupported cap raises GL_INVALID_ENUM. */
+      return false;
+   }
+}
+
+
+/**
+ * Drop the state changes of a display list that are no-ops, because the
+ * list already set the same value, or that are overwritten before
+ * anything uses them.  Only vertex lists are known not to touch the
+ * tracked state; any other instruction ends the tracking.
+ */
+static void
+remove_redundant_state(Node **ops, unsigned num_ops, bool *removed)
+{
+   struct dlist_opt_state state[OPT_MAX_STATE];
+   unsigned num_state = 0;
+
+   for (unsigned i = 0; i < num_ops; i++) {
+      Node *n = ops[i];
+      const OpCode opcode = n[0].opcode;
+      uint32_t key;
+      unsigned nparams;
+
+      if (get_state_op_key(n, &key, &nparams)) {
+         struct dlist_opt_state *s = NULL;
+
+         for (unsigned j = 0; j < num_state; j++) {
+            if (state[j].key == key) {
+               s = &state[j];
+               break;
+            }
+         }
+
+         if (!s) {
+            if (num_state == OPT_MAX_STATE)
+               num_state = 0;
+            s = &state[num_state++];
+            s->key = key;
+            s->known = false;
+            s->pending = false;
+         }
+
+         if (s->known && same_state_value(ops[s->setter], n, nparams)) {
+            removed[i] = true;
+            continue;
+         }
+
+         if (s->pending && state_op_always_succeeds(ops[s->setter]) &&
+             state_op_always_succeeds(n))
+            removed[s->setter] = true;
+
+         s->setter = i;
+         s->known = true;
+         s->pending = true;
+
+         /* glEnable(GL_COLOR_MATERIAL) reads the current color. */
+         if (opcode == OPCODE_ENABLE || opcode == OPCODE_DISABLE) {
+            for (unsigned j = 0; j < num_state; j++) {
+               if (state[j].key >> 16 == OPT_KEY_ATTR)
+                  state[j].pending = false;
+            }
+         }
+         continue;
+      }
+
+      if (opcode == OPCODE_VERTEX_LIST ||
+          opcode == OPCODE_VERTEX_LIST_COPY_CURRENT) {
+         const struct vbo_save_vertex_list *node =
+            (const struct vbo_save_vertex_list *) n;
+         GLbitfield copied = 0;
+
+         /* These attribs are drawn from the vertex buffer, then set to the
+          * last vertex, see playback_copy_to_current().  The current color
+          * is still set before the draw, and GL_COLOR_MATERIAL copies it to
+          * the material, so glColor is kept.
+          */
+         if (opcode == OPCODE_VERTEX_LIST_COPY_CURRENT &&
+             node->cold->current_data)
+            copied = node->cold->VAO[VP_MODE_SHADER]->Enabled & ~VERT_BIT_POS;
+
+         for (unsigned j = 0; j < num_state; j++) {
+            struct dlist_opt_state *s = &state[j];
+
+            if (s->key >> 16 == OPT_KEY_ATTR &&
+                copied & VERT_BIT(s->key & 0xffff)) {
+               if (s->pending && (s->key & 0xffff) != VERT_ATTRIB_COLOR0)
+                  removed[s->setter] = true;
+               s->known = false;
+            }
+            s->pending = false;
+         }
+         continue;
+      }
+
+      num_state = 0;
+   }
+}
+
+
+static inline struct pipe_draw_start_count_bias *
+get_vertex_list_draws(struct vbo_save_vertex_list *node)
+{
+   return node->num_draws > 1 ? node->start_counts : &node->start_count;
+}
+
+
+/**
+ * Return the color a vertex list copies to the current values after it is
+ * drawn, or NULL.  The current values are laid out as in copy_vao().
+ */
+static const fi_type *
+get_vertex_list_current_color(const struct vbo_save_vertex_list *node)
+{
+   const struct gl_vertex_array_object *vao = node->cold->VAO[VP_MODE_SHADER];
+   const fi_type *data = node->cold->current_data;
+   GLbitfield mask = vao->Enabled & ~VERT_BIT_POS &
+                     BITFIELD_MASK(VERT_ATTRIB_COLOR0);
+
+   if (node->header.opcode != OPCODE_VERTEX_LIST_COPY_CURRENT || !data ||
+       !(vao->Enabled & VERT_BIT_COLOR0))
+      return NULL;
+
+   while (mask)
+      data += vao->VertexAttrib[u_bit_scan(&mask)].Format.Size;
+
+   return data;
+}
+
+
+/**
+ * Append the draws of vertex list \p b to vertex list \p a, so that they
+ * are replayed as one multi-draw, and destroy \p b.  This is possible when
+ * both lists use the same VAOs and gallium vertex state, which vbo_save
+ * shares between consecutive lists with the same vertex format.
+ */
+static bool
+merge_vertex_lists(struct gl_context *ctx, struct vbo_save_vertex_list *a,
+                   struct vbo_save_vertex_list *b)
+{
+   if (!a->num_draws || !b->num_draws || !b->draw_begins ||
+       !a->cold->prims[a->cold->prim_count - 1].end ||
+       a->cold->ib.obj != b->cold->ib.obj ||
+       !a->cold->current_data != !b->cold->current_data)
+      return false;
+
+   for (gl_vertex_processing_mode mode = VP_MODE_FF; mode < VP_MODE_MAX; ++mode) {
+      if (a->cold->VAO[mode] != b->cold->VAO[mode] ||
+          a->state[mode] != b->state[mode])
+         return false;
+   }
+
+   /* Only b's last vertex is copied to the current values.  Skipping a's
+    * copy is invisible unless it changes the current color, which
+    * GL_COLOR_MATERIAL also copies to the material.
+    */
+   const struct gl_vertex_array_object *vao = a->cold->VAO[VP_MODE_SHADER];
+   const fi_type *color = get_vertex_list_current_color(a);
+   if (color &&
+       memcmp(color, get_vertex_list_current_color(b),
+              vao->VertexAttrib[VERT_ATTRIB_COLOR0].Format.Size *
+              sizeof(fi_type)))
+      return false;
+
+   const unsigned num_draws = a->num_draws + b->num_draws;
+   const unsigned prim_count = a->cold->prim_count + b->cold->prim_count;
+   const bool same_mode = !a->modes && !b->modes &&
+                          a->cold->info.mode == b->cold->info.mode;
+   struct pipe_draw_start_count_bias *start_counts =
+      malloc(num_draws * sizeof(*start_counts));
+   struct _mesa_prim *prims = malloc(prim_count * sizeof(*prims));
+   uint8_t *modes = same_mode ? NULL : malloc(num_draws);
+
+   if (!start_counts || !prims || (!same_mode && !modes)) {
+      free(start_counts);
+      free(prims);
+      free(modes);
+      return false;
+   }
+
+   memcpy(start_counts, get_vertex_list_draws(a),
+          a->num_draws * sizeof(*start_counts));
+   memcpy(start_counts + a->num_draws, get_vertex_list_draws(b),
+          b->num_draws * sizeof(*start_counts));
+
+   if (modes) {
+      for (unsigned i = 0; i < a->num_draws; i++)
+         modes[i] = a->modes ? a->modes[i] : a->cold->info.mode;
+      for (unsigned i = 0; i < b->num_draws; i++)
+         modes[a->num_draws + i] = b->modes ? b->modes[i] : b->cold->info.mode;
+   }
+
+   memcpy(prims, a->cold->prims, a->cold->prim_count * sizeof(*prims));
+   memcpy(prims + a->cold->prim_count, b->cold->prims,
+          b->cold->prim_count * sizeof(*prims));
+
+   if (a->num_draws > 1)
+      free(a->start_counts);
+   free(a->modes);
+   free(a->cold->prims);
+
+   a->start_counts = start_counts;
+   a->modes = modes;
+   a->num_draws = num_draws;
+   a->cold->prims = prims;
+   a->cold->prim_count = prim_count;
+   a->cold->vertex_count += b->cold->vertex_count;
+   a->cold->min_index = MIN2(a->cold->min_index, b->cold->min_index);
+   a->cold->max_index = MAX2(a->cold->max_index, b->cold->max_index);
+
+   /* b's last vertex is the one copied to the current values. */
+   free(a->cold->current_data);
+   a->cold->current_data = b->cold->current_data;
+   b->cold->current_data = NULL;
+
+   vbo_destroy_vertex_list(ctx, b);
+   return true;
+}
+
+
+/**
+ * Rewrite the instructions of a display list without the removed ones.
+ * This is done in place: every instruction moves to the same or an
+ * earlier position, and the blocks left unused at the end are freed.
+ */
+static void
+compact_list(struct gl_context *ctx, Node **blocks, unsigned num_blocks,
+             Node **ops, const unsigned *op_block, unsigned num_ops,
+             const bool *removed)
+{
+   const GLuint contNodes = 1 + POINTER_DWORDS;
+   unsigned block = 0, pos = 0, size = 0;
+   Node *last = NULL;
+
+   for (unsigned i = 0; i < num_ops; i++) {
+      if (removed[i])
+         continue;
+
+      const OpCode opcode = ops[i][0].opcode;
+      const bool align8 = opcode == OPCODE_VERTEX_LIST ||
+                          opcode == OPCODE_VERTEX_LIST_COPY_CURRENT;
+      size = ops[i][0].InstSize;
+
+      /* Same layout rules as dlist_alloc().  InstSize may include the
+       * padding of a following vertex list, so never chain past the block
+       * the instruction comes from: it already fits there.
+       */
+      const unsigned pad = sizeof(void *) == 8 && align8 && pos % 2 == 1;
+
+      if (pos + pad + size + contNodes <= BLOCK_SIZE ||
+          block == op_block[i]) {
+         if (pad) {
+            last->InstSize++;
+            pos++;
+         }
+      } else {
+         Node *n = blocks[block] + pos;
+         n[0].opcode = OPCODE_CONTINUE;
+         save_pointer(&n[1], blocks[++block]);
+         pos = 0;
+      }
+
+      last = blocks[block] + pos;
+      memmove(last, ops[i], size * sizeof(Node));
+      pos += size;
+   }
+
+   assert(last && last[0].opcode == OPCODE_END_OF_LIST);
+
+   for (unsigned i = block + 1; i < num_blocks; i++)
+      free(blocks[i]);
+
+   ctx->ListState.CurrentBlock = blocks[block];
+   ctx->ListState.CurrentPos = pos;
+   ctx->ListState.LastInstSize = size;
+}
+
+
+/**
+ * Optimize the display list being compiled for replay: drop redundant
+ * state changes, and merge vertex lists that end up next to each other
+ * into a single multi-draw on the pre-built gallium vertex state.
+ */
+static void
+optimize_list(struct gl_context *ctx, struct gl_display_list *dlist)
+{
+   unsigned num_ops = 0, num_blocks = 1, num_removed = 0;
+   Node *n;
+
+   for (n = dlist->Head; n[0].opcode != OPCODE_END_OF_LIST;) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) get_pointer(&n[1]);
+         num_blocks++;
+      } else {
+         n += n[0].InstSize;
+         num_ops++;
+      }
+   }
+   num_ops++;
+
+   Node **ops = malloc(num_ops * sizeof(Node *));
+   Node **blocks = malloc(num_blocks * sizeof(Node *));
+   unsigned *op_block = malloc(num_ops * sizeof(unsigned));
+   bool *removed = calloc(num_ops, sizeof(bool));
+
+   if (!ops || !blocks || !op_block || !removed)
+      goto out;
+
+   blocks[0] = n = dlist->Head;
+   for (unsigned i = 0, b = 0; i < num_ops;) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         blocks[++b] = n = (Node *) get_pointer(&n[1]);
+         continue;
+      }
+      op_block[i] = b;
+      ops[i++] = n;
+      n += n[0].InstSize;
+   }
+
+   remove_redundant_state(ops, num_ops, removed);
+
+   Node *prev = NULL;
+   for (unsigned i = 0; i < num_ops; i++) {
+      const OpCode opcode = ops[i][0].opcode;
+
+      if (removed[i])
+         continue;
+
+      if (prev && prev[0].opcode == opcode &&
+          (opcode == OPCODE_VERTEX_LIST ||
+           opcode == OPCODE_VERTEX_LIST_COPY_CURRENT) &&
+          merge_vertex_lists(ctx, (struct vbo_save_vertex_list *) prev,
+                             (struct vbo_save_vertex_list *) ops[i])) {
+         removed[i] = true;
+         continue;
+      }
+      prev = ops[i];
+   }
+
+   for (unsigned i = 0; i < num_ops; i++)
+      num_removed += removed[i];
+
+   if (num_removed) {
+      compact_list(ctx, blocks, num_blocks, ops, op_block, num_ops, removed);
+   }
+
+out:
+   free(ops);
+   free(blocks);
+   free(op_block);
+   free(removed);
+}
+
+
 /**
  * End definition of current display list.
  */
@@ -13655,6 +14142,12 @@ _mesa_EndList(void)
 
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
+   /* Loopback lists are replayed as immediate mode calls, so the vertex
+    * lists can't be merged.
+    */
+   if (!ctx->ListState.Current.UseLoopback && !debug_get_option_no_dlist_optimize())
+      optimize_list(ctx, ctx->ListState.CurrentList);
+
    _mesa_HashLockMutex(ctx->Shared->DisplayList);
 
    if (ctx->ListState.Current.UseLoopback)
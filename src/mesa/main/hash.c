@@ -38,6 +38,8 @@
 #include "glheader.h"
 #include "hash.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_idalloc.h"
 
@@ -61,6 +63,20 @@ _mesa_NewHashTable(void)
          return NULL;
       }
 
+      /* The dense array has to exist from the start: DELETED_KEY_VALUE must
+       * never be looked up in the hash table, not even in an empty table.
+       */
+      table->Dense = calloc(1, sizeof(*table->Dense) +
+                               MESA_HASH_INITIAL_DENSE_KEYS *
+                               sizeof(table->Dense->Data[0]));
+      if (table->Dense == NULL) {
+         _mesa_hash_table_destroy(table->ht, NULL);
+         free(table);
+         _mesa_error_no_memory(__func__);
+         return NULL;
+      }
+      table->Dense->Size = MESA_HASH_INITIAL_DENSE_KEYS;
+
       _mesa_hash_table_set_deleted_key(table->ht, uint_key(DELETED_KEY_VALUE));
       simple_mtx_init(&table->Mutex, mtx_plain);
    }
@@ -86,11 +102,19 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
    assert(table);
 
-   if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
+   if (table->NumDenseEntries ||
+       _mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
       _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
+
+   struct _mesa_HashDenseArray *dense = table->Dense;
+   while (dense) {
+      struct _mesa_HashDenseArray *prev = dense->prev;
+      free(dense);
+      dense = prev;
+   }
    if (table->id_alloc) {
       util_idalloc_fini(table->id_alloc);
       free(table->id_alloc);
@@ -102,7 +126,7 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
 static void init_name_reuse(struct _mesa_HashTable *table)
 {
-   assert(_mesa_hash_table_num_entries(table->ht) == 0);
+   assert(_mesa_HashNumEntries(table) == 0);
    table->id_alloc = MALLOC_STRUCT(util_idalloc);
    util_idalloc_init(table->id_alloc, 8);
    ASSERTED GLuint reserve0 = util_idalloc_alloc(table->id_alloc);
@@ -117,6 +141,95 @@ _mesa_HashEnableNameReuse(struct _mesa_HashTable *table)
    _mesa_HashUnlockMutex(table);
 }
 
+/**
+ * Make sure the dense array can hold \p key, growing it if needed.
+ *
+ * The array only grows while it stays reasonably full, so a few large,
+ * sparse names don't allocate megabytes; those names stay in the hash
+ * table instead.  Entries of the hash table that the grown array covers
+ * are moved into it.
+ *
+ * Must be called with the mutex held.
+ *
+ * \return true if \p key belongs in the dense array.
+ */
+static bool
+dense_reserve(struct _mesa_HashTable *table, GLuint key)
+{
+   struct _mesa_HashDenseArray *old = table->Dense;
+   const GLuint old_size = old->Size;
+
+   if (key >= MESA_HASH_MAX_DENSE_KEYS)
+      return false;
+   if (key < old_size)
+      return true;
+
+   GLuint size = MAX2(util_next_power_of_two(key + 1), old_size * 2);
+   size = MIN2(size, MESA_HASH_MAX_DENSE_KEYS);
+
+   const GLuint max_size = MAX2(MESA_HASH_MIN_DENSE_KEYS,
+                                (_mesa_HashNumEntries(table) + 1) *
+                                MESA_HASH_DENSE_SPARSITY);
+   if (size > max_size)
+      return false;
+
+   struct _mesa_HashDenseArray *dense =
+      calloc(1, sizeof(*dense) + size * sizeof(dense->Data[0]));
+   if (!dense)
+      return false;
+
+   dense->prev = old;
+   dense->Size = size;
+   memcpy(dense->Data, old->Data, old_size * sizeof(dense->Data[0]));
+
+   unsigned moved = 0;
+   hash_table_foreach(table->ht, entry) {
+      GLuint k = (uintptr_t) entry->key;
+      if (k < size) {
+         dense->Data[k] = entry->data;
+         moved++;
+      }
+   }
+
+   /* Publish the new array only once it is fully initialized.  The old one
+    * stays allocated for readers that already loaded it.  Lock-free readers
+    * only look at keys below the size of the array they loaded, and locked
+    * readers reload the array, so removing the moved entries from the hash
+    * table afterwards is safe.
+    */
+   p_atomic_set(&table->Dense, dense);
+
+   if (moved) {
+      hash_table_foreach(table->ht, entry) {
+         GLuint k = (uintptr_t) entry->key;
+         if (k < size) {
+            if (entry->data)
+               table->NumDenseEntries++;
+            _mesa_hash_table_remove(table->ht, entry);
+         }
+      }
+   }
+   return true;
+}
+
+/**
+ * Lookup an entry in the dense array, without locking.
+ *
+ * \return false if \p key is not covered by the dense array and has to be
+ * looked up in the hash table, with the mutex held.
+ */
+static inline bool
+dense_lookup(struct _mesa_HashTable *table, GLuint key, void **data)
+{
+   struct _mesa_HashDenseArray *dense = p_atomic_read(&table->Dense);
+
+   if (key >= dense->Size)
+      return false;
+
+   *data = p_atomic_read(&dense->Data[key]);
+   return true;
+}
+
 /**
  * Lookup an entry in the hash table, without locking.
  * \sa _mesa_HashLookup
@@ -125,12 +238,13 @@ static inline void *
 _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 {
    const struct hash_entry *entry;
+   void *data;
 
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   if (dense_lookup(table, key, &data))
+      return data;
 
    entry = _mesa_hash_table_search_pre_hashed(table->ht,
                                               uint_hash(key),
@@ -144,6 +258,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * The mutex is only taken for keys that aren't covered by the dense array.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -154,6 +270,10 @@ void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
    void *res;
+
+   if (dense_lookup(table, key, &res))
+      return res;
+
    _mesa_HashLockMutex(table);
    res = _mesa_HashLookup_unlocked(table, key);
    _mesa_HashUnlockMutex(table);
@@ -191,8 +311,14 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = data;
+   if (dense_reserve(table, key)) {
+      void **slot = &table->Dense->Data[key];
+      if (!*slot && data)
+         table->NumDenseEntries++;
+      else if (*slot && !data)
+         table->NumDenseEntries--;
+
+      p_atomic_set(slot, data);
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
       if (entry) {
@@ -271,8 +397,12 @@ _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
    assert(!table->InDeleteAll);
    #endif
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = NULL;
+   struct _mesa_HashDenseArray *dense = table->Dense;
+   if (key < dense->Size) {
+      if (dense->Data[key]) {
+         table->NumDenseEntries--;
+         p_atomic_set(&dense->Data[key], NULL);
+      }
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht,
                                                  uint_hash(key),
@@ -318,14 +448,18 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    #ifndef NDEBUG
    table->InDeleteAll = GL_TRUE;
    #endif
+   for (GLuint key = 0; key < table->Dense->Size; key++) {
+      void *data = table->Dense->Data[key];
+      if (data) {
+         callback(data, userData);
+         p_atomic_set(&table->Dense->Data[key], NULL);
+      }
+   }
+   table->NumDenseEntries = 0;
    hash_table_foreach(table->ht, entry) {
       callback(entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
    }
-   if (table->deleted_key_data) {
-      callback(table->deleted_key_data, userData);
-      table->deleted_key_data = NULL;
-   }
    if (table->id_alloc) {
       util_idalloc_fini(table->id_alloc);
       free(table->id_alloc);
@@ -354,11 +488,15 @@ hash_walk_unlocked(const struct _mesa_HashTable *table,
    assert(table);
    assert(callback);
 
+   /* The callback may insert new objects, so reload the array every time. */
+   for (GLuint key = 0; key < table->Dense->Size; key++) {
+      void *data = table->Dense->Data[key];
+      if (data)
+         callback(data, userData);
+   }
    hash_table_foreach(table->ht, entry) {
       callback(entry->data, userData);
    }
-   if (table->deleted_key_data)
-      callback(table->deleted_key_data, userData);
 }
 
 
@@ -391,8 +529,10 @@ _mesa_HashWalkLocked(const struct _mesa_HashTable *table,
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   if (table->deleted_key_data)
-      _mesa_debug(NULL, "%u %p\n", DELETED_KEY_VALUE, table->deleted_key_data);
+   for (GLuint key = 0; key < table->Dense->Size; key++) {
+      if (table->Dense->Data[key])
+         _mesa_debug(NULL, "%u %p\n", key, table->Dense->Data[key]);
+   }
 
    hash_table_foreach(table->ht, entry) {
       _mesa_debug(NULL, "%u %p\n", (unsigned)(uintptr_t) entry->key,
@@ -474,12 +614,5 @@ _mesa_HashFindFreeKeys(struct _mesa_HashTable *table, GLuint* keys, GLuint numKe
 GLuint
 _mesa_HashNumEntries(const struct _mesa_HashTable *table)
 {
-   GLuint count = 0;
-
-   if (table->deleted_key_data)
-      count++;
-
-   count += _mesa_hash_table_num_entries(table->ht);
-
-   return count;
+   return table->NumDenseEntries + _mesa_hash_table_num_entries(table->ht);
 }
@@ -39,18 +39,22 @@
 #include "c11/threads.h"
 #include "util/simple_mtx.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct util_idalloc;
 
 /**
- * Magic GLuint object name that gets stored outside of the struct hash_table.
+ * Magic GLuint object name that is never stored in the struct hash_table.
  *
  * The hash table needs a particular pointer to be the marker for a key that
  * was deleted from the table, along with NULL for the "never allocated in the
  * table" marker.  Legacy GL allows any GLuint to be used as a GL object name,
- * and we use a 1:1 mapping from GLuints to key pointers, so we need to be
- * able to track a GLuint that happens to match the deleted key outside of
- * struct hash_table.  We tell the hash table to use "1" as the deleted key
- * value, so that we test the deleted-key-in-the-table path as best we can.
+ * and we use a 1:1 mapping from GLuints to key pointers, so we need a GLuint
+ * that never reaches the hash table.  Since _mesa_HashTable::Dense is
+ * allocated with the table and always covers the first
+ * MESA_HASH_INITIAL_DENSE_KEYS names, any small name works; we use "1".
  */
 #define DELETED_KEY_VALUE 1
 
@@ -98,18 +102,58 @@ uint_key(GLuint id)
 }
 /** @} */
 
+/**
+ * Number of keys covered by the _mesa_HashTable::Dense array a new table
+ * starts with.
+ */
+#define MESA_HASH_INITIAL_DENSE_KEYS 64
+
+/**
+ * Largest number of keys stored in _mesa_HashTable::Dense.  Keys above this
+ * go to the hash table.
+ */
+#define MESA_HASH_MAX_DENSE_KEYS (1 << 20)
+
+/**
+ * _mesa_HashTable::Dense may always grow to this many keys.  Beyond that it
+ * only grows while it has at most MESA_HASH_DENSE_SPARSITY slots per object
+ * in the table, so sparse names don't make it allocate up to
+ * MESA_HASH_MAX_DENSE_KEYS pointers.
+ */
+#define MESA_HASH_MIN_DENSE_KEYS 1024
+#define MESA_HASH_DENSE_SPARSITY 4
+
+/**
+ * Array of object pointers indexed directly by GL name.
+ *
+ * Arrays are never freed while the table is alive: growing the array
+ * publishes a copy and keeps the old one around (through \c prev), so that
+ * lock-free readers that loaded the old pointer can keep using it.
+ */
+struct _mesa_HashDenseArray {
+   struct _mesa_HashDenseArray *prev;
+   GLuint Size;
+   void *Data[];
+};
+
 /**
  * The hash table data structure.
+ *
+ * Small names, which is where glGen*() names and names handed out by
+ * util_idalloc end up, are stored in the Dense array and can be looked up
+ * without taking the mutex.  The array covers names from 0 up to its size,
+ * which grows with the number of objects (see MESA_HASH_DENSE_SPARSITY).
+ * Other names go to the hash table.  All modifications still happen under
+ * the mutex.
  */
 struct _mesa_HashTable {
    struct hash_table *ht;
+   struct _mesa_HashDenseArray *Dense;   /**< read with p_atomic_read() */
+   GLuint NumDenseEntries;               /**< non-NULL entries in Dense */
    GLuint MaxKey;                        /**< highest key inserted so far */
    simple_mtx_t Mutex;                   /**< mutual exclusion lock */
    /* Used when name reuse is enabled */
    struct util_idalloc* id_alloc;
-
-   /** Value that would be in the table for DELETED_KEY_VALUE. */
-   void *deleted_key_data;
    #ifndef NDEBUG
    GLboolean InDeleteAll;                /**< Debug check */
    #endif
@@ -202,7 +246,7 @@ _mesa_HashWalkMaybeLocked(const struct _mesa_HashTable *table,
       _mesa_HashWalk(table, callback, userData);
 }
 
-static inline struct gl_buffer_object *
+static inline void *
 _mesa_HashLookupMaybeLocked(struct _mesa_HashTable *table, GLuint key,
                             bool locked)
 {
@@ -237,4 +281,8 @@ _mesa_HashUnlockMaybeLocked(struct _mesa_HashTable *table, bool locked)
       _mesa_HashUnlockMutex(table);
 }
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
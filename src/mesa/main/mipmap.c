@@ -41,6 +41,7 @@
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/u_gen_mipmap.h"
 
 #include "state_tracker/st_cb_texture.h"
 
@@ -1948,6 +1949,44 @@ _mesa_prepare_mipmap_levels(struct gl_context *ctx,
 }
 
 
+/**
+ * Try the gallium CPU filter, which averages sRGB formats in linear space
+ * and splits big levels over several threads.  Only borderless 2D images
+ * and arrays are handled.
+ */
+static GLboolean
+generate_mipmap_level_cpu(GLenum target, mesa_format format, GLint border,
+                          GLint srcWidth, GLint srcHeight,
+                          const GLubyte **srcData, GLint srcRowStride,
+                          GLint dstWidth, GLint dstHeight, GLint dstDepth,
+                          GLubyte **dstData, GLint dstRowStride)
+{
+   switch (target) {
+   case GL_TEXTURE_2D:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
+   case GL_TEXTURE_2D_ARRAY_EXT:
+   case GL_TEXTURE_CUBE_MAP_ARRAY:
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   if (border)
+      return GL_FALSE;
+
+   return util_gen_mipmap_cpu_level(format, dstDepth,
+                                    (const uint8_t * const *) srcData,
+                                    srcRowStride, srcWidth, srcHeight,
+                                    (uint8_t * const *) dstData,
+                                    dstRowStride, dstWidth, dstHeight);
+}
+
+
 static void
 generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
                              struct gl_texture_object *texObj,
@@ -1957,9 +1996,13 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
    GLuint level;
    GLenum datatype;
    GLuint comps;
+   mesa_format format = srcImage->TexFormat;
 
    _mesa_uncompressed_format_to_type_and_comps(srcImage->TexFormat, &datatype, &comps);
 
+   if (texObj->Sampler.Attrib.sRGBDecode == GL_SKIP_DECODE_EXT)
+      format = _mesa_get_srgb_format_linear(format);
+
    for (level = texObj->Attrib.BaseLevel; level < maxLevel; level++) {
       /* generate image[level+1] from image[level] */
       struct gl_texture_image *srcImage, *dstImage;
@@ -2031,7 +2074,12 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
          success = GL_FALSE;
       }
 
-      if (success) {
+      if (success &&
+          !generate_mipmap_level_cpu(target, format, border,
+                                     srcWidth, srcHeight,
+                                     (const GLubyte **) srcMaps, srcRowStride,
+                                     dstWidth, dstHeight, dstDepth,
+                                     dstMaps, dstRowStride)) {
          /* generate one mipmap level (for 1D/2D/3D/array/etc texture) */
          _mesa_generate_mipmap_level(target, datatype, comps, border,
                                      srcWidth, srcHeight, srcDepth,
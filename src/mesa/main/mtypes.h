@@ -1426,10 +1426,9 @@ struct gl_buffer_object
 
    /** Memoization of min/max index computations for static index buffers */
    simple_mtx_t MinMaxCacheMutex;
-   struct hash_table *MinMaxCache;
+   struct vbo_minmax_cache *MinMaxCache;
    unsigned MinMaxCacheHitIndices;
    unsigned MinMaxCacheMissIndices;
-   bool MinMaxCacheDirty;
 
    bool HandleAllocated; /**< GL_ARB_bindless_texture */
 
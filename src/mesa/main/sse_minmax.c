@@ -25,70 +25,188 @@
  *
  */
 
+
+/*
+ * Min/max scanning of index arrays.
+ *
+ * This file is built twice, once with -msse4.1 and once with -mavx2, and
+ * the variants are picked at runtime by vbo_get_minmax_index_mapped().
+ * Restart indices are skipped by forcing them to the neutral value of the
+ * min and max operations, so primitive restart doesn't need a scalar path.
+ */
+
 #include "main/sse_minmax.h"
-#include <smmintrin.h>
+#include "util/macros.h"
 #include <stdint.h>
 
-void
-_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count)
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define SIMD(x) x##_avx2
+#define VEC_BYTES 32
+
+typedef __m256i vec;
+
+#define vec_load(p)           _mm256_loadu_si256((const __m256i *)(p))
+#define vec_store(p, v)       _mm256_storeu_si256((__m256i *)(p), v)
+#define vec_or(a, b)          _mm256_or_si256(a, b)
+#define vec_andnot(a, b)      _mm256_andnot_si256(a, b)
+#define vec_zero()            _mm256_setzero_si256()
+#define vec_op(op, bits, ...) _mm256_##op##bits(__VA_ARGS__)
+
+#else
+
+#include <smmintrin.h>
+
+#define SIMD(x) x##_sse41
+#define VEC_BYTES 16
+
+typedef __m128i vec;
+
+#define vec_load(p)           _mm_loadu_si128((const __m128i *)(p))
+#define vec_store(p, v)       _mm_storeu_si128((__m128i *)(p), v)
+#define vec_or(a, b)          _mm_or_si128(a, b)
+#define vec_andnot(a, b)      _mm_andnot_si128(a, b)
+#define vec_zero()            _mm_setzero_si128()
+#define vec_op(op, bits, ...) _mm_##op##bits(__VA_ARGS__)
+
+#endif
+
+static ALWAYS_INLINE unsigned
+load_index(const uint8_t *p, unsigned index_size)
 {
-   unsigned max_ui = 0;
-   unsigned min_ui = ~0U;
-   unsigned i = 0;
-   unsigned aligned_count = count;
+   switch (index_size) {
+   case 1: return *p;
+   case 2: return *(const uint16_t *)p;
+   default: return *(const uint32_t *)p;
+   }
+}
 
-   /* handle the first few values without SSE until the pointer is aligned */
-   while (((uintptr_t)ui_indices & 15) && aligned_count) {
-      if (*ui_indices > max_ui)
-         max_ui = *ui_indices;
-      if (*ui_indices < min_ui)
-         min_ui = *ui_indices;
+static ALWAYS_INLINE vec
+vec_set1(unsigned v, unsigned index_size)
+{
+   switch (index_size) {
+   case 1: return vec_op(set1_, epi8, (char)v);
+   case 2: return vec_op(set1_, epi16, (short)v);
+   default: return vec_op(set1_, epi32, (int)v);
+   }
+}
 
-      aligned_count--;
-      ui_indices++;
+static ALWAYS_INLINE vec
+vec_min(vec a, vec b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1: return vec_op(min_, epu8, a, b);
+   case 2: return vec_op(min_, epu16, a, b);
+   default: return vec_op(min_, epu32, a, b);
    }
+}
 
-   /* TODO: The actual threshold for SSE begin useful may be higher than 8.
-    * Some careful microbenchmarks and measurement are required to
-    * find the actual tipping point.
-    */
-   if (aligned_count >= 8) {
-      unsigned max_arr[4] __attribute__ ((aligned (16)));
-      unsigned min_arr[4] __attribute__ ((aligned (16)));
-      unsigned vec_count;
-      __m128i max_ui4 = _mm_setzero_si128();
-      __m128i min_ui4 = _mm_set1_epi32(~0U);
-      __m128i ui_indices4;
-      __m128i *ui_indices_ptr;
-
-      vec_count = aligned_count & ~0x3;
-      ui_indices_ptr = (__m128i *)ui_indices;
-      for (i = 0; i < vec_count / 4; i++) {
-         ui_indices4 = _mm_load_si128(&ui_indices_ptr[i]);
-         max_ui4 = _mm_max_epu32(ui_indices4, max_ui4);
-         min_ui4 = _mm_min_epu32(ui_indices4, min_ui4);
-      }
+static ALWAYS_INLINE vec
+vec_max(vec a, vec b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1: return vec_op(max_, epu8, a, b);
+   case 2: return vec_op(max_, epu16, a, b);
+   default: return vec_op(max_, epu32, a, b);
+   }
+}
+
+static ALWAYS_INLINE vec
+vec_cmpeq(vec a, vec b, unsigned index_size)
+{
+   switch (index_size) {
+   case 1: return vec_op(cmpeq_, epi8, a, b);
+   case 2: return vec_op(cmpeq_, epi16, a, b);
+   default: return vec_op(cmpeq_, epi32, a, b);
+   }
+}
+
+static ALWAYS_INLINE void
+index_array_min_max(const uint8_t *indices, unsigned count,
+                    unsigned index_size, bool restart, unsigned restart_index,
+                    unsigned *min_index, unsigned *max_index)
+{
+   const unsigned type_max = index_size == 4 ? ~0u :
+                             (1u << (index_size * 8)) - 1;
+   const unsigned per_vec = VEC_BYTES / index_size;
+   unsigned min_i = ~0u, max_i = 0;
+   unsigned i = 0;
+
+   /* a restart index that doesn't fit never matches */
+   if (restart_index > type_max)
+      restart = false;
 
-      _mm_store_si128((__m128i *)max_arr, max_ui4);
-      _mm_store_si128((__m128i *)min_arr, min_ui4);
+   if (count >= per_vec * 2) {
+      vec vmin = vec_set1(type_max, index_size);
+      vec vmax = vec_zero();
+      uint8_t min_arr[VEC_BYTES], max_arr[VEC_BYTES];
 
-      for (i = 0; i < 4; i++) {
-         if (max_arr[i] > max_ui)
-            max_ui = max_arr[i];
-         if (min_arr[i] < min_ui)
-            min_ui = min_arr[i];
+      if (restart) {
+         const vec vrestart = vec_set1(restart_index, index_size);
+
+         for (; i + per_vec <= count; i += per_vec) {
+            vec v = vec_load(indices + i * index_size);
+            vec eq = vec_cmpeq(v, vrestart, index_size);
+
+            vmin = vec_min(vmin, vec_or(v, eq), index_size);
+            vmax = vec_max(vmax, vec_andnot(eq, v), index_size);
+         }
+      } else {
+         for (; i + per_vec <= count; i += per_vec) {
+            vec v = vec_load(indices + i * index_size);
+
+            vmin = vec_min(vmin, v, index_size);
+            vmax = vec_max(vmax, v, index_size);
+         }
+      }
+
+      vec_store(min_arr, vmin);
+      vec_store(max_arr, vmax);
+      for (unsigned j = 0; j < per_vec; j++) {
+         min_i = MIN2(min_i, load_index(min_arr + j * index_size, index_size));
+         max_i = MAX2(max_i, load_index(max_arr + j * index_size, index_size));
       }
-      i = vec_count;
    }
 
-   for (; i < aligned_count; i++) {
-      if (ui_indices[i] > max_ui)
-         max_ui = ui_indices[i];
-      if (ui_indices[i] < min_ui)
-         min_ui = ui_indices[i];
+   for (; i < count; i++) {
+      unsigned v = load_index(indices + i * index_size, index_size);
+
+      if (restart && v == restart_index)
+         continue;
+      min_i = MIN2(min_i, v);
+      max_i = MAX2(max_i, v);
    }
 
-   *min_index = min_ui;
-   *max_index = max_ui;
+   /* Lanes that only saw restart indices hold type_max as their minimum.
+    * Report ~0 like the scalar code does when every index was skipped.
+    */
+   if (min_i > max_i)
+      min_i = ~0u;
+
+   *min_index = min_i;
+   *max_index = max_i;
+}
+
+void
+SIMD(_mesa_index_array_min_max)(unsigned index_size, const void *indices,
+                                unsigned count, bool restart,
+                                unsigned restart_index,
+                                unsigned *min_index, unsigned *max_index)
+{
+   switch (index_size) {
+   case 1:
+      index_array_min_max(indices, count, 1, restart, restart_index,
+                          min_index, max_index);
+      break;
+   case 2:
+      index_array_min_max(indices, count, 2, restart, restart_index,
+                          min_index, max_index);
+      break;
+   default:
+      index_array_min_max(indices, count, 4, restart, restart_index,
+                          min_index, max_index);
+      break;
+   }
 }
@@ -28,8 +28,23 @@
 #ifndef SSE_MINMAX_H
 #define SSE_MINMAX_H
 
+#include <stdbool.h>
+
+/**
+ * Min and max of an array of 1, 2 or 4 byte indices, skipping
+ * restart_index if restart is set.  If every index is skipped, min is ~0
+ * and max is 0.
+ */
+void
+_mesa_index_array_min_max_sse41(unsigned index_size, const void *indices,
+                                unsigned count, bool restart,
+                                unsigned restart_index,
+                                unsigned *min_index, unsigned *max_index);
+
 void
-_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
-                         unsigned *max_index, const unsigned count);
+_mesa_index_array_min_max_avx2(unsigned index_size, const void *indices,
+                               unsigned count, bool restart,
+                               unsigned restart_index,
+                               unsigned *min_index, unsigned *max_index);
 
 #endif /* SSE_MINMAX_H */
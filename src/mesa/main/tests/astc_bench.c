@@ -0,0 +1,170 @@
+/*
+ * Copyright 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Throughput of _mesa_unpack_astc_2d_ldr() for every 2D block size.  The
+ * images are tiled with a pool of random valid blocks, which is harder on
+ * the decoder's per-mode caches than real textures, and every block is
+ * checked against the same block decoded on its own.
+ *
+ * Usage: ./astc_bench [width [height]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main/formats.h"
+#include "main/texcompress_astc.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+
+static const mesa_format formats[] = {
+   MESA_FORMAT_RGBA_ASTC_4x4,
+   MESA_FORMAT_RGBA_ASTC_5x4,
+   MESA_FORMAT_RGBA_ASTC_5x5,
+   MESA_FORMAT_RGBA_ASTC_6x5,
+   MESA_FORMAT_RGBA_ASTC_6x6,
+   MESA_FORMAT_RGBA_ASTC_8x5,
+   MESA_FORMAT_RGBA_ASTC_8x6,
+   MESA_FORMAT_RGBA_ASTC_8x8,
+   MESA_FORMAT_RGBA_ASTC_10x5,
+   MESA_FORMAT_RGBA_ASTC_10x6,
+   MESA_FORMAT_RGBA_ASTC_10x8,
+   MESA_FORMAT_RGBA_ASTC_10x10,
+   MESA_FORMAT_RGBA_ASTC_12x10,
+   MESA_FORMAT_RGBA_ASTC_12x12,
+   MESA_FORMAT_SRGB8_ALPHA8_ASTC_4x4,
+   MESA_FORMAT_SRGB8_ALPHA8_ASTC_8x8,
+   MESA_FORMAT_SRGB8_ALPHA8_ASTC_12x12,
+};
+
+#define POOL_SIZE 256
+
+struct pool_block {
+   uint8_t data[16];
+   uint8_t texels[12 * 12 * 4];
+};
+
+
+/**
+ * Fill the pool with random blocks that don't decode to the error colour.
+ */
+static void
+fill_pool(mesa_format format, unsigned blk_w, unsigned blk_h,
+          struct pool_block *pool)
+{
+   unsigned n = 0, i;
+
+   while (n < POOL_SIZE) {
+      struct pool_block *blk = &pool[n];
+      bool error = true;
+
+      for (i = 0; i < 16; i++)
+         blk->data[i] = rand();
+
+      _mesa_unpack_astc_2d_ldr(blk->texels, blk_w * 4, blk->data, 16,
+                               blk_w, blk_h, format);
+
+      for (i = 0; i < blk_w * blk_h; i++) {
+         const uint8_t *t = &blk->texels[i * 4];
+         if (t[0] != 0xff || t[1] != 0 || t[2] != 0xff || t[3] != 0xff)
+            error = false;
+      }
+
+      if (!error)
+         n++;
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned width = argc > 1 ? atoi(argv[1]) : 4096;
+   unsigned height = argc > 2 ? atoi(argv[2]) : width;
+   struct pool_block *pool = malloc(POOL_SIZE * sizeof(*pool));
+   uint8_t *dst = malloc((size_t)width * height * 4);
+   int failed = 0;
+   unsigned i;
+
+   if (!pool || !dst || !width || !height)
+      return 1;
+
+   printf("%-32s %10s %10s\n", "format", "ms", "Mtexel/s");
+
+   for (i = 0; i < ARRAY_SIZE(formats); i++) {
+      const mesa_format format = formats[i];
+      unsigned blk_w, blk_h, x_blocks, y_blocks, x, y, j;
+      uint8_t *src, *index;
+      int64_t start;
+      double t;
+
+      _mesa_get_format_block_size(format, &blk_w, &blk_h);
+      x_blocks = DIV_ROUND_UP(width, blk_w);
+      y_blocks = DIV_ROUND_UP(height, blk_h);
+
+      src = malloc((size_t)x_blocks * y_blocks * 16);
+      index = malloc((size_t)x_blocks * y_blocks);
+      if (!src || !index)
+         return 1;
+
+      srand(4359025 + i);
+      fill_pool(format, blk_w, blk_h, pool);
+      for (j = 0; j < x_blocks * y_blocks; j++) {
+         index[j] = rand() % POOL_SIZE;
+         memcpy(&src[j * 16], pool[index[j]].data, 16);
+      }
+
+      start = os_time_get_nano();
+      _mesa_unpack_astc_2d_ldr(dst, width * 4, src, x_blocks * 16,
+                               width, height, format);
+      t = (os_time_get_nano() - start) / 1e9;
+
+      for (y = 0; y < height; y++) {
+         for (x = 0; x < width; x++) {
+            const struct pool_block *blk =
+               &pool[index[(y / blk_h) * x_blocks + x / blk_w]];
+            const uint8_t *expected =
+               &blk->texels[((y % blk_h) * blk_w + x % blk_w) * 4];
+
+            if (memcmp(&dst[(y * width + x) * 4], expected, 4)) {
+               printf("%s: texel %u,%u differs from the block decoded alone\n",
+                      _mesa_get_format_name(format), x, y);
+               failed = 1;
+               y = height;
+               break;
+            }
+         }
+      }
+
+      printf("%-32s %10.2f %10.1f\n", _mesa_get_format_name(format),
+             t * 1e3, width * height / t / 1e6);
+
+      free(index);
+      free(src);
+   }
+
+   free(dst);
+   free(pool);
+
+   return failed;
+}
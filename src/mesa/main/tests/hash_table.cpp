@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "main/hash.h"
+#include "util/macros.h"
+
+static void
+count_cb(void *data, void *userData)
+{
+   (*(unsigned *) userData)++;
+}
+
+/* Keys that go to the dense array and keys that don't must behave the
+ * same.
+ */
+static const GLuint keys[] = {
+   1, 2, 63, 64, 65, 1000,
+   MESA_HASH_MAX_DENSE_KEYS - 1,
+   MESA_HASH_MAX_DENSE_KEYS,
+   0xdeadbeef,
+   ~0u,
+};
+
+/* DELETED_KEY_VALUE must not reach the hash table before the first insert */
+TEST(HashTable, LookupEmpty)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      EXPECT_EQ(_mesa_HashLookup(table, keys[i]), (void *) NULL);
+
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(HashTable, InsertLookupRemove)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   int objects[ARRAY_SIZE(keys)];
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      _mesa_HashInsert(table, keys[i], &objects[i], false);
+
+   EXPECT_EQ(_mesa_HashNumEntries(table), ARRAY_SIZE(keys));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      EXPECT_EQ(_mesa_HashLookup(table, keys[i]), &objects[i]);
+   EXPECT_EQ(_mesa_HashLookup(table, 3), (void *) NULL);
+   EXPECT_EQ(_mesa_HashLookup(table, 0xdeadbeee), (void *) NULL);
+
+   unsigned count = 0;
+   _mesa_HashWalk(table, count_cb, &count);
+   EXPECT_EQ(count, ARRAY_SIZE(keys));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i += 2)
+      _mesa_HashRemove(table, keys[i]);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++) {
+      EXPECT_EQ(_mesa_HashLookup(table, keys[i]),
+                i % 2 ? &objects[i] : (void *) NULL);
+   }
+   EXPECT_EQ(_mesa_HashNumEntries(table), ARRAY_SIZE(keys) / 2);
+
+   count = 0;
+   _mesa_HashDeleteAll(table, count_cb, &count);
+   EXPECT_EQ(count, ARRAY_SIZE(keys) / 2);
+   EXPECT_EQ(_mesa_HashNumEntries(table), 0u);
+   EXPECT_EQ(_mesa_HashLookup(table, keys[1]), (void *) NULL);
+
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(HashTable, GrowKeepsEntries)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   static int objects[4096];
+
+   for (GLuint key = 1; key < ARRAY_SIZE(objects); key++) {
+      _mesa_HashInsert(table, key, &objects[key], false);
+      EXPECT_EQ(_mesa_HashLookup(table, 1), &objects[1]);
+      EXPECT_EQ(_mesa_HashLookup(table, key), &objects[key]);
+   }
+
+   for (GLuint key = 1; key < ARRAY_SIZE(objects); key++)
+      _mesa_HashRemove(table, key);
+
+   EXPECT_EQ(_mesa_HashNumEntries(table), 0u);
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(HashTable, SparseKeysDontGrowDense)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   static int objects[4096];
+   const GLuint sparse[] = { MESA_HASH_MAX_DENSE_KEYS / 2, 3000 };
+   int sparse_objects[ARRAY_SIZE(sparse)];
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sparse); i++)
+      _mesa_HashInsert(table, sparse[i], &sparse_objects[i], false);
+   for (unsigned i = 0; i < ARRAY_SIZE(sparse); i++)
+      EXPECT_EQ(_mesa_HashLookup(table, sparse[i]), &sparse_objects[i]);
+   EXPECT_LE(table->Dense->Size, (GLuint) MESA_HASH_MIN_DENSE_KEYS);
+
+   /* Once enough objects exist, the array grows over the smaller sparse
+    * key, which has to move out of the hash table.
+    */
+   unsigned num_objects = 0;
+   for (GLuint key = 1; key < ARRAY_SIZE(objects); key++) {
+      if (key != sparse[1]) {
+         _mesa_HashInsert(table, key, &objects[key], false);
+         num_objects++;
+      }
+   }
+   EXPECT_GT(table->Dense->Size, sparse[1]);
+   EXPECT_LT(table->Dense->Size, sparse[0]);
+   EXPECT_EQ(_mesa_HashNumEntries(table), num_objects + ARRAY_SIZE(sparse));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sparse); i++)
+      EXPECT_EQ(_mesa_HashLookup(table, sparse[i]), &sparse_objects[i]);
+   EXPECT_EQ(_mesa_HashLookup(table, 1), &objects[1]);
+
+   _mesa_HashRemove(table, sparse[1]);
+   EXPECT_EQ(_mesa_HashLookup(table, sparse[1]), (void *) NULL);
+
+   unsigned count = 0;
+   _mesa_HashDeleteAll(table, count_cb, &count);
+   EXPECT_EQ(count, num_objects + ARRAY_SIZE(sparse) - 1);
+   _mesa_DeleteHashTable(table);
+}
+
+/* Other contexts look names up without the mutex while one context creates
+ * objects, which grows the dense array and moves entries out of the hash
+ * table.  A reader must always see either nothing or the right object, and
+ * always see the objects that existed before its lookup started.
+ */
+TEST(HashTable, ConcurrentLookupInsertGrow)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   static int objects[1 << 16];
+   const GLuint sparse = 3 * MESA_HASH_MIN_DENSE_KEYS;
+   int sparse_object;
+   std::atomic<GLuint> last_key(0);
+   std::atomic<bool> done(false);
+   std::atomic<unsigned> errors(0);
+
+   /* Starts in the hash table, and moves to the dense array once enough
+    * objects exist.
+    */
+   _mesa_HashInsert(table, sparse, &sparse_object, false);
+
+   std::vector<std::thread> readers;
+   for (unsigned t = 0; t < 3; t++) {
+      readers.emplace_back([&, t] {
+         GLuint key = 1 + t;
+
+         while (!done.load(std::memory_order_acquire)) {
+            const GLuint last = last_key.load(std::memory_order_acquire);
+            void *data = _mesa_HashLookup(table, key);
+
+            if (key != sparse) {
+               if (key <= last ? data != &objects[key]
+                               : data && data != &objects[key])
+                  errors++;
+            }
+            if (_mesa_HashLookup(table, sparse) != &sparse_object)
+               errors++;
+
+            key = key * 7 % ARRAY_SIZE(objects) + 1;
+         }
+      });
+   }
+
+   for (GLuint key = 1; key < ARRAY_SIZE(objects); key++) {
+      if (key != sparse)
+         _mesa_HashInsert(table, key, &objects[key], false);
+      last_key.store(key, std::memory_order_release);
+
+      /* let the readers run between growths on a single core, too */
+      if (key % 256 == 0)
+         std::this_thread::yield();
+   }
+   done.store(true, std::memory_order_release);
+
+   for (std::thread &reader : readers)
+      reader.join();
+
+   EXPECT_EQ(errors.load(), 0u);
+   EXPECT_GE(table->Dense->Size, ARRAY_SIZE(objects));
+   EXPECT_EQ(_mesa_HashNumEntries(table), ARRAY_SIZE(objects) - 1);
+
+   _mesa_DeleteHashTable(table);
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file vbo_minmax_index.cpp
+ *
+ * Compare the index scanners and the min/max segment tree of
+ * vbo_minmax_index.c against a brute force scan, with random buffers,
+ * draws and partial buffer writes.  Every test is run once per scanner
+ * (scalar, SSE4.1, AVX2) the CPU supports.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "frontend/api.h"
+#include "main/mtypes.h"
+#include "pipe/p_context.h"
+#include "pipe/p_state.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "vbo/vbo.h"
+
+extern "C" {
+#include "x86/common_x86_asm.h"
+
+extern struct util_cpu_caps_t util_cpu_caps;
+}
+
+/* MINMAX_LEAF_BYTES of vbo_minmax_index.c */
+#define LEAF_BYTES 1024
+
+enum minmax_scanner {
+   SCANNER_SCALAR,
+   SCANNER_SSE41,
+   SCANNER_AVX2,
+};
+
+static const char *
+scanner_name(const testing::TestParamInfo<minmax_scanner> &info)
+{
+   switch (info.param) {
+   case SCANNER_SCALAR: return "scalar";
+   case SCANNER_SSE41: return "sse41";
+   default: return "avx2";
+   }
+}
+
+/* A buffer resource backed by plain memory. */
+struct fake_buffer {
+   struct pipe_resource base;
+   struct pipe_transfer transfer;
+   std::vector<uint8_t> data;
+};
+
+static void *
+fake_buffer_map(struct pipe_context *pipe, struct pipe_resource *resource,
+                unsigned level, unsigned usage, const struct pipe_box *box,
+                struct pipe_transfer **transfer)
+{
+   struct fake_buffer *buf = (struct fake_buffer *)resource;
+
+   *transfer = &buf->transfer;
+   return buf->data.data() + box->x;
+}
+
+static void
+fake_buffer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+}
+
+static unsigned
+load_index(const uint8_t *p, unsigned index_size)
+{
+   switch (index_size) {
+   case 1: return *p;
+   case 2: return *(const uint16_t *)p;
+   default: return *(const uint32_t *)p;
+   }
+}
+
+static void
+brute_minmax(const uint8_t *indices, unsigned count, unsigned index_size,
+             bool restart, unsigned restart_index,
+             unsigned *min_index, unsigned *max_index)
+{
+   *min_index = ~0u;
+   *max_index = 0;
+
+   for (unsigned i = 0; i < count; i++) {
+      unsigned v = load_index(indices + i * index_size, index_size);
+
+      if (restart && v == restart_index)
+         continue;
+      *min_index = MIN2(*min_index, v);
+      *max_index = MAX2(*max_index, v);
+   }
+}
+
+class vbo_minmax_index : public testing::TestWithParam<minmax_scanner> {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void fill(uint8_t *data, unsigned size);
+   unsigned pick_restart_index(const uint8_t *indices, unsigned count,
+                               unsigned index_size);
+
+   std::mt19937 rng;
+   struct util_cpu_caps_t saved_caps;
+   int saved_x86_features;
+};
+
+void
+vbo_minmax_index::SetUp()
+{
+   util_cpu_detect();
+   _mesa_get_x86_features();
+
+   saved_caps = util_cpu_caps;
+   saved_x86_features = _mesa_x86_cpu_features;
+
+   /* vbo_get_minmax_index_mapped() picks the scanner from these. */
+   switch (GetParam()) {
+   case SCANNER_SCALAR:
+      util_cpu_caps.has_avx2 = 0;
+      _mesa_x86_cpu_features &= ~X86_FEATURE_SSE4_1;
+      break;
+   case SCANNER_SSE41:
+      if (!(_mesa_x86_cpu_features & X86_FEATURE_SSE4_1))
+         GTEST_SKIP() << "no SSE4.1";
+      util_cpu_caps.has_avx2 = 0;
+      break;
+   case SCANNER_AVX2:
+      if (!util_cpu_caps.has_avx2)
+         GTEST_SKIP() << "no AVX2";
+      break;
+   }
+
+   rng.seed(0x5eed);
+}
+
+void
+vbo_minmax_index::TearDown()
+{
+   util_cpu_caps = saved_caps;
+   _mesa_x86_cpu_features = saved_x86_features;
+}
+
+/* Random bytes in a small random range, and some 0xff for the restart
+ * index, so that each write is likely to move the min or max.
+ */
+void
+vbo_minmax_index::fill(uint8_t *data, unsigned size)
+{
+   unsigned base = rng() % 256;
+   unsigned spread = 1 + rng() % 16;
+
+   for (unsigned i = 0; i < size; i++)
+      data[i] = rng() % 7 ? MIN2(base + rng() % spread, 0xff) : 0xff;
+}
+
+/* The fixed restart index of the type, one that occurs in the data, or
+ * one that can't occur.
+ */
+unsigned
+vbo_minmax_index::pick_restart_index(const uint8_t *indices, unsigned count,
+                                     unsigned index_size)
+{
+   switch (rng() % 3) {
+   case 0:
+      return index_size == 4 ? ~0u : (1u << (index_size * 8)) - 1;
+   case 1:
+      if (count)
+         return load_index(indices + rng() % count * index_size, index_size);
+      return 0;
+   default:
+      return ~0u;
+   }
+}
+
+TEST_P(vbo_minmax_index, scan)
+{
+   std::vector<uint8_t> buf(16384 + 64);
+
+   for (unsigned iter = 0; iter < 4000; iter++) {
+      unsigned index_size = 1 << (rng() % 3);
+      unsigned count = rng() % (rng() % 2 ? 70 : 16384 / index_size);
+      /* misaligned for the vector loads, but aligned to the index size */
+      unsigned offset = rng() % 16 * index_size;
+      bool restart = rng() % 2;
+      unsigned min_index, max_index, ref_min, ref_max;
+
+      fill(buf.data(), offset + count * index_size);
+      unsigned restart_index = pick_restart_index(buf.data() + offset, count,
+                                                  index_size);
+
+      brute_minmax(buf.data() + offset, count, index_size, restart,
+                   restart_index, &ref_min, &ref_max);
+      vbo_get_minmax_index_mapped(count, index_size, restart_index, restart,
+                                  buf.data() + offset, &min_index, &max_index);
+
+      ASSERT_EQ(ref_min, min_index) << "index size " << index_size
+                                    << " count " << count
+                                    << " restart " << restart;
+      ASSERT_EQ(ref_max, max_index) << "index size " << index_size
+                                    << " count " << count
+                                    << " restart " << restart;
+   }
+}
+
+TEST_P(vbo_minmax_index, tree)
+{
+   struct st_config_options opts = {};
+   struct pipe_context pipe = {};
+   struct gl_context *ctx = CALLOC_STRUCT(gl_context);
+
+   pipe.buffer_map = fake_buffer_map;
+   pipe.buffer_unmap = fake_buffer_unmap;
+   ctx->pipe = &pipe;
+   ctx->st_opts = &opts;
+
+   for (unsigned round = 0; round < 100; round++) {
+      struct gl_buffer_object *obj = CALLOC_STRUCT(gl_buffer_object);
+      struct fake_buffer buf = {};
+      /* one leaf or less, or many leaves with a partial last one */
+      unsigned size = 1 + rng() % (round % 4 ? 100000 : 3 * LEAF_BYTES);
+      unsigned index_size = 1 << (rng() % 3);
+      bool restart = rng() % 2;
+      unsigned restart_index = index_size == 4 ? ~0u :
+                               (1u << (index_size * 8)) - 1;
+
+      buf.data.resize(size);
+      buf.base.width0 = size;
+      fill(buf.data.data(), size);
+      obj->Size = size;
+      obj->buffer = &buf.base;
+      simple_mtx_init(&obj->MinMaxCacheMutex, mtx_plain);
+
+      for (unsigned q = 0; q < 200; q++) {
+         /* partial buffer writes, half of them next to a leaf boundary */
+         if (rng() % 4 == 0) {
+            unsigned offset = rng() % size;
+            unsigned length = 1 + rng() % (rng() % 2 ? 64 : 5000);
+
+            if (rng() % 2) {
+               offset = rng() % (size / LEAF_BYTES + 1) * LEAF_BYTES;
+               offset = MIN2(offset + rng() % 3, size) - MIN2(offset, 1u);
+               length = rng() % 2 ? 1 + rng() % 3 : length;
+            }
+            length = MIN2(length, size - offset);
+            fill(buf.data.data() + offset, length);
+            vbo_invalidate_minmax_cache(obj, offset, length);
+         }
+
+         if (rng() % 50 == 0) {
+            index_size = 1 << (rng() % 3);
+            restart_index = index_size == 4 ? ~0u :
+                            (1u << (index_size * 8)) - 1;
+         }
+         if (rng() % 50 == 0)
+            restart = !restart;
+         if (rng() % 50 == 0)
+            restart_index = pick_restart_index(buf.data.data(),
+                                               size / index_size, index_size);
+
+         unsigned num_indices = size / index_size;
+         if (!num_indices)
+            continue;
+
+         /* one to three draws, sometimes back to back so they are merged */
+         struct pipe_draw_start_count_bias draws[3];
+         unsigned num_draws = 1 + rng() % 3;
+         unsigned ref_min = ~0u, ref_max = 0;
+
+         for (unsigned i = 0; i < num_draws; i++) {
+            unsigned tmp_min, tmp_max;
+
+            if (i && rng() % 2)
+               draws[i].start = draws[i - 1].start + draws[i - 1].count;
+            else
+               draws[i].start = rng() % num_indices;
+            draws[i].start = MIN2(draws[i].start, num_indices - 1);
+            draws[i].count = 1 + rng() % (num_indices - draws[i].start);
+            draws[i].index_bias = 0;
+
+            brute_minmax(buf.data.data() + draws[i].start * index_size,
+                         draws[i].count, index_size, restart, restart_index,
+                         &tmp_min, &tmp_max);
+            ref_min = MIN2(ref_min, tmp_min);
+            ref_max = MAX2(ref_max, tmp_max);
+         }
+
+         struct pipe_draw_info info = {};
+         info.index_size = index_size;
+         info.index.gl_bo = obj;
+         info.primitive_restart = restart;
+         info.restart_index = restart_index;
+
+         vbo_get_minmax_indices_gallium(ctx, &info, draws, num_draws);
+
+         ASSERT_EQ(ref_min, info.min_index) << "round " << round
+                                            << " draw " << q;
+         ASSERT_EQ(ref_max, info.max_index) << "round " << round
+                                            << " draw " << q;
+      }
+
+      /* A whole-buffer draw covers a leaf and must use the tree, unless
+       * the writes made it give up on this buffer.
+       */
+      if (size >= LEAF_BYTES + index_size &&
+          !(obj->UsageHistory & USAGE_DISABLE_MINMAX_CACHE)) {
+         struct pipe_draw_start_count_bias draw = { 0, size / index_size, 0 };
+         struct pipe_draw_info info = {};
+         unsigned ref_min, ref_max;
+
+         info.index_size = index_size;
+         info.index.gl_bo = obj;
+         info.primitive_restart = restart;
+         info.restart_index = restart_index;
+         brute_minmax(buf.data.data(), size / index_size, index_size, restart,
+                      restart_index, &ref_min, &ref_max);
+         vbo_get_minmax_indices_gallium(ctx, &info, &draw, 1);
+
+         EXPECT_EQ(ref_min, info.min_index) << "round " << round;
+         EXPECT_EQ(ref_max, info.max_index) << "round " << round;
+         EXPECT_TRUE(obj->MinMaxCache != NULL) << "round " << round;
+      }
+
+      vbo_delete_minmax_cache(obj);
+      simple_mtx_destroy(&obj->MinMaxCacheMutex);
+      FREE(obj);
+   }
+
+   FREE(ctx);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+   scanners, vbo_minmax_index,
+   testing::Values(SCANNER_SCALAR, SCANNER_SSE41, SCANNER_AVX2),
+   scanner_name);
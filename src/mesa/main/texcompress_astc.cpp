@@ -36,9 +36,16 @@
 #include "texcompress_astc.h"
 #include "macros.h"
 #include "util/half_float.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 #include <stdio.h>
 #include <cstdlib>  // for abort() on windows
 
+#if defined(__SSE2__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#include <emmintrin.h>
+#define ASTC_USE_SSE2
+#endif
+
 static bool VERBOSE_DECODE = false;
 static bool VERBOSE_WRITE = false;
 
@@ -48,6 +55,20 @@ uint16_div_64k_to_half_to_unorm8(uint16_t v)
    return _mesa_half_to_unorm8(_mesa_uint16_div_64k_to_half(v));
 }
 
+/* uint16_div_64k_to_half_to_unorm8() of every value, except that 65535
+ * maps to 0xff as write_decoded() wants.
+ */
+static uint8_t unorm16_to_unorm8[65536];
+static once_flag unorm16_to_unorm8_once = ONCE_FLAG_INIT;
+
+static void
+init_unorm16_to_unorm8(void)
+{
+   for (unsigned i = 0; i < 65535; i++)
+      unorm16_to_unorm8[i] = uint16_div_64k_to_half_to_unorm8(i);
+   unorm16_to_unorm8[65535] = 0xff;
+}
+
 class decode_error
 {
 public:
@@ -539,17 +560,54 @@ struct OutputBitVector
 };
 
 
+/**
+ * Where a texel's infilled weight comes from: the top-left of the 2x2
+ * weights around it and their bilinear factors.  These only depend on the
+ * block size and the weight grid size.
+ */
+struct infill_tap
+{
+   uint8_t v0;
+   uint8_t w00, w01, w10, w11;
+};
+
 class Decoder
 {
 public:
    Decoder(int block_w, int block_h, int block_d, bool srgb, bool output_unorm8)
       : block_w(block_w), block_h(block_h), block_d(block_d), srgb(srgb),
-        output_unorm8(output_unorm8) {}
+        output_unorm8(output_unorm8)
+   {
+      for (unsigned i = 0; i < ARRAY_SIZE(infill_cache); ++i)
+         infill_cache[i].key = -1;
+      for (unsigned i = 0; i < ARRAY_SIZE(partition_cache); ++i)
+         partition_cache[i].key = -1;
+      if (output_unorm8)
+         call_once(&unorm16_to_unorm8_once, init_unorm16_to_unorm8);
+   }
 
-   decode_error::type decode(const uint8_t *in, uint16_t *output) const;
+   decode_error::type decode(const uint8_t *in, uint16_t *output);
+
+   const infill_tap *get_infill_taps(int wt_w, int wt_h, int wt_d);
+   const uint8_t *get_partitions(int seed, int num_parts);
 
    int block_w, block_h, block_d;
    bool srgb, output_unorm8;
+
+private:
+   /* The blocks of an image mostly share a few weight grid sizes and
+    * partitionings, so their per-texel tables are kept in small
+    * direct-mapped caches rather than recomputed for every block.
+    */
+   struct infill_cache_entry {
+      int key;
+      infill_tap taps[216];
+   } infill_cache[32];
+
+   struct partition_cache_entry {
+      int key;
+      uint8_t partition[216];
+   } partition_cache[64];
 };
 
 struct Block
@@ -629,7 +687,7 @@ struct Block
    void unquantise_weights();
    void unquantise_colour_endpoints();
 
-   decode_error::type decode(const Decoder &decoder, InputBitVector in);
+   decode_error::type decode(Decoder &decoder, InputBitVector in);
 
    decode_error::type decode_block_mode(InputBitVector in);
    decode_error::type decode_void_extent(InputBitVector in);
@@ -637,13 +695,13 @@ struct Block
    void unpack_colour_endpoints(InputBitVector in);
    void decode_colour_endpoints();
    void unpack_weights(InputBitVector in);
-   void compute_infill_weights(int block_w, int block_h, int block_d);
+   void compute_infill_weights(const infill_tap *taps, int num_texels);
 
-   void write_decoded(const Decoder &decoder, uint16_t *output);
+   void write_decoded(Decoder &decoder, uint16_t *output);
 };
 
 
-decode_error::type Decoder::decode(const uint8_t *in, uint16_t *output) const
+decode_error::type Decoder::decode(const uint8_t *in, uint16_t *output)
 {
    Block blk;
    InputBitVector in_vec;
@@ -673,6 +731,85 @@ decode_error::type Decoder::decode(const uint8_t *in, uint16_t *output) const
 }
 
 
+const infill_tap *Decoder::get_infill_taps(int wt_w, int wt_h, int wt_d)
+{
+   int key = wt_w | (wt_h << 4) | (wt_d << 8);
+   infill_cache_entry *entry =
+      &infill_cache[(wt_w * 13 + wt_h) % ARRAY_SIZE(infill_cache)];
+
+   if (entry->key == key)
+      return entry->taps;
+
+   int Ds = block_w <= 1 ? 0 : (1024 + block_w / 2) / (block_w - 1);
+   int Dt = block_h <= 1 ? 0 : (1024 + block_h / 2) / (block_h - 1);
+   int Dr = block_d <= 1 ? 0 : (1024 + block_d / 2) / (block_d - 1);
+   infill_tap *tap = entry->taps;
+   for (int r = 0; r < block_d; ++r) {
+      for (int t = 0; t < block_h; ++t) {
+         for (int s = 0; s < block_w; ++s) {
+            int cs = Ds * s;
+            int ct = Dt * t;
+            int cr = Dr * r;
+            int gs = (cs * (wt_w - 1) + 32) >> 6;
+            int gt = (ct * (wt_h - 1) + 32) >> 6;
+            int gr = (cr * (wt_d - 1) + 32) >> 6;
+            assert(gs >= 0 && gs <= 176);
+            assert(gt >= 0 && gt <= 176);
+            assert(gr >= 0 && gr <= 176);
+            int js = gs >> 4;
+            int fs = gs & 0xf;
+            int jt = gt >> 4;
+            int ft = gt & 0xf;
+            int jr = gr >> 4;
+            int fr = gr & 0xf;
+
+            /* TODO: 3D */
+            (void)jr;
+            (void)fr;
+
+            int w11 = (fs * ft + 8) >> 4;
+
+            tap->v0 = js + jt * wt_w;
+            tap->w00 = 16 - fs - ft + w11;
+            tap->w01 = fs - w11;
+            tap->w10 = ft - w11;
+            tap->w11 = w11;
+            tap++;
+         }
+      }
+   }
+
+   entry->key = key;
+   return entry->taps;
+}
+
+const uint8_t *Decoder::get_partitions(int seed, int num_parts)
+{
+   int key = seed | (num_parts << 10);
+   partition_cache_entry *entry =
+      &partition_cache[(seed ^ (num_parts << 4)) % ARRAY_SIZE(partition_cache)];
+
+   if (entry->key == key)
+      return entry->partition;
+
+   int small_block = (block_w * block_h * block_d) < 31;
+   int idx = 0;
+   for (int z = 0; z < block_d; ++z) {
+      for (int y = 0; y < block_h; ++y) {
+         for (int x = 0; x < block_w; ++x) {
+            entry->partition[idx] = select_partition(seed, x, y, z, num_parts,
+                                                     small_block);
+            assert(entry->partition[idx] < num_parts);
+            idx++;
+         }
+      }
+   }
+
+   entry->key = key;
+   return entry->partition;
+}
+
+
 decode_error::type Block::decode_void_extent(InputBitVector block)
 {
    /* TODO: 3D */
@@ -1260,69 +1397,39 @@ void Block::unquantise_weights()
    }
 }
 
-void Block::compute_infill_weights(int block_w, int block_h, int block_d)
+void Block::compute_infill_weights(const infill_tap *taps, int num_texels)
 {
-   int Ds = block_w <= 1 ? 0 : (1024 + block_w / 2) / (block_w - 1);
-   int Dt = block_h <= 1 ? 0 : (1024 + block_h / 2) / (block_h - 1);
-   int Dr = block_d <= 1 ? 0 : (1024 + block_d / 2) / (block_d - 1);
-   for (int r = 0; r < block_d; ++r) {
-      for (int t = 0; t < block_h; ++t) {
-         for (int s = 0; s < block_w; ++s) {
-            int cs = Ds * s;
-            int ct = Dt * t;
-            int cr = Dr * r;
-            int gs = (cs * (wt_w - 1) + 32) >> 6;
-            int gt = (ct * (wt_h - 1) + 32) >> 6;
-            int gr = (cr * (wt_d - 1) + 32) >> 6;
-            assert(gs >= 0 && gs <= 176);
-            assert(gt >= 0 && gt <= 176);
-            assert(gr >= 0 && gr <= 176);
-            int js = gs >> 4;
-            int fs = gs & 0xf;
-            int jt = gt >> 4;
-            int ft = gt & 0xf;
-            int jr = gr >> 4;
-            int fr = gr & 0xf;
-
-            /* TODO: 3D */
-            (void)jr;
-            (void)fr;
-
-            int w11 = (fs * ft + 8) >> 4;
-            int w10 = ft - w11;
-            int w01 = fs - w11;
-            int w00 = 16 - fs - ft + w11;
-
-            if (dual_plane) {
-               int p00, p01, p10, p11, i0, i1;
-               int v0 = js + jt * wt_w;
-               p00 = weights[(v0) * 2];
-               p01 = weights[(v0 + 1) * 2];
-               p10 = weights[(v0 + wt_w) * 2];
-               p11 = weights[(v0 + wt_w + 1) * 2];
-               i0 = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
-               p00 = weights[(v0) * 2 + 1];
-               p01 = weights[(v0 + 1) * 2 + 1];
-               p10 = weights[(v0 + wt_w) * 2 + 1];
-               p11 = weights[(v0 + wt_w + 1) * 2 + 1];
-               assert((v0 + wt_w + 1) * 2 + 1 < (int)ARRAY_SIZE(weights));
-               i1 = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
-               assert(0 <= i0 && i0 <= 64);
-               infill_weights[0][s + t*block_w + r*block_w*block_h] = i0;
-               infill_weights[1][s + t*block_w + r*block_w*block_h] = i1;
-            } else {
-               int p00, p01, p10, p11, i;
-               int v0 = js + jt * wt_w;
-               p00 = weights[v0];
-               p01 = weights[v0 + 1];
-               p10 = weights[v0 + wt_w];
-               p11 = weights[v0 + wt_w + 1];
-               assert(v0 + wt_w + 1 < (int)ARRAY_SIZE(weights));
-               i = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
-               assert(0 <= i && i <= 64);
-               infill_weights[0][s + t*block_w + r*block_w*block_h] = i;
-            }
-         }
+   for (int idx = 0; idx < num_texels; ++idx) {
+      const infill_tap *tap = &taps[idx];
+      int w00 = tap->w00, w01 = tap->w01, w10 = tap->w10, w11 = tap->w11;
+      int v0 = tap->v0;
+
+      if (dual_plane) {
+         int p00, p01, p10, p11, i0, i1;
+         p00 = weights[(v0) * 2];
+         p01 = weights[(v0 + 1) * 2];
+         p10 = weights[(v0 + wt_w) * 2];
+         p11 = weights[(v0 + wt_w + 1) * 2];
+         i0 = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
+         p00 = weights[(v0) * 2 + 1];
+         p01 = weights[(v0 + 1) * 2 + 1];
+         p10 = weights[(v0 + wt_w) * 2 + 1];
+         p11 = weights[(v0 + wt_w + 1) * 2 + 1];
+         assert((v0 + wt_w + 1) * 2 + 1 < (int)ARRAY_SIZE(weights));
+         i1 = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
+         assert(0 <= i0 && i0 <= 64);
+         infill_weights[0][idx] = i0;
+         infill_weights[1][idx] = i1;
+      } else {
+         int p00, p01, p10, p11, i;
+         p00 = weights[v0];
+         p01 = weights[v0 + 1];
+         p10 = weights[v0 + wt_w];
+         p11 = weights[v0 + wt_w + 1];
+         assert(v0 + wt_w + 1 < (int)ARRAY_SIZE(weights));
+         i = (p00*w00 + p01*w01 + p10*w10 + p11*w11 + 8) >> 4;
+         assert(0 <= i && i <= 64);
+         infill_weights[0][idx] = i;
       }
    }
 }
@@ -1439,7 +1546,7 @@ void Block::unquantise_colour_endpoints()
    }
 }
 
-decode_error::type Block::decode(const Decoder &decoder, InputBitVector in)
+decode_error::type Block::decode(Decoder &decoder, InputBitVector in)
 {
    decode_error::type err;
 
@@ -1580,7 +1687,8 @@ decode_error::type Block::decode(const Decoder &decoder, InputBitVector in)
       }
    }
 
-   compute_infill_weights(decoder.block_w, decoder.block_h, decoder.block_d);
+   compute_infill_weights(decoder.get_infill_taps(wt_w, wt_h, wt_d),
+                          decoder.block_w * decoder.block_h * decoder.block_d);
 
    if (VERBOSE_DECODE) {
       for (int plane = 0; plane <= dual_plane; ++plane) {
@@ -1606,120 +1714,146 @@ decode_error::type Block::decode(const Decoder &decoder, InputBitVector in)
    return decode_error::ok;
 }
 
-void Block::write_decoded(const Decoder &decoder, uint16_t *output)
+void Block::write_decoded(Decoder &decoder, uint16_t *output)
 {
    /* sRGB can only be stored as unorm8. */
    assert(!decoder.srgb || decoder.output_unorm8);
 
+   const int num_texels = decoder.block_w * decoder.block_h * decoder.block_d;
+
    if (is_void_extent) {
-      for (int idx = 0; idx < decoder.block_w*decoder.block_h*decoder.block_d; ++idx) {
-         if (decoder.output_unorm8) {
-            if (decoder.srgb) {
-               output[idx*4+0] = void_extent_colour_r >> 8;
-               output[idx*4+1] = void_extent_colour_g >> 8;
-               output[idx*4+2] = void_extent_colour_b >> 8;
-            } else {
-               output[idx*4+0] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_r);
-               output[idx*4+1] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_g);
-               output[idx*4+2] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_b);
-            }
-            output[idx*4+3] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_a);
+      uint16_t c[4];
+
+      if (decoder.output_unorm8) {
+         if (decoder.srgb) {
+            c[0] = void_extent_colour_r >> 8;
+            c[1] = void_extent_colour_g >> 8;
+            c[2] = void_extent_colour_b >> 8;
          } else {
-            /* Store the color as FP16. */
-            output[idx*4+0] = _mesa_uint16_div_64k_to_half(void_extent_colour_r);
-            output[idx*4+1] = _mesa_uint16_div_64k_to_half(void_extent_colour_g);
-            output[idx*4+2] = _mesa_uint16_div_64k_to_half(void_extent_colour_b);
-            output[idx*4+3] = _mesa_uint16_div_64k_to_half(void_extent_colour_a);
+            c[0] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_r);
+            c[1] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_g);
+            c[2] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_b);
          }
+         c[3] = uint16_div_64k_to_half_to_unorm8(void_extent_colour_a);
+      } else {
+         /* Store the color as FP16. */
+         c[0] = _mesa_uint16_div_64k_to_half(void_extent_colour_r);
+         c[1] = _mesa_uint16_div_64k_to_half(void_extent_colour_g);
+         c[2] = _mesa_uint16_div_64k_to_half(void_extent_colour_b);
+         c[3] = _mesa_uint16_div_64k_to_half(void_extent_colour_a);
       }
+
+      for (int idx = 0; idx < num_texels; ++idx)
+         memcpy(&output[idx*4], c, sizeof(c));
       return;
    }
 
-   int small_block = (decoder.block_w * decoder.block_h * decoder.block_d) < 31;
+   const uint8_t *partitions = NULL;
+   if (num_parts > 1)
+      partitions = decoder.get_partitions(partition_index, num_parts);
 
-   int idx = 0;
-   for (int z = 0; z < decoder.block_d; ++z) {
-      for (int y = 0; y < decoder.block_h; ++y) {
-         for (int x = 0; x < decoder.block_w; ++x) {
-
-            int partition;
-            if (num_parts > 1) {
-               partition = select_partition(partition_index, x, y, z, num_parts, small_block);
-               assert(partition < num_parts);
-            } else {
-               partition = 0;
-            }
+   /* TODO: HDR */
 
-            /* TODO: HDR */
-
-            uint8x4_t e0 = endpoints_decoded[0][partition];
-            uint8x4_t e1 = endpoints_decoded[1][partition];
-            uint16_t c0[4], c1[4];
-
-            /* Expand to 16 bits. */
-            if (decoder.srgb) {
-               c0[0] = (uint16_t)((e0.v[0] << 8) | 0x80);
-               c0[1] = (uint16_t)((e0.v[1] << 8) | 0x80);
-               c0[2] = (uint16_t)((e0.v[2] << 8) | 0x80);
-               c0[3] = (uint16_t)((e0.v[3] << 8) | 0x80);
-
-               c1[0] = (uint16_t)((e1.v[0] << 8) | 0x80);
-               c1[1] = (uint16_t)((e1.v[1] << 8) | 0x80);
-               c1[2] = (uint16_t)((e1.v[2] << 8) | 0x80);
-               c1[3] = (uint16_t)((e1.v[3] << 8) | 0x80);
-            } else {
-               c0[0] = (uint16_t)((e0.v[0] << 8) | e0.v[0]);
-               c0[1] = (uint16_t)((e0.v[1] << 8) | e0.v[1]);
-               c0[2] = (uint16_t)((e0.v[2] << 8) | e0.v[2]);
-               c0[3] = (uint16_t)((e0.v[3] << 8) | e0.v[3]);
-
-               c1[0] = (uint16_t)((e1.v[0] << 8) | e1.v[0]);
-               c1[1] = (uint16_t)((e1.v[1] << 8) | e1.v[1]);
-               c1[2] = (uint16_t)((e1.v[2] << 8) | e1.v[2]);
-               c1[3] = (uint16_t)((e1.v[3] << 8) | e1.v[3]);
-            }
+   /* Expand the endpoints to 16 bits. */
+   uint16_t c0[4][4], c1[4][4];
+   for (int p = 0; p < num_parts; ++p) {
+      for (int i = 0; i < 4; ++i) {
+         uint8_t e0 = endpoints_decoded[0][p].v[i];
+         uint8_t e1 = endpoints_decoded[1][p].v[i];
 
-            int w[4];
-            if (dual_plane) {
-               int w0 = infill_weights[0][idx];
-               int w1 = infill_weights[1][idx];
-               w[0] = w[1] = w[2] = w[3] = w0;
-               w[colour_component_selector] = w1;
-            } else {
-               int w0 = infill_weights[0][idx];
-               w[0] = w[1] = w[2] = w[3] = w0;
-            }
+         if (decoder.srgb) {
+            c0[p][i] = (uint16_t)((e0 << 8) | 0x80);
+            c1[p][i] = (uint16_t)((e1 << 8) | 0x80);
+         } else {
+            c0[p][i] = (uint16_t)((e0 << 8) | e0);
+            c1[p][i] = (uint16_t)((e1 << 8) | e1);
+         }
+      }
+   }
 
-            /* Interpolate to produce UNORM16, applying weights. */
-            uint16_t c[4] = {
-               (uint16_t)((c0[0] * (64 - w[0]) + c1[0] * w[0] + 32) >> 6),
-               (uint16_t)((c0[1] * (64 - w[1]) + c1[1] * w[1] + 32) >> 6),
-               (uint16_t)((c0[2] * (64 - w[2]) + c1[2] * w[2] + 32) >> 6),
-               (uint16_t)((c0[3] * (64 - w[3]) + c1[3] * w[3] + 32) >> 6),
-            };
-
-            if (decoder.output_unorm8) {
-               if (decoder.srgb) {
-                  output[idx*4+0] = c[0] >> 8;
-                  output[idx*4+1] = c[1] >> 8;
-                  output[idx*4+2] = c[2] >> 8;
-               } else {
-                  output[idx*4+0] = c[0] == 65535 ? 0xff : uint16_div_64k_to_half_to_unorm8(c[0]);
-                  output[idx*4+1] = c[1] == 65535 ? 0xff : uint16_div_64k_to_half_to_unorm8(c[1]);
-                  output[idx*4+2] = c[2] == 65535 ? 0xff : uint16_div_64k_to_half_to_unorm8(c[2]);
-               }
-               output[idx*4+3] = c[3] == 65535 ? 0xff : uint16_div_64k_to_half_to_unorm8(c[3]);
-            } else {
-               /* Store the color as FP16. */
-               output[idx*4+0] = c[0] == 65535 ? FP16_ONE : _mesa_uint16_div_64k_to_half(c[0]);
-               output[idx*4+1] = c[1] == 65535 ? FP16_ONE : _mesa_uint16_div_64k_to_half(c[1]);
-               output[idx*4+2] = c[2] == 65535 ? FP16_ONE : _mesa_uint16_div_64k_to_half(c[2]);
-               output[idx*4+3] = c[3] == 65535 ? FP16_ONE : _mesa_uint16_div_64k_to_half(c[3]);
-            }
+   /* Interpolate to produce UNORM16, applying weights. */
+#ifdef ASTC_USE_SSE2
+   /* With the colours biased to signed 16 bits, pmaddwd computes
+    * c0 * (64 - w) + c1 * w of all four channels of a texel, and
+    * ((sum + 32) >> 6) + 32768 is exactly the unbiased result.
+    */
+   __m128i ends[4];
+   for (int p = 0; p < num_parts; ++p) {
+      ends[p] = _mm_setr_epi16(c0[p][0] - 32768, c1[p][0] - 32768,
+                               c0[p][1] - 32768, c1[p][1] - 32768,
+                               c0[p][2] - 32768, c1[p][2] - 32768,
+                               c0[p][3] - 32768, c1[p][3] - 32768);
+   }
 
-            idx++;
+   for (int idx = 0; idx < num_texels; idx += 2) {
+      __m128i sum[2];
+
+      for (int k = 0; k < 2; ++k) {
+         int i = MIN2(idx + k, num_texels - 1);
+         int w0 = infill_weights[0][i];
+         __m128i w = _mm_set1_epi32((w0 << 16) | (64 - w0));
+
+         if (dual_plane) {
+            int32_t ws[4];
+            int w1 = infill_weights[1][i];
+
+            _mm_storeu_si128((__m128i *)ws, w);
+            ws[colour_component_selector] = (w1 << 16) | (64 - w1);
+            w = _mm_loadu_si128((const __m128i *)ws);
          }
+
+         sum[k] = _mm_madd_epi16(ends[partitions ? partitions[i] : 0], w);
+         sum[k] = _mm_srai_epi32(_mm_add_epi32(sum[k], _mm_set1_epi32(32)), 6);
       }
+
+      __m128i c = _mm_xor_si128(_mm_packs_epi32(sum[0], sum[1]),
+                                _mm_set1_epi16(-0x8000));
+      if (idx + 1 < num_texels)
+         _mm_storeu_si128((__m128i *)&output[idx*4], c);
+      else
+         _mm_storel_epi64((__m128i *)&output[idx*4], c);
+   }
+#else
+   for (int idx = 0; idx < num_texels; ++idx) {
+      int partition = partitions ? partitions[idx] : 0;
+
+      int w[4];
+      if (dual_plane) {
+         int w0 = infill_weights[0][idx];
+         int w1 = infill_weights[1][idx];
+         w[0] = w[1] = w[2] = w[3] = w0;
+         w[colour_component_selector] = w1;
+      } else {
+         int w0 = infill_weights[0][idx];
+         w[0] = w[1] = w[2] = w[3] = w0;
+      }
+
+      for (int i = 0; i < 4; ++i) {
+         output[idx*4+i] = (uint16_t)((c0[partition][i] * (64 - w[i]) +
+                                       c1[partition][i] * w[i] + 32) >> 6);
+      }
+   }
+#endif
+
+   if (decoder.output_unorm8) {
+      for (int idx = 0; idx < num_texels; ++idx) {
+         uint16_t *c = &output[idx*4];
+
+         if (decoder.srgb) {
+            c[0] >>= 8;
+            c[1] >>= 8;
+            c[2] >>= 8;
+         } else {
+            c[0] = unorm16_to_unorm8[c[0]];
+            c[1] = unorm16_to_unorm8[c[1]];
+            c[2] = unorm16_to_unorm8[c[2]];
+         }
+         c[3] = unorm16_to_unorm8[c[3]];
+      }
+   } else {
+      /* Store the color as FP16. */
+      for (int i = 0; i < num_texels * 4; ++i)
+         output[i] = output[i] == 65535 ? FP16_ONE : _mesa_uint16_div_64k_to_half(output[i]);
    }
 }
 
@@ -1814,35 +1948,39 @@ decode_error::type Block::calculate_colour_endpoints_size()
    return decode_error::invalid_colour_endpoints_size;
 }
 
-/**
- * Decode ASTC 2D LDR texture data.
- *
- * \param src_width in pixels
- * \param src_height in pixels
- * \param dst_stride in bytes
- */
-extern "C" void
-_mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
-                         unsigned dst_stride,
-                         const uint8_t *src_row,
-                         unsigned src_stride,
-                         unsigned src_width,
-                         unsigned src_height,
-                         mesa_format format)
-{
-   assert(_mesa_is_format_astc_2d(format));
-   bool srgb = _mesa_is_format_srgb(format);
+/* Images are split into bands of at least this many blocks, one per thread. */
+#define ASTC_BAND_BLOCKS 4096
+#define ASTC_MAX_THREADS 8
 
+struct astc_band
+{
+   uint8_t *dst_row;
+   unsigned dst_stride;
+   const uint8_t *src_row;
+   unsigned src_stride;
+   unsigned src_width;
+   unsigned src_height;
    unsigned blk_w, blk_h;
-   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+   bool srgb;
+
+   /* block rows to decode */
+   unsigned first_y, last_y;
 
+   struct util_queue_fence fence;
+};
+
+static void
+unpack_astc_band(const astc_band *band)
+{
    const unsigned block_size = 16;
-   unsigned x_blocks = (src_width + blk_w - 1) / blk_w;
-   unsigned y_blocks = (src_height + blk_h - 1) / blk_h;
+   const unsigned blk_w = band->blk_w, blk_h = band->blk_h;
+   unsigned x_blocks = (band->src_width + blk_w - 1) / blk_w;
+   const uint8_t *src_row = band->src_row + band->first_y * band->src_stride;
+   uint8_t *dst_row = band->dst_row + band->first_y * blk_h * band->dst_stride;
 
-   Decoder dec(blk_w, blk_h, 1, srgb, true);
+   Decoder dec(blk_w, blk_h, 1, band->srgb, true);
 
-   for (unsigned y = 0; y < y_blocks; ++y) {
+   for (unsigned y = band->first_y; y < band->last_y; ++y) {
       for (unsigned x = 0; x < x_blocks; ++x) {
          /* Same size as the largest block. */
          uint16_t block_out[12 * 12 * 4];
@@ -1850,12 +1988,12 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
          dec.decode(src_row + x * block_size, block_out);
 
          /* This can be smaller with NPOT dimensions. */
-         unsigned dst_blk_w = MIN2(blk_w, src_width  - x*blk_w);
-         unsigned dst_blk_h = MIN2(blk_h, src_height - y*blk_h);
+         unsigned dst_blk_w = MIN2(blk_w, band->src_width  - x*blk_w);
+         unsigned dst_blk_h = MIN2(blk_h, band->src_height - y*blk_h);
 
          for (unsigned sub_y = 0; sub_y < dst_blk_h; ++sub_y) {
             for (unsigned sub_x = 0; sub_x < dst_blk_w; ++sub_x) {
-               uint8_t *dst = dst_row + sub_y * dst_stride +
+               uint8_t *dst = dst_row + sub_y * band->dst_stride +
                               (x * blk_w + sub_x) * 4;
                const uint16_t *src = &block_out[(sub_y * blk_w + sub_x) * 4];
 
@@ -1866,7 +2004,92 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
             }
          }
       }
-      src_row += src_stride;
-      dst_row += dst_stride * blk_h;
+      src_row += band->src_stride;
+      dst_row += band->dst_stride * blk_h;
+   }
+}
+
+static void
+unpack_astc_band_execute(void *data, void *gdata, int thread_index)
+{
+   unpack_astc_band((const astc_band *)data);
+}
+
+static struct util_queue astc_queue;
+static unsigned astc_num_threads = 1;
+static once_flag astc_queue_once = ONCE_FLAG_INIT;
+
+static void
+astc_queue_init(void)
+{
+   unsigned threads;
+
+   util_cpu_detect();
+   threads = MIN2(util_get_cpu_caps()->nr_cpus, ASTC_MAX_THREADS);
+
+   /* the calling thread decodes a band too */
+   if (threads > 1 &&
+       util_queue_init(&astc_queue, "astc", ASTC_MAX_THREADS, threads - 1,
+                       UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL))
+      astc_num_threads = threads;
+}
+
+/**
+ * Decode ASTC 2D LDR texture data.  Large images are decoded by several
+ * threads, in bands of block rows.
+ *
+ * \param src_width in pixels
+ * \param src_height in pixels
+ * \param dst_stride in bytes
+ */
+extern "C" void
+_mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
+                         unsigned dst_stride,
+                         const uint8_t *src_row,
+                         unsigned src_stride,
+                         unsigned src_width,
+                         unsigned src_height,
+                         mesa_format format)
+{
+   assert(_mesa_is_format_astc_2d(format));
+
+   astc_band bands[ASTC_MAX_THREADS];
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+
+   unsigned x_blocks = (src_width + blk_w - 1) / blk_w;
+   unsigned y_blocks = (src_height + blk_h - 1) / blk_h;
+
+   call_once(&astc_queue_once, astc_queue_init);
+
+   unsigned num_bands = MIN2(astc_num_threads, y_blocks);
+   num_bands = MIN2(num_bands, x_blocks * y_blocks / ASTC_BAND_BLOCKS);
+   num_bands = MAX2(num_bands, 1);
+
+   for (unsigned i = 0; i < num_bands; i++) {
+      bands[i].dst_row = dst_row;
+      bands[i].dst_stride = dst_stride;
+      bands[i].src_row = src_row;
+      bands[i].src_stride = src_stride;
+      bands[i].src_width = src_width;
+      bands[i].src_height = src_height;
+      bands[i].blk_w = blk_w;
+      bands[i].blk_h = blk_h;
+      bands[i].srgb = _mesa_is_format_srgb(format);
+      bands[i].first_y = y_blocks * i / num_bands;
+      bands[i].last_y = y_blocks * (i + 1) / num_bands;
+   }
+
+   for (unsigned i = 1; i < num_bands; i++) {
+      util_queue_fence_init(&bands[i].fence);
+      util_queue_add_job(&astc_queue, &bands[i], &bands[i].fence,
+                         unpack_astc_band_execute, NULL, 0);
+   }
+
+   unpack_astc_band(&bands[0]);
+
+   for (unsigned i = 1; i < num_bands; i++) {
+      util_queue_fence_wait(&bands[i].fence);
+      util_queue_fence_destroy(&bands[i].fence);
    }
 }
@@ -34,10 +34,12 @@
 #include "pipe/p_defines.h"
 #include "st_context.h"
 #include "st_atom.h"
+#include "st_debug.h"
 #include "st_program.h"
 #include "st_manager.h"
 #include "st_util.h"
 
+#include "util/os_time.h"
 #include "util/u_cpu_detect.h"
 
 
@@ -46,6 +48,12 @@ typedef void (*update_func_t)(struct st_context *st);
 /* The list state update functions. */
 static update_func_t update_functions[ST_NUM_ATOMS];
 
+static const char *atom_names[ST_NUM_ATOMS] = {
+#define ST_STATE(FLAG, st_update) #FLAG,
+#include "st_atom_list.h"
+#undef ST_STATE
+};
+
 static void
 init_atoms_once(void)
 {
@@ -68,7 +76,38 @@ void st_init_atoms( struct st_context *st )
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   if (!(ST_DEBUG & DEBUG_ATOMS))
+      return;
+
+   debug_printf("st: state atom validation statistics:\n");
+   for (unsigned i = 0; i < ST_NUM_ATOMS; i++) {
+      if (!st->atom_stats[i].calls)
+         continue;
+
+      debug_printf("  %-28s %10"PRIu64" calls %10.3f ms %8.3f us/call\n",
+                   atom_names[i], st->atom_stats[i].calls,
+                   st->atom_stats[i].time_ns / 1000000.0,
+                   st->atom_stats[i].time_ns / 1000.0 /
+                   st->atom_stats[i].calls);
+   }
+}
+
+
+/* Same as the update loop in st_validate_state, but also gathers the
+ * ST_DEBUG=atoms statistics.
+ */
+static void
+update_states_profiled(struct st_context *st, uint64_t dirty)
+{
+   while (dirty) {
+      unsigned i = u_bit_scan64(&dirty);
+      int64_t start = os_time_get_nano();
+
+      update_functions[i](st);
+
+      st->atom_stats[i].time_ns += os_time_get_nano() - start;
+      st->atom_stats[i].calls++;
+   }
 }
 
 
@@ -279,17 +318,21 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    if (!dirty)
       return;
 
-   dirty_lo = dirty;
-   dirty_hi = dirty >> 32;
+   if (unlikely(ST_DEBUG & DEBUG_ATOMS)) {
+      update_states_profiled(st, dirty);
+   } else {
+      dirty_lo = dirty;
+      dirty_hi = dirty >> 32;
 
-   /* Update states.
-    *
-    * Don't use u_bit_scan64, it may be slower on 32-bit.
-    */
-   while (dirty_lo)
-      update_functions[u_bit_scan(&dirty_lo)](st);
-   while (dirty_hi)
-      update_functions[32 + u_bit_scan(&dirty_hi)](st);
+      /* Update states.
+       *
+       * Don't use u_bit_scan64, it may be slower on 32-bit.
+       */
+      while (dirty_lo)
+         update_functions[u_bit_scan(&dirty_lo)](st);
+      while (dirty_hi)
+         update_functions[32 + u_bit_scan(&dirty_hi)](st);
+   }
 
    /* Clear the render or compute state bits. */
    st->dirty &= ~pipeline_mask;
@@ -432,7 +432,12 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
    st_validate_state(st, ST_PIPELINE_UPDATE_FRAMEBUFFER);
    st_flush_bitmap_cache(st);
 
-   if (!st->prefer_blit_based_texture_transfer) {
+   /* Drivers that otherwise map the renderbuffer may still want PBO
+    * downloads packed by a shader, which doesn't wait for rendering.
+    */
+   if (!st->prefer_blit_based_texture_transfer &&
+       !(st->prefer_pbo_download && st->pbo.download_enabled &&
+         pack->BufferObj)) {
       goto fallback;
    }
 
@@ -491,6 +496,10 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
          return;
    }
 
+   if (!st->prefer_blit_based_texture_transfer) {
+      goto fallback;
+   }
+
    if (needs_integer_signed_unsigned_conversion(ctx, format, type)) {
       goto fallback;
    }
@@ -417,6 +417,23 @@ st_FreeTextureImageBuffer(struct gl_context *ctx,
    st_texture_release_all_sampler_views(st, stObj);
 }
 
+bool
+st_etc2_format_fallback(const struct st_context *st, mesa_format format)
+{
+   if (!_mesa_is_format_etc2(format))
+      return false;
+
+   switch (format) {
+   case MESA_FORMAT_ETC2_R11_EAC:
+   case MESA_FORMAT_ETC2_RG11_EAC:
+   case MESA_FORMAT_ETC2_SIGNED_R11_EAC:
+   case MESA_FORMAT_ETC2_SIGNED_RG11_EAC:
+      return !st->has_etc2_eac;
+   default:
+      return !st->has_etc2;
+   }
+}
+
 bool
 st_astc_format_fallback(const struct st_context *st, mesa_format format)
 {
@@ -436,8 +453,8 @@ st_compressed_format_fallback(struct st_context *st, mesa_format format)
    if (format == MESA_FORMAT_ETC1_RGB8)
       return !st->has_etc1;
 
-   if (_mesa_is_format_etc2(format))
-      return !st->has_etc2;
+   if (st_etc2_format_fallback(st, format))
+      return true;
 
    if (st_astc_format_fallback(st, format))
       return true;
@@ -2427,7 +2444,9 @@ st_GetTexSubImage(struct gl_context * ctx,
    pipe_target = gl_target_to_pipe(gl_target);
 
    if (!st->prefer_blit_based_texture_transfer &&
-       !_mesa_is_format_compressed(texImage->TexFormat)) {
+       !_mesa_is_format_compressed(texImage->TexFormat) &&
+       !(st->prefer_pbo_download && st->pbo.download_enabled &&
+         ctx->Pack.BufferObj)) {
       /* Try to avoid the non_blit_transfer if we're doing texture decompression here */
       goto non_blit_transfer;
    }
@@ -2473,6 +2492,10 @@ st_GetTexSubImage(struct gl_context * ctx,
          return;
    }
 
+   if (!st->prefer_blit_based_texture_transfer &&
+       !_mesa_is_format_compressed(texImage->TexFormat))
+      goto non_blit_transfer;
+
    /* See if the texture format already matches the format and type,
     * in which case the memcpy-based fast path will be used. */
    if (_mesa_format_matches_format_and_type(texImage->TexFormat, format,
@@ -524,6 +524,7 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
       enum pipe_texture_transfer_mode val = screen->get_param(screen, PIPE_CAP_TEXTURE_TRANSFER_MODES);
       st->prefer_blit_based_texture_transfer = (val & PIPE_TEXTURE_TRANSFER_BLIT) != 0;
       st->allow_compute_based_texture_transfer = (val & PIPE_TEXTURE_TRANSFER_COMPUTE) != 0;
+      st->prefer_pbo_download = (val & PIPE_TEXTURE_TRANSFER_PBO_DOWNLOAD) != 0;
    }
    st_init_pbo_helpers(st);
 
@@ -566,6 +567,10 @@ st_create_context_priv(struct gl_context *ctx, struct pipe_context *pipe,
    st->has_etc2 = screen->is_format_supported(screen, PIPE_FORMAT_ETC2_RGB8,
                                               PIPE_TEXTURE_2D, 0, 0,
                                               PIPE_BIND_SAMPLER_VIEW);
+   st->has_etc2_eac = screen->is_format_supported(screen,
+                                                  PIPE_FORMAT_ETC2_R11_UNORM,
+                                                  PIPE_TEXTURE_2D, 0, 0,
+                                                  PIPE_BIND_SAMPLER_VIEW);
    st->transcode_etc = options->transcode_etc &&
                        screen->is_format_supported(screen, PIPE_FORMAT_DXT1_SRGBA,
                                                    PIPE_TEXTURE_2D, 0, 0,
@@ -139,12 +139,14 @@ struct st_context
    boolean has_time_elapsed;
    boolean has_etc1;
    boolean has_etc2;
+   boolean has_etc2_eac;
    boolean transcode_etc;
    boolean transcode_astc;
    boolean has_astc_2d_ldr;
    boolean has_astc_5x5_ldr;
    boolean prefer_blit_based_texture_transfer;
    boolean allow_compute_based_texture_transfer;
+   boolean prefer_pbo_download;
    boolean force_persample_in_shader;
    boolean has_shareable_shaders;
    boolean has_half_float_packing;
@@ -244,6 +246,12 @@ struct st_context
    bool gfx_shaders_may_be_dirty;
    bool compute_shader_may_be_dirty;
 
+   /** Per-atom validation statistics, only gathered with ST_DEBUG=atoms. */
+   struct {
+      uint64_t calls;
+      uint64_t time_ns;
+   } atom_stats[ST_NUM_ATOMS];
+
    GLboolean vertdata_edgeflags;
    GLboolean edgeflag_culls_prims;
 
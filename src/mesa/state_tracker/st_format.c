@@ -74,7 +74,7 @@ st_mesa_format_to_pipe_format(const struct st_context *st,
     * The destination formats mustn't be changed, because they are also
     * destination formats of the unpack/decompression function.
     */
-   if (_mesa_is_format_etc2(mesaFormat) && !st->has_etc2) {
+   if (st_etc2_format_fallback(st, mesaFormat)) {
       bool has_bgra_srgb = screen->is_format_supported(screen,
                                                        PIPE_FORMAT_B8G8R8A8_SRGB,
                                                        PIPE_TEXTURE_2D, 0, 0,
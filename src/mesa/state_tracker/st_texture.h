@@ -217,6 +217,9 @@ st_destroy_bound_texture_handles(struct st_context *st);
 void
 st_destroy_bound_image_handles(struct st_context *st);
 
+bool
+st_etc2_format_fallback(const struct st_context *st, mesa_format format);
+
 bool
 st_astc_format_fallback(const struct st_context *st, mesa_format format);
 
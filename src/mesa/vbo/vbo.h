@@ -49,8 +49,11 @@ struct pipe_draw_start_count_bias;
 
 /**
  * Max number of primitives (number of glBegin/End pairs) per VBO.
+ *
+ * Primitives that can't be merged (strips, fans, loops) each take a slot,
+ * so this bounds how many small glBegin/End pairs go into one multi-draw.
  */
-#define VBO_MAX_PRIM 64
+#define VBO_MAX_PRIM 1024
 
 
 /**
@@ -218,6 +221,10 @@ vbo_save_EndList(struct gl_context *ctx);
 void
 vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj);
 
+void
+vbo_invalidate_minmax_cache(struct gl_buffer_object *bufferObj,
+                            GLintptr offset, GLsizeiptr size);
+
 void
 vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
                             unsigned restartIndex, bool restart,
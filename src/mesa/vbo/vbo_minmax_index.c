@@ -32,47 +32,43 @@
 #include "main/macros.h"
 #include "main/sse_minmax.h"
 #include "x86/common_x86_asm.h"
-#include "util/hash_table.h"
+#include "util/bitset.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "pipe/p_state.h"
 
-struct minmax_cache_key {
-   GLintptr offset;
-   GLuint count;
-   unsigned index_size;
-};
+/* Bytes of index data summarized by each leaf of the min/max tree. */
+#define MINMAX_LEAF_BYTES 1024
 
+/**
+ * Min/max summary of an index buffer.
+ *
+ * The buffer is cut into leaves of MINMAX_LEAF_BYTES, and the leaves are
+ * the bottom of a segment tree stored in the usual implicit layout: node i
+ * has children 2i and 2i+1, and leaf j is node num_leaves + j.  The
+ * min/max of any range of whole leaves is the min/max of O(log n) nodes,
+ * so draws of arbitrary sub-ranges only scan the partial leaves at both
+ * ends.
+ *
+ * Leaves are computed the first time a draw covers them and are marked
+ * dirty again by writes to that part of the buffer.  Nodes above dirty
+ * leaves hold stale values, but a query only reads nodes whose leaves it
+ * has just made clean.
+ */
+struct vbo_minmax_cache {
+   /* what the summary was computed for */
+   GLsizeiptr size;
+   unsigned index_size;
+   bool restart;
+   unsigned restart_index;
 
-struct minmax_cache_entry {
-   struct minmax_cache_key key;
-   GLuint min;
-   GLuint max;
+   unsigned num_leaves;
+   GLuint *min;            /**< [2 * num_leaves] */
+   GLuint *max;            /**< [2 * num_leaves] */
+   BITSET_WORD *dirty;     /**< [BITSET_WORDS(num_leaves)] */
 };
 
 
-static uint32_t
-vbo_minmax_cache_hash(const struct minmax_cache_key *key)
-{
-   return _mesa_hash_data(key, sizeof(*key));
-}
-
-
-static bool
-vbo_minmax_cache_key_equal(const struct minmax_cache_key *a,
-                           const struct minmax_cache_key *b)
-{
-   return (a->offset == b->offset) && (a->count == b->count) &&
-          (a->index_size == b->index_size);
-}
-
-
-static void
-vbo_minmax_cache_delete_entry(struct hash_entry *entry)
-{
-   free(entry->data);
-}
-
-
 static GLboolean
 vbo_use_minmax_cache(struct gl_buffer_object *bufferObj)
 {
@@ -96,135 +92,299 @@ vbo_use_minmax_cache(struct gl_buffer_object *bufferObj)
 void
 vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
 {
-   _mesa_hash_table_destroy(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
+   struct vbo_minmax_cache *cache = bufferObj->MinMaxCache;
+
+   if (cache) {
+      free(cache->min);
+      free(cache->max);
+      free(cache->dirty);
+      free(cache);
+   }
    bufferObj->MinMaxCache = NULL;
 }
 
 
-static GLboolean
-vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
-                      unsigned index_size, GLintptr offset, GLuint count,
-                      GLuint *min_index, GLuint *max_index)
+static void
+vbo_minmax_cache_set_dirty(struct vbo_minmax_cache *cache,
+                           unsigned first, unsigned last)
+{
+   unsigned i = first;
+
+   while (i <= last) {
+      if (i % BITSET_WORDBITS == 0 && last - i >= BITSET_WORDBITS - 1) {
+         cache->dirty[BITSET_BITWORD(i)] = ~(BITSET_WORD)0;
+         i += BITSET_WORDBITS;
+      } else {
+         BITSET_SET(cache->dirty, i);
+         i++;
+      }
+   }
+}
+
+
+/**
+ * Mark the part of the summary covering [offset, offset + size) as dirty,
+ * after that range of the buffer was written.
+ */
+void
+vbo_invalidate_minmax_cache(struct gl_buffer_object *bufferObj,
+                            GLintptr offset, GLsizeiptr size)
 {
-   GLboolean found = GL_FALSE;
-   struct minmax_cache_key key;
-   uint32_t hash;
-   struct hash_entry *result;
+   struct vbo_minmax_cache *cache;
 
-   if (!bufferObj->MinMaxCache)
-      return GL_FALSE;
-   if (!vbo_use_minmax_cache(bufferObj))
-      return GL_FALSE;
+   if (!bufferObj->MinMaxCache || size <= 0)
+      return;
 
    simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
 
-   if (bufferObj->MinMaxCacheDirty) {
-      /* Disable the cache permanently for this BO if the number of hits
-       * is asymptotically less than the number of misses. This happens when
-       * applications use the BO for streaming.
-       *
-       * However, some initial optimism allows applications that interleave
-       * draw calls with glBufferSubData during warmup.
-       */
-      unsigned optimism = bufferObj->Size;
-      if (bufferObj->MinMaxCacheMissIndices > optimism &&
-          bufferObj->MinMaxCacheHitIndices < bufferObj->MinMaxCacheMissIndices - optimism) {
-         bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
-         vbo_delete_minmax_cache(bufferObj);
-         goto out_disable;
-      }
+   cache = bufferObj->MinMaxCache;
+   if (cache && offset < cache->size) {
+      unsigned first = offset / MINMAX_LEAF_BYTES;
+      unsigned last = MIN2(offset + size - 1, cache->size - 1) /
+                      MINMAX_LEAF_BYTES;
 
-      _mesa_hash_table_clear(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
-      bufferObj->MinMaxCacheDirty = false;
-      goto out_invalidate;
+      vbo_minmax_cache_set_dirty(cache, first, last);
    }
 
-   key.index_size = index_size;
-   key.offset = offset;
-   key.count = count;
-   hash = vbo_minmax_cache_hash(&key);
-   result = _mesa_hash_table_search_pre_hashed(bufferObj->MinMaxCache, hash, &key);
-   if (result) {
-      struct minmax_cache_entry *entry = result->data;
-      *min_index = entry->min;
-      *max_index = entry->max;
-      found = GL_TRUE;
+   simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Return the summary of the buffer for the given index type, creating it
+ * (with every leaf dirty) if there is none or it was made for another
+ * index type or buffer size.
+ */
+static struct vbo_minmax_cache *
+vbo_minmax_cache_get(struct gl_buffer_object *bufferObj, unsigned index_size,
+                     bool restart, unsigned restart_index)
+{
+   struct vbo_minmax_cache *cache = bufferObj->MinMaxCache;
+
+   if (cache && cache->size == bufferObj->Size &&
+       cache->index_size == index_size && cache->restart == restart &&
+       (!restart || cache->restart_index == restart_index))
+      return cache;
+
+   vbo_delete_minmax_cache(bufferObj);
+
+   cache = CALLOC_STRUCT(vbo_minmax_cache);
+   if (!cache)
+      return NULL;
+
+   cache->size = bufferObj->Size;
+   cache->index_size = index_size;
+   cache->restart = restart;
+   cache->restart_index = restart_index;
+   cache->num_leaves = DIV_ROUND_UP(bufferObj->Size, MINMAX_LEAF_BYTES);
+   cache->min = malloc(2 * cache->num_leaves * sizeof(GLuint));
+   cache->max = malloc(2 * cache->num_leaves * sizeof(GLuint));
+   cache->dirty = malloc(BITSET_WORDS(cache->num_leaves) * sizeof(BITSET_WORD));
+   bufferObj->MinMaxCache = cache;
+
+   if (!cache->min || !cache->max || !cache->dirty) {
+      vbo_delete_minmax_cache(bufferObj);
+      return NULL;
    }
 
-out_invalidate:
-   if (found) {
-      /* The hit counter saturates so that we don't accidently disable the
-       * cache in a long-running program.
-       */
-      unsigned new_hit_count = bufferObj->MinMaxCacheHitIndices + count;
-
-      if (new_hit_count >= bufferObj->MinMaxCacheHitIndices)
-         bufferObj->MinMaxCacheHitIndices = new_hit_count;
-      else
-         bufferObj->MinMaxCacheHitIndices = ~(unsigned)0;
-   } else {
-      bufferObj->MinMaxCacheMissIndices += count;
+   vbo_minmax_cache_set_dirty(cache, 0, cache->num_leaves - 1);
+   return cache;
+}
+
+
+static bool
+vbo_minmax_cache_any_dirty(const struct vbo_minmax_cache *cache,
+                           unsigned first, unsigned last)
+{
+   for (unsigned i = first; i < last; i++) {
+      if (i % BITSET_WORDBITS == 0 && last - i >= BITSET_WORDBITS) {
+         if (cache->dirty[BITSET_BITWORD(i)])
+            return true;
+         i += BITSET_WORDBITS - 1;
+      } else if (BITSET_TEST(cache->dirty, i)) {
+         return true;
+      }
    }
 
-out_disable:
-   simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
-   return found;
+   return false;
 }
 
 
-static void
-vbo_minmax_cache_store(struct gl_context *ctx,
-                       struct gl_buffer_object *bufferObj,
-                       unsigned index_size, GLintptr offset, GLuint count,
-                       GLuint min, GLuint max)
+/**
+ * Recompute the dirty leaves in [first, last) from the mapped index data,
+ * which starts at leaf first, and the tree nodes above them.
+ *
+ * \return the number of indices scanned
+ */
+static unsigned
+vbo_minmax_cache_refresh(struct vbo_minmax_cache *cache, const char *indices,
+                         unsigned first, unsigned last)
+{
+   const unsigned leaf_count = MINMAX_LEAF_BYTES / cache->index_size;
+   const unsigned n = cache->num_leaves;
+   unsigned scanned = 0;
+   unsigned i = first;
+
+   while (i < last) {
+      /* skip clean words quickly, the common case */
+      if (i % BITSET_WORDBITS == 0 && !cache->dirty[BITSET_BITWORD(i)]) {
+         i += BITSET_WORDBITS;
+         continue;
+      }
+      if (!BITSET_TEST(cache->dirty, i)) {
+         i++;
+         continue;
+      }
+
+      /* refresh a run of dirty leaves, then their ancestors */
+      unsigned run_start = i;
+      for (; i < last && BITSET_TEST(cache->dirty, i); i++) {
+         vbo_get_minmax_index_mapped(leaf_count, cache->index_size,
+                                     cache->restart_index, cache->restart,
+                                     indices + (size_t)(i - first) *
+                                               MINMAX_LEAF_BYTES,
+                                     &cache->min[n + i], &cache->max[n + i]);
+         BITSET_CLEAR(cache->dirty, i);
+      }
+      scanned += (i - run_start) * leaf_count;
+
+      for (unsigned lo = (n + run_start) >> 1, hi = (n + i - 1) >> 1;
+           lo; lo >>= 1, hi >>= 1) {
+         for (unsigned node = lo; node <= hi; node++) {
+            cache->min[node] = MIN2(cache->min[2 * node],
+                                    cache->min[2 * node + 1]);
+            cache->max[node] = MAX2(cache->max[2 * node],
+                                    cache->max[2 * node + 1]);
+         }
+      }
+   }
+
+   return scanned;
+}
+
+
+/**
+ * Try to compute the min/max of a range of an index buffer from its
+ * summary, updating the summary as needed.
+ *
+ * \return false if the summary can't be used for this range
+ */
+static bool
+vbo_get_minmax_cached(struct gl_context *ctx,
+                      struct gl_buffer_object *bufferObj,
+                      unsigned index_size, GLintptr offset, GLuint count,
+                      bool primitive_restart, unsigned restart_index,
+                      GLuint *min_index, GLuint *max_index)
 {
-   struct minmax_cache_entry *entry;
-   struct hash_entry *table_entry;
-   uint32_t hash;
+   struct vbo_minmax_cache *cache;
+   GLintptr end = offset + (GLintptr)count * index_size;
+   unsigned first, last, scanned = 0;
+   const char *map = NULL;
+   GLuint min = ~0u, max = 0, tmp_min, tmp_max;
+   bool found = false;
 
    if (!vbo_use_minmax_cache(bufferObj))
-      return;
+      return false;
+
+   /* Ranges that don't cover a whole leaf, misaligned ranges and ranges
+    * past the end of the buffer are just scanned.
+    */
+   first = DIV_ROUND_UP(offset, MINMAX_LEAF_BYTES);
+   last = end / MINMAX_LEAF_BYTES;
+   if (first >= last || offset % index_size || end > bufferObj->Size)
+      return false;
 
    simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
 
-   if (!bufferObj->MinMaxCache) {
-      bufferObj->MinMaxCache =
-         _mesa_hash_table_create(NULL,
-                                 (uint32_t (*)(const void *))vbo_minmax_cache_hash,
-                                 (bool (*)(const void *, const void *))vbo_minmax_cache_key_equal);
-      if (!bufferObj->MinMaxCache)
-         goto out;
+   /* Disable the cache permanently for this BO if the number of indices
+    * answered from the summary is asymptotically less than the number of
+    * indices that had to be rescanned after writes. This happens when
+    * applications use the BO for streaming.
+    *
+    * However, some initial optimism allows applications that interleave
+    * draw calls with glBufferSubData during warmup.
+    */
+   unsigned optimism = bufferObj->Size;
+   if (bufferObj->MinMaxCacheMissIndices > optimism &&
+       bufferObj->MinMaxCacheHitIndices < bufferObj->MinMaxCacheMissIndices - optimism) {
+      bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
+      vbo_delete_minmax_cache(bufferObj);
+      goto out;
    }
 
-   entry = MALLOC_STRUCT(minmax_cache_entry);
-   if (!entry)
+   cache = vbo_minmax_cache_get(bufferObj, index_size, primitive_restart,
+                                restart_index);
+   if (!cache)
       goto out;
 
-   entry->key.offset = offset;
-   entry->key.count = count;
-   entry->key.index_size = index_size;
-   entry->min = min;
-   entry->max = max;
-   hash = vbo_minmax_cache_hash(&entry->key);
-
-   table_entry = _mesa_hash_table_search_pre_hashed(bufferObj->MinMaxCache,
-                                                    hash, &entry->key);
-   if (table_entry) {
-      /* It seems like this could happen when two contexts are rendering using
-       * the same buffer object from multiple threads.
-       */
-      _mesa_debug(ctx, "duplicate entry in minmax cache\n");
-      free(entry);
-      goto out;
+   /* The partial leaves at both ends, and any dirty leaves, need the data. */
+   if (offset % MINMAX_LEAF_BYTES || end % MINMAX_LEAF_BYTES ||
+       vbo_minmax_cache_any_dirty(cache, first, last)) {
+      map = _mesa_bufferobj_map_range(ctx, offset, end - offset,
+                                      GL_MAP_READ_BIT, bufferObj,
+                                      MAP_INTERNAL);
+      if (!map)
+         goto out;
    }
 
-   table_entry = _mesa_hash_table_insert_pre_hashed(bufferObj->MinMaxCache,
-                                                    hash, &entry->key, entry);
-   if (!table_entry)
-      free(entry);
+   if (map) {
+      GLintptr head = (GLintptr)first * MINMAX_LEAF_BYTES - offset;
+      GLintptr tail = end - (GLintptr)last * MINMAX_LEAF_BYTES;
+
+      scanned = vbo_minmax_cache_refresh(cache, map + head, first, last);
+
+      if (head) {
+         vbo_get_minmax_index_mapped(head / index_size, index_size,
+                                     restart_index, primitive_restart, map,
+                                     &tmp_min, &tmp_max);
+         min = MIN2(min, tmp_min);
+         max = MAX2(max, tmp_max);
+      }
+      if (tail) {
+         vbo_get_minmax_index_mapped(tail / index_size, index_size,
+                                     restart_index, primitive_restart,
+                                     map + (end - tail - offset),
+                                     &tmp_min, &tmp_max);
+         min = MIN2(min, tmp_min);
+         max = MAX2(max, tmp_max);
+      }
+
+      _mesa_bufferobj_unmap(ctx, bufferObj, MAP_INTERNAL);
+   }
+
+   for (unsigned l = first + cache->num_leaves, r = last + cache->num_leaves;
+        l < r; l >>= 1, r >>= 1) {
+      if (l & 1) {
+         min = MIN2(min, cache->min[l]);
+         max = MAX2(max, cache->max[l]);
+         l++;
+      }
+      if (r & 1) {
+         r--;
+         min = MIN2(min, cache->min[r]);
+         max = MAX2(max, cache->max[r]);
+      }
+   }
+
+   *min_index = min;
+   *max_index = max;
+   found = true;
+
+   /* The hit counter saturates so that we don't accidently disable the
+    * cache in a long-running program.
+    */
+   unsigned new_hit_count = bufferObj->MinMaxCacheHitIndices +
+                            (count - scanned);
+
+   if (new_hit_count >= bufferObj->MinMaxCacheHitIndices)
+      bufferObj->MinMaxCacheHitIndices = new_hit_count;
+   else
+      bufferObj->MinMaxCacheHitIndices = ~(unsigned)0;
+   bufferObj->MinMaxCacheMissIndices += scanned;
 
 out:
    simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+   return found;
 }
 
 
@@ -234,6 +394,21 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
                             const void *indices,
                             unsigned *min_index, unsigned *max_index)
 {
+#if defined(USE_AVX2)
+   if (util_get_cpu_caps()->has_avx2) {
+      _mesa_index_array_min_max_avx2(index_size, indices, count, restart,
+                                     restartIndex, min_index, max_index);
+      return;
+   }
+#endif
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      _mesa_index_array_min_max_sse41(index_size, indices, count, restart,
+                                      restartIndex, min_index, max_index);
+      return;
+   }
+#endif
+
    switch (index_size) {
    case 4: {
       const GLuint *ui_indices = (const GLuint *)indices;
@@ -248,16 +423,10 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
          }
       }
       else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
+         for (unsigned i = 0; i < count; i++) {
+            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
          }
-         else
-#endif
-            for (unsigned i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
       }
       *min_index = min_ui;
       *max_index = max_ui;
@@ -333,8 +502,9 @@ vbo_get_minmax_index(struct gl_context *ctx, struct gl_buffer_object *obj,
    } else {
       GLsizeiptr size = MIN2((GLsizeiptr)count * index_size, obj->Size);
 
-      if (vbo_get_minmax_cached(obj, index_size, offset, count, min_index,
-                                max_index))
+      if (vbo_get_minmax_cached(ctx, obj, index_size, offset, count,
+                                primitive_restart, restart_index,
+                                min_index, max_index))
          return;
 
       indices = _mesa_bufferobj_map_range(ctx, offset, size, GL_MAP_READ_BIT,
@@ -345,11 +515,8 @@ vbo_get_minmax_index(struct gl_context *ctx, struct gl_buffer_object *obj,
                                primitive_restart, indices,
                                min_index, max_index);
 
-   if (obj) {
-      vbo_minmax_cache_store(ctx, obj, index_size, offset, count, *min_index,
-                             *max_index);
+   if (obj)
       _mesa_bufferobj_unmap(ctx, obj, MAP_INTERNAL);
-   }
 }
 
 /**
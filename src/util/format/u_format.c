@@ -591,7 +591,10 @@ util_format_fits_8unorm(const struct util_format_description *format_desc)
       return FALSE;
 
    case UTIL_FORMAT_LAYOUT_ETC:
-      if (format_desc->format == PIPE_FORMAT_ETC1_RGB8)
+      if (format_desc->format == PIPE_FORMAT_ETC1_RGB8 ||
+          format_desc->format == PIPE_FORMAT_ETC2_RGB8 ||
+          format_desc->format == PIPE_FORMAT_ETC2_RGB8A1 ||
+          format_desc->format == PIPE_FORMAT_ETC2_RGBA8)
          return TRUE;
       return FALSE;
 
@@ -1,9 +1,11 @@
 #include "pipe/p_compiler.h"
 #include "util/u_debug.h"
 #include "util/u_math.h"
+#include "util/format_srgb.h"
+#include "util/format/u_format.h"
 #include "util/format/u_format_etc.h"
 
-/* define etc1_parse_block and etc. */
+/* define etc1_parse_block, etc2_rgb8_parse_block and etc. */
 #define UINT8_TYPE uint8_t
 #define TAG(x) x
 #include "../../mesa/main/texcompress_etc_tmp.h"
@@ -83,3 +85,297 @@ util_format_etc1_rgb8_fetch_rgba(void *restrict in_dst, const uint8_t *restrict
    dst[2] = ubyte_to_float(tmp[2]);
    dst[3] = 1.0f;
 }
+
+
+/*
+ * ETC2 RGB8, RGB8A1 and RGBA8, and their sRGB variants.  As for the other
+ * compressed sRGB formats, unpacking to 8unorm returns the sRGB encoded
+ * values, while unpacking to float decodes them.
+ */
+
+static void
+etc2_fetch_texel_8unorm(enum pipe_format format, const uint8_t *src,
+                        unsigned i, unsigned j, uint8_t *dst)
+{
+   struct etc2_block block;
+
+   switch (format) {
+   case PIPE_FORMAT_ETC2_RGB8:
+   case PIPE_FORMAT_ETC2_SRGB8:
+      etc2_rgb8_parse_block(&block, src, false /* punchthrough_alpha */);
+      etc2_rgb8_fetch_texel(&block, i, j, dst, false /* punchthrough_alpha */);
+      dst[3] = 255;
+      break;
+   case PIPE_FORMAT_ETC2_RGB8A1:
+   case PIPE_FORMAT_ETC2_SRGB8A1:
+      etc2_rgb8_parse_block(&block, src, true /* punchthrough_alpha */);
+      etc2_rgb8_fetch_texel(&block, i, j, dst, true /* punchthrough_alpha */);
+      break;
+   case PIPE_FORMAT_ETC2_RGBA8:
+   case PIPE_FORMAT_ETC2_SRGBA8:
+      etc2_rgba8_parse_block(&block, src);
+      etc2_rgba8_fetch_texel(&block, i, j, dst);
+      break;
+   default:
+      unreachable("not an ETC2 color format");
+   }
+}
+
+static void
+etc2_texel_to_float(const uint8_t *src, float *dst, bool srgb)
+{
+   for (unsigned c = 0; c < 3; c++) {
+      dst[c] = srgb ? util_format_srgb_8unorm_to_linear_float(src[c]) :
+                      ubyte_to_float(src[c]);
+   }
+   dst[3] = ubyte_to_float(src[3]);
+}
+
+static void
+etc2_unpack_rgba_float(enum pipe_format format,
+                       void *restrict dst_row, unsigned dst_stride,
+                       const uint8_t *restrict src_row, unsigned src_stride,
+                       unsigned width, unsigned height)
+{
+   const unsigned bw = 4, bh = 4, comps = 4;
+   const unsigned bs = util_format_get_blocksize(format);
+   const bool srgb = util_format_is_srgb(format);
+   unsigned x, y, i, j;
+
+   for (y = 0; y < height; y += bh) {
+      const uint8_t *src = src_row;
+
+      for (x = 0; x < width; x += bw) {
+         for (j = 0; j < MIN2(bh, height - y); j++) {
+            float *dst = (float *)((uint8_t *)dst_row + (y + j) * dst_stride + x * comps * 4);
+            for (i = 0; i < MIN2(bw, width - x); i++) {
+               uint8_t tmp[4];
+
+               etc2_fetch_texel_8unorm(format, src, i, j, tmp);
+               etc2_texel_to_float(tmp, dst, srgb);
+               dst += comps;
+            }
+         }
+
+         src += bs;
+      }
+
+      src_row += src_stride;
+   }
+}
+
+static void
+etc2_fetch_rgba(enum pipe_format format, float *dst, const uint8_t *src,
+                unsigned i, unsigned j)
+{
+   uint8_t tmp[4];
+
+   assert(i < 4 && j < 4); /* check i, j against 4x4 block size */
+
+   etc2_fetch_texel_8unorm(format, src, i, j, tmp);
+   etc2_texel_to_float(tmp, dst, util_format_is_srgb(format));
+}
+
+void
+util_format_etc2_rgb8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgb8(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgb8_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                       UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                       UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgb8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_RGB8, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgb8_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                      UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                      UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgb8_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_RGB8, in_dst, src, i, j);
+}
+
+void
+util_format_etc2_srgb8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgb8(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgb8_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                        UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                        UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgb8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_SRGB8, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgb8_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                       UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                       UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgb8_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_SRGB8, in_dst, src, i, j);
+}
+
+void
+util_format_etc2_rgb8a1_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgb8_punchthrough_alpha1(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgb8a1_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                         UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                         UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgb8a1_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_RGB8A1, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgb8a1_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                        UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                        UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgb8a1_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_RGB8A1, in_dst, src, i, j);
+}
+
+void
+util_format_etc2_srgb8a1_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgb8_punchthrough_alpha1(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgb8a1_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                          UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                          UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgb8a1_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_SRGB8A1, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgb8a1_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                         UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                         UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgb8a1_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_SRGB8A1, in_dst, src, i, j);
+}
+
+void
+util_format_etc2_rgba8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba8(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgba8_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                        UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                        UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgba8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_RGBA8, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_rgba8_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                       UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                       UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_rgba8_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_RGBA8, in_dst, src, i, j);
+}
+
+void
+util_format_etc2_srgba8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba8(dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgba8_pack_rgba_8unorm(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                         UNUSED const uint8_t *restrict src_row, UNUSED unsigned src_stride,
+                                         UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgba8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height)
+{
+   etc2_unpack_rgba_float(PIPE_FORMAT_ETC2_SRGBA8, dst_row, dst_stride, src_row, src_stride, width, height);
+}
+
+void
+util_format_etc2_srgba8_pack_rgba_float(UNUSED uint8_t *restrict dst_row, UNUSED unsigned dst_stride,
+                                        UNUSED const float *restrict src_row, UNUSED unsigned src_stride,
+                                        UNUSED unsigned width, UNUSED unsigned height)
+{
+   assert(0);
+}
+
+void
+util_format_etc2_srgba8_fetch_rgba(void *restrict in_dst, const uint8_t *restrict src, unsigned i, unsigned j)
+{
+   etc2_fetch_rgba(PIPE_FORMAT_ETC2_SRGBA8, in_dst, src, i, j);
+}
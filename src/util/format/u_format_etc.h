@@ -43,4 +43,94 @@ util_format_etc1_rgb8_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_st
 void
 util_format_etc1_rgb8_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
 
+void
+util_format_etc2_rgb8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
+void
+util_format_etc2_srgb8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
+void
+util_format_etc2_rgb8a1_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8a1_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8a1_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8a1_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgb8a1_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
+void
+util_format_etc2_srgb8a1_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8a1_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8a1_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8a1_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgb8a1_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
+void
+util_format_etc2_rgba8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgba8_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgba8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgba8_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_rgba8_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
+void
+util_format_etc2_srgba8_unpack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgba8_pack_rgba_8unorm(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgba8_unpack_rgba_float(void *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgba8_pack_rgba_float(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height);
+
+void
+util_format_etc2_srgba8_fetch_rgba(void *restrict dst, const uint8_t *restrict src, unsigned i, unsigned j);
+
 #endif /* U_FORMAT_ETC1_H_ */
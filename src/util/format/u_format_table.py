@@ -115,9 +115,20 @@ def has_access(format):
     ]
     if format.short_name() in noaccess_formats:
         return False
+    # Of the ETC formats, only those decoding to 8 bits per channel are
+    # implemented.
+    etc_access_formats = [
+        'etc1_rgb8',
+        'etc2_rgb8',
+        'etc2_srgb8',
+        'etc2_rgb8a1',
+        'etc2_srgb8a1',
+        'etc2_rgba8',
+        'etc2_srgba8',
+    ]
     if format.layout in ('astc', 'atc'):
         return False
-    if format.layout == 'etc' and format.short_name() != 'etc1_rgb8':
+    if format.layout == 'etc' and format.short_name() not in etc_access_formats:
         return False
     return True
 
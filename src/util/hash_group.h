@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file hash_group.h
+ *
+ * Control byte groups shared by hash_table.c and set.c.
+ *
+ * Next to the entry array, the tables keep one control byte per slot: either
+ * HASH_CTRL_EMPTY, HASH_CTRL_DELETED, or 7 bits of the key's hash for a
+ * present entry.  Slots are probed HASH_GROUP_WIDTH at a time by comparing a
+ * whole group of control bytes at once, so that entries are only touched
+ * when their hash bits match.
+ *
+ * Tables smaller than a group still allocate HASH_GROUP_WIDTH control bytes;
+ * the unused ones are set to HASH_CTRL_PAD, which matches nothing.
+ */
+
+#ifndef HASH_GROUP_H
+#define HASH_GROUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || (defined(_M_X64) && !defined(_M_ARM64EC))
+#include <emmintrin.h>
+#define HASH_GROUP_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HASH_GROUP_NEON
+#endif
+
+#define HASH_GROUP_WIDTH  16
+#define HASH_GROUP_SHIFT  4
+
+#define HASH_CTRL_EMPTY   0x80
+#define HASH_CTRL_DELETED 0xfe
+#define HASH_CTRL_PAD     0xff
+
+/** Number of control bytes to allocate for a table of \p size slots. */
+static inline uint32_t
+hash_group_ctrl_size(uint32_t size)
+{
+   return size < HASH_GROUP_WIDTH ? HASH_GROUP_WIDTH : size;
+}
+
+/**
+ * Spread the key hash so that both the group index (top bits) and the
+ * control byte (bottom bits) are usable even with weak hashes, like the
+ * identity hash used for GL object names.
+ */
+static inline uint32_t
+hash_group_mix(uint32_t hash)
+{
+   return hash * 0x9e3779b1u;
+}
+
+static inline uint8_t
+hash_group_h2(uint32_t mixed)
+{
+   return mixed & 0x7f;
+}
+
+/**
+ * Group the probe sequence starts at, for a table of 2^size_index slots.
+ */
+static inline uint32_t
+hash_group_first(uint32_t mixed, uint32_t size_index)
+{
+   if (size_index <= HASH_GROUP_SHIFT)
+      return 0;
+
+   return mixed >> (32 - (size_index - HASH_GROUP_SHIFT));
+}
+
+static inline uint32_t
+hash_group_count(uint32_t size)
+{
+   return size <= HASH_GROUP_WIDTH ? 1 : size >> HASH_GROUP_SHIFT;
+}
+
+/**
+ * Returns a mask with bit i set if ctrl[i] == value, for the
+ * HASH_GROUP_WIDTH control bytes starting at ctrl.
+ */
+static inline uint32_t
+hash_group_match(const uint8_t *ctrl, uint8_t value)
+{
+#if defined(HASH_GROUP_SSE2)
+   __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group,
+                                           _mm_set1_epi8((char)value)));
+#elif defined(HASH_GROUP_NEON)
+   static const uint8_t bits[16] = {
+      1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+   };
+   uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value)),
+                            vld1q_u8(bits));
+   return vaddv_u8(vget_low_u8(eq)) |
+          ((uint32_t)vaddv_u8(vget_high_u8(eq)) << 8);
+#else
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < HASH_GROUP_WIDTH; i++)
+      mask |= (uint32_t)(ctrl[i] == value) << i;
+   return mask;
+#endif
+}
+
+/** Mask of the empty or deleted slots in a group. */
+static inline uint32_t
+hash_group_match_available(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY) |
+          hash_group_match(ctrl, HASH_CTRL_DELETED);
+}
+
+static inline bool
+hash_ctrl_is_present(uint8_t ctrl)
+{
+   return ctrl < HASH_CTRL_EMPTY;
+}
+
+/** Marks all \p size slots as empty. */
+static inline void
+hash_ctrl_reset(uint8_t *ctrl, uint32_t size)
+{
+   memset(ctrl, HASH_CTRL_EMPTY, size);
+   if (size < HASH_GROUP_WIDTH)
+      memset(ctrl + size, HASH_CTRL_PAD, HASH_GROUP_WIDTH - size);
+}
+
+/**
+ * Largest number of entries (including deleted ones) a table of \p size
+ * slots may hold.  This always leaves an empty slot to end probing.
+ */
+static inline uint32_t
+hash_group_max_entries(uint32_t size)
+{
+   return (uint32_t)(((uint64_t)size * 7) / 8);
+}
+
+#endif /* HASH_GROUP_H */
@@ -33,9 +33,12 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table.
  *
- * For more information, see:
+ * Tables have a power-of-two number of slots, probed in groups of
+ * HASH_GROUP_WIDTH using the control bytes described in hash_group.h.
+ *
+ * For more information on the original design, see:
  *
  * http://cgit.freedesktop.org/~anholt/hash_table/tree/README
  */
@@ -48,7 +51,8 @@
 #include "ralloc.h"
 #include "macros.h"
 #include "u_memory.h"
-#include "fast_urem_by_const.h"
+#include "bitscan.h"
+#include "hash_group.h"
 #include "util/u_memory.h"
 
 #define XXH_INLINE_ALL
@@ -75,51 +79,8 @@ uint_key(unsigned id)
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
+#define MIN_SIZE_INDEX 2
+#define MAX_SIZE_INDEX 31
 
 ASSERTED static inline bool
 key_pointer_is_reserved(const struct hash_table *ht, const void *key)
@@ -127,22 +88,45 @@ key_pointer_is_reserved(const struct hash_table *ht, const void *key)
    return key == NULL || key == ht->deleted_key;
 }
 
-static int
-entry_is_free(const struct hash_entry *entry)
+static inline bool
+entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
 {
-   return entry->key == NULL;
+   return hash_ctrl_is_present(ht->ctrl[entry - ht->table]);
 }
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
+/**
+ * Allocates empty storage with 2^size_index slots for the table.
+ */
+static bool
+hash_table_alloc(struct hash_table *ht, void *mem_ctx, unsigned size_index)
 {
-   return entry->key == ht->deleted_key;
-}
+   uint32_t size = 1u << size_index;
+   struct hash_entry *table = rzalloc_array(mem_ctx, struct hash_entry, size);
+   uint8_t *ctrl;
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   if (table == NULL)
+      return false;
+
+   /* A child of the table, so that callers which free only the table, as
+    * with a NULL mem_ctx, free it too.
+    */
+   ctrl = ralloc_array(table, uint8_t, hash_group_ctrl_size(size));
+   if (ctrl == NULL) {
+      ralloc_free(table);
+      return false;
+   }
+
+   hash_ctrl_reset(ctrl, size);
+
+   ht->table = table;
+   ht->ctrl = ctrl;
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = hash_group_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+
+   return true;
 }
 
 bool
@@ -152,20 +136,11 @@ _mesa_hash_table_init(struct hash_table *ht,
                       bool (*key_equals_function)(const void *a,
                                                   const void *b))
 {
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(mem_ctx, struct hash_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
 
-   return ht->table != NULL;
+   return hash_table_alloc(ht, mem_ctx, MIN_SIZE_INDEX);
 }
 
 struct hash_table *
@@ -230,6 +205,14 @@ _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 
    memcpy(ht->table, src->table, ht->size * sizeof(struct hash_entry));
 
+   ht->ctrl = ralloc_array(ht->table, uint8_t, hash_group_ctrl_size(ht->size));
+   if (ht->ctrl == NULL) {
+      ralloc_free(ht);
+      return NULL;
+   }
+
+   memcpy(ht->ctrl, src->ctrl, hash_group_ctrl_size(ht->size));
+
    return ht;
 }
 
@@ -257,7 +240,8 @@ _mesa_hash_table_destroy(struct hash_table *ht,
 static void
 hash_table_clear_fast(struct hash_table *ht)
 {
-   memset(ht->table, 0, sizeof(struct hash_entry) * hash_sizes[ht->size_index].size);
+   memset(ht->table, 0, sizeof(struct hash_entry) * ht->size);
+   hash_ctrl_reset(ht->ctrl, ht->size);
    ht->entries = ht->deleted_entries = 0;
 }
 
@@ -283,6 +267,7 @@ _mesa_hash_table_clear(struct hash_table *ht,
 
          entry->key = NULL;
       }
+      hash_ctrl_reset(ht->ctrl, ht->size);
       ht->entries = 0;
       ht->deleted_entries = 0;
    } else
@@ -310,27 +295,30 @@ hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(ht, key));
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
+   uint32_t mixed = hash_group_mix(hash);
+   uint8_t h2 = hash_group_h2(mixed);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
 
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
+   for (uint32_t i = 1; i <= group_mask + 1; i++) {
+      const uint8_t *ctrl = ht->ctrl + (group << HASH_GROUP_SHIFT);
+      struct hash_entry *entries = ht->table + (group << HASH_GROUP_SHIFT);
+      unsigned match = hash_group_match(ctrl, h2);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+      while (match) {
+         struct hash_entry *entry = entries + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key))
             return entry;
-         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      /* The key would have been inserted in this group. */
+      if (hash_group_match(ctrl, HASH_CTRL_EMPTY))
+         return NULL;
+
+      group = (group + i) & group_mask;
+   }
 
    return NULL;
 }
@@ -364,58 +352,45 @@ static void
 hash_table_insert_rehash(struct hash_table *ht, uint32_t hash,
                          const void *key, void *data)
 {
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
+   uint32_t mixed = hash_group_mix(hash);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
+
+   for (uint32_t i = 1; ; i++) {
+      unsigned empty = hash_group_match(ht->ctrl + (group << HASH_GROUP_SHIFT),
+                                        HASH_CTRL_EMPTY);
+      if (likely(empty)) {
+         uint32_t slot = (group << HASH_GROUP_SHIFT) + ffs(empty) - 1;
+         struct hash_entry *entry = ht->table + slot;
 
-      if (likely(entry->key == NULL)) {
+         ht->ctrl[slot] = hash_group_h2(mixed);
          entry->hash = hash;
          entry->key = key;
          entry->data = data;
          return;
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (true);
+      group = (group + i) & group_mask;
+   }
 }
 
 static void
 _mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
 {
    struct hash_table old_ht;
-   struct hash_entry *table;
 
-   if (ht->size_index == new_size_index && ht->deleted_entries == ht->max_entries) {
+   if (ht->size_index == new_size_index && ht->entries == 0) {
       hash_table_clear_fast(ht);
-      assert(!ht->entries);
       return;
    }
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
-
-   table = rzalloc_array(ralloc_parent(ht->table), struct hash_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size_index > MAX_SIZE_INDEX)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!hash_table_alloc(ht, ralloc_parent(old_ht.table), new_size_index))
+      return;
 
    hash_table_foreach(&old_ht, entry) {
       hash_table_insert_rehash(ht, entry->hash, entry->key, entry->data);
@@ -440,21 +415,15 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
       _mesa_hash_table_rehash(ht, ht->size_index);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+   uint32_t mixed = hash_group_mix(hash);
+   uint8_t h2 = hash_group_h2(mixed);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
+
+   for (uint32_t i = 1; i <= group_mask + 1; i++) {
+      const uint8_t *ctrl = ht->ctrl + (group << HASH_GROUP_SHIFT);
+      struct hash_entry *entries = ht->table + (group << HASH_GROUP_SHIFT);
+      unsigned match = hash_group_match(ctrl, h2);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -467,22 +436,36 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
        * required to avoid memory leaks, perform a search
        * before inserting.
        */
-      if (!entry_is_deleted(ht, entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
+      while (match) {
+         struct hash_entry *entry = entries + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         unsigned available = hash_group_match_available(ctrl);
+         if (available)
+            available_entry = entries + ffs(available) - 1;
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      if (hash_group_match(ctrl, HASH_CTRL_EMPTY))
+         break;
+
+      group = (group + i) & group_mask;
+   }
 
    if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
+      uint32_t slot = available_entry - ht->table;
+
+      if (ht->ctrl[slot] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      ht->ctrl[slot] = h2;
       available_entry->hash = hash;
       available_entry->key = key;
       available_entry->data = data;
@@ -530,9 +513,21 @@ _mesa_hash_table_remove(struct hash_table *ht,
    if (!entry)
       return;
 
-   entry->key = ht->deleted_key;
+   uint32_t slot = entry - ht->table;
+   const uint8_t *group = ht->ctrl + (slot & ~(HASH_GROUP_WIDTH - 1));
+
+   /* If the group still has an empty slot, no probe sequence ever went past
+    * it, so the slot can be made empty rather than deleted.
+    */
+   if (hash_group_match(group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[slot] = HASH_CTRL_EMPTY;
+      entry->key = NULL;
+   } else {
+      ht->ctrl[slot] = HASH_CTRL_DELETED;
+      entry->key = ht->deleted_key;
+      ht->deleted_entries++;
+   }
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -565,6 +560,23 @@ _mesa_hash_table_next_entry_unsafe(const struct hash_table *ht, struct hash_entr
    return NULL;
 }
 
+/**
+ * Helper for hash_table_foreach_remove(): empties \p entry, which must be
+ * present, and returns the next entry.
+ */
+struct hash_entry *
+_mesa_hash_table_next_entry_remove_unsafe(struct hash_table *ht,
+                                          struct hash_entry *entry)
+{
+   ht->ctrl[entry - ht->table] = HASH_CTRL_EMPTY;
+   entry->hash = 0;
+   entry->key = NULL;
+   entry->data = NULL;
+   ht->entries--;
+
+   return _mesa_hash_table_next_entry_unsafe(ht, entry);
+}
+
 /**
  * This function is an iterator over the hash table.
  *
@@ -733,8 +745,8 @@ _mesa_hash_table_reserve(struct hash_table *ht, unsigned size)
 {
    if (size < ht->max_entries)
       return true;
-   for (unsigned i = ht->size_index + 1; i < ARRAY_SIZE(hash_sizes); i++) {
-      if (hash_sizes[i].max_entries >= size) {
+   for (unsigned i = ht->size_index + 1; i <= MAX_SIZE_INDEX; i++) {
+      if (hash_group_max_entries(1u << i) >= size) {
          _mesa_hash_table_rehash(ht, i);
          break;
       }
@@ -46,13 +46,11 @@ struct hash_entry {
 
 struct hash_table {
    struct hash_entry *table;
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    const void *deleted_key;
    uint32_t size;
-   uint32_t rehash;
-   uint64_t size_magic;
-   uint64_t rehash_magic;
    uint32_t max_entries;
    uint32_t size_index;
    uint32_t entries;
@@ -109,6 +107,9 @@ struct hash_entry *_mesa_hash_table_next_entry(struct hash_table *ht,
 struct hash_entry *_mesa_hash_table_next_entry_unsafe(const struct hash_table *ht,
                                                struct hash_entry *entry);
 struct hash_entry *
+_mesa_hash_table_next_entry_remove_unsafe(struct hash_table *ht,
+                                          struct hash_entry *entry);
+struct hash_entry *
 _mesa_hash_table_random_entry(struct hash_table *ht,
                               bool (*predicate)(struct hash_entry *entry));
 
@@ -149,8 +150,7 @@ _mesa_hash_table_reserve(struct hash_table *ht, unsigned size);
 #define hash_table_foreach_remove(ht, entry)                                      \
    for (struct hash_entry *entry = _mesa_hash_table_next_entry_unsafe(ht, NULL);  \
         (ht)->entries;                                                     \
-        entry->hash = 0, entry->key = (void*)NULL, entry->data = NULL,      \
-        (ht)->entries--, entry = _mesa_hash_table_next_entry_unsafe(ht, entry))
+        entry = _mesa_hash_table_next_entry_remove_unsafe(ht, entry))
 
 static inline void
 hash_table_call_foreach(struct hash_table *ht,
@@ -40,57 +40,14 @@
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
-#include "fast_urem_by_const.h"
-
-/*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
+#include "bitscan.h"
+#include "hash_group.h"
 
 static const uint32_t deleted_key_value;
 static const void *deleted_key = &deleted_key_value;
 
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
+#define MIN_SIZE_INDEX 2
+#define MAX_SIZE_INDEX 31
 
 ASSERTED static inline bool
 key_pointer_is_reserved(const void *key)
@@ -98,22 +55,45 @@ key_pointer_is_reserved(const void *key)
    return key == NULL || key == deleted_key;
 }
 
-static int
-entry_is_free(struct set_entry *entry)
+static inline bool
+entry_is_present(const struct set *ht, struct set_entry *entry)
 {
-   return entry->key == NULL;
+   return hash_ctrl_is_present(ht->ctrl[entry - ht->table]);
 }
 
-static int
-entry_is_deleted(struct set_entry *entry)
+/**
+ * Allocates empty storage with 2^size_index slots for the set.
+ */
+static bool
+set_alloc(struct set *ht, void *mem_ctx, unsigned size_index)
 {
-   return entry->key == deleted_key;
-}
+   uint32_t size = 1u << size_index;
+   struct set_entry *table = rzalloc_array(mem_ctx, struct set_entry, size);
+   uint8_t *ctrl;
 
-static int
-entry_is_present(struct set_entry *entry)
-{
-   return entry->key != NULL && entry->key != deleted_key;
+   if (table == NULL)
+      return false;
+
+   /* A child of the table, so that callers which free only the table, as
+    * with a NULL mem_ctx, free it too.
+    */
+   ctrl = ralloc_array(table, uint8_t, hash_group_ctrl_size(size));
+   if (ctrl == NULL) {
+      ralloc_free(table);
+      return false;
+   }
+
+   hash_ctrl_reset(ctrl, size);
+
+   ht->table = table;
+   ht->ctrl = ctrl;
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = hash_group_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+
+   return true;
 }
 
 bool
@@ -122,19 +102,10 @@ _mesa_set_init(struct set *ht, void *mem_ctx,
                  bool (*key_equals_function)(const void *a,
                                              const void *b))
 {
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(mem_ctx, struct set_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
 
-   return ht->table != NULL;
+   return set_alloc(ht, mem_ctx, MIN_SIZE_INDEX);
 }
 
 struct set *
@@ -196,6 +167,14 @@ _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 
    memcpy(clone->table, set->table, clone->size * sizeof(struct set_entry));
 
+   clone->ctrl = ralloc_array(clone->table, uint8_t, hash_group_ctrl_size(clone->size));
+   if (clone->ctrl == NULL) {
+      ralloc_free(clone);
+      return NULL;
+   }
+
+   memcpy(clone->ctrl, set->ctrl, hash_group_ctrl_size(clone->size));
+
    return clone;
 }
 
@@ -224,7 +203,8 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
 static void
 set_clear_fast(struct set *ht)
 {
-   memset(ht->table, 0, sizeof(struct set_entry) * hash_sizes[ht->size_index].size);
+   memset(ht->table, 0, sizeof(struct set_entry) * ht->size);
+   hash_ctrl_reset(ht->ctrl, ht->size);
    ht->entries = ht->deleted_entries = 0;
 }
 
@@ -244,11 +224,12 @@ _mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry
 
    if (delete_function) {
       for (entry = set->table; entry != set->table + set->size; entry++) {
-         if (entry_is_present(entry))
+         if (entry_is_present(set, entry))
             delete_function(entry);
 
          entry->key = NULL;
       }
+      hash_ctrl_reset(set->ctrl, set->size);
       set->entries = 0;
       set->deleted_entries = 0;
    } else
@@ -265,26 +246,30 @@ set_search(const struct set *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(key));
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
+   uint32_t mixed = hash_group_mix(hash);
+   uint8_t h2 = hash_group_h2(mixed);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+   for (uint32_t i = 1; i <= group_mask + 1; i++) {
+      const uint8_t *ctrl = ht->ctrl + (group << HASH_GROUP_SHIFT);
+      struct set_entry *entries = ht->table + (group << HASH_GROUP_SHIFT);
+      unsigned match = hash_group_match(ctrl, h2);
+
+      while (match) {
+         struct set_entry *entry = entries + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key))
             return entry;
-         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      /* The key would have been added to this group. */
+      if (hash_group_match(ctrl, HASH_CTRL_EMPTY))
+         return NULL;
+
+      group = (group + i) & group_mask;
+   }
 
    return NULL;
 }
@@ -308,56 +293,44 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
 static void
 set_add_rehash(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-      if (likely(entry->key == NULL)) {
+   uint32_t mixed = hash_group_mix(hash);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
+
+   for (uint32_t i = 1; ; i++) {
+      unsigned empty = hash_group_match(ht->ctrl + (group << HASH_GROUP_SHIFT),
+                                        HASH_CTRL_EMPTY);
+      if (likely(empty)) {
+         uint32_t slot = (group << HASH_GROUP_SHIFT) + ffs(empty) - 1;
+         struct set_entry *entry = ht->table + slot;
+
+         ht->ctrl[slot] = hash_group_h2(mixed);
          entry->hash = hash;
          entry->key = key;
          return;
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (true);
+      group = (group + i) & group_mask;
+   }
 }
 
 static void
 set_rehash(struct set *ht, unsigned new_size_index)
 {
    struct set old_ht;
-   struct set_entry *table;
 
-   if (ht->size_index == new_size_index && ht->deleted_entries == ht->max_entries) {
+   if (ht->size_index == new_size_index && ht->entries == 0) {
       set_clear_fast(ht);
-      assert(!ht->entries);
       return;
    }
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
-
-   table = rzalloc_array(ralloc_parent(ht->table), struct set_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size_index > MAX_SIZE_INDEX)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!set_alloc(ht, ralloc_parent(old_ht.table), new_size_index))
+      return;
 
    set_foreach(&old_ht, entry) {
       set_add_rehash(ht, entry->hash, entry->key);
@@ -375,8 +348,9 @@ _mesa_set_resize(struct set *set, uint32_t entries)
    if (set->entries > entries)
       entries = set->entries;
 
-   unsigned size_index = 0;
-   while (hash_sizes[size_index].max_entries < entries)
+   unsigned size_index = MIN_SIZE_INDEX;
+   while (size_index < MAX_SIZE_INDEX &&
+          hash_group_max_entries(1u << size_index) < entries)
       size_index++;
 
    set_rehash(set, size_index);
@@ -402,39 +376,47 @@ set_search_or_add(struct set *ht, uint32_t hash, const void *key, bool *found)
       set_rehash(ht, ht->size_index);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
+   uint32_t mixed = hash_group_mix(hash);
+   uint8_t h2 = hash_group_h2(mixed);
+   uint32_t group_mask = hash_group_count(ht->size) - 1;
+   uint32_t group = hash_group_first(mixed, ht->size_index);
+
+   for (uint32_t i = 1; i <= group_mask + 1; i++) {
+      const uint8_t *ctrl = ht->ctrl + (group << HASH_GROUP_SHIFT);
+      struct set_entry *entries = ht->table + (group << HASH_GROUP_SHIFT);
+      unsigned match = hash_group_match(ctrl, h2);
+
+      while (match) {
+         struct set_entry *entry = entries + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            if (found)
+               *found = true;
+            return entry;
+         }
       }
 
-      if (!entry_is_deleted(entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         if (found)
-            *found = true;
-         return entry;
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         unsigned available = hash_group_match_available(ctrl);
+         if (available)
+            available_entry = entries + ffs(available) - 1;
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      if (hash_group_match(ctrl, HASH_CTRL_EMPTY))
+         break;
+
+      group = (group + i) & group_mask;
+   }
 
    if (available_entry) {
       /* There is no matching entry, create it. */
-      if (entry_is_deleted(available_entry))
+      uint32_t slot = available_entry - ht->table;
+
+      if (ht->ctrl[slot] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      ht->ctrl[slot] = h2;
       available_entry->hash = hash;
       available_entry->key = key;
       ht->entries++;
@@ -546,9 +528,21 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
    if (!entry)
       return;
 
-   entry->key = deleted_key;
+   uint32_t slot = entry - ht->table;
+   const uint8_t *group = ht->ctrl + (slot & ~(HASH_GROUP_WIDTH - 1));
+
+   /* If the group still has an empty slot, no probe sequence ever went past
+    * it, so the slot can be made empty rather than deleted.
+    */
+   if (hash_group_match(group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[slot] = HASH_CTRL_EMPTY;
+      entry->key = NULL;
+   } else {
+      ht->ctrl[slot] = HASH_CTRL_DELETED;
+      entry->key = deleted_key;
+      ht->deleted_entries++;
+   }
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -581,6 +575,21 @@ _mesa_set_next_entry_unsafe(const struct set *ht, struct set_entry *entry)
    return NULL;
 }
 
+/**
+ * Helper for set_foreach_remove(): empties \p entry, which must be present,
+ * and returns the next entry.
+ */
+struct set_entry *
+_mesa_set_next_entry_remove_unsafe(struct set *ht, struct set_entry *entry)
+{
+   ht->ctrl[entry - ht->table] = HASH_CTRL_EMPTY;
+   entry->hash = 0;
+   entry->key = NULL;
+   ht->entries--;
+
+   return _mesa_set_next_entry_unsafe(ht, entry);
+}
+
 /**
  * This function is an iterator over the hash table.
  *
@@ -596,7 +605,7 @@ _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
       entry = entry + 1;
 
    for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
+      if (entry_is_present(ht, entry)) {
          return entry;
       }
    }
@@ -615,14 +624,14 @@ _mesa_set_random_entry(struct set *ht,
       return NULL;
 
    for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
+      if (entry_is_present(ht, entry) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
    }
 
    for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
+      if (entry_is_present(ht, entry) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
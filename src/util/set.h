@@ -43,12 +43,10 @@ struct set_entry {
 struct set {
    void *mem_ctx;
    struct set_entry *table;
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    uint32_t size;
-   uint32_t rehash;
-   uint64_t size_magic;
-   uint64_t rehash_magic;
    uint32_t max_entries;
    uint32_t size_index;
    uint32_t entries;
@@ -113,6 +111,8 @@ struct set_entry *
 _mesa_set_next_entry(const struct set *set, struct set_entry *entry);
 struct set_entry *
 _mesa_set_next_entry_unsafe(const struct set *set, struct set_entry *entry);
+struct set_entry *
+_mesa_set_next_entry_remove_unsafe(struct set *set, struct set_entry *entry);
 
 struct set_entry *
 _mesa_set_random_entry(struct set *set,
@@ -141,7 +141,7 @@ _mesa_set_intersects(struct set *a, struct set *b);
 #define set_foreach_remove(set, entry)                              \
    for (struct set_entry *entry = _mesa_set_next_entry_unsafe(set, NULL);  \
         (set)->entries;                                              \
-        entry->hash = 0, entry->key = (void*)NULL, (set)->entries--, entry = _mesa_set_next_entry_unsafe(set, entry))
+        entry = _mesa_set_next_entry_remove_unsafe(set, entry))
 
 #ifdef __cplusplus
 } /* extern C */
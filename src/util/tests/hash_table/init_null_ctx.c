@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A table embedded in another struct and initialized without a ralloc
+ * context is freed by freeing only its table, as zink does.  Everything
+ * else the table allocates must go with it, also after it has grown.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdint.h>
+#include "hash_table.h"
+#include "ralloc.h"
+
+int
+main(int argc, char **argv)
+{
+   struct hash_table ht;
+   uintptr_t i;
+
+   (void) argc;
+   (void) argv;
+
+   if (!_mesa_hash_table_init(&ht, NULL, _mesa_hash_pointer,
+                              _mesa_key_pointer_equal))
+      return 1;
+
+   assert(ralloc_parent(ht.ctrl) == ht.table);
+
+   for (i = 1; i <= 1000; i++)
+      _mesa_hash_table_insert(&ht, (void *)i, (void *)i);
+
+   assert(ht.entries == 1000);
+   assert(ralloc_parent(ht.ctrl) == ht.table);
+
+   ralloc_free(ht.table);
+
+   return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Times insert/search/remove on pointer-keyed tables and sets, the way NIR
+ * passes and the GLSL linker use them, while checking the results.
+ *
+ * The numbers are printed for comparing hash table changes; they are not
+ * checked.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include "hash_table.h"
+#include "set.h"
+#include "os_time.h"
+
+#define SIZE 200000
+#define ROUNDS 4
+
+static void
+report(const char *what, int64_t start, unsigned ops)
+{
+   int64_t ns = os_time_get_nano() - start;
+
+   printf("%-24s %8.2f Mops/s\n", what, ops * 1000.0 / (ns ? ns : 1));
+}
+
+static void
+hash_table_throughput(void **keys)
+{
+   struct hash_table *ht = _mesa_pointer_hash_table_create(NULL);
+   int64_t start;
+   unsigned i, r;
+
+   start = os_time_get_nano();
+   for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SIZE; i++)
+         _mesa_hash_table_insert(ht, keys[i], keys[i]);
+   }
+   report("hash_table insert", start, ROUNDS * SIZE);
+   assert(ht->entries == SIZE);
+
+   start = os_time_get_nano();
+   for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SIZE; i++) {
+         struct hash_entry *entry = _mesa_hash_table_search(ht, keys[i]);
+         assert(entry && entry->data == keys[i]);
+      }
+   }
+   report("hash_table search hit", start, ROUNDS * SIZE);
+
+   start = os_time_get_nano();
+   for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SIZE; i++) {
+         /* Odd addresses are never used as keys below. */
+         assert(!_mesa_hash_table_search(ht, (char *)keys[i] + 1));
+      }
+   }
+   report("hash_table search miss", start, ROUNDS * SIZE);
+
+   start = os_time_get_nano();
+   for (i = 0; i < SIZE; i += 2)
+      _mesa_hash_table_remove_key(ht, keys[i]);
+   for (i = 0; i < SIZE; i += 2)
+      _mesa_hash_table_insert(ht, keys[i], NULL);
+   for (i = 1; i < SIZE; i += 2)
+      _mesa_hash_table_remove_key(ht, keys[i]);
+   report("hash_table remove/insert", start, SIZE + SIZE / 2);
+
+   assert(ht->entries == SIZE / 2);
+   for (i = 0; i < SIZE; i++) {
+      struct hash_entry *entry = _mesa_hash_table_search(ht, keys[i]);
+      assert((i & 1) ? entry == NULL : entry && entry->data == NULL);
+   }
+
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+static void
+set_throughput(void **keys)
+{
+   struct set *s = _mesa_pointer_set_create(NULL);
+   int64_t start;
+   unsigned i, r;
+
+   start = os_time_get_nano();
+   for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SIZE; i++)
+         _mesa_set_add(s, keys[i]);
+   }
+   report("set add", start, ROUNDS * SIZE);
+   assert(s->entries == SIZE);
+
+   start = os_time_get_nano();
+   for (r = 0; r < ROUNDS; r++) {
+      for (i = 0; i < SIZE; i++)
+         assert(_mesa_set_search(s, keys[i]));
+   }
+   report("set search", start, ROUNDS * SIZE);
+
+   start = os_time_get_nano();
+   for (i = 0; i < SIZE; i++)
+      _mesa_set_remove_key(s, keys[i]);
+   report("set remove", start, SIZE);
+
+   assert(s->entries == 0);
+   for (i = 0; i < SIZE; i++)
+      assert(!_mesa_set_search(s, keys[i]));
+
+   _mesa_set_destroy(s, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   void **keys = malloc(SIZE * sizeof(*keys));
+   unsigned i;
+
+   (void) argc;
+   (void) argv;
+
+   /* Heap pointers have the low-bit patterns real pointer keys have. */
+   for (i = 0; i < SIZE; i++)
+      keys[i] = malloc(16);
+
+   hash_table_throughput(keys);
+   set_throughput(keys);
+
+   for (i = 0; i < SIZE; i++)
+      free(keys[i]);
+   free(keys);
+
+   return 0;
+}
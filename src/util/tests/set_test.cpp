@@ -23,6 +23,7 @@
 
 #include <gtest/gtest.h>
 #include "util/hash_table.h"
+#include "util/ralloc.h"
 #include "util/set.h"
 
 TEST(set, basic)
@@ -135,6 +136,26 @@ TEST(set, remove_key)
    _mesa_set_destroy(s, NULL);
 }
 
+/* Sets embedded in another struct without a ralloc context are freed by
+ * freeing only their table.
+ */
+TEST(set, init_null_ctx)
+{
+   struct set s;
+
+   ASSERT_TRUE(_mesa_set_init(&s, NULL, _mesa_hash_pointer,
+                              _mesa_key_pointer_equal));
+   EXPECT_EQ(ralloc_parent(s.ctrl), s.table);
+
+   for (uintptr_t i = 1; i <= 1000; i++)
+      _mesa_set_add(&s, (const void *)i);
+
+   EXPECT_EQ(s.entries, 1000);
+   EXPECT_EQ(ralloc_parent(s.ctrl), s.table);
+
+   ralloc_free(s.table);
+}
+
 static uint32_t hash_int(const void *p)
 {
    int i = *(const int *)p;